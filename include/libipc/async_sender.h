@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <string>
+
+#include "libipc/export.h"
+#include "libipc/def.h"
+#include "libipc/buffer.h"
+#include "libipc/ipc.h"
+
+namespace ipc {
+
+/**
+ * \brief Sends through a channel from a background thread, so that the callers never wait for the ring.
+ *
+ * 'send' copies the message into a process-local lock-free queue (of the mem allocators) and returns,
+ * a flusher thread drains the queue into the ring in batches, with the usual 'send' of the channel
+ * (its overflow policy & the timeout of the options). The messages keep the order in which
+ * they have been queued, and each one could have a callback (or a future) of its result.
+ * The queue is bounded by 'memory_limit' bytes, beyond it 'send' fails at once.
+ *
+ *  ipc::async_sender as {ch};
+ *  as.send(data, size);                                  // never waits
+ *  as.send(data, size, [](bool sent) { ... });           // called by the flusher thread
+ *  std::future<bool> f = as.send_future(data, size);
+ *  as.flush();                                           // all of the above have been sent (or failed)
+ *
+ * The channel is only sent to by the flusher while the async_sender lives, and must outlive it.
+*/
+class IPC_EXPORT async_sender {
+    async_sender(async_sender const &) = delete;
+    async_sender &operator=(async_sender const &) = delete;
+
+public:
+    using send_fn    = bool (*)(ipc::handle_t, void const *, std::size_t, std::uint64_t);
+    using callback_t = std::function<void(bool sent)>;
+
+    struct options {
+        std::size_t   memory_limit = 16 * 1024 * 1024; // bytes of the queued messages
+        std::uint64_t timeout      = default_timeout;  // of each send of the flusher
+        std::size_t   batch        = 64;               // messages sent before the flush waiters are told
+    };
+
+    struct counters {
+        std::uint64_t queued;       // messages waiting in the queue
+        std::uint64_t queued_bytes;
+        std::uint64_t sent;
+        std::uint64_t failed;       // which 'send' of the channel has failed
+        std::uint64_t rejected;     // which haven't been queued, beyond the memory limit
+    };
+
+    template <typename Flag, typename Hooks>
+    explicit async_sender(chan_wrapper<Flag, Hooks> & ch, options const & opt = {})
+        : async_sender(ch.handle(), &chan_impl<Flag>::send, opt) {}
+
+    async_sender(ipc::handle_t h, send_fn send, options const & opt);
+
+    /// \brief Sends what has been queued, then stops the flusher.
+    ~async_sender();
+
+    /// \brief False if it isn't queued (an empty message, or beyond the memory limit), 'cb' isn't called then.
+    bool send(void const * data, std::size_t size, callback_t cb = {});
+
+    /// \brief The future is false if it's been rejected, or has failed.
+    std::future<bool> send_future(void const * data, std::size_t size);
+
+    bool send(buff_t const & buff, callback_t cb = {}) {
+        return this->send(buff.data(), buff.size(), std::move(cb));
+    }
+
+    bool send(std::string const & str, callback_t cb = {}) {
+        return this->send(str.c_str(), str.size() + 1, std::move(cb));
+    }
+
+    /**
+     * \brief Waits until the messages which have been queued (by any thread) before the call
+     * are out of the queue, false on timeout.
+    */
+    bool flush(std::uint64_t tm = invalid_value);
+
+    counters stats() const noexcept;
+
+private:
+    class async_sender_;
+    async_sender_* p_;
+};
+
+} // namespace ipc
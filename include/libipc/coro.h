@@ -0,0 +1,194 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "libipc/def.h"
+#include "libipc/buffer.h"
+#include "libipc/ipc.h"
+#include "libipc/reactor.h"
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#   if __has_include(<coroutine>)
+#       include <coroutine>
+#       define LIBIPC_COROUTINES 1
+#   endif
+#endif
+#if !defined(LIBIPC_COROUTINES)
+#   define LIBIPC_COROUTINES 0
+#endif
+
+/**
+ * The awaitable versions of recv & send, over an ipc::reactor:
+ *
+ *  ipc::reactor r {executor};   // anything with post(std::function<void()>)
+ *  ...
+ *  ipc::buff_t buf = co_await ipc::async_recv(r, ch);
+ *  bool ok = co_await ipc::async_send(r, ch, data, size);
+ *
+ * A coroutine which finds the ring empty (or full) is suspended, and resumed by the executor
+ * once the reactor has seen it may go on, so no thread sleeps in recv or send for it.
+ * Both return at once if they could, like try_recv/try_send, and fail (an empty buffer, false)
+ * once 'tm' has passed, with the same defaults as recv & send.
+ *
+ * Without C++20 coroutines (LIBIPC_COROUTINES == 0) they are the blocking recv & send,
+ * which return the results directly, so the same code could at least be built as plain calls.
+*/
+
+namespace ipc {
+namespace detail {
+
+class async_deadline {
+    using clock_t = std::chrono::steady_clock;
+
+    clock_t::time_point deadline_;
+    bool                forever_;
+
+public:
+    explicit async_deadline(std::uint64_t tm) noexcept
+        : deadline_{(tm == invalid_value) ? clock_t::time_point{} : (clock_t::now() + std::chrono::milliseconds(tm))}
+        , forever_ {tm == invalid_value} {}
+
+    std::uint64_t remain() const noexcept {
+        if (forever_) return invalid_value;
+        auto now = clock_t::now();
+        if (now >= deadline_) return 0;
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                          deadline_ - now + std::chrono::microseconds(999)).count());
+    }
+};
+
+#if LIBIPC_COROUTINES
+
+template <typename Flag, typename Hooks>
+class recv_awaiter {
+    reactor &                   r_;
+    chan_wrapper<Flag, Hooks> & ch_;
+    async_deadline              deadline_;
+    buff_t                      buf_;
+    std::coroutine_handle<>     co_;
+
+    bool wait() {
+        return r_.when_readable(ch_, deadline_.remain(), [this](bool ready) { on_ready(ready); });
+    }
+
+    void on_ready(bool ready) {
+        if (ready) {
+            buf_ = r_.try_recv(ch_);
+            // someone else has got it, wait for the next one
+            if (buf_.empty() && (deadline_.remain() != 0) && wait()) return;
+        }
+        co_.resume();
+    }
+
+public:
+    recv_awaiter(reactor & r, chan_wrapper<Flag, Hooks> & ch, std::uint64_t tm)
+        : r_{r}, ch_{ch}, deadline_{tm} {}
+
+    bool await_ready() {
+        buf_ = r_.try_recv(ch_);
+        return !buf_.empty() || (deadline_.remain() == 0);
+    }
+
+    bool await_suspend(std::coroutine_handle<> co) {
+        co_ = co;
+        // it may be resumed on another thread before this returns, 'this' mustn't be touched after
+        return wait();
+    }
+
+    buff_t await_resume() {
+        return std::move(buf_);
+    }
+};
+
+template <typename Flag, typename Hooks>
+class send_awaiter {
+    reactor &                   r_;
+    chan_wrapper<Flag, Hooks> & ch_;
+    void const *                data_;
+    std::size_t                 size_;
+    async_deadline              deadline_;
+    bool                        sent_ = false;
+    std::coroutine_handle<>     co_;
+
+    bool wait() {
+        return r_.when_writable(ch_, deadline_.remain(), [this](bool ready) { on_ready(ready); });
+    }
+
+    void on_ready(bool ready) {
+        if (ready) {
+            sent_ = ch_.try_send(data_, size_, 0);
+            // someone else has taken the room, wait for the next pop
+            if (!sent_ && (deadline_.remain() != 0) && wait()) return;
+        }
+        co_.resume();
+    }
+
+public:
+    send_awaiter(reactor & r, chan_wrapper<Flag, Hooks> & ch, void const * data, std::size_t size, std::uint64_t tm)
+        : r_{r}, ch_{ch}, data_{data}, size_{size}, deadline_{tm} {}
+
+    bool await_ready() {
+        sent_ = ch_.try_send(data_, size_, 0);
+        return sent_ || (deadline_.remain() == 0);
+    }
+
+    bool await_suspend(std::coroutine_handle<> co) {
+        co_ = co;
+        // it may be resumed on another thread before this returns, 'this' mustn't be touched after
+        return wait();
+    }
+
+    bool await_resume() const noexcept {
+        return sent_;
+    }
+};
+
+#endif/*LIBIPC_COROUTINES*/
+
+} // namespace detail
+
+#if LIBIPC_COROUTINES
+
+template <typename Flag, typename Hooks>
+detail::recv_awaiter<Flag, Hooks> async_recv(reactor & r, chan_wrapper<Flag, Hooks> & ch,
+                                             std::uint64_t tm = invalid_value) {
+    return {r, ch, tm};
+}
+
+/// \brief 'data' must stay valid until the coroutine is resumed.
+template <typename Flag, typename Hooks>
+detail::send_awaiter<Flag, Hooks> async_send(reactor & r, chan_wrapper<Flag, Hooks> & ch,
+                                             void const * data, std::size_t size,
+                                             std::uint64_t tm = default_timeout) {
+    return {r, ch, data, size, tm};
+}
+
+#else /*!LIBIPC_COROUTINES*/
+
+template <typename Flag, typename Hooks>
+buff_t async_recv(reactor &, chan_wrapper<Flag, Hooks> & ch, std::uint64_t tm = invalid_value) {
+    return ch.recv(tm);
+}
+
+template <typename Flag, typename Hooks>
+bool async_send(reactor &, chan_wrapper<Flag, Hooks> & ch, void const * data, std::size_t size,
+                std::uint64_t tm = default_timeout) {
+    return ch.send(data, size, tm);
+}
+
+#endif/*!LIBIPC_COROUTINES*/
+
+template <typename Flag, typename Hooks>
+auto async_send(reactor & r, chan_wrapper<Flag, Hooks> & ch, buff_t const & buff, std::uint64_t tm = default_timeout) {
+    return async_send(r, ch, buff.data(), buff.size(), tm);
+}
+
+template <typename Flag, typename Hooks>
+auto async_send(reactor & r, chan_wrapper<Flag, Hooks> & ch, std::string const & str, std::uint64_t tm = default_timeout) {
+    return async_send(r, ch, str.c_str(), str.size() + 1, tm);
+}
+
+} // namespace ipc
@@ -35,6 +35,7 @@ enum : std::size_t {
     large_msg_limit = data_length,
     large_msg_align = 1024,
     large_msg_cache = 32,
+    default_spill_limit = 4 * 1024 * 1024,
 };
 
 enum class relat { // multiplicity of the relationship
@@ -44,7 +45,43 @@ enum class relat { // multiplicity of the relationship
 
 enum class trans { // transmission
     unicast,
-    broadcast
+    broadcast,
+    overwrite   // lossy broadcast, the newest message overwrites the oldest one
+};
+
+enum class overflow { // what a sender does when the ring is full
+    disconnect, // wait for the timeout, then disconnect the slow receivers (default)
+    block,      // wait until there is room, ignoring the timeout
+    drop,       // drop the newest message, 'send' still succeeds
+    reject,     // fail at once, with a hint of how long to back off
+    spill       // park the message in a process-local queue, drained by a background thread
+};
+
+struct overflow_stats {
+    std::uint64_t full;         // pushes which found the ring full
+    std::uint64_t blocked;      // messages which have waited for room (block)
+    std::uint64_t dropped;      // messages which have been dropped (drop, or discarded from the spill queue)
+    std::uint64_t rejected;     // messages which have been rejected (reject, or the spill queue is full)
+    std::uint64_t disconnected; // force_push calls, which disconnect the slow receivers
+    std::uint64_t spilled;      // messages which have been parked in the spill queue
+    std::uint64_t spill_depth;  // messages still waiting in the spill queue
+    std::uint64_t backoff_hint; // us, how long to back off after a rejection
+};
+
+struct lag_stats {
+    std::size_t messages; // unread messages, all the fragments of a message count as one
+    std::size_t bytes;    // the payload of the unread messages
+    std::size_t slots;    // unread slots of the ring
+};
+
+// send->recv latency of the stamped messages, in nanoseconds
+struct latency_stats {
+    std::uint64_t count;
+    std::uint64_t mean;
+    std::uint64_t p50;
+    std::uint64_t p99;
+    std::uint64_t p999;
+    std::uint64_t max;
 };
 
 // producer-consumer policy flag
@@ -60,7 +97,8 @@ template <relat Rp, relat Rc, trans Ts>
 struct relat_trait<wr<Rp, Rc, Ts>> {
     constexpr static bool is_multi_producer = (Rp == relat::multi);
     constexpr static bool is_multi_consumer = (Rc == relat::multi);
-    constexpr static bool is_broadcast      = (Ts == trans::broadcast);
+    constexpr static bool is_broadcast      = (Ts != trans::unicast);
+    constexpr static bool is_lossy          = (Ts == trans::overwrite);
 };
 
 // ȥģװ
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "libipc/export.h"
+#include "libipc/def.h"
+#include "libipc/buffer.h"
+#include "libipc/ipc.h"
+#include "libipc/select.h"
+
+namespace ipc {
+
+/**
+ * \brief Owns the receive loop of some channels, and runs their messages on a pool of workers.
+ *
+ * The messages start with a dispatcher::header (see dispatcher::send), which carries the type
+ * of the message, routed to the handler registered for it by 'on', and a key.
+ * The messages with the same key are handled one after another, in the order they have been received,
+ * while those with different keys run in parallel:
+ *
+ *  ipc::dispatcher d;
+ *  d.on(1, [](ipc::dispatcher::message const & m) { ... });
+ *  d.add(ch);       // a connected receiver
+ *  d.start();
+ *  ...
+ *  ipc::dispatcher::send(ch, 1, order_id, data, size); // from a sender
+ *
+ * One thread receives from all the channels (through an ipc::select), a batch at a time,
+ * and queues each message on the strand of its key. The strands are scheduled on
+ * lock-free work-stealing queues, a worker only runs one strand at a time,
+ * and puts it back after 'batch' messages so that a busy key can't starve the others.
+ * When a strand is full the receive loop waits for it, and the channels fill up behind it.
+ *
+ * The handlers must be registered, and the channels added, before 'start'.
+ * The channels must outlive the dispatcher, or its 'stop'.
+*/
+class IPC_EXPORT dispatcher {
+    dispatcher(dispatcher const &) = delete;
+    dispatcher &operator=(dispatcher const &) = delete;
+
+public:
+    struct header {
+        std::uint32_t type;
+        std::uint32_t reserved;
+        std::uint64_t key;
+    };
+
+    struct message {
+        std::uint32_t type;
+        std::uint64_t key;
+        void const *  data;    // after the header
+        std::size_t   size;
+        std::size_t   channel; // the index returned by 'add'
+    };
+
+    using handler_t = std::function<void(message const &)>;
+
+    struct handler_stats {
+        std::uint64_t received;  // messages routed to the handler
+        std::uint64_t handled;   // which it has returned from
+        std::uint64_t depth;     // received - handled: queued, or being handled
+        std::uint64_t max_depth;
+        latency_stats wait;      // received -> handler called, in ns
+        latency_stats run;       // in the handler, in ns
+    };
+
+    struct options {
+        std::size_t workers = 0;  // 0: the hardware threads
+        std::size_t strands = 0;  // 0: 16 for each worker
+        std::size_t batch   = 64; // messages received, or run on a strand, in a row
+    };
+
+    enum : std::uint64_t {
+        no_key = ~std::uint64_t(0) // not ordered with anything, spread over the strands
+    };
+
+    dispatcher();
+    explicit dispatcher(options const & opt);
+
+    /// \brief Stops it, see 'stop'.
+    ~dispatcher();
+
+    /// \brief Registers the handler of a type (replacing the previous one), false once started.
+    bool on(std::uint32_t type, handler_t handler);
+
+    /// \brief The handler of the types which have none, otherwise those messages are dropped.
+    bool on_unknown(handler_t handler);
+
+    /// \brief Adds a channel to receive from, returns its index, or invalid_value (also once started).
+    template <typename Flag, typename Hooks>
+    std::size_t add(chan_wrapper<Flag, Hooks> & ch) {
+        return add(ch.handle(), &chan_impl<Flag>::select_attach,
+                                &chan_impl<Flag>::select_detach,
+                                &chan_impl<Flag>::try_recv);
+    }
+
+    std::size_t add(ipc::handle_t h, select::attach_fn attach, select::detach_fn detach, select::recv_fn try_recv);
+
+    bool start();
+
+    /// \brief Stops receiving, and returns once the messages already received have been handled.
+    void stop();
+
+    handler_stats stats(std::uint32_t type) const;
+
+    /// \brief The messages without a header, or without a handler.
+    std::uint64_t dropped() const noexcept;
+
+    /// \brief Sends 'data' behind a header, for a dispatcher on the other side.
+    template <typename Flag, typename Hooks>
+    static bool send(chan_wrapper<Flag, Hooks> & ch, std::uint32_t type, std::uint64_t key,
+                     void const * data, std::size_t size, std::uint64_t tm = default_timeout) {
+        std::vector<byte_t> buf(sizeof(header) + size);
+        header hd {type, 0, key};
+        std::memcpy(buf.data(), &hd, sizeof(hd));
+        if (size != 0) std::memcpy(buf.data() + sizeof(hd), data, size);
+        return ch.send(buf.data(), buf.size(), tm);
+    }
+
+private:
+    class dispatcher_;
+    dispatcher_* p_;
+};
+
+} // namespace ipc
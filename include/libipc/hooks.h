@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+/**
+ * The hook policy of chan_wrapper (its second template parameter).
+ * A policy is a class with any of these static functions, the missing ones cost nothing:
+ *
+ *  struct my_hooks {
+ *      static void on_push      (ipc::hook_info const &);
+ *      static void on_pop       (ipc::hook_info const &);
+ *      static void on_full      (ipc::hook_info const &);
+ *      static void on_force_push(ipc::hook_info const &);
+ *      static void on_reassembly(ipc::hook_info const &);
+ *      static void on_park      (ipc::hook_info const &);
+ *      static void on_wake      (ipc::hook_info const &);
+ *  };
+ *
+ * The events happen inside the library, so the wrapper hands it one dispatching function
+ * and a mask of the hooks the policy has; an event without a hook is a single branch.
+ * Each event also has a USDT probe (libipc:push, libipc:pop, ...) with the same arguments,
+ * see LIBIPC_ENABLE_USDT.
+*/
+
+namespace ipc {
+
+enum class hook_event : unsigned {
+    push,       // a fragment has been pushed into the ring
+    pop,        // a fragment has been popped from the ring
+    full,       // a push has found the ring full
+    force_push, // the slow receivers are going to be disconnected
+    reassembly, // a message has been put together from its fragments
+    park,       // going to wait on the waiter
+    wake        // back from the waiter
+};
+
+struct hook_info {
+    char const *  channel;
+    std::uint32_t msg_id; // 0 for park & wake
+    std::int64_t  value;  // remain of the fragment (push/pop/full/force_push), message size (reassembly),
+                          // whether the wait succeeded (wake)
+};
+
+using hook_fn = void (*)(hook_event, hook_info const &);
+
+constexpr unsigned hook_bit(hook_event e) noexcept {
+    return 1u << static_cast<unsigned>(e);
+}
+
+// The default hook policy, hooks nothing.
+struct no_hooks {};
+
+namespace detail {
+
+template <template <typename> class Op, typename H, typename = void>
+struct has_hook : std::false_type {};
+
+template <template <typename> class Op, typename H>
+struct has_hook<Op, H, std::void_t<Op<H>>> : std::true_type {};
+
+template <typename H> using on_push_t       = decltype(H::on_push      (std::declval<hook_info const &>()));
+template <typename H> using on_pop_t        = decltype(H::on_pop       (std::declval<hook_info const &>()));
+template <typename H> using on_full_t       = decltype(H::on_full      (std::declval<hook_info const &>()));
+template <typename H> using on_force_push_t = decltype(H::on_force_push(std::declval<hook_info const &>()));
+template <typename H> using on_reassembly_t = decltype(H::on_reassembly(std::declval<hook_info const &>()));
+template <typename H> using on_park_t       = decltype(H::on_park      (std::declval<hook_info const &>()));
+template <typename H> using on_wake_t       = decltype(H::on_wake      (std::declval<hook_info const &>()));
+
+template <typename H>
+struct hook_dispatch {
+    static constexpr unsigned mask =
+          (has_hook<on_push_t      , H>::value ? hook_bit(hook_event::push      ) : 0)
+        | (has_hook<on_pop_t       , H>::value ? hook_bit(hook_event::pop       ) : 0)
+        | (has_hook<on_full_t      , H>::value ? hook_bit(hook_event::full      ) : 0)
+        | (has_hook<on_force_push_t, H>::value ? hook_bit(hook_event::force_push) : 0)
+        | (has_hook<on_reassembly_t, H>::value ? hook_bit(hook_event::reassembly) : 0)
+        | (has_hook<on_park_t      , H>::value ? hook_bit(hook_event::park      ) : 0)
+        | (has_hook<on_wake_t      , H>::value ? hook_bit(hook_event::wake      ) : 0);
+
+    static void call(hook_event e, hook_info const & info) {
+        switch (e) {
+        case hook_event::push:
+            if constexpr (has_hook<on_push_t, H>::value) H::on_push(info);
+            break;
+        case hook_event::pop:
+            if constexpr (has_hook<on_pop_t, H>::value) H::on_pop(info);
+            break;
+        case hook_event::full:
+            if constexpr (has_hook<on_full_t, H>::value) H::on_full(info);
+            break;
+        case hook_event::force_push:
+            if constexpr (has_hook<on_force_push_t, H>::value) H::on_force_push(info);
+            break;
+        case hook_event::reassembly:
+            if constexpr (has_hook<on_reassembly_t, H>::value) H::on_reassembly(info);
+            break;
+        case hook_event::park:
+            if constexpr (has_hook<on_park_t, H>::value) H::on_park(info);
+            break;
+        case hook_event::wake:
+            if constexpr (has_hook<on_wake_t, H>::value) H::on_wake(info);
+            break;
+        default:
+            break;
+        }
+    }
+};
+
+} // namespace detail
+} // namespace ipc
@@ -6,15 +6,37 @@
 #include "libipc/def.h"
 #include "libipc/buffer.h"
 #include "libipc/shm.h"
+#include "libipc/stats.h"
+#include "libipc/hooks.h"
 
 namespace ipc {
 
 using handle_t = void*;
 using buff_t   = buffer;
 
+/**
+ * The mode flags of a connection.
+ * 'inproc' (or a name starting with "inproc://") connects through the in-process transport:
+ * the channel only lives in this process, no shared memory is named nor mapped,
+ * and the messages are handed over to the receivers without being copied.
+ * The stats, the timestamps, the ready fd, NUMA & the hooks are of the shared memory transport only.
+*/
 enum : unsigned {
     sender,
-    receiver
+    receiver,
+    inproc = 2
+};
+
+/**
+ * The calls of a connection which has been checked once by chan_impl::prepare,
+ * see ipc::prepared_sender & ipc::prepared_receiver. 'ctx' is passed back to them as it is.
+ * Only the calls of the prepared side (sending or receiving) are set.
+*/
+struct prepared_ops {
+    void * ctx;
+    bool   (*send)    (void * ctx, void const * data, std::size_t size, std::uint64_t tm);
+    bool   (*try_send)(void * ctx, void const * data, std::size_t size, std::uint64_t tm);
+    buff_t (*recv)    (void * ctx, std::uint64_t tm);
 };
 
 template <typename Flag>
@@ -41,16 +63,54 @@ struct IPC_EXPORT chan_impl {
     static bool        wait_for_recv(ipc::handle_t h, std::size_t r_count, std::uint64_t tm);
 
     static bool   send(ipc::handle_t h, void const * data, std::size_t size, std::uint64_t tm);
+    static bool   send(ipc::handle_t h, buff_t && buff, std::uint64_t tm);
     static buff_t recv(ipc::handle_t h, std::uint64_t tm);
 
     static bool   try_send(ipc::handle_t h, void const * data, std::size_t size, std::uint64_t tm);
     static buff_t try_recv(ipc::handle_t h);
+
+    static lag_stats     lag       (ipc::handle_t h);
+    static std::size_t   skip      (ipc::handle_t h, std::size_t n);
+    static std::uint64_t lost_count(ipc::handle_t h);
+
+    static stats::channel const * stats(ipc::handle_t h);
+
+    static bool          set_timestamps(ipc::handle_t h, bool enabled);
+    static latency_stats latency       (ipc::handle_t h);
+
+    static void           set_overflow     (ipc::handle_t h, overflow policy, std::size_t spill_limit);
+    static overflow_stats overflow_counters(ipc::handle_t h);
+
+    static int ready_fd(ipc::handle_t h);
+
+    // Used by ipc::select.
+    static bool select_attach(ipc::handle_t h, std::uint64_t token);
+    static void select_detach(ipc::handle_t h);
+
+    // Used by ipc::reactor, for the senders waiting for room.
+    static bool select_attach_writer(ipc::handle_t h, std::uint64_t token);
+    static void select_detach_writer(ipc::handle_t h);
+
+    static bool        set_numa   (ipc::handle_t h, shm::numa_policy const & ring, shm::numa_policy const & chunk);
+    static std::string numa_report(ipc::handle_t h);
+
+    static void set_hooks(ipc::handle_t h, hook_fn fn, unsigned mask);
+
+    // Used by ipc::prepared_sender & ipc::prepared_receiver.
+    static bool prepare(ipc::handle_t h, unsigned mode, prepared_ops * ops);
 };
 
-template <typename Flag>
+template <typename Flag, typename Hooks = no_hooks>
 class chan_wrapper {
 private:
     using detail_t = chan_impl<Flag>;
+    using hooks_t  = detail::hook_dispatch<Hooks>;
+
+    void install_hooks() {
+        if constexpr (hooks_t::mask != 0) {
+            detail_t::set_hooks(h_, &hooks_t::call, hooks_t::mask);
+        }
+    }
 
     // queue_generator<policy_t>::conn_info_t
     ipc::handle_t h_ = detail_t::init_first();
@@ -136,12 +196,16 @@ public:
     bool connect(char const * name, unsigned mode = ipc::sender | ipc::receiver) {
         if (name == nullptr || name[0] == '\0') return false;
         detail_t::disconnect(h_); // clear old connection
-        return connected_ = detail_t::connect(&h_, name, mode_ = mode);
+        connected_ = detail_t::connect(&h_, name, mode_ = mode);
+        this->install_hooks();
+        return connected_;
     }
     bool connect(prefix pref, char const * name, unsigned mode = ipc::sender | ipc::receiver) {
         if (name == nullptr || name[0] == '\0') return false;
         detail_t::disconnect(h_); // clear old connection
-        return connected_ = detail_t::connect(&h_, pref, name, mode_ = mode);
+        connected_ = detail_t::connect(&h_, pref, name, mode_ = mode);
+        this->install_hooks();
+        return connected_;
     }
 
     /**
@@ -182,6 +246,12 @@ public:
     bool send(buff_t const & buff, std::uint64_t tm = default_timeout) {
         return this->send(buff.data(), buff.size(), tm);
     }
+    /**
+     * Hands the buffer over, the in-process transport delivers it to the receivers without a copy.
+    */
+    bool send(buff_t && buff, std::uint64_t tm = default_timeout) {
+        return detail_t::send(h_, std::move(buff), tm);
+    }
     bool send(std::string const & str, std::uint64_t tm = default_timeout) {
         return this->send(str.c_str(), str.size() + 1, tm);
     }
@@ -206,10 +276,106 @@ public:
     buff_t try_recv() {
         return detail_t::try_recv(h_);
     }
+
+    /**
+     * How far this receiver is behind the sender(s).
+    */
+    lag_stats lag() const {
+        return detail_t::lag(h_);
+    }
+
+    /**
+     * Throw away the next 'n' unread messages without receiving them,
+     * returns how many messages have been skipped.
+    */
+    std::size_t skip(std::size_t n) {
+        return detail_t::skip(h_, n);
+    }
+
+    /**
+     * Throw away the whole backlog, the next 'recv' gets the newest data.
+    */
+    std::size_t skip_to_latest() {
+        return this->skip((std::numeric_limits<std::size_t>::max)());
+    }
+
+    /**
+     * The message fragments this receiver has missed because they were overwritten,
+     * it's always 0 on a channel which isn't lossy (trans::overwrite).
+    */
+    std::uint64_t lost_count() const {
+        return detail_t::lost_count(h_);
+    }
+
+    /**
+     * The counters of this channel in shared memory, shared by all the connections,
+     * nullptr if they have been compiled out (LIBIPC_DISABLE_STATS).
+    */
+    stats::channel const * stats() const {
+        return detail_t::stats(h_);
+    }
+
+    /**
+     * Switch the send timestamps of the whole channel on/off, it could be called from any connection.
+     * The receivers then feed the latency histograms in the stats block with send->recv,
+     * so it fails if the stats have been compiled out.
+    */
+    bool set_timestamps(bool enabled = true) {
+        return detail_t::set_timestamps(h_, enabled);
+    }
+
+    /**
+     * The send->recv latency of this channel, merged from the histograms of all the receivers.
+    */
+    latency_stats latency() const {
+        return detail_t::latency(h_);
+    }
+
+    /**
+     * Choose what 'send' does when the ring is full, see ipc::overflow.
+     * 'spill_limit' bounds the bytes parked in the spill queue, beyond it messages are rejected.
+     * It's a local setting of this sender, and only affects 'send' ('try_send' always fails when full).
+    */
+    void set_overflow(overflow policy, std::size_t spill_limit = default_spill_limit) {
+        detail_t::set_overflow(h_, policy, spill_limit);
+    }
+
+    overflow_stats overflow_counters() const {
+        return detail_t::overflow_counters(h_);
+    }
+
+    /**
+     * A file descriptor of this receiver for poll/epoll/select, -1 if it's not a connected receiver,
+     * or it isn't supported on this system (only Linux is).
+     * It becomes readable when a message may have arrived: then call 'try_recv' until it returns empty,
+     * which re-arms it (a 'try_recv' which finds the ring empty is what arms it, don't read the fd yourself).
+     * The senders only pay a syscall for it when this receiver is parked like that.
+     * The fd belongs to the channel, it's closed on disconnect.
+    */
+    int ready_fd() {
+        return detail_t::ready_fd(h_);
+    }
+
+    /**
+     * Place the ring and the large-message chunk storage on NUMA nodes.
+     * The kernel only migrates the pages which no other process has mapped yet,
+     * so call it right after the first connection of a channel has been made.
+     * The chunk storage is shared by all channels with the same prefix.
+    */
+    bool set_numa(shm::numa_policy const & ring, shm::numa_policy const & chunk = {}) {
+        return detail_t::set_numa(h_, ring, chunk);
+    }
+
+    /**
+     * Reports on which NUMA nodes the pages of each segment of this channel reside.
+    */
+    std::string numa_report() const {
+        return detail_t::numa_report(h_);
+    }
 };
 
-template <relat Rp, relat Rc, trans Ts>
-using chan = chan_wrapper<ipc::wr<Rp, Rc, Ts>>;
+template <relat Rp, relat Rc, trans Ts, typename Hooks = no_hooks>
+using chan = chan_wrapper<ipc::wr<Rp, Rc, Ts>, Hooks>;
 
 /**
  * \class route
@@ -230,4 +396,13 @@ using route = chan<relat::single, relat::multi, trans::broadcast>;
 */
 using channel = chan<relat::multi, relat::multi, trans::broadcast>;
 
+/**
+ * \class telemetry
+ *
+ * \note A route which never blocks its producer/writer: the newest message overwrites the oldest one,
+ *       and a consumer/reader falling behind skips what it has missed (see lost_count).
+ *       Large messages are sent as fragments, keep them small.
+*/
+using telemetry = chan<relat::single, relat::multi, trans::overwrite>;
+
 } // namespace ipc
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "libipc/export.h"
+
+/**
+ * The logging of the library (ipc::log/ipc::error inside it) doesn't format anything on the caller side:
+ * the format string & the raw arguments are put into a lock-free ring of this process,
+ * and a background thread formats them & hands them to the sink.
+ * Each call site (format string) is limited to a number of records per second,
+ * the rest are counted and reported once the next second begins.
+ * Levels below LIBIPC_LOG_LEVEL are compiled out (0 debug, 1 info, 2 warn, 3 error, 4 none).
+*/
+
+namespace ipc {
+
+enum class log_level : unsigned {
+    debug,
+    info,
+    warn,
+    error
+};
+
+using log_sink_t = void (*)(log_level, char const * msg, std::size_t len);
+
+// nullptr restores the default sink, which writes info/debug to stdout and warn/error to stderr.
+IPC_EXPORT void set_log_sink(log_sink_t sink) noexcept;
+
+// The records each call site may write per second, 0 means unlimited.
+IPC_EXPORT void set_log_rate_limit(std::uint32_t per_second) noexcept;
+
+/**
+ * With async off there is no background thread, the records wait in the ring
+ * until an external reader calls flush_log.
+*/
+IPC_EXPORT void set_log_async(bool async) noexcept;
+
+// Drains the ring into the sink now, returns how many records have been written.
+IPC_EXPORT std::size_t flush_log() noexcept;
+
+// The records which have been thrown away since the ring was full.
+IPC_EXPORT std::uint64_t log_dropped() noexcept;
+
+} // namespace ipc
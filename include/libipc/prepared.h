@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "libipc/def.h"
+#include "libipc/buffer.h"
+#include "libipc/ipc.h"
+
+namespace ipc {
+
+/**
+ * \brief The sending side of a channel, checked once instead of on every call.
+ *
+ *  ipc::route que {"ticks"};
+ *  ipc::prepared_sender snd {que};
+ *  while (...) snd.send(data, size);
+ *
+ * 'prepare' checks the connection (the ring, the sender slot & the message counter) and keeps them,
+ * & picks the push of the overflow policy which has been set, then 'send' skips the checks & the lookups.
+ * The stats, the timestamps & the hooks of the channel all work as usual.
+ * Once the channel has been disconnected or reconnected, or its overflow policy has been changed,
+ * the calls go the checked way of the channel until it's prepared again. It mustn't outlive the channel.
+*/
+template <typename Flag>
+class prepared_sender {
+    prepared_ops ops_ {};
+
+public:
+    prepared_sender() noexcept = default;
+
+    template <typename Hooks>
+    explicit prepared_sender(chan_wrapper<Flag, Hooks> & ch) {
+        this->prepare(ch);
+    }
+
+    template <typename Hooks>
+    bool prepare(chan_wrapper<Flag, Hooks> & ch) {
+        if (chan_impl<Flag>::prepare(ch.handle(), ipc::sender, &ops_)) return true;
+        ops_ = {};
+        return false;
+    }
+
+    bool valid() const noexcept {
+        return ops_.send != nullptr;
+    }
+
+    /**
+     * If timeout, this function would force the push like chan_wrapper::send.
+    */
+    bool send(void const * data, std::size_t size, std::uint64_t tm = default_timeout) {
+        return valid() && ops_.send(ops_.ctx, data, size, tm);
+    }
+    bool send(buff_t const & buff, std::uint64_t tm = default_timeout) {
+        return this->send(buff.data(), buff.size(), tm);
+    }
+    bool send(std::string const & str, std::uint64_t tm = default_timeout) {
+        return this->send(str.c_str(), str.size() + 1, tm);
+    }
+
+    /**
+     * If timeout, this function would just return false.
+    */
+    bool try_send(void const * data, std::size_t size, std::uint64_t tm = default_timeout) {
+        return valid() && ops_.try_send(ops_.ctx, data, size, tm);
+    }
+    bool try_send(buff_t const & buff, std::uint64_t tm = default_timeout) {
+        return this->try_send(buff.data(), buff.size(), tm);
+    }
+    bool try_send(std::string const & str, std::uint64_t tm = default_timeout) {
+        return this->try_send(str.c_str(), str.size() + 1, tm);
+    }
+};
+
+/**
+ * \brief The receiving side of a channel, checked once instead of on every call.
+ * The channel must have been connected as a receiver, and the lookup of its stats slot is kept as well,
+ * see prepared_sender.
+*/
+template <typename Flag>
+class prepared_receiver {
+    prepared_ops ops_ {};
+
+public:
+    prepared_receiver() noexcept = default;
+
+    template <typename Hooks>
+    explicit prepared_receiver(chan_wrapper<Flag, Hooks> & ch) {
+        this->prepare(ch);
+    }
+
+    template <typename Hooks>
+    bool prepare(chan_wrapper<Flag, Hooks> & ch) {
+        if (chan_impl<Flag>::prepare(ch.handle(), ipc::receiver, &ops_)) return true;
+        ops_ = {};
+        return false;
+    }
+
+    bool valid() const noexcept {
+        return ops_.recv != nullptr;
+    }
+
+    buff_t recv(std::uint64_t tm = invalid_value) {
+        return valid() ? ops_.recv(ops_.ctx, tm) : buff_t{};
+    }
+
+    buff_t try_recv() {
+        return this->recv(0);
+    }
+};
+
+template <typename Flag, typename Hooks>
+prepared_sender(chan_wrapper<Flag, Hooks> &) -> prepared_sender<Flag>;
+
+template <typename Flag, typename Hooks>
+prepared_receiver(chan_wrapper<Flag, Hooks> &) -> prepared_receiver<Flag>;
+
+} // namespace ipc
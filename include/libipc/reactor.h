@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+#include "libipc/export.h"
+#include "libipc/def.h"
+#include "libipc/buffer.h"
+#include "libipc/ipc.h"
+#include "libipc/select.h"
+
+namespace ipc {
+
+/**
+ * \brief Resumes the tasks which wait on channels, from a thread of its own.
+ *
+ * The reactor thread parks on an ipc::select of all the channels it has been asked about,
+ * and hands the waiting tasks over to an executor (anything with 'post(std::function<void()>)')
+ * when their channel may have a message, so that many logical consumers could share a few threads.
+ * Without an executor, the tasks run on the reactor thread.
+ * It's what the awaitables of libipc/coro.h are built on.
+ *
+ * The tasks waiting to send park the same way on the room of the ring:
+ * the try_send which finds it full arms the sender in the select, and the next pop signals it.
+ * The channels must outlive the reactor, or be forgotten first.
+*/
+class IPC_EXPORT reactor {
+    reactor(reactor const &) = delete;
+    reactor &operator=(reactor const &) = delete;
+
+public:
+    using task_t    = std::function<void()>;
+    using resume_fn = std::function<void(bool ready)>; // false: timed out, or the reactor has stopped
+    using post_fn   = std::function<void(task_t)>;
+
+    struct chan_fns {
+        select::attach_fn attach;
+        select::detach_fn detach;
+        select::recv_fn   try_recv; // not used by the senders
+    };
+
+    reactor();
+    explicit reactor(post_fn post);
+
+    template <typename Executor,
+              typename = decltype(std::declval<Executor &>().post(std::declval<task_t>()))>
+    explicit reactor(Executor & ex)
+        : reactor(post_fn{[&ex](task_t t) { ex.post(std::move(t)); }}) {}
+
+    /// \brief Stops the thread, the tasks still waiting are resumed with false.
+    ~reactor();
+
+    /**
+     * \brief try_recv of the channel, serialized with the other tasks on it.
+     * The channel is watched from then on.
+    */
+    template <typename Flag, typename Hooks>
+    buff_t try_recv(chan_wrapper<Flag, Hooks> & ch) {
+        return try_recv(ch.handle(), fns_of<Flag>());
+    }
+
+    /**
+     * \brief Queues 'resume' until the channel may have a message (which it should try_recv again),
+     * or 'tm' has passed. False if the channel can't be watched (it isn't a connected receiver).
+    */
+    template <typename Flag, typename Hooks>
+    bool when_readable(chan_wrapper<Flag, Hooks> & ch, std::uint64_t tm, resume_fn resume) {
+        return when_readable(ch.handle(), fns_of<Flag>(), tm, std::move(resume));
+    }
+
+    /**
+     * \brief Queues 'resume' until a receiver has made room in the ring since the last try_send of the channel
+     * which has found it full (it should try_send again), or 'tm' has passed.
+     * False if the channel can't be watched.
+    */
+    template <typename Flag, typename Hooks>
+    bool when_writable(chan_wrapper<Flag, Hooks> & ch, std::uint64_t tm, resume_fn resume) {
+        return when_writable(ch.handle(), writer_fns_of<Flag>(), tm, std::move(resume));
+    }
+
+    /// \brief Stops watching the channel, the tasks still waiting on it are resumed with false.
+    template <typename Flag, typename Hooks>
+    void forget(chan_wrapper<Flag, Hooks> & ch) {
+        forget(ch.handle());
+    }
+
+    buff_t try_recv     (ipc::handle_t h, chan_fns const & fns);
+    bool   when_readable(ipc::handle_t h, chan_fns const & fns, std::uint64_t tm, resume_fn resume);
+    bool   when_writable(ipc::handle_t h, chan_fns const & fns, std::uint64_t tm, resume_fn resume);
+    void   forget       (ipc::handle_t h);
+
+    /// \brief Runs 'task' by the executor.
+    void post(task_t task);
+
+private:
+    template <typename Flag>
+    static chan_fns fns_of() noexcept {
+        return {&chan_impl<Flag>::select_attach, &chan_impl<Flag>::select_detach, &chan_impl<Flag>::try_recv};
+    }
+
+    template <typename Flag>
+    static chan_fns writer_fns_of() noexcept {
+        return {&chan_impl<Flag>::select_attach_writer, &chan_impl<Flag>::select_detach_writer, nullptr};
+    }
+
+    class reactor_;
+    reactor_* p_;
+};
+
+} // namespace ipc
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <string>
+#include <utility>
+
+#include "libipc/export.h"
+#include "libipc/def.h"
+#include "libipc/buffer.h"
+#include "libipc/ipc.h"
+
+/**
+ * Request/reply over the channels, without every client seeing the replies of the others:
+ *
+ *  ipc::rpc::server srv {"calc", [](void const * data, std::size_t size) -> ipc::buff_t { ... }};
+ *  srv.run(); // until srv.stop()
+ *
+ *  ipc::rpc::client cli {"calc"};
+ *  ipc::buff_t r = cli.request(data, size, 100);          // a round trip
+ *  auto f = cli.call(data, size, 100);                    // pipelined, std::future<client::result_t>
+ *  cli.call(data, size, [](ipc::rpc::status, ipc::buff_t reply) { ... }, 100);
+ *
+ * The requests of all the clients go through one channel ("name"), which only the server receives.
+ * Each client has a private single-producer/single-consumer reply ring of its own,
+ * which only the server sends to, so a client never receives (nor skips) the replies of others.
+ * Every request carries the id of its client, a correlation id, and its deadline:
+ * the server doesn't handle the requests which have expired before their turn came,
+ * and the client fails the calls which have no reply by their deadline.
+ * A client could have many requests in flight, the server answers them in order.
+ * Neither side ever forces a push: a full ring fails the call (or drops the reply) instead,
+ * so a slow client couldn't disconnect the server, nor lose its own reply ring.
+ *
+ * There is one server for a name.
+*/
+
+namespace ipc {
+namespace rpc {
+
+enum class status : std::uint32_t {
+    ok,
+    timeout, // no reply before the deadline
+    failed   // not sent, or the client has been closed
+};
+
+/**
+ * \brief Answers the requests sent to its name.
+ * The handler runs on the thread of 'poll'/'run', and returns the reply (which could be empty).
+*/
+class IPC_EXPORT server {
+    server(server const &) = delete;
+    server &operator=(server const &) = delete;
+
+public:
+    using handler_t = std::function<buff_t(void const * data, std::size_t size)>;
+
+    server(char const * name, handler_t handler);
+    ~server();
+
+    bool valid() const noexcept;
+
+    /// \brief Handles the requests which have arrived, waiting up to 'tm' for the first one.
+    /// Returns how many have been answered.
+    std::size_t poll(std::uint64_t tm = invalid_value);
+
+    /// \brief Polls until 'stop'.
+    void run();
+
+    /// \brief Makes 'run' return, it could be called from any thread.
+    void stop();
+
+    /// \brief The replies which haven't found room in the ring of their client in time,
+    /// the calls of them fail by their deadlines.
+    std::uint64_t dropped_replies() const noexcept;
+
+    static void clear_storage(char const * name) noexcept;
+
+private:
+    class server_;
+    server_* p_;
+};
+
+/**
+ * \brief Sends requests to the server of a name.
+ *
+ * With a reply thread (the default) the replies are received in the background,
+ * and all the functions are thread-safe.
+ * Without, the replies are only received by 'request' and 'poll' (a future never gets ready by itself),
+ * and the client must be used by one thread: it saves the hand-off between the threads,
+ * which is most of a round trip on the same socket.
+*/
+class IPC_EXPORT client {
+    client(client const &) = delete;
+    client &operator=(client const &) = delete;
+
+public:
+    using callback_t = std::function<void(status, buff_t reply)>;
+    using result_t   = std::pair<status, buff_t>;
+
+    enum : std::uint64_t {
+        expire_ms = 10 // the longest the reply thread waits before it checks the deadlines
+    };
+
+    explicit client(char const * name, bool reply_thread = true);
+
+    /// \brief The calls still in flight fail.
+    ~client();
+
+    bool valid() const noexcept;
+
+    /// \brief The future gets the status of the call & its reply, which is empty unless the status is ok.
+    std::future<result_t> call(void const * data, std::size_t size, std::uint64_t tm = default_timeout);
+
+    /// \brief 'cb' is called with the reply, by the reply thread (or 'poll'),
+    /// or at once with status::failed if it couldn't be sent within 'tm'.
+    void call(void const * data, std::size_t size, callback_t cb, std::uint64_t tm = default_timeout);
+
+    /// \brief A call which waits for its reply.
+    buff_t request(void const * data, std::size_t size, std::uint64_t tm = default_timeout);
+
+    /// \brief Without a reply thread: receives the replies, waiting up to 'tm' for the first one,
+    /// and fails the calls which have expired. Returns how many calls it has completed.
+    std::size_t poll(std::uint64_t tm = 0);
+
+    /// \brief The calls waiting for their replies.
+    std::size_t in_flight() const;
+
+    buff_t request(std::string const & str, std::uint64_t tm = default_timeout) {
+        return request(str.c_str(), str.size() + 1, tm);
+    }
+
+private:
+    class client_;
+    client_* p_;
+};
+
+} // namespace rpc
+} // namespace ipc
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "libipc/export.h"
+#include "libipc/def.h"
+#include "libipc/buffer.h"
+#include "libipc/ipc.h"
+
+namespace ipc {
+
+/**
+ * \brief Waits on many receiving channels at once, in one thread.
+ *
+ * The select parks once on a waiter of its own, and each of its channels wakes it up
+ * the same way recv would have been (a futex on Linux), not through the fds of ready_fd.
+ * A channel only signals the select after a try_recv on it has found nothing,
+ * so a busy channel costs its senders nothing more than a load per push.
+ *
+ *  ipc::select sel;
+ *  sel.add(ch1);
+ *  sel.add(ch2);
+ *  for (std::size_t i;;) {
+ *      ipc::buff_t buf = sel.recv(&i); // round-robin over the ready channels
+ *      ...
+ *  }
+ *
+ * The channels must be connected receivers, which are only received from through the select
+ * (or by the thread of the select), and outlive it or be removed first.
+ * A select isn't thread-safe, except 'wake'.
+*/
+class IPC_EXPORT select {
+    select(select const &) = delete;
+    select &operator=(select const &) = delete;
+
+public:
+    using attach_fn = bool   (*)(ipc::handle_t, std::uint64_t token);
+    using detach_fn = void   (*)(ipc::handle_t);
+    using recv_fn   = buff_t (*)(ipc::handle_t);
+
+    enum : std::size_t { max_channels = 64 };
+
+    select();
+    ~select();
+
+    /// \brief Adds a channel, returns its index in this select, or invalid_value.
+    template <typename Flag, typename Hooks>
+    std::size_t add(chan_wrapper<Flag, Hooks> & ch) {
+        return add(ch.handle(), &chan_impl<Flag>::select_attach,
+                                &chan_impl<Flag>::select_detach,
+                                &chan_impl<Flag>::try_recv);
+    }
+
+    std::size_t add(ipc::handle_t h, attach_fn attach, detach_fn detach, recv_fn try_recv);
+    bool        remove(std::size_t index);
+    std::size_t size() const noexcept;
+
+    /**
+     * \brief Waits until any of the channels may have messages, returns their indices
+     * (empty on timeout, or when it has been woken up by 'wake').
+     * The indices start after the first one of the last call, so that no channel is always served first.
+     * Drain each returned channel with try_recv until it returns empty,
+     * since that's what makes the channel signal the select again.
+    */
+    std::vector<std::size_t> wait(std::uint64_t tm = invalid_value);
+
+    /**
+     * \brief Receives one message from the next ready channel after the last one received from,
+     * so that a flooding channel can't starve the others. 'index' receives the index of the channel.
+     * Empty on timeout.
+    */
+    buff_t recv(std::size_t * index = nullptr, std::uint64_t tm = invalid_value);
+    buff_t try_recv(std::size_t * index = nullptr);
+
+    /// \brief Makes the current (or the next) wait/recv return at once, it could be called from any thread.
+    void wake();
+
+private:
+    class select_;
+    select_* p_;
+};
+
+} // namespace ipc
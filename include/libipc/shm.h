@@ -15,6 +15,23 @@ enum : unsigned {
     open   = 0x02
 };
 
+// NUMA placement of the pages of a segment (only honored on Linux).
+enum class numa : unsigned {
+    none,       // first-touch, the kernel default
+    bind,       // only allocate pages on the nodes of 'nodes'
+    interleave, // round-robin pages over the nodes of 'nodes' (0 means all nodes)
+    local       // prefer the node of the creator, whoever touches the pages first
+};
+
+struct numa_policy {
+    numa          mode  = numa::none;
+    std::uint64_t nodes = 0; // bit n stands for node n
+};
+
+enum : std::size_t {
+    numa_max_nodes = 64
+};
+
 // ڴ
 IPC_EXPORT id_t         acquire(char const * name, std::size_t size, unsigned mode = create | open);
 // ڴӳ䵽
@@ -27,6 +44,11 @@ IPC_EXPORT void         remove (char const * name) noexcept;
 IPC_EXPORT std::int32_t get_ref(id_t id);
 IPC_EXPORT void sub_ref(id_t id);
 
+// Before get_mem the policy is applied while mapping, after it the resident pages are migrated if possible.
+IPC_EXPORT bool         set_numa(id_t id, numa_policy const & policy) noexcept;
+// Counts the resident pages of each node into 'pages', returns the number of all resident pages.
+IPC_EXPORT std::size_t  numa_residency(id_t id, std::size_t * pages, std::size_t count) noexcept;
+
 // ڴ
 // һֵ͵ľʵ֣һڲжԴֱref
 class IPC_EXPORT handle {
@@ -50,8 +72,13 @@ public:
 
     // ȡڴ棬Ѿ˽
     bool acquire(char const * name, std::size_t size, unsigned mode = create | open);
+    bool acquire(char const * name, std::size_t size, numa_policy const & policy, unsigned mode = create | open);
     std::int32_t release();
 
+    // NUMA placement, see shm::set_numa & shm::numa_residency.
+    bool        set_numa(numa_policy const & policy) noexcept;
+    std::size_t numa_residency(std::size_t * pages, std::size_t count) const noexcept;
+
     // Clean the handle file.
     void clear() noexcept;
     static void clear_storage(char const * name) noexcept;
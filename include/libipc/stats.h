@@ -0,0 +1,228 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "libipc/def.h"
+
+/**
+ * The statistics of a channel live in a shared memory block of their own ("ST_CONN__" + name,
+ * or "ST_SLOT__" + name for a typed channel),
+ * so that a process outside the channel (see tools/ipc-top) could watch it.
+ * All the counters are relaxed atomics, a reader only gets a rough snapshot of them.
+ * The send->recv latency is only measured when the timestamps of the channel are on,
+ * see chan_wrapper::set_timestamps.
+ * Define LIBIPC_DISABLE_STATS (cmake -DLIBIPC_ENABLE_STATS=OFF) to compile them out.
+*/
+
+namespace ipc {
+namespace stats {
+
+using counter_t = std::atomic<std::uint64_t>;
+
+enum : std::uint32_t {
+    magic   = 0x53435049, // "IPCS"
+    version = 3
+};
+
+enum : std::size_t {
+    line_size    = 64, // the counters of different writers never share a cache line
+    producer_max = 32, // claimed by the producers, the ones beyond share them by their connection ids
+    receiver_max = 32, // one slot for each connection bit of the receivers
+    sub_bits     = 3,  // 8 sub-buckets for each power of 2, the error of a bucket is below 12.5%
+    bucket_count = 38 << sub_bits // up to 2^40 ns (about 18 minutes)
+};
+
+struct alignas(line_size) producer_t {
+    std::atomic<std::uint32_t> pid;    // 0 if the slot is free
+    std::atomic<std::uint64_t> pid_ns; // the pid namespace of the owner, 0 while it's being claimed
+    counter_t messages;     // messages which have been sent
+    counter_t bytes;        // payload which has been sent
+    counter_t fragments;    // ring slots which have been pushed
+    counter_t large;        // messages which have been placed in the chunk storage
+    counter_t failures;     // sends which have failed
+    counter_t parks;        // waits on a full ring
+    counter_t force_pushes; // slow receivers which have been disconnected by force
+};
+
+/**
+ * A log-linear (HDR-style) histogram of nanoseconds.
+ * Values below 2^sub_bits have buckets of their own, above that every power of 2 is split into
+ * 2^sub_bits linear buckets, and the values out of range fall into the last bucket.
+*/
+struct histogram {
+    counter_t count;
+    counter_t sum;
+    counter_t max;
+    counter_t buckets[bucket_count];
+
+    static unsigned log2_of(std::uint64_t v) noexcept {
+#if defined(__GNUC__)
+        return 63u - static_cast<unsigned>(__builtin_clzll(v));
+#else
+        unsigned r = 0;
+        while (v >>= 1) ++r;
+        return r;
+#endif
+    }
+
+    static std::size_t index_of(std::uint64_t ns) noexcept {
+        constexpr std::uint64_t sub = 1u << sub_bits;
+        if (ns < sub) return static_cast<std::size_t>(ns);
+        unsigned e = log2_of(ns);
+        std::size_t i = static_cast<std::size_t>((e - sub_bits + 1) << sub_bits)
+                      + static_cast<std::size_t>((ns >> (e - sub_bits)) & (sub - 1));
+        return (i < bucket_count) ? i : (bucket_count - 1);
+    }
+
+    // The highest value which falls into the bucket.
+    static std::uint64_t upper_of(std::size_t index) noexcept {
+        constexpr std::uint64_t sub = 1u << sub_bits;
+        if (index < sub) return index;
+        unsigned e = static_cast<unsigned>(index >> sub_bits) + sub_bits - 1;
+        std::uint64_t low = (sub + (index & (sub - 1))) << (e - sub_bits);
+        return low + (std::uint64_t(1) << (e - sub_bits)) - 1;
+    }
+
+    void record(std::uint64_t ns) noexcept {
+        count.fetch_add(1 , std::memory_order_relaxed);
+        sum  .fetch_add(ns, std::memory_order_relaxed);
+        buckets[index_of(ns)].fetch_add(1, std::memory_order_relaxed);
+        auto m = max.load(std::memory_order_relaxed);
+        while ((m < ns) && !max.compare_exchange_weak(m, ns, std::memory_order_relaxed)) ;
+    }
+
+    /**
+     * The percentiles of the buckets which have been copied out of one or more histograms.
+     * A percentile is the highest value of its bucket, never beyond the max.
+    */
+    static ipc::latency_stats summarize(std::uint64_t const (&merged)[bucket_count],
+                                        std::uint64_t count, std::uint64_t sum, std::uint64_t max) noexcept {
+        std::uint64_t total = 0;
+        for (auto n : merged) total += n;
+        if (total == 0) return {};
+        ipc::latency_stats ls {};
+        ls.count = count;
+        ls.max   = max;
+        ls.mean  = (count == 0) ? 0 : (sum / count);
+        auto at = [&](double q) {
+            auto rank = static_cast<std::uint64_t>(q * static_cast<double>(total) + 0.5);
+            if (rank == 0) rank = 1;
+            std::uint64_t seen = 0;
+            for (std::size_t k = 0; k < bucket_count; ++k) {
+                if ((seen += merged[k]) >= rank) {
+                    auto v = upper_of(k);
+                    return (v < max) ? v : max;
+                }
+            }
+            return max;
+        };
+        ls.p50  = at(0.5);
+        ls.p99  = at(0.99);
+        ls.p999 = at(0.999);
+        return ls;
+    }
+
+    ipc::latency_stats summary() const noexcept {
+        std::uint64_t copied[bucket_count];
+        for (std::size_t k = 0; k < bucket_count; ++k) {
+            copied[k] = buckets[k].load(std::memory_order_relaxed);
+        }
+        return summarize(copied, count.load(std::memory_order_relaxed),
+                                 sum  .load(std::memory_order_relaxed),
+                                 max  .load(std::memory_order_relaxed));
+    }
+
+    void reset() noexcept {
+        count.store(0, std::memory_order_relaxed);
+        sum  .store(0, std::memory_order_relaxed);
+        max  .store(0, std::memory_order_relaxed);
+        for (auto & b : buckets) b.store(0, std::memory_order_relaxed);
+    }
+};
+
+struct alignas(line_size) receiver_t {
+    std::atomic<std::uint32_t> pid; // 0 if the slot is free
+    counter_t messages;     // messages which have been received
+    counter_t bytes;        // payload which has been received
+    counter_t fragments;    // ring slots which have been popped
+    counter_t skipped;      // ring slots which have been skipped
+    counter_t lost;         // ring slots which have been overwritten before read (lossy rings)
+    counter_t parks;        // waits on an empty ring
+    counter_t base;         // the pushed slots of the channel when the receiver connected
+    histogram latency;      // send->recv of the stamped messages
+};
+
+struct channel {
+    std::atomic<std::uint32_t> magic;
+    std::atomic<std::uint32_t> version;
+    std::atomic<std::uint32_t> ring_size;   // slots of the ring
+    std::atomic<std::uint32_t> data_size;   // payload of a slot
+    std::atomic<std::uint32_t> connections; // the connection bits of the receivers
+    std::atomic<std::uint32_t> timestamps;  // whether the senders stamp their messages
+    counter_t connects;                     // receivers which have connected
+    counter_t disconnects;                  // receivers which have disconnected
+    counter_t chunks;                       // chunks of the large messages in use
+    counter_t retired;                      // ring slots pushed by the producers which have released their slots
+
+    producer_t producers[producer_max];
+    receiver_t receivers[receiver_max];
+
+    producer_t & producer(std::uint64_t conn_id) noexcept {
+        return producers[conn_id % producer_max];
+    }
+
+    receiver_t & receiver(std::size_t index) noexcept {
+        return receivers[index % receiver_max];
+    }
+
+    std::uint64_t pushed() const noexcept {
+        std::uint64_t n = retired.load(std::memory_order_relaxed);
+        for (auto const & p : producers) n += p.fragments.load(std::memory_order_relaxed);
+        return n;
+    }
+
+    // The slots which the receiver hasn't consumed yet, an estimate since nothing is locked.
+    std::uint64_t depth(receiver_t const & r) const noexcept {
+        std::uint64_t done = r.base     .load(std::memory_order_relaxed)
+                           + r.fragments.load(std::memory_order_relaxed)
+                           + r.skipped  .load(std::memory_order_relaxed)
+                           + r.lost     .load(std::memory_order_relaxed);
+        std::uint64_t all  = pushed();
+        std::uint64_t cap  = ring_size.load(std::memory_order_relaxed);
+        return (all <= done) ? 0 : (((all - done) > cap) ? cap : (all - done));
+    }
+
+    /**
+     * The percentiles of the latency histograms of all the receivers,
+     * or of the receiver in the slot 'index' only.
+    */
+    ipc::latency_stats latency(std::size_t index = receiver_max) const noexcept {
+        std::uint64_t merged[bucket_count] {};
+        std::uint64_t count = 0, sum = 0, max = 0;
+        for (std::size_t i = 0; i < receiver_max; ++i) {
+            if ((index < receiver_max) && (i != index)) continue;
+            auto const & h = receivers[i].latency;
+            count += h.count.load(std::memory_order_relaxed);
+            sum   += h.sum  .load(std::memory_order_relaxed);
+            auto m = h.max  .load(std::memory_order_relaxed);
+            if (m > max) max = m;
+            for (std::size_t k = 0; k < bucket_count; ++k) {
+                merged[k] += h.buckets[k].load(std::memory_order_relaxed);
+            }
+        }
+        return histogram::summarize(merged, count, sum, max);
+    }
+};
+
+inline void add(counter_t & c, std::uint64_t n = 1) noexcept {
+    c.fetch_add(n, std::memory_order_relaxed);
+}
+
+inline void sub(counter_t & c, std::uint64_t n = 1) noexcept {
+    c.fetch_sub(n, std::memory_order_relaxed);
+}
+
+} // namespace stats
+} // namespace ipc
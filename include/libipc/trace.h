@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+
+#include "libipc/export.h"
+
+/**
+ * Opt-in tracing of the message flow between processes.
+ * When it's on, every process records send/recv, the push/pop of each fragment,
+ * the parks on a waiter and force_push into lock-free buffers of its own threads.
+ * A message is identified by the connection id & message id in its header,
+ * so a send in one process is linked to its recv in another by a flow arrow.
+ *
+ * The events are written in the JSON array format of Chrome's trace events
+ * (chrome://tracing, ui.perfetto.dev), appending to the file under a file lock,
+ * so all the processes of a pipeline could dump into the same file.
+ *
+ * Setting LIBIPC_TRACE=<file> in the environment turns it on at startup and dumps at exit,
+ * LIBIPC_TRACE_EVENTS=<n> sets the events kept by each thread (65536 by default),
+ * the oldest ones are overwritten when a buffer is full.
+*/
+
+namespace ipc {
+namespace trace {
+
+IPC_EXPORT void enable(bool on = true) noexcept;
+IPC_EXPORT bool enabled() noexcept;
+
+// Appends the recorded events of this process to 'path', returns how many have been written.
+// Should be called when the recording threads are quiet, otherwise the newest events may be torn.
+IPC_EXPORT std::size_t dump(char const * path);
+
+// Discards the recorded events of this process.
+IPC_EXPORT void clear() noexcept;
+
+} // namespace trace
+} // namespace ipc
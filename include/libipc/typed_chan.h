@@ -0,0 +1,203 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "libipc/export.h"
+#include "libipc/def.h"
+#include "libipc/ipc.h"
+#include "libipc/stats.h"
+
+namespace ipc {
+
+enum : std::size_t {
+    max_typed_size = 256 // the largest type of a typed channel
+};
+
+/**
+ * The typed channels are built in a few slot sizes (the powers of 2 from 8 to max_typed_size),
+ * a type goes through the smallest one which could hold it.
+ * 'size' bytes of a slot are copied in by send, and out by recv.
+*/
+template <typename Flag, std::size_t SlotSize>
+struct IPC_EXPORT typed_impl {
+    static bool connect   (ipc::handle_t * ph, prefix, char const * name, unsigned mode);
+    static bool reconnect (ipc::handle_t * ph, unsigned mode);
+    static void disconnect(ipc::handle_t h);
+    static void destroy   (ipc::handle_t h);
+
+    static char const * name(ipc::handle_t h);
+
+    static void clear_storage(prefix, char const * name) noexcept;
+
+    static std::size_t recv_count   (ipc::handle_t h);
+    static bool        wait_for_recv(ipc::handle_t h, std::size_t r_count, std::uint64_t tm);
+
+    static bool send    (ipc::handle_t h, void const * data, std::size_t size, std::uint64_t tm);
+    static bool try_send(ipc::handle_t h, void const * data, std::size_t size, std::uint64_t tm);
+    static bool recv    (ipc::handle_t h, void * data, std::size_t size, std::uint64_t tm);
+
+    static stats::channel const * stats(ipc::handle_t h);
+};
+
+namespace detail {
+
+constexpr std::size_t slot_size_of(std::size_t size) noexcept {
+    std::size_t s = 8;
+    while (s < size) s <<= 1;
+    return s;
+}
+
+} // namespace detail
+
+/**
+ * \brief A channel of fixed-size messages of type T, one message is one slot of the ring.
+ *
+ *  struct tick { std::uint64_t id; double bid, ask; };
+ *  ipc::typed_chan<tick> que {"ticks"};
+ *  que.send(tick{1, 0.5, 0.6});
+ *  que.emplace(2, 0.7, 0.8);
+ *
+ *  ipc::typed_chan<tick> rcv {"ticks", ipc::receiver};
+ *  tick t;
+ *  while (rcv.recv(t)) { ... }
+ *
+ * There is no message header, fragment, reassembly nor heap buffer: send copies the T into a slot,
+ * recv copies the slot into the T. So T must be trivially copyable.
+ * Without a header the receivers can't tell who has sent a message,
+ * a connection which both sends & receives gets its own messages as well.
+ * The rings are apart from the ones of the byte channels of the same name, and have no in-process transport.
+*/
+template <typename T, typename Flag = ipc::wr<relat::single, relat::multi, trans::broadcast>>
+class typed_chan {
+    static_assert(std::is_trivially_copyable<T>::value, "ipc::typed_chan: T must be trivially copyable.");
+    static_assert(sizeof(T) <= max_typed_size, "ipc::typed_chan: T is larger than ipc::max_typed_size.");
+
+public:
+    using value_t  = T;
+    using detail_t = typed_impl<Flag, detail::slot_size_of(sizeof(T))>;
+
+private:
+    ipc::handle_t h_ = nullptr;
+    unsigned mode_   = ipc::sender;
+    bool connected_  = false;
+
+public:
+    typed_chan() noexcept = default;
+
+    explicit typed_chan(char const * name, unsigned mode = ipc::sender)
+        : connected_{this->connect(name, mode)} {
+    }
+
+    typed_chan(prefix pref, char const * name, unsigned mode = ipc::sender)
+        : connected_{this->connect(pref, name, mode)} {
+    }
+
+    typed_chan(typed_chan&& rhs) noexcept
+        : typed_chan{} {
+        swap(rhs);
+    }
+
+    ~typed_chan() {
+        detail_t::destroy(h_);
+    }
+
+    void swap(typed_chan& rhs) noexcept {
+        std::swap(h_        , rhs.h_);
+        std::swap(mode_     , rhs.mode_);
+        std::swap(connected_, rhs.connected_);
+    }
+
+    typed_chan& operator=(typed_chan rhs) noexcept {
+        swap(rhs);
+        return *this;
+    }
+
+    char const * name() const noexcept {
+        return detail_t::name(h_);
+    }
+
+    static void clear_storage(char const * name) noexcept {
+        detail_t::clear_storage({nullptr}, name);
+    }
+
+    static void clear_storage(prefix pref, char const * name) noexcept {
+        detail_t::clear_storage(pref, name);
+    }
+
+    ipc::handle_t handle() const noexcept {
+        return h_;
+    }
+
+    bool valid() const noexcept {
+        return (handle() != nullptr);
+    }
+
+    unsigned mode() const noexcept {
+        return mode_;
+    }
+
+    bool connect(char const * name, unsigned mode = ipc::sender | ipc::receiver) {
+        return this->connect({nullptr}, name, mode);
+    }
+    bool connect(prefix pref, char const * name, unsigned mode = ipc::sender | ipc::receiver) {
+        if (name == nullptr || name[0] == '\0') return false;
+        detail_t::disconnect(h_); // clear old connection
+        return connected_ = detail_t::connect(&h_, pref, name, mode_ = mode);
+    }
+
+    bool reconnect(unsigned mode) {
+        if (!valid()) return false;
+        if (connected_ && (mode_ == mode)) return true;
+        return connected_ = detail_t::reconnect(&h_, mode_ = mode);
+    }
+
+    void disconnect() {
+        if (!valid()) return;
+        detail_t::disconnect(h_);
+        connected_ = false;
+    }
+
+    std::size_t recv_count() const {
+        return detail_t::recv_count(h_);
+    }
+
+    bool wait_for_recv(std::size_t r_count, std::uint64_t tm = invalid_value) const {
+        return detail_t::wait_for_recv(h_, r_count, tm);
+    }
+
+    /**
+     * If timeout, this function would force the slot like chan_wrapper::send.
+    */
+    bool send(T const & value, std::uint64_t tm = default_timeout) {
+        return detail_t::send(h_, &value, sizeof(T), tm);
+    }
+
+    /**
+     * If timeout, this function would just return false.
+    */
+    bool try_send(T const & value, std::uint64_t tm = default_timeout) {
+        return detail_t::try_send(h_, &value, sizeof(T), tm);
+    }
+
+    template <typename... A>
+    bool emplace(A &&... args) {
+        return this->send(T{std::forward<A>(args)...});
+    }
+
+    bool recv(T & value, std::uint64_t tm = invalid_value) {
+        return detail_t::recv(h_, &value, sizeof(T), tm);
+    }
+
+    bool try_recv(T & value) {
+        return detail_t::recv(h_, &value, sizeof(T), 0);
+    }
+
+    stats::channel const * stats() const {
+        return detail_t::stats(h_);
+    }
+};
+
+} // namespace ipc
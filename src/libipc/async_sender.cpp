@@ -0,0 +1,226 @@
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+
+#include "libipc/async_sender.h"
+#include "libipc/pool_alloc.h"
+
+#include "libipc/utility/pimpl.h"
+#include "libipc/utility/log.h"
+
+namespace ipc {
+
+class async_sender::async_sender_ : public ipc::pimpl<async_sender_> {
+public:
+    // A message of the queue, with its payload right behind it.
+    struct node_t {
+        std::atomic<node_t *> next_ {nullptr};
+        std::size_t           size_ = 0;
+        callback_t            cb_;
+
+        std::size_t bytes() const noexcept {
+            return sizeof(node_t) + size_;
+        }
+
+        void *data() noexcept {
+            return this + 1;
+        }
+    };
+
+    ipc::handle_t h_;
+    send_fn       send_;
+    options       opt_;
+
+    // Vyukov's intrusive MPSC queue: the callers exchange the head, the flusher follows the tail.
+    std::atomic<node_t *>      head_;
+    node_t *                   tail_;  // the stub, already sent
+    std::atomic<std::uint64_t> bytes_    {0};
+    std::atomic<std::uint64_t> queued_   {0}; // all the messages which have been queued
+    std::atomic<std::uint64_t> done_     {0}; // & taken out of the queue
+    std::atomic<std::uint64_t> sent_     {0};
+    std::atomic<std::uint64_t> failed_   {0};
+    std::atomic<std::uint64_t> rejected_ {0};
+
+    std::mutex              lock_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    std::atomic<bool>       sleeping_ {false};
+    std::atomic<std::size_t> flushers_ {0};
+    bool                    quit_ = false;
+    std::thread             flusher_;
+
+    static node_t *make_node(void const * data, std::size_t size, callback_t cb) {
+        auto n = ::new (ipc::mem::alloc(sizeof(node_t) + size)) node_t;
+        n->size_ = size;
+        n->cb_   = std::move(cb);
+        if (size != 0) std::memcpy(n->data(), data, size);
+        return n;
+    }
+
+    static void free_node(node_t * n) {
+        auto bytes = n->bytes();
+        n->~node_t();
+        ipc::mem::free(n, bytes);
+    }
+
+    async_sender_(ipc::handle_t h, send_fn send, options const & opt)
+        : h_   {h}
+        , send_{send}
+        , opt_ {opt} {
+        if (opt_.batch == 0) opt_.batch = 1;
+        auto stub = make_node(nullptr, 0, {});
+        head_.store(stub, std::memory_order_relaxed);
+        tail_ = stub;
+        flusher_ = std::thread{[this] { run(); }};
+    }
+
+    ~async_sender_() {
+        {
+            std::lock_guard<std::mutex> guard {lock_};
+            quit_ = true;
+        }
+        work_cv_.notify_one();
+        if (flusher_.joinable()) flusher_.join();
+        free_node(tail_);
+    }
+
+    bool push(void const * data, std::size_t size, callback_t cb) {
+        if ((data == nullptr) || (size == 0) || (h_ == nullptr)) {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        auto bytes = sizeof(node_t) + size;
+        if (bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes > opt_.memory_limit) {
+            bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        auto n = make_node(data, size, std::move(cb));
+        queued_.fetch_add(1, std::memory_order_relaxed);
+        auto prev = head_.exchange(n, std::memory_order_acq_rel);
+        prev->next_.store(n, std::memory_order_release);
+        // only pays for the lock when the flusher has nothing to do
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping_.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> guard {lock_};
+            work_cv_.notify_one();
+        }
+        return true;
+    }
+
+    // By the flusher only, the node stays as the stub until the next pop.
+    node_t *pop() noexcept {
+        auto next = tail_->next_.load(std::memory_order_acquire);
+        if (next == nullptr) return nullptr;
+        free_node(std::exchange(tail_, next));
+        return next;
+    }
+
+    bool empty() const noexcept {
+        return tail_->next_.load(std::memory_order_acquire) == nullptr;
+    }
+
+    void flush_out(node_t * n) {
+        bool ok = send_(h_, n->data(), n->size_, opt_.timeout);
+        (ok ? sent_ : failed_).fetch_add(1, std::memory_order_relaxed);
+        bytes_.fetch_sub(n->bytes(), std::memory_order_relaxed);
+        if (n->cb_) std::exchange(n->cb_, nullptr)(ok);
+    }
+
+    void run() {
+        for (;;) {
+            std::size_t n = 0;
+            for (; n < opt_.batch; ++n) {
+                auto p = pop();
+                if (p == nullptr) break;
+                flush_out(p);
+            }
+            if (n != 0) {
+                done_.fetch_add(n, std::memory_order_release);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (flushers_.load(std::memory_order_relaxed) != 0) {
+                    std::lock_guard<std::mutex> guard {lock_};
+                    done_cv_.notify_all();
+                }
+                continue;
+            }
+            std::unique_lock<std::mutex> guard {lock_};
+            if (quit_) {
+                // a push may be in the middle of linking its node
+                if (done_.load(std::memory_order_relaxed) == queued_.load(std::memory_order_acquire)) break;
+                guard.unlock();
+                std::this_thread::yield();
+                continue;
+            }
+            sleeping_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (empty()) work_cv_.wait(guard);
+            sleeping_.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    bool flush(std::uint64_t tm) {
+        auto ticket = queued_.load(std::memory_order_acquire);
+        auto ready  = [this, ticket] { return done_.load(std::memory_order_acquire) >= ticket; };
+        if (ready()) return true;
+        std::unique_lock<std::mutex> guard {lock_};
+        flushers_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool ok = true;
+        if (tm == invalid_value) {
+            done_cv_.wait(guard, ready);
+        }
+        else {
+            ok = done_cv_.wait_for(guard, std::chrono::milliseconds(tm), ready);
+        }
+        flushers_.fetch_sub(1, std::memory_order_relaxed);
+        return ok;
+    }
+};
+
+async_sender::async_sender(ipc::handle_t h, send_fn send, options const & opt)
+    : p_(p_->make(h, send, opt)) {
+}
+
+async_sender::~async_sender() {
+    p_->clear();
+}
+
+bool async_sender::send(void const * data, std::size_t size, callback_t cb) {
+    return impl(p_)->push(data, size, std::move(cb));
+}
+
+std::future<bool> async_sender::send_future(void const * data, std::size_t size) {
+    auto promise = std::make_shared<std::promise<bool>>();
+    auto future  = promise->get_future();
+    if (!impl(p_)->push(data, size, [promise](bool sent) { promise->set_value(sent); })) {
+        promise->set_value(false);
+    }
+    return future;
+}
+
+bool async_sender::flush(std::uint64_t tm) {
+    return impl(p_)->flush(tm);
+}
+
+async_sender::counters async_sender::stats() const noexcept {
+    auto a = impl(p_);
+    counters c {};
+    auto queued = a->queued_.load(std::memory_order_relaxed);
+    auto done   = a->done_  .load(std::memory_order_relaxed);
+    c.queued       = (queued > done) ? (queued - done) : 0;
+    c.queued_bytes = a->bytes_   .load(std::memory_order_relaxed);
+    c.sent         = a->sent_    .load(std::memory_order_relaxed);
+    c.failed       = a->failed_  .load(std::memory_order_relaxed);
+    c.rejected     = a->rejected_.load(std::memory_order_relaxed);
+    return c;
+}
+
+} // namespace ipc
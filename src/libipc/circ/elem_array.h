@@ -118,6 +118,18 @@ public:
         return r_ckr_.disconnect(*this, cc_id);
     }
 
+    /**
+     * Disconnect the receivers among 'cc_id' whose processes have died,
+     * when the ring is full at the write cursor 'at', returns the reclaimed connection bits.
+    */
+    cc_t disconnect_dead_receiver(cc_t cc_id, std::uint64_t at) noexcept {
+        cc_t dead = base_t::dead_receivers(cc_id, at);
+        if (dead != 0) {
+            disconnect_receiver(dead);
+        }
+        return dead;
+    }
+
     cursor_t cursor() const noexcept {
         return head_.cursor();
     }
@@ -137,6 +149,21 @@ public:
         if (cur == nullptr) return false;
         return head_.pop(que, *cur, std::forward<F>(f), std::forward<R>(out), block_);
     }
+
+    cursor_t pending(cursor_t cur) const noexcept {
+        return head_.pending(cur);
+    }
+
+    template <typename F>
+    void peek(cursor_t cur, F&& f) const {
+        head_.peek(cur, std::forward<F>(f), block_);
+    }
+
+    template <typename Q, typename F>
+    cursor_t skip(Q* que, cursor_t* cur, F&& f) {
+        if (cur == nullptr) return 0;
+        return head_.skip(que, *cur, std::forward<F>(f), block_);
+    }
 };
 
 } // namespace circ
@@ -9,6 +9,8 @@
 #include "libipc/rw_lock.h"
 
 #include "libipc/platform/detail.h"
+#include "libipc/platform/process.h"
+#include "libipc/platform/clock.h"
 
 namespace ipc {
 namespace circ {
@@ -65,6 +67,28 @@ class conn_head;
 // ÿλһӶ4ֽ32λ32
 template <typename P>
 class conn_head<P, true> : public conn_head_base {
+    enum : unsigned {
+        cc_bits = sizeof(cc_t) * 8
+    };
+
+    enum : std::uint64_t {
+        probe_interval = 1000000 // ns, between two probes of the receiver processes
+    };
+
+    // pid of the receiver which holds each connection bit (0 means unknown), and its pid namespace.
+    std::atomic<detail::pid_t>    pids_  [cc_bits] {};
+    std::atomic<detail::pid_ns_t> pid_ns_[cc_bits] {};
+    std::atomic<std::uint64_t>    probed_    {0}; // when the receivers have been probed (monotonic_ns)
+    std::atomic<std::uint64_t>    probed_at_ {0}; // the write cursor the ring was full at, then
+    std::atomic<std::uint64_t>    full_at_   {0}; // the write cursor the ring has been found full at last
+
+    template <typename F>
+    static void for_each_bit(cc_t cc, F&& f) {
+        for (unsigned i = 0; cc != 0; ++i, cc >>= 1) {
+            if (cc & 1u) f(i);
+        }
+    }
+
 public:
     // עһӱλظñλ
     cc_t connect() noexcept {
@@ -77,15 +101,57 @@ public:
                 return 0;
             }
             if (this->cc_.compare_exchange_weak(curr, next, std::memory_order_release)) {
-                return next ^ curr; // return connected id
+                cc_t cc_id = next ^ curr;
+                for_each_bit(cc_id, [this](unsigned i) {
+                    pid_ns_[i].store(detail::this_pid_ns(), std::memory_order_relaxed);
+                    pids_  [i].store(detail::this_process(), std::memory_order_release);
+                });
+                return cc_id; // return connected id
             }
         }
     }
 
     cc_t disconnect(cc_t cc_id) noexcept {
+        // The bits could be reused right after being cleared, so the pids go first.
+        for_each_bit(cc_id, [this](unsigned i) {
+            pids_[i].store(0, std::memory_order_relaxed);
+        });
         return this->cc_.fetch_and(~cc_id, std::memory_order_acq_rel) & ~cc_id;
     }
 
+    /**
+     * Returns the connection bits among 'cc_id' whose receiver processes have died,
+     * 'at' is the write cursor the ring is full at.
+     * The first time it's full there, the receivers have moved since it was full the last time, they're alive.
+     * If it's still full there the next time, the receivers haven't moved & they're probed at once.
+     * Then a full ring calls it again & again while the senders wait for a slow receiver,
+     * so the processes are probed at most once per probe_interval there, the other calls return 0.
+    */
+    cc_t dead_receivers(cc_t cc_id, std::uint64_t at) noexcept {
+        if (full_at_.exchange(at, std::memory_order_relaxed) != at) {
+            return 0;
+        }
+        auto now = detail::monotonic_ns();
+        if (probed_at_.exchange(at, std::memory_order_relaxed) != at) {
+            probed_.store(now, std::memory_order_relaxed);
+        }
+        else {
+            auto last = probed_.load(std::memory_order_relaxed);
+            if ((now - last < probe_interval) ||
+                !probed_.compare_exchange_strong(last, now, std::memory_order_relaxed)) {
+                return 0;
+            }
+        }
+        cc_t dead = 0;
+        for_each_bit(cc_id & this->cc_.load(std::memory_order_acquire), [this, &dead](unsigned i) {
+            auto pid = pids_[i].load(std::memory_order_acquire);
+            if ((pid != 0) && !detail::process_alive(pid, pid_ns_[i].load(std::memory_order_relaxed))) {
+                dead |= (static_cast<cc_t>(1u) << i);
+            }
+        });
+        return dead;
+    }
+
     std::size_t conn_count(std::memory_order order = std::memory_order_acquire) const noexcept {
         cc_t cur = this->cc_.load(order);
         cc_t cnt; // accumulates the total bits set in cc
@@ -115,6 +181,11 @@ public:
     std::size_t conn_count(std::memory_order order = std::memory_order_acquire) const noexcept {
         return this->connections(order);
     }
+
+    // Unicast receivers don't own a bit, so there is nothing to check.
+    cc_t dead_receivers(cc_t /*cc_id*/, std::uint64_t /*at*/) noexcept {
+        return 0;
+    }
 };
 
 } // namespace circ
@@ -0,0 +1,359 @@
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "libipc/dispatcher.h"
+#include "libipc/stats.h"
+
+#include "libipc/utility/pimpl.h"
+#include "libipc/utility/log.h"
+#include "libipc/utility/ws_queue.h"
+#include "libipc/memory/resource.h"
+#include "libipc/platform/clock.h"
+
+namespace ipc {
+
+class dispatcher::dispatcher_ : public ipc::pimpl<dispatcher_> {
+public:
+    struct entry_t {
+        handler_t             handler_;
+        ipc::stats::counter_t received_;
+        ipc::stats::counter_t handled_;
+        ipc::stats::counter_t max_depth_;
+        ipc::stats::histogram wait_;
+        ipc::stats::histogram run_;
+
+        explicit entry_t(handler_t h)
+            : handler_{std::move(h)} {
+            received_ .store(0, std::memory_order_relaxed);
+            handled_  .store(0, std::memory_order_relaxed);
+            max_depth_.store(0, std::memory_order_relaxed);
+            wait_.reset();
+            run_ .reset();
+        }
+    };
+
+    struct item_t {
+        entry_t *     entry_;
+        buff_t        buf_;
+        std::size_t   channel_;
+        std::uint64_t stamp_;
+    };
+
+    /**
+     * The messages of some keys, in order.
+     * The receive loop is the only producer, and the worker which has taken it from a queue the only consumer.
+     * It's in a queue, or being run, while it's scheduled, never in two places at once.
+    */
+    struct strand_t {
+        enum : std::size_t { capacity = 64 };
+
+        alignas(ipc::stats::line_size) std::atomic<std::size_t> head_ {0};
+        alignas(ipc::stats::line_size) std::atomic<std::size_t> tail_ {0};
+        alignas(ipc::stats::line_size) std::atomic<bool> scheduled_ {false};
+        item_t items_[capacity];
+
+        bool push(item_t & it) {
+            auto t = tail_.load(std::memory_order_relaxed);
+            if ((t - head_.load(std::memory_order_acquire)) >= capacity) return false;
+            items_[t % capacity] = std::move(it);
+            tail_.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        item_t *front() noexcept {
+            auto h = head_.load(std::memory_order_relaxed);
+            if (h == tail_.load(std::memory_order_acquire)) return nullptr;
+            return &items_[h % capacity];
+        }
+
+        void pop() {
+            auto h = head_.load(std::memory_order_relaxed);
+            items_[h % capacity].buf_ = buff_t{};
+            head_.store(h + 1, std::memory_order_release);
+        }
+
+        bool empty() const noexcept {
+            return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+        }
+    };
+
+    using queue_t = detail::ws_queue<strand_t>;
+
+    options                 opt_;
+    std::mutex              lock_;
+    bool                    started_ = false;
+    bool                    stopped_ = false;
+    ipc::unordered_map<std::uint32_t, std::unique_ptr<entry_t>> entries_;
+    std::unique_ptr<entry_t> unknown_;
+    ipc::stats::counter_t   dropped_;
+    ipc::select             sel_;
+    std::vector<std::unique_ptr<strand_t>> strands_;
+    std::vector<std::unique_ptr<queue_t>>  queues_; // one of each worker, the last one of the receive loop
+    std::size_t             next_strand_ = 0;       // of the messages without a key
+    std::atomic<bool>       quit_ {false};
+    std::atomic<bool>       done_ {false};          // the receive loop has returned
+    std::mutex              park_lock_;
+    std::condition_variable park_cv_;
+    std::atomic<std::size_t> sleepers_ {0};
+    std::thread             receiver_;
+    std::vector<std::thread> workers_;
+
+    dispatcher_(options const & opt)
+        : opt_{opt} {
+        if (opt_.workers == 0) opt_.workers = (std::max)(std::thread::hardware_concurrency(), 1u);
+        if (opt_.strands == 0) opt_.strands = opt_.workers * 16;
+        if (opt_.batch   == 0) opt_.batch   = 1;
+        dropped_.store(0, std::memory_order_relaxed);
+    }
+
+    entry_t *find(std::uint32_t type) const noexcept {
+        auto it = entries_.find(type);
+        return (it == entries_.end()) ? unknown_.get() : it->second.get();
+    }
+
+    strand_t &strand_of(std::uint64_t key) noexcept {
+        std::size_t i;
+        if (key == no_key) {
+            i = next_strand_++ % strands_.size();
+        }
+        else {
+            // the sequential keys are spread anyway
+            i = static_cast<std::size_t>((key * 0x9e3779b97f4a7c15ull) >> 32) % strands_.size();
+        }
+        return *strands_[i];
+    }
+
+    bool has_work() const noexcept {
+        for (auto & q : queues_) {
+            if (!q->empty()) return true;
+        }
+        return false;
+    }
+
+    void wake(bool all) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers_.load(std::memory_order_relaxed) == 0) return;
+        std::lock_guard<std::mutex> guard {park_lock_};
+        if (all) park_cv_.notify_all();
+        else     park_cv_.notify_one();
+    }
+
+    void park() {
+        std::unique_lock<std::mutex> guard {park_lock_};
+        sleepers_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!has_work() && !done_.load(std::memory_order_acquire)) {
+            // the timeout is only a safety net
+            park_cv_.wait_for(guard, std::chrono::milliseconds(100));
+        }
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Returns true if the strand has been scheduled by it.
+    bool route(buff_t & buf, std::size_t channel) {
+        if (buf.size() < sizeof(header)) {
+            ipc::stats::add(dropped_);
+            return false;
+        }
+        header hd;
+        std::memcpy(&hd, buf.data(), sizeof(hd));
+        auto e = find(hd.type);
+        if (e == nullptr) {
+            ipc::stats::add(dropped_);
+            return false;
+        }
+        auto depth = e->received_.fetch_add(1, std::memory_order_relaxed) + 1
+                   - e->handled_.load(std::memory_order_relaxed);
+        if (depth > e->max_depth_.load(std::memory_order_relaxed)) {
+            e->max_depth_.store(depth, std::memory_order_relaxed);
+        }
+        item_t it {e, std::move(buf), channel, detail::timestamp()};
+        auto & s = strand_of(hd.key);
+        while (!s.push(it)) {
+            // it's full, so it's scheduled already
+            wake(true);
+            std::this_thread::yield();
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (s.scheduled_.exchange(true, std::memory_order_acq_rel)) return false;
+        // never full: a strand is in one queue at most
+        queues_.back()->push(&s);
+        return true;
+    }
+
+    void receive() {
+        while (!quit_.load(std::memory_order_acquire)) {
+            std::size_t index = 0;
+            buff_t buf = sel_.recv(&index);
+            std::size_t scheduled = 0;
+            for (std::size_t n = 0; !buf.empty();) {
+                if (route(buf, index)) ++scheduled;
+                if (++n >= opt_.batch) break;
+                buf = sel_.try_recv(&index);
+            }
+            if (scheduled != 0) wake(scheduled > 1);
+        }
+        done_.store(true, std::memory_order_release);
+        wake(true);
+    }
+
+    strand_t *take(std::size_t self) noexcept {
+        // its own first, then the receive loop's, then the other workers'
+        if (auto s = queues_[self]->steal()) return s;
+        auto n = queues_.size();
+        if (auto s = queues_[n - 1]->steal()) return s;
+        for (std::size_t i = 1; i + 1 < n; ++i) {
+            if (auto s = queues_[(self + i) % (n - 1)]->steal()) return s;
+        }
+        return nullptr;
+    }
+
+    static void invoke(item_t & it) {
+        auto e     = it.entry_;
+        auto start = detail::timestamp();
+        e->wait_.record(detail::stamp_to_ns(it.stamp_, start));
+        header hd;
+        std::memcpy(&hd, it.buf_.data(), sizeof(hd));
+        message m {hd.type, hd.key,
+                   static_cast<byte_t const *>(it.buf_.data()) + sizeof(hd),
+                   it.buf_.size() - sizeof(hd),
+                   it.channel_};
+        e->handler_(m);
+        e->run_.record(detail::stamp_to_ns(start, detail::timestamp()));
+        e->handled_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void run(strand_t & s, queue_t & own) {
+        for (std::size_t n = 0; n < opt_.batch; ++n) {
+            auto it = s.front();
+            if (it == nullptr) break;
+            invoke(*it);
+            s.pop();
+        }
+        if (!s.empty()) {
+            // behind the others
+            own.push(&s);
+            return;
+        }
+        s.scheduled_.store(false, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // the receive loop may have pushed before it's been unscheduled
+        if (!s.empty() && !s.scheduled_.exchange(true, std::memory_order_acq_rel)) {
+            own.push(&s);
+        }
+    }
+
+    void work(std::size_t self) {
+        auto & own = *queues_[self];
+        for (;;) {
+            if (auto s = take(self)) {
+                run(*s, own);
+                continue;
+            }
+            if (done_.load(std::memory_order_acquire) && !has_work()) break;
+            park();
+        }
+    }
+
+    bool start() {
+        std::lock_guard<std::mutex> guard {lock_};
+        if (started_) return false;
+        started_ = true;
+        for (std::size_t i = 0; i < opt_.strands; ++i) strands_.emplace_back(new strand_t);
+        for (std::size_t i = 0; i <= opt_.workers; ++i) queues_.emplace_back(new queue_t{opt_.strands});
+        for (std::size_t i = 0; i < opt_.workers; ++i) {
+            workers_.emplace_back([this, i] { work(i); });
+        }
+        receiver_ = std::thread{[this] { receive(); }};
+        return true;
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> guard {lock_};
+            if (!started_ || stopped_) return;
+            stopped_ = true;
+        }
+        quit_.store(true, std::memory_order_release);
+        sel_.wake();
+        receiver_.join();
+        for (auto & w : workers_) w.join();
+        workers_.clear();
+    }
+};
+
+dispatcher::dispatcher()
+    : dispatcher(options{}) {
+}
+
+dispatcher::dispatcher(options const & opt)
+    : p_(p_->make(opt)) {
+}
+
+dispatcher::~dispatcher() {
+    impl(p_)->stop();
+    p_->clear();
+}
+
+bool dispatcher::on(std::uint32_t type, handler_t handler) {
+    auto d = impl(p_);
+    std::lock_guard<std::mutex> guard {d->lock_};
+    if (d->started_ || !handler) return false;
+    d->entries_[type].reset(new dispatcher_::entry_t{std::move(handler)});
+    return true;
+}
+
+bool dispatcher::on_unknown(handler_t handler) {
+    auto d = impl(p_);
+    std::lock_guard<std::mutex> guard {d->lock_};
+    if (d->started_ || !handler) return false;
+    d->unknown_.reset(new dispatcher_::entry_t{std::move(handler)});
+    return true;
+}
+
+std::size_t dispatcher::add(ipc::handle_t h, select::attach_fn attach, select::detach_fn detach, select::recv_fn try_recv) {
+    auto d = impl(p_);
+    std::lock_guard<std::mutex> guard {d->lock_};
+    if (d->started_) {
+        ipc::error("fail dispatcher::add: it has been started\n");
+        return invalid_value;
+    }
+    return d->sel_.add(h, attach, detach, try_recv);
+}
+
+bool dispatcher::start() {
+    return impl(p_)->start();
+}
+
+void dispatcher::stop() {
+    impl(p_)->stop();
+}
+
+dispatcher::handler_stats dispatcher::stats(std::uint32_t type) const {
+    auto d = impl(p_);
+    std::lock_guard<std::mutex> guard {d->lock_};
+    auto it = d->entries_.find(type);
+    if (it == d->entries_.end()) return {};
+    auto const & e = *(it->second);
+    handler_stats st {};
+    st.received  = e.received_ .load(std::memory_order_relaxed);
+    st.handled   = e.handled_  .load(std::memory_order_relaxed);
+    st.depth     = (st.received > st.handled) ? (st.received - st.handled) : 0;
+    st.max_depth = e.max_depth_.load(std::memory_order_relaxed);
+    st.wait      = e.wait_.summary();
+    st.run       = e.run_ .summary();
+    return st;
+}
+
+std::uint64_t dispatcher::dropped() const noexcept {
+    return impl(p_)->dropped_.load(std::memory_order_relaxed);
+}
+
+} // namespace ipc
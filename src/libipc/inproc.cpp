@@ -0,0 +1,529 @@
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "libipc/inproc.h"
+#include "libipc/pool_alloc.h"
+#include "libipc/ready_table.h"
+#include "libipc/select_link.h"
+
+#include "libipc/utility/log.h"
+#include "libipc/memory/resource.h"
+
+namespace ipc {
+namespace detail {
+namespace inproc {
+namespace {
+
+constexpr char scheme[] = "inproc://";
+
+// A message shared by the queues it has been pushed to, the last reference frees it.
+struct message_t {
+    std::atomic<std::size_t> refs_ {1}; // the sender's, until it has been pushed
+    std::size_t              size_ = 0;
+    void *                   data_ = nullptr;
+    ipc::buff_t              owned_; // handed over by 'send(buff_t &&)', or the payload is right behind
+
+    std::size_t bytes() const noexcept {
+        return sizeof(message_t) + (owned_.empty() ? size_ : 0);
+    }
+};
+
+message_t *make_message(void const * data, std::size_t size) {
+    auto m = ::new (ipc::mem::alloc(sizeof(message_t) + size)) message_t;
+    m->size_ = size;
+    m->data_ = m + 1;
+    std::memcpy(m->data_, data, size);
+    return m;
+}
+
+message_t *make_message(ipc::buff_t && buff) {
+    auto m = ::new (ipc::mem::alloc(sizeof(message_t))) message_t;
+    m->owned_ = std::move(buff);
+    m->size_  = m->owned_.size();
+    m->data_  = m->owned_.data();
+    return m;
+}
+
+void release(message_t * m) noexcept {
+    if (m->refs_.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+    auto bytes = m->bytes();
+    m->~message_t();
+    ipc::mem::free(m, bytes);
+}
+
+struct queue_t {
+    std::deque<message_t *> msgs_;
+    std::size_t             bytes_ = 0;
+    std::uint64_t           lost_  = 0;
+
+    bool full() const noexcept {
+        return msgs_.size() >= ring_size;
+    }
+
+    void push(message_t * m) {
+        m->refs_.fetch_add(1, std::memory_order_relaxed);
+        msgs_.push_back(m);
+        bytes_ += m->size_;
+    }
+
+    message_t *pop() noexcept {
+        auto m = msgs_.front();
+        msgs_.pop_front();
+        bytes_ -= m->size_;
+        return m;
+    }
+
+    void clear() noexcept {
+        while (!msgs_.empty()) release(pop());
+    }
+};
+
+struct chan_t;
+
+struct conn_t {
+    chan_t *            chan_;
+    std::string         name_;
+    queue_t             own_;
+    queue_t *           que_;       // own_, or the one shared by the receivers of a unicast channel
+    bool                receiving_   = false;
+    std::size_t         select_slot_ = ready_table::max_slots;
+    std::size_t         writer_slot_ = ready_table::max_slots;
+    ipc::overflow       policy_      = ipc::overflow::disconnect;
+    std::size_t         spill_limit_ = ipc::default_spill_limit;
+    ipc::overflow_stats ovf_ {};
+};
+
+// All of it is guarded by lock_, except refs_ (by the lock of the registry).
+struct chan_t {
+    std::string key_;
+    kind_t      kind_;
+    std::size_t refs_ = 0;
+
+    std::mutex              lock_;
+    std::condition_variable readable_;
+    std::condition_variable writable_;
+    std::condition_variable conns_cv_;
+    std::size_t             readers_ = 0; // waiting for a message
+    std::size_t             writers_ = 0; // waiting for room
+    std::vector<conn_t *>   rcvs_;
+    queue_t                 shared_;
+
+    ready_table  selects_ {};
+    ready_table  writer_selects_ {}; // the senders waiting for room on a select
+    select_links links_;
+
+    chan_t(std::string key, kind_t kind)
+        : key_ {std::move(key)}
+        , kind_{kind} {}
+
+    // The queues a message of 'sender' goes to.
+    template <typename F>
+    void for_each_queue(conn_t const * sender, F && f) {
+        if (!kind_.broadcast) {
+            if (!rcvs_.empty()) f(shared_);
+            return;
+        }
+        for (auto r : rcvs_) {
+            if (kind_.multi_producer && (r == sender)) continue; // the messages to self are ignored
+            f(r->own_);
+        }
+    }
+
+    bool full(conn_t const * sender) {
+        if (kind_.lossy) return false;
+        bool ret = false;
+        for_each_queue(sender, [&ret](queue_t & q) { ret = ret || q.full(); });
+        return ret;
+    }
+
+    // Signals the selects of the senders waiting for room, after a pop, out of the lock.
+    void notify_writers() {
+        writer_selects_.notify([this](std::size_t slot, std::uint64_t token) {
+            return links_.signal(slot, token);
+        });
+    }
+
+    void leave(conn_t * c) {
+        if (!c->receiving_) return;
+        c->receiving_ = false;
+        rcvs_.erase(std::find(rcvs_.begin(), rcvs_.end(), c));
+        selects_.leave(std::exchange(c->select_slot_, ready_table::max_slots));
+        if (c->que_ == &(c->own_)) c->own_.clear();
+        else if (rcvs_.empty()) shared_.clear();
+        readable_.notify_all();
+        writable_.notify_all();
+        conns_cv_.notify_all();
+    }
+};
+
+// The channels of this process, by the prefix & the name & the kind.
+// It's never destroyed, the handles in the other static objects may outlive it.
+struct registry_t {
+    std::mutex                                lock_;
+    ipc::unordered_map<std::string, chan_t *> chans_;
+
+    static registry_t &instance() {
+        static auto *inst = new registry_t;
+        return *inst;
+    }
+};
+
+conn_t *conn_of(ipc::handle_t h) noexcept {
+    return reinterpret_cast<conn_t *>(reinterpret_cast<std::uintptr_t>(h) & ~std::uintptr_t(1));
+}
+
+ipc::handle_t handle_of(conn_t * c) noexcept {
+    return reinterpret_cast<ipc::handle_t>(reinterpret_cast<std::uintptr_t>(c) | 1);
+}
+
+template <typename F>
+bool wait_for(std::condition_variable & cv, std::unique_lock<std::mutex> & guard, std::uint64_t tm, F && pred) {
+    if (tm == ipc::invalid_value) {
+        cv.wait(guard, std::forward<F>(pred));
+        return true;
+    }
+    return cv.wait_for(guard, std::chrono::milliseconds(tm), std::forward<F>(pred));
+}
+
+// Waits for room in all the queues of the sender.
+bool wait_room(chan_t * ch, conn_t * c, std::unique_lock<std::mutex> & guard, std::uint64_t tm) {
+    ++(ch->writers_);
+    bool ret = wait_for(ch->writable_, guard, tm, [ch, c] { return !ch->full(c); });
+    --(ch->writers_);
+    return ret;
+}
+
+/**
+ * Pushes a message of 'c' to the queues of the receivers, with the overflow policy of 'c' if any one is full,
+ * or waiting for room up to 'tm' (try_send).
+*/
+bool push(conn_t * c, message_t * m, std::uint64_t tm, bool try_only) {
+    auto ch = c->chan_;
+    std::unique_lock<std::mutex> guard {ch->lock_};
+    if (ch->full(c)) {
+        ++(c->ovf_.full);
+        if (try_only) {
+            if (!wait_room(ch, c, guard, tm)) {
+                // the pops are under the lock, so the next one sees it armed
+                ch->writer_selects_.arm(c->writer_slot_);
+                return false;
+            }
+        }
+        else switch (c->policy_) {
+        case ipc::overflow::block:
+            ++(c->ovf_.blocked);
+            wait_room(ch, c, guard, ipc::invalid_value);
+            break;
+        case ipc::overflow::drop:
+            ++(c->ovf_.dropped);
+            return true;
+        case ipc::overflow::reject:
+            ++(c->ovf_.rejected);
+            return false;
+        case ipc::overflow::spill: {
+            // the queues are process-local already, they only grow beyond the ring up to the limit
+            bool fits = true;
+            ch->for_each_queue(c, [c, m, &fits](queue_t & q) {
+                fits = fits && (!q.full() || (q.bytes_ + m->size_ <= c->spill_limit_));
+            });
+            if (!fits) {
+                ++(c->ovf_.rejected);
+                return false;
+            }
+            ++(c->ovf_.spilled);
+            break;
+        }
+        default:
+            if (!wait_room(ch, c, guard, tm)) {
+                ipc::log("force_push: %s, disconnects the slow receivers\n", c->name_.c_str());
+                ++(c->ovf_.disconnected);
+                auto rcvs = ch->rcvs_;
+                for (auto r : rcvs) {
+                    if ((r != c || !ch->kind_.multi_producer) && r->que_->full()) ch->leave(r);
+                }
+            }
+            break;
+        }
+    }
+    std::size_t n = 0;
+    ch->for_each_queue(c, [ch, m, &n](queue_t & q) {
+        if (ch->kind_.lossy && q.full()) {
+            release(q.pop());
+            ++(q.lost_);
+        }
+        q.push(m);
+        ++n;
+    });
+    if (n == 0) {
+        ipc::error("fail: send, there is no receiver on this connection.\n");
+        return false;
+    }
+    if (ch->readers_ != 0) ch->readable_.notify_all();
+    guard.unlock();
+    ch->selects_.notify([ch](std::size_t slot, std::uint64_t token) {
+        return ch->links_.signal(slot, token);
+    });
+    return true;
+}
+
+bool send(ipc::handle_t h, message_t * m, std::uint64_t tm, bool try_only) {
+    bool ret = push(conn_of(h), m, tm, try_only);
+    release(m);
+    return ret;
+}
+
+} // internal-linkage
+
+bool selected(char const * name, unsigned mode) noexcept {
+    if ((mode & ipc::inproc) != 0) return true;
+    return (name != nullptr) && (std::strncmp(name, scheme, sizeof(scheme) - 1) == 0);
+}
+
+bool is(ipc::handle_t h) noexcept {
+    return (reinterpret_cast<std::uintptr_t>(h) & 1) != 0;
+}
+
+bool connect(ipc::handle_t * ph, kind_t kind, ipc::prefix pref, char const * name, bool start_to_recv) {
+    if (*ph == nullptr) {
+        std::string key {(pref.str == nullptr) ? "" : pref.str};
+        key.push_back('\0');
+        key += name;
+        key.push_back('\0');
+        key.push_back(static_cast<char>('0' + (kind.multi_producer ? 4 : 0) + (kind.broadcast ? 2 : 0) + (kind.lossy ? 1 : 0)));
+        auto &reg = registry_t::instance();
+        chan_t *ch = nullptr;
+        {
+            std::lock_guard<std::mutex> guard {reg.lock_};
+            auto it = reg.chans_.find(key);
+            if (it == reg.chans_.end()) {
+                ch = ipc::mem::alloc<chan_t>(key, kind);
+                reg.chans_.emplace(std::move(key), ch);
+            }
+            else ch = it->second;
+            ++(ch->refs_);
+        }
+        auto c = ipc::mem::alloc<conn_t>();
+        c->chan_ = ch;
+        c->name_ = name;
+        c->que_  = kind.broadcast ? &(c->own_) : &(ch->shared_);
+        *ph = handle_of(c);
+    }
+    return reconnect(ph, start_to_recv);
+}
+
+bool reconnect(ipc::handle_t * ph, bool start_to_recv) {
+    auto c  = conn_of(*ph);
+    auto ch = c->chan_;
+    std::lock_guard<std::mutex> guard {ch->lock_};
+    if (!start_to_recv) {
+        ch->leave(c);
+    }
+    else if (!c->receiving_) {
+        c->receiving_ = true;
+        c->own_.lost_ = 0;
+        ch->rcvs_.push_back(c);
+        ch->conns_cv_.notify_all();
+    }
+    return true;
+}
+
+void disconnect(ipc::handle_t h) {
+    auto c = conn_of(h);
+    if (c == nullptr) return;
+    std::lock_guard<std::mutex> guard {c->chan_->lock_};
+    c->chan_->leave(c);
+    c->chan_->writer_selects_.leave(std::exchange(c->writer_slot_, ready_table::max_slots));
+}
+
+void destroy(ipc::handle_t h) {
+    auto c = conn_of(h);
+    if (c == nullptr) return;
+    auto ch = c->chan_;
+    disconnect(h);
+    ipc::mem::free(c);
+    auto &reg = registry_t::instance();
+    std::lock_guard<std::mutex> guard {reg.lock_};
+    if (--(ch->refs_) != 0) return;
+    reg.chans_.erase(ch->key_);
+    ipc::mem::free(ch);
+}
+
+char const * name(ipc::handle_t h) {
+    auto c = conn_of(h);
+    return (c == nullptr) ? nullptr : c->name_.c_str();
+}
+
+std::size_t recv_count(ipc::handle_t h) {
+    auto ch = conn_of(h)->chan_;
+    std::lock_guard<std::mutex> guard {ch->lock_};
+    return ch->rcvs_.size();
+}
+
+bool wait_for_recv(ipc::handle_t h, std::size_t r_count, std::uint64_t tm) {
+    auto ch = conn_of(h)->chan_;
+    std::unique_lock<std::mutex> guard {ch->lock_};
+    return wait_for(ch->conns_cv_, guard, tm, [ch, r_count] { return ch->rcvs_.size() >= r_count; });
+}
+
+bool send(ipc::handle_t h, void const * data, std::size_t size, std::uint64_t tm) {
+    if (data == nullptr || size == 0) {
+        ipc::error("fail: send(%p, %zd)\n", data, size);
+        return false;
+    }
+    return send(h, make_message(data, size), tm, false);
+}
+
+bool send(ipc::handle_t h, ipc::buff_t && buff, std::uint64_t tm) {
+    if (buff.empty()) {
+        ipc::error("fail: send, the buffer is empty\n");
+        return false;
+    }
+    return send(h, make_message(std::move(buff)), tm, false);
+}
+
+bool try_send(ipc::handle_t h, void const * data, std::size_t size, std::uint64_t tm) {
+    if (data == nullptr || size == 0) {
+        ipc::error("fail: try_send(%p, %zd)\n", data, size);
+        return false;
+    }
+    return send(h, make_message(data, size), tm, true);
+}
+
+buff_t recv(ipc::handle_t h, std::uint64_t tm) {
+    auto c  = conn_of(h);
+    auto ch = c->chan_;
+    std::unique_lock<std::mutex> guard {ch->lock_};
+    if (!c->receiving_) {
+        return {};
+    }
+    auto ready = [c] { return !c->receiving_ || !c->que_->msgs_.empty(); };
+    if (!ready()) {
+        if (tm == 0) {
+            // the senders look at the armed slots after they have pushed, out of the lock
+            ch->selects_.arm(c->select_slot_);
+            return {};
+        }
+        ++(ch->readers_);
+        bool ret = wait_for(ch->readable_, guard, tm, ready);
+        --(ch->readers_);
+        if (!ret || !c->receiving_) return {};
+    }
+    auto m = c->que_->pop();
+    if (ch->writers_ != 0) ch->writable_.notify_all();
+    guard.unlock();
+    ch->notify_writers();
+    // the reference of the queue goes to the buffer
+    return ipc::buff_t{m->data_, m->size_, [](void * p, std::size_t) {
+        release(static_cast<message_t *>(p));
+    }, m};
+}
+
+ipc::lag_stats lag(ipc::handle_t h) {
+    auto c = conn_of(h);
+    std::lock_guard<std::mutex> guard {c->chan_->lock_};
+    if (!c->receiving_) return {};
+    ipc::lag_stats st {};
+    st.messages = st.slots = c->que_->msgs_.size();
+    st.bytes    = c->que_->bytes_;
+    return st;
+}
+
+std::size_t skip(ipc::handle_t h, std::size_t n) {
+    auto c  = conn_of(h);
+    auto ch = c->chan_;
+    std::unique_lock<std::mutex> guard {ch->lock_};
+    if (!c->receiving_) return 0;
+    std::size_t count = 0;
+    for (; (count < n) && !c->que_->msgs_.empty(); ++count) {
+        release(c->que_->pop());
+    }
+    if ((count != 0) && (ch->writers_ != 0)) ch->writable_.notify_all();
+    guard.unlock();
+    if (count != 0) ch->notify_writers();
+    return count;
+}
+
+std::uint64_t lost_count(ipc::handle_t h) {
+    auto c = conn_of(h);
+    std::lock_guard<std::mutex> guard {c->chan_->lock_};
+    return c->que_->lost_;
+}
+
+void set_overflow(ipc::handle_t h, ipc::overflow policy, std::size_t spill_limit) {
+    auto c = conn_of(h);
+    std::lock_guard<std::mutex> guard {c->chan_->lock_};
+    c->policy_      = policy;
+    c->spill_limit_ = spill_limit;
+}
+
+ipc::overflow_stats overflow_counters(ipc::handle_t h) {
+    auto c  = conn_of(h);
+    auto ch = c->chan_;
+    std::lock_guard<std::mutex> guard {ch->lock_};
+    auto st = c->ovf_;
+    // the messages beyond the ring
+    ch->for_each_queue(c, [&st](queue_t & q) {
+        if (q.msgs_.size() > ring_size) st.spill_depth += q.msgs_.size() - ring_size;
+    });
+    return st;
+}
+
+bool select_attach(ipc::handle_t h, std::uint64_t token) {
+    auto c  = conn_of(h);
+    auto ch = c->chan_;
+    std::lock_guard<std::mutex> guard {ch->lock_};
+    if (!c->receiving_) {
+        ipc::error("fail: select_attach, the handle isn't a connected receiver\n");
+        return false;
+    }
+    ch->selects_.leave(c->select_slot_);
+    c->select_slot_ = ch->selects_.join(token);
+    if (c->select_slot_ >= ready_table::max_slots) {
+        ipc::error("fail: select_attach, all the %zu slots are in use\n",
+                   static_cast<std::size_t>(ready_table::max_slots));
+        return false;
+    }
+    return true;
+}
+
+void select_detach(ipc::handle_t h) {
+    auto c = conn_of(h);
+    if (c == nullptr) return;
+    std::lock_guard<std::mutex> guard {c->chan_->lock_};
+    c->chan_->selects_.leave(std::exchange(c->select_slot_, ready_table::max_slots));
+}
+
+bool select_attach_writer(ipc::handle_t h, std::uint64_t token) {
+    auto c  = conn_of(h);
+    auto ch = c->chan_;
+    std::lock_guard<std::mutex> guard {ch->lock_};
+    ch->writer_selects_.leave(c->writer_slot_);
+    c->writer_slot_ = ch->writer_selects_.join(token);
+    if (c->writer_slot_ >= ready_table::max_slots) {
+        ipc::error("fail: select_attach_writer, all the %zu slots are in use\n",
+                   static_cast<std::size_t>(ready_table::max_slots));
+        return false;
+    }
+    return true;
+}
+
+void select_detach_writer(ipc::handle_t h) {
+    auto c = conn_of(h);
+    if (c == nullptr) return;
+    std::lock_guard<std::mutex> guard {c->chan_->lock_};
+    c->chan_->writer_selects_.leave(std::exchange(c->writer_slot_, ready_table::max_slots));
+}
+
+} // namespace inproc
+} // namespace detail
+} // namespace ipc
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "libipc/def.h"
+#include "libipc/ipc.h"
+
+namespace ipc {
+namespace detail {
+
+/**
+ * \brief The in-process transport of the channels (see ipc::inproc).
+ *
+ * A channel is a process-local object found by its name, no shared memory is named nor mapped.
+ * Each receiver has a queue of message pointers on the heap (the unicast receivers share one),
+ * a message is allocated once by 'send' and handed over to all the receivers as it is,
+ * so 'recv' never copies, and 'send(buff_t &&)' doesn't copy either.
+ * The senders & receivers wait on the condition variables of the channel.
+ *
+ * The handles of this transport are tagged (the lowest bit), chan_impl dispatches on 'is'.
+*/
+namespace inproc {
+
+enum : std::size_t {
+    ring_size = 256 // messages of a receiver, as many as the slots of a shared memory ring
+};
+
+struct kind_t {
+    bool multi_producer;
+    bool broadcast;
+    bool lossy;
+};
+
+template <typename Flag>
+constexpr kind_t kind_of() noexcept {
+    return { ipc::relat_trait<Flag>::is_multi_producer,
+             ipc::relat_trait<Flag>::is_broadcast,
+             ipc::relat_trait<Flag>::is_lossy };
+}
+
+/// \brief Whether a connection with this name & mode goes through this transport.
+bool selected(char const * name, unsigned mode) noexcept;
+bool is(ipc::handle_t h) noexcept;
+
+bool connect   (ipc::handle_t * ph, kind_t kind, ipc::prefix pref, char const * name, bool start_to_recv);
+bool reconnect (ipc::handle_t * ph, bool start_to_recv);
+void disconnect(ipc::handle_t h);
+void destroy   (ipc::handle_t h);
+
+char const * name(ipc::handle_t h);
+
+std::size_t recv_count   (ipc::handle_t h);
+bool        wait_for_recv(ipc::handle_t h, std::size_t r_count, std::uint64_t tm);
+
+bool   send    (ipc::handle_t h, void const * data, std::size_t size, std::uint64_t tm);
+bool   send    (ipc::handle_t h, ipc::buff_t && buff, std::uint64_t tm);
+bool   try_send(ipc::handle_t h, void const * data, std::size_t size, std::uint64_t tm);
+buff_t recv    (ipc::handle_t h, std::uint64_t tm);
+
+ipc::lag_stats lag       (ipc::handle_t h);
+std::size_t    skip      (ipc::handle_t h, std::size_t n);
+std::uint64_t  lost_count(ipc::handle_t h);
+
+void                set_overflow     (ipc::handle_t h, ipc::overflow policy, std::size_t spill_limit);
+ipc::overflow_stats overflow_counters(ipc::handle_t h);
+
+bool select_attach(ipc::handle_t h, std::uint64_t token);
+void select_detach(ipc::handle_t h);
+bool select_attach_writer(ipc::handle_t h, std::uint64_t token);
+void select_detach_writer(ipc::handle_t h);
+
+} // namespace inproc
+} // namespace detail
+} // namespace ipc
@@ -10,10 +10,15 @@
 #include <array>
 #include <cassert>
 #include <mutex>
+#include <deque>
+#include <thread>
+#include <condition_variable>
 
 #include "libipc/ipc.h"
+#include "libipc/typed_chan.h"
 #include "libipc/def.h"
 #include "libipc/shm.h"
+#include "libipc/stats.h"
 #include "libipc/pool_alloc.h"
 #include "libipc/queue.h"
 #include "libipc/policy.h"
@@ -27,6 +32,14 @@
 
 #include "libipc/memory/resource.h"
 #include "libipc/platform/detail.h"
+#include "libipc/platform/process.h"
+#include "libipc/platform/clock.h"
+#include "libipc/platform/ready_fd.h"
+#include "libipc/ready_table.h"
+#include "libipc/select_link.h"
+#include "libipc/inproc.h"
+#include "libipc/utility/trace.h"
+#include "libipc/utility/probe.h"
 #include "libipc/circ/elem_array.h"
 
 namespace {
@@ -35,42 +48,136 @@ using msg_id_t = std::uint32_t;
 // std::atomic<std::uint32_t>
 using acc_t    = std::atomic<msg_id_t>;
 
-// Ϣص
-template <std::size_t DataSize, std::size_t AlignSize>
-struct msg_t;
-
-// ݳΪƫػ
-template <std::size_t AlignSize>
-struct msg_t<0, AlignSize> {
-    msg_id_t     cc_id_;
-    msg_id_t     id_;
-    std::int32_t remain_; // ʣ೤
-    bool         storage_; // ڴǷ
+// The flags in the head of a slot.
+enum : unsigned {
+    msg_ids     = 1u << 0, // the producer id & the message id follow the head
+    msg_stamped = 1u << 1, // the send time follows (the ids)
+    msg_storage = 1u << 2, // the payload is the storage id of a large message
+    msg_flag_bits = 3
+};
+
+// The decoded head of a slot.
+struct msg_head_t {
+    std::uint64_t length; // bytes of the message from this slot to its end, or the size of a large message
+    unsigned      flags;
+    msg_id_t      cc_id;  // 0 if the slot doesn't carry the ids
+    msg_id_t      id;
+    std::uint64_t stamp;  // the send time (see ipc::detail::timestamp), 0 if not stamped
+    std::size_t   offset; // of the payload in the slot
 };
 
-// ݵƫػ
+constexpr std::size_t varint_size(std::uint64_t v) noexcept {
+    std::size_t n = 1;
+    while ((v >>= 7) != 0) ++n;
+    return n;
+}
+
+/**
+ * A slot of the byte channels:
+ *  - the head, a varint of 'length << msg_flag_bits | flags';
+ *  - the ids, only on the fragments & the large messages, or when the receivers need them
+ *    (to ignore the messages of their own connection, or to trace);
+ *  - the stamp, only when the timestamps are on;
+ *  - the payload, as much of the message as the rest of the slot could hold.
+ * A message which fits in a slot goes with one byte or two of header.
+*/
 template <std::size_t DataSize, std::size_t AlignSize>
-struct msg_t : msg_t<0, AlignSize> {
-    std::aligned_storage_t<DataSize, AlignSize> data_ {}; // ݴ洢ڴ
+struct msg_t {
+    std::aligned_storage_t<DataSize, AlignSize> data_; // ݴ洢ڴ
 
     msg_t() = default;
-    msg_t(msg_id_t cc_id, msg_id_t id, std::int32_t remain, void const * data, std::size_t size)
-        : msg_t<0, AlignSize> {cc_id, id, remain, (data == nullptr) || (size == 0)} {
-        if (this->storage_) {
-            if (data != nullptr) {
-                // copy storage-id
-                *reinterpret_cast<ipc::storage_id_t*>(&data_) =
-                     *static_cast<ipc::storage_id_t const *>(data);
+    msg_t(msg_id_t cc_id, msg_id_t id, std::uint64_t stamp, unsigned flags, std::uint64_t length, 
+          void const * data, std::size_t size) {
+        auto p = reinterpret_cast<ipc::byte_t *>(&data_);
+        if (stamp != 0) flags |= msg_stamped;
+        for (std::uint64_t v = (length << msg_flag_bits) | flags; ; v >>= 7) {
+            if (v < 0x80) {
+                *p++ = static_cast<ipc::byte_t>(v);
+                break;
             }
+            *p++ = static_cast<ipc::byte_t>(v | 0x80);
+        }
+        if (flags & msg_ids) {
+            std::memcpy(p, &cc_id, sizeof(cc_id)); p += sizeof(cc_id);
+            std::memcpy(p, &id   , sizeof(id)   ); p += sizeof(id);
+        }
+        if (flags & msg_stamped) {
+            std::memcpy(p, &stamp, sizeof(stamp)); p += sizeof(stamp);
+        }
+        std::memcpy(p, data, size);
+    }
+
+    // The payload bytes of a slot with this head.
+    constexpr static std::size_t capacity(std::uint64_t length, unsigned flags) noexcept {
+        std::size_t head = varint_size((length << msg_flag_bits) | flags) 
+                         + ((flags & msg_ids    ) ? 2 * sizeof(msg_id_t)   : 0)
+                         + ((flags & msg_stamped) ? sizeof(std::uint64_t) : 0);
+        return DataSize - head;
+    }
+
+    msg_head_t head() const noexcept {
+        auto p = reinterpret_cast<ipc::byte_t const *>(&data_);
+        std::uint64_t v = 0;
+        for (unsigned s = 0; ; s += 7) {
+            v |= static_cast<std::uint64_t>(*p & 0x7f) << s;
+            if ((*p++ & 0x80) == 0) break;
         }
-        else std::memcpy(&data_, data, size);
+        msg_head_t h {v >> msg_flag_bits, static_cast<unsigned>(v) & ((1u << msg_flag_bits) - 1), 0, 0, 0, 0};
+        if (h.flags & msg_ids) {
+            std::memcpy(&h.cc_id, p, sizeof(h.cc_id)); p += sizeof(h.cc_id);
+            std::memcpy(&h.id   , p, sizeof(h.id)   ); p += sizeof(h.id);
+        }
+        if (h.flags & msg_stamped) {
+            std::memcpy(&h.stamp, p, sizeof(h.stamp)); p += sizeof(h.stamp);
+        }
+        h.offset = static_cast<std::size_t>(p - reinterpret_cast<ipc::byte_t const *>(&data_));
+        return h;
+    }
+
+    void const * payload(msg_head_t const & h) const noexcept {
+        return reinterpret_cast<ipc::byte_t const *>(&data_) + h.offset;
+    }
+
+    // The payload bytes of the message in this slot.
+    std::size_t size_of(msg_head_t const & h) const noexcept {
+        return static_cast<std::size_t>((ipc::detail::min)(h.length, static_cast<std::uint64_t>(DataSize - h.offset)));
+    }
+
+    ipc::storage_id_t storage_id(msg_head_t const & h) const noexcept {
+        ipc::storage_id_t id;
+        std::memcpy(&id, payload(h), sizeof(id));
+        return id;
+    }
+};
+
+enum : std::size_t {
+    msg_align = alignof(std::max_align_t)
+};
+
+/**
+ * The slot size of the byte channels of a policy:
+ * a whole element of the ring (the slot & the policy's own counters) takes two cache lines.
+*/
+template <typename Policy>
+constexpr std::size_t msg_size_of() noexcept {
+    using elem_t = typename Policy::template elems_t<ipc::cache_line_size, msg_align>::elem_t;
+    return 2 * ipc::cache_line_size - (sizeof(elem_t) - ipc::cache_line_size);
+}
+
+// The slot of a typed channel (see ipc::typed_chan): the message itself, without any header.
+template <std::size_t DataSize, std::size_t AlignSize>
+struct slot_t {
+    std::aligned_storage_t<DataSize, AlignSize> data_;
+
+    slot_t(void const * data, std::size_t size) {
+        std::memcpy(&data_, data, size);
     }
 };
 
-template <typename T>
-ipc::buff_t make_cache(T& data, std::size_t size) {
+// A buffer of 'size' bytes, with the first 'fill' of them copied from 'data'.
+ipc::buff_t make_cache(void const * data, std::size_t fill, std::size_t size) {
     auto ptr = ipc::mem::alloc(size);
-    std::memcpy(ptr, &data, (ipc::detail::min)(sizeof(data), size));
+    std::memcpy(ptr, data, (ipc::detail::min)(fill, size));
     return { ptr, size, ipc::mem::free };
 }
 
@@ -108,25 +215,163 @@ struct cache_t {
     }
 };
 
+// Counters of the overflow policies of a sender, process-local.
+struct overflow_counter_t {
+    std::atomic<std::uint64_t> full_         {0};
+    std::atomic<std::uint64_t> blocked_      {0};
+    std::atomic<std::uint64_t> dropped_      {0};
+    std::atomic<std::uint64_t> rejected_     {0};
+    std::atomic<std::uint64_t> disconnected_ {0};
+    std::atomic<std::uint64_t> spilled_      {0};
+    std::atomic<std::uint64_t> backoff_      {0}; // us
+
+    // Doubles the backoff hint on every consecutive rejection.
+    void reject() noexcept {
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+        std::uint64_t hint = backoff_.load(std::memory_order_relaxed);
+        backoff_.store((ipc::detail::min)((hint == 0) ? std::uint64_t(1) : hint * 2, 
+                                          std::uint64_t(ipc::default_timeout) * 1000), 
+                       std::memory_order_relaxed);
+    }
+
+    void succeed() noexcept {
+        if (backoff_.load(std::memory_order_relaxed) != 0) {
+            backoff_.store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+// The process-local queue of the spill policy, drained by a background thread.
+struct spill_t {
+    std::mutex              lock_;
+    std::condition_variable cv_;
+    std::deque<ipc::buff_t> que_;
+    std::size_t             bytes_  = 0;
+    std::size_t             limit_  = 0;
+    std::atomic<bool>       quit_   {false}; // read by the drainer out of the lock, while it waits for room
+    std::thread             drainer_;
+
+    enum : std::uint64_t {
+        retry_ms = 10 // how often a drainer which waits for room checks whether it should quit
+    };
+};
+
+// The receivers which wait outside of recv, in shared memory (RF_CONN__).
+struct parked_t {
+    ipc::detail::ready_table receivers_; // the ready fds & the selects, see ready_fd & ipc::select
+    ipc::detail::ready_table writers_;   // the senders waiting for room, see select_attach_writer
+};
+
+// The names of the shared objects of a connection besides its ring.
+// A typed channel & a byte channel could have the same name, so they have tags of their own.
+struct conn_tags_t {
+    char const *cc, *wt, *rd, *ac, *st, *rf;
+};
+
+constexpr conn_tags_t conn_tags {"CC_CONN__", "WT_CONN__", "RD_CONN__", "AC_CONN__", "ST_CONN__", "RF_CONN__"};
+constexpr conn_tags_t slot_tags {"CC_SLOT__", "WT_SLOT__", "RD_SLOT__", "AC_SLOT__", "ST_SLOT__", "RF_SLOT__"};
+
 // Ϣͷ
 struct conn_info_head {
 
     ipc::string prefix_;
     ipc::string name_;
+    conn_tags_t tags_;
     msg_id_t    cc_id_; // connection-info id
     ipc::detail::waiter cc_waiter_, wt_waiter_, rd_waiter_;
     ipc::shm::handle acc_h_;
-
-    conn_info_head(char const * prefix, char const * name)
+    ipc::shm::handle stats_h_;
+    ipc::shm::handle parked_h_;
+    ipc::detail::ready_fd ready_;  // opened by the first call of ready_fd()
+    std::size_t select_slot_ = ipc::detail::ready_table::max_slots;
+    std::atomic<std::size_t> writer_slot_ {ipc::detail::ready_table::max_slots}; // armed by any sending thread
+    std::atomic<ipc::detail::select_links *> select_links_ {nullptr};
+    ipc::shm::numa_policy chunk_numa_;
+    std::uint16_t trace_name_ = 0;
+    ipc::hook_fn  hook_       = nullptr;
+    unsigned      hook_mask_  = 0;
+
+    std::atomic<ipc::overflow> overflow_ {ipc::overflow::disconnect};
+    std::size_t        spill_limit_ = 0;
+    overflow_counter_t ovf_;
+    std::mutex         spill_lock_; // guards spill_, taken before spill_t::lock_
+    spill_t *          spill_       = nullptr;
+
+    // The messages which 'skip' has stopped in the middle of, 'recv' drops the rest of their fragments.
+    std::vector<msg_id_t> skipped_;
+
+    // The stats slot of this producer, claimed by its first send & released when it disconnects.
+    std::atomic<std::size_t> producer_slot_ {ipc::stats::producer_max};
+
+    // Bumped by whatever makes the prepared calls stale, see detail_impl::prepare.
+    std::atomic<std::uint32_t> prepared_epoch_ {0};
+
+    conn_info_head(char const * prefix, char const * name, conn_tags_t const & tags)
         : prefix_{ipc::make_string(prefix)}
         , name_  {ipc::make_string(name)}
+        , tags_  {tags}
         , cc_id_ {} {}
 
+    ~conn_info_head() {
+        stop_spill();
+        release_producer();
+        unpark();
+        leave_writer();
+        ipc::mem::free(select_links_.load(std::memory_order_acquire));
+    }
+
+    // Called with spill_lock_ held.
+    spill_t &spill() {
+        if (spill_ == nullptr) {
+            spill_ = ipc::mem::alloc<spill_t>();
+            spill_->limit_ = spill_limit_;
+        }
+        return *spill_;
+    }
+
+    // The messages which are still in the spill queue are discarded.
+    void stop_spill() {
+        spill_t *sp;
+        {
+            // waits for the sends which are queueing their messages, the drainer doesn't take it
+            std::lock_guard<std::mutex> guard {spill_lock_};
+            sp = std::exchange(spill_, nullptr);
+        }
+        if (sp == nullptr) return;
+        {
+            std::lock_guard<std::mutex> guard {sp->lock_};
+            sp->quit_.store(true, std::memory_order_release);
+        }
+        sp->cv_.notify_all();
+        wt_waiter_.broadcast(); // the drainer may be waiting for room
+        if (sp->drainer_.joinable()) {
+            sp->drainer_.join();
+        }
+        ovf_.dropped_.fetch_add(sp->que_.size(), std::memory_order_relaxed);
+        ipc::mem::free(sp);
+    }
+
     void init() {
-        if (!cc_waiter_.valid()) cc_waiter_.open(ipc::make_prefix(prefix_, {"CC_CONN__", name_}).c_str());
-        if (!wt_waiter_.valid()) wt_waiter_.open(ipc::make_prefix(prefix_, {"WT_CONN__", name_}).c_str());
-        if (!rd_waiter_.valid()) rd_waiter_.open(ipc::make_prefix(prefix_, {"RD_CONN__", name_}).c_str());
-        if (!acc_h_.valid()) acc_h_.acquire(ipc::make_prefix(prefix_, {"AC_CONN__", name_}).c_str(), sizeof(acc_t));
+        if (!cc_waiter_.valid()) cc_waiter_.open(ipc::make_prefix(prefix_, {tags_.cc, name_}).c_str());
+        if (!wt_waiter_.valid()) wt_waiter_.open(ipc::make_prefix(prefix_, {tags_.wt, name_}).c_str());
+        if (!rd_waiter_.valid()) rd_waiter_.open(ipc::make_prefix(prefix_, {tags_.rd, name_}).c_str());
+        if (!acc_h_.valid()) acc_h_.acquire(ipc::make_prefix(prefix_, {tags_.ac, name_}).c_str(), sizeof(acc_t));
+        if (!parked_h_.valid()) {
+            parked_h_.acquire(ipc::make_prefix(prefix_, {tags_.rf, name_}).c_str(), sizeof(parked_t));
+        }
+        if (trace_name_ == 0) {
+            trace_name_ = ipc::detail::trace::intern((prefix_.empty() ? name_ : (prefix_ + "/" + name_)).c_str());
+        }
+#if !defined(LIBIPC_DISABLE_STATS)
+        if (!stats_h_.valid() && 
+             stats_h_.acquire(ipc::make_prefix(prefix_, {tags_.st, name_}).c_str(), sizeof(ipc::stats::channel))) {
+            auto st = stats();
+            std::uint32_t magic = 0;
+            if ((st != nullptr) && st->magic.compare_exchange_strong(magic, ipc::stats::magic, std::memory_order_relaxed)) {
+                st->version.store(ipc::stats::version, std::memory_order_relaxed);
+            }
+        }
+#endif
         if (cc_id_ != 0) {
             return;
         }
@@ -143,19 +388,24 @@ struct conn_info_head {
     }
 
     void clear() noexcept {
+        release_producer();
         cc_waiter_.clear();
         wt_waiter_.clear();
         rd_waiter_.clear();
         acc_h_.clear();
+        stats_h_.clear();
+        parked_h_.clear();
     }
 
-    static void clear_storage(char const * prefix, char const * name) noexcept {
+    static void clear_storage(char const * prefix, char const * name, conn_tags_t const & tags) noexcept {
         auto p = ipc::make_string(prefix);
         auto n = ipc::make_string(name);
-        ipc::detail::waiter::clear_storage(ipc::make_prefix(p, {"CC_CONN__", n}).c_str());
-        ipc::detail::waiter::clear_storage(ipc::make_prefix(p, {"WT_CONN__", n}).c_str());
-        ipc::detail::waiter::clear_storage(ipc::make_prefix(p, {"RD_CONN__", n}).c_str());
-        ipc::shm::handle::clear_storage(ipc::make_prefix(p, {"AC_CONN__", n}).c_str());
+        ipc::detail::waiter::clear_storage(ipc::make_prefix(p, {tags.cc, n}).c_str());
+        ipc::detail::waiter::clear_storage(ipc::make_prefix(p, {tags.wt, n}).c_str());
+        ipc::detail::waiter::clear_storage(ipc::make_prefix(p, {tags.rd, n}).c_str());
+        ipc::shm::handle::clear_storage(ipc::make_prefix(p, {tags.ac, n}).c_str());
+        ipc::shm::handle::clear_storage(ipc::make_prefix(p, {tags.st, n}).c_str());
+        ipc::shm::handle::clear_storage(ipc::make_prefix(p, {tags.rf, n}).c_str());
     }
 
     void quit_waiting() {
@@ -169,6 +419,177 @@ struct conn_info_head {
         return static_cast<acc_t*>(acc_h_.get());
     }
 
+    // Always nullptr with LIBIPC_DISABLE_STATS, so that all the counting is compiled out.
+    ipc::stats::channel *stats() noexcept {
+#if defined(LIBIPC_DISABLE_STATS)
+        return nullptr;
+#else
+        return static_cast<ipc::stats::channel*>(stats_h_.get());
+#endif
+    }
+
+    ipc::detail::ready_table *ready_receivers() noexcept {
+        auto p = static_cast<parked_t*>(parked_h_.get());
+        return (p == nullptr) ? nullptr : &(p->receivers_);
+    }
+
+    ipc::detail::ready_table *ready_writers() noexcept {
+        auto p = static_cast<parked_t*>(parked_h_.get());
+        return (p == nullptr) ? nullptr : &(p->writers_);
+    }
+
+    ipc::detail::select_links &select_links() {
+        auto p = select_links_.load(std::memory_order_acquire);
+        if (p == nullptr) {
+            auto q = ipc::mem::alloc<ipc::detail::select_links>();
+            if (select_links_.compare_exchange_strong(p, q, std::memory_order_acq_rel)) p = q;
+            else ipc::mem::free(q);
+        }
+        return *p;
+    }
+
+    // Whether this receiver waits outside of recv, by a ready_fd or an ipc::select.
+    bool parkable() const noexcept {
+        return ready_.valid() || (select_slot_ < ipc::detail::ready_table::max_slots);
+    }
+
+    // Called when try_recv has found the ring empty, see ready_table::arm.
+    void park() noexcept {
+        ready_.park(ready_receivers());
+        if (auto tb = ready_receivers()) tb->arm(select_slot_);
+    }
+
+    void leave_select() noexcept {
+        if (auto tb = ready_receivers()) tb->leave(select_slot_);
+        select_slot_ = ipc::detail::ready_table::max_slots;
+    }
+
+    void unpark() noexcept {
+        ready_.close(ready_receivers());
+        leave_select();
+    }
+
+    void leave_writer() noexcept {
+        auto slot = writer_slot_.exchange(ipc::detail::ready_table::max_slots, std::memory_order_acq_rel);
+        if (auto tb = ready_writers()) tb->leave(slot);
+    }
+
+    /**
+     * Called when try_send has found the ring full, see ready_table::arm.
+     * False if no select waits for room on this sender.
+    */
+    bool park_writer() noexcept {
+        auto slot = writer_slot_.load(std::memory_order_acquire);
+        auto tb   = ready_writers();
+        if ((slot >= ipc::detail::ready_table::max_slots) || (tb == nullptr)) return false;
+        tb->arm(slot);
+        return true;
+    }
+
+    // Wakes up the senders waiting for room, the blocking ones & the ones parked on a select, after a pop.
+    void notify_writers() {
+        wt_waiter_.broadcast();
+        if (auto tb = ready_writers()) {
+            tb->notify([this](std::size_t slot, std::uint64_t token) {
+                return select_links().signal(slot, token);
+            });
+        }
+    }
+
+    // Wakes up the receivers, the blocking ones & the ones parked outside of recv (nothing more if none is armed).
+    void notify_receivers() {
+        rd_waiter_.broadcast();
+        if (auto tb = ready_receivers()) {
+            tb->notify([this, tb](std::size_t slot, std::uint64_t token) {
+                return tb->by_select(slot) ? select_links().signal(slot, token)
+                                           : ipc::detail::ready_fd::signal(token);
+            });
+        }
+    }
+
+    ipc::stats::producer_t *producer_stats() noexcept {
+        auto st = stats();
+        if (st == nullptr) return nullptr;
+        auto slot = producer_slot_.load(std::memory_order_acquire);
+        if (slot == ipc::stats::producer_max) {
+            auto claimed = claim_producer(*st);
+            if (producer_slot_.compare_exchange_strong(slot, claimed, std::memory_order_acq_rel)) {
+                slot = claimed;
+            }
+            else release_producer(*st, claimed); // another thread of this connection has claimed one
+        }
+        // all the slots are in use, share one by the connection id
+        return (slot < ipc::stats::producer_max) ? &(st->producers[slot]) : &(st->producer(cc_id_));
+    }
+
+    void release_producer() noexcept {
+        // the prepared senders keep the slot
+        unprepare();
+        auto slot = producer_slot_.exchange(ipc::stats::producer_max, std::memory_order_acq_rel);
+        if (auto st = stats()) release_producer(*st, slot);
+    }
+
+    void unprepare() noexcept {
+        prepared_epoch_.fetch_add(1, std::memory_order_acq_rel);
+    }
+
+    // Whether what has been kept by 'prepare' has gone stale since.
+    bool unprepared(std::uint32_t epoch) const noexcept {
+        return epoch != prepared_epoch_.load(std::memory_order_acquire);
+    }
+
+    // The counters of a slot move to the channel, so that the depths of the receivers still add up.
+    static void retire_producer(ipc::stats::channel &st, ipc::stats::producer_t &p) noexcept {
+        st.retired.fetch_add(p.fragments.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+        for (auto *c : {&p.messages, &p.bytes, &p.large, &p.failures, &p.parks, &p.force_pushes}) {
+            c->store(0, std::memory_order_relaxed);
+        }
+    }
+
+    static void release_producer(ipc::stats::channel &st, std::size_t slot) noexcept {
+        if (slot >= ipc::stats::producer_max) return;
+        auto &p = st.producers[slot];
+        p.pid_ns.store(0, std::memory_order_relaxed);
+        retire_producer(st, p);
+        p.pid.store(0, std::memory_order_release);
+    }
+
+    /**
+     * Claims a free producer slot like the receivers do with their connection bits,
+     * or takes over the slot of a producer which has died without releasing it.
+     * Returns producer_max + 1 if all the slots are in use.
+    */
+    static std::size_t claim_producer(ipc::stats::channel &st) noexcept {
+        auto pid = ipc::detail::this_process();
+        auto take = [&](std::size_t i, std::uint32_t owner) {
+            auto &p = st.producers[i];
+            if (!p.pid.compare_exchange_strong(owner, pid, std::memory_order_acquire, std::memory_order_relaxed)) {
+                return false;
+            }
+            retire_producer(st, p); // the dead owner's, or the ones counted by the sharing producers
+            p.pid_ns.store(ipc::detail::this_pid_ns(), std::memory_order_release);
+            return true;
+        };
+        for (std::size_t i = 0; i < ipc::stats::producer_max; ++i) {
+            if (take(i, 0)) return i;
+        }
+        for (std::size_t i = 0; i < ipc::stats::producer_max; ++i) {
+            auto &p = st.producers[i];
+            auto owner = p.pid.load(std::memory_order_acquire);
+            if ((owner != 0) && !ipc::detail::process_alive(owner, p.pid_ns.load(std::memory_order_acquire))
+                             && take(i, owner)) {
+                return i;
+            }
+        }
+        return ipc::stats::producer_max + 1;
+    }
+
+    void fire(ipc::hook_event e, std::uint32_t msg_id, std::int64_t value) {
+        if ((hook_mask_ & ipc::hook_bit(e)) != 0) {
+            hook_(e, ipc::hook_info {name_.c_str(), msg_id, value});
+        }
+    }
+
     auto& recv_cache() {
         // thread_local ڴӵһηʿʼ߳̽
         thread_local ipc::unordered_map<msg_id_t, cache_t> tls;
@@ -176,6 +597,19 @@ struct conn_info_head {
     }
 };
 
+// Fires the USDT probe libipc:EVT & the hook of the connection.
+#define IPC_HOOK_(INF, EVT, ID, VAL)                                                  \
+    do {                                                                               \
+        IPC_PROBE_(EVT, (INF)->name_.c_str(), static_cast<std::uint32_t>(ID),          \
+                                              static_cast<std::int64_t>(VAL));          \
+        (INF)->fire(ipc::hook_event::EVT, static_cast<std::uint32_t>(ID),               \
+                                          static_cast<std::int64_t>(VAL));              \
+    } while (0)
+
+ipc::stats::channel *stats_of(conn_info_head *inf) noexcept {
+    return (inf == nullptr) ? nullptr : inf->stats();
+}
+
 IPC_CONSTEXPR_ std::size_t align_chunk_size(std::size_t size) noexcept {
     return (((size - 1) / ipc::large_msg_align) + 1) * ipc::large_msg_align;
 }
@@ -219,10 +653,11 @@ auto& chunk_storages() {
         ipc::unordered_map<ipc::string, ipc::shm::handle> handles_;
         std::mutex lock_;
 
-        static bool make_handle(ipc::shm::handle &h, ipc::string const &shm_name, std::size_t chunk_size) {
+        static bool make_handle(ipc::shm::handle &h, ipc::string const &shm_name, std::size_t chunk_size,
+                                ipc::shm::numa_policy const &numa) {
             if (!h.valid() &&
                 !h.acquire( shm_name.c_str(), 
-                            sizeof(chunk_info_t) + chunk_info_t::chunks_mem_size(chunk_size) )) {
+                            sizeof(chunk_info_t) + chunk_info_t::chunks_mem_size(chunk_size), numa )) {
                 ipc::error("[chunk_storages] chunk_shm.id_info_.acquire failed: chunk_size = %zd\n", chunk_size);
                 return false;
             }
@@ -237,7 +672,8 @@ auto& chunk_storages() {
             {
                 std::lock_guard<std::mutex> guard {lock_};
                 h = &(handles_[pref]);
-                if (!make_handle(*h, shm_name, chunk_size)) {
+                if (!make_handle(*h, shm_name, chunk_size, 
+                                 (inf == nullptr) ? ipc::shm::numa_policy{} : inf->chunk_numa_)) {
                     return nullptr;
                 }
             }
@@ -248,6 +684,16 @@ auto& chunk_storages() {
             }
             return info;
         }
+
+        ipc::shm::handle *find_handle(conn_info_head *inf) {
+            ipc::string pref {(inf == nullptr) ? ipc::string{} : inf->prefix_};
+            std::lock_guard<std::mutex> guard {lock_};
+            auto it = handles_.find(pref);
+            if ((it == handles_.end()) || !it->second.valid()) {
+                return nullptr;
+            }
+            return &(it->second);
+        }
     };
     using deleter_t = void (*)(chunk_handle_t*);
     using chunk_handle_ptr_t = std::unique_ptr<chunk_handle_t, deleter_t>;
@@ -255,11 +701,16 @@ auto& chunk_storages() {
     return chunk_hs;
 }
 
+ipc::rw_lock &chunk_storages_lock() {
+    static ipc::rw_lock lock;
+    return lock;
+}
+
 chunk_info_t *chunk_storage_info(conn_info_head *inf, std::size_t chunk_size) {
     auto &storages = chunk_storages();
     std::decay_t<decltype(storages)>::iterator it;
     {
-        static ipc::rw_lock lock;
+        auto &lock = chunk_storages_lock();
         IPC_UNUSED_ std::shared_lock<ipc::rw_lock> guard {lock};
         if ((it = storages.find(chunk_size)) == storages.end()) {
             using chunk_handle_ptr_t = std::decay_t<decltype(storages)>::value_type::second_type;
@@ -275,6 +726,17 @@ chunk_info_t *chunk_storage_info(conn_info_head *inf, std::size_t chunk_size) {
     return it->second->get_info(inf, chunk_size);
 }
 
+// Visits the chunk storages which have been mapped under the prefix of 'inf'.
+template <typename F>
+void for_each_chunk_storage(conn_info_head *inf, F &&f) {
+    auto &storages = chunk_storages();
+    IPC_UNUSED_ std::shared_lock<ipc::rw_lock> guard {chunk_storages_lock()};
+    for (auto &pair : storages) {
+        auto *h = pair.second->find_handle(inf);
+        if (h != nullptr) f(*h);
+    }
+}
+
 std::pair<ipc::storage_id_t, void*> acquire_storage(conn_info_head *inf, std::size_t size, ipc::circ::cc_t conns) {
     std::size_t chunk_size = calc_chunk_size(size);
     auto info = chunk_storage_info(inf, chunk_size);
@@ -289,6 +751,7 @@ std::pair<ipc::storage_id_t, void*> acquire_storage(conn_info_head *inf, std::si
     auto chunk = info->at(chunk_size, id);
     if (chunk == nullptr) return {};
     chunk->conns().store(conns, std::memory_order_relaxed);
+    if (auto st = stats_of(inf)) ipc::stats::add(st->chunks);
     return { id, chunk->data() };
 }
 
@@ -314,6 +777,7 @@ void release_storage(ipc::storage_id_t id, conn_info_head *inf, std::size_t size
     info->lock_.lock();
     info->pool_.release(id);
     info->lock_.unlock();
+    if (auto st = stats_of(inf)) ipc::stats::sub(st->chunks);
 }
 
 template <ipc::relat Rp, ipc::relat Rc>
@@ -322,6 +786,12 @@ bool sub_rc(ipc::wr<Rp, Rc, ipc::trans::unicast>,
     return true;
 }
 
+template <ipc::relat Rp, ipc::relat Rc>
+bool sub_rc(ipc::wr<Rp, Rc, ipc::trans::overwrite>, 
+            std::atomic<ipc::circ::cc_t> &/*conns*/, ipc::circ::cc_t /*curr_conns*/, ipc::circ::cc_t /*conn_id*/) noexcept {
+    return true;
+}
+
 template <ipc::relat Rp, ipc::relat Rc>
 bool sub_rc(ipc::wr<Rp, Rc, ipc::trans::broadcast>, 
             std::atomic<ipc::circ::cc_t> &conns, ipc::circ::cc_t curr_conns, ipc::circ::cc_t conn_id) noexcept {
@@ -354,31 +824,40 @@ void recycle_storage(ipc::storage_id_t id, conn_info_head *inf, std::size_t size
     info->lock_.lock();
     info->pool_.release(id);
     info->lock_.unlock();
+    if (auto st = stats_of(inf)) ipc::stats::sub(st->chunks);
 }
 
 template <typename MsgT>
 bool clear_message(conn_info_head *inf, void* p) {
     auto msg = static_cast<MsgT*>(p);
-    if (msg->storage_) {
-        std::int32_t r_size = static_cast<std::int32_t>(ipc::data_length) + msg->remain_;
-        if (r_size <= 0) {
-            ipc::error("[clear_message] invalid msg size: %d\n", (int)r_size);
+    auto h   = msg->head();
+    if (h.flags & msg_storage) {
+        if (h.length == 0) {
+            ipc::error("[clear_message] invalid msg size: 0\n");
             return true;
         }
-        release_storage(*reinterpret_cast<ipc::storage_id_t*>(&msg->data_),
-                        inf, static_cast<std::size_t>(r_size));
+        release_storage(msg->storage_id(h), inf, static_cast<std::size_t>(h.length));
     }
     return true;
 }
 
 // ѭִpred ֱ䷵false
+template <typename S>
+ipc::stats::counter_t *parks_of(S *s) noexcept {
+    return (s == nullptr) ? nullptr : &(s->parks);
+}
+
 template <typename W, typename F>
-bool wait_for(W& waiter, F&& pred, std::uint64_t tm) {
+bool wait_for(W& waiter, F&& pred, std::uint64_t tm, 
+              ipc::stats::counter_t *parks = nullptr, conn_info_head *inf = nullptr) {
     if (tm == 0) return !pred();
     for (unsigned k = 0; pred();) {
         bool ret = true;
-        ipc::sleep(k, [&k, &ret, &waiter, &pred, tm] {
+        ipc::sleep(k, [&k, &ret, &waiter, &pred, tm, parks, inf] {
+            if (parks != nullptr) ipc::stats::add(*parks);
+            if (inf   != nullptr) IPC_HOOK_(inf, park, 0, 0);
             ret = waiter.wait_if(std::forward<F>(pred), tm);
+            if (inf   != nullptr) IPC_HOOK_(inf, wake, 0, ret);
             k   = 0;
         });
         if (!ret) return false; // timeout or fail
@@ -388,28 +867,65 @@ bool wait_for(W& waiter, F&& pred, std::uint64_t tm) {
 }
 
 // Policy = ipc::policy::choose<ipc::circ::elem_array,ipc::wr<1,1,1>>
+// Msg = msg_t (the fragments of the byte channels), or slot_t (the typed channels)
 template <typename Policy,
-          std::size_t DataSize  = ipc::data_length,
-          std::size_t AlignSize = (ipc::detail::min)(DataSize, alignof(std::max_align_t))>
+          std::size_t DataSize  = msg_size_of<Policy>(),
+          std::size_t AlignSize = (ipc::detail::min)(DataSize, alignof(std::max_align_t)),
+          typename    Msg       = msg_t<DataSize, AlignSize>>
 struct queue_generator {
 
-    using queue_t = ipc::queue<msg_t<DataSize, AlignSize>, Policy>;
+    using queue_t = ipc::queue<Msg, Policy>;
+
+    // the rings of both kinds could have the same name & data size
+    constexpr static bool is_bytes = std::is_same<Msg, msg_t<DataSize, AlignSize>>::value;
+    constexpr static char const * queue_tag = is_bytes ? "QU_CONN__" : "QU_SLOT__";
+    constexpr static conn_tags_t const & tags = is_bytes ? conn_tags : slot_tags;
+
+    static_assert(!is_bytes || 
+                  (queue_t::elems_t::elem_size == 2 * ipc::cache_line_size), "a slot of a byte channel should take two cache lines");
 
     struct conn_info_t : conn_info_head {
         queue_t que_; // ݶ
 
+        // What 'send' needs of a connection, see detail_impl::ready_to_send.
+        struct sender_t {
+            conn_info_t *              inf;
+            queue_t *                  que;
+            typename queue_t::elems_t *elems;
+            acc_t *                    acc;
+            ipc::stats::channel *      st;
+            ipc::stats::producer_t *   ps;
+            std::uint32_t              epoch;
+        };
+
+        // What 'recv' needs of a connection, see detail_impl::ready_to_recv.
+        struct receiver_t {
+            conn_info_t *             inf;
+            queue_t *                 que;
+            ipc::stats::receiver_t *  rs;
+            std::uint32_t             epoch;
+        };
+
+        // Cached by 'prepare' for the prepared senders & receivers.
+        sender_t   prepared_ {};
+        receiver_t prepared_recv_ {};
+
         conn_info_t(char const * pref, char const * name)
-            : conn_info_head{pref, name} { init(); }
+            : conn_info_head{pref, name, tags} { init(); }
 
         void init() {
             conn_info_head::init();
             if (!que_.valid()) {
                 que_.open(ipc::make_prefix(prefix_, {
-                          "QU_CONN__", 
+                          queue_tag, 
                           this->name_, 
                           "__", ipc::to_string(DataSize), 
                           "__", ipc::to_string(AlignSize)}).c_str());
             }
+            if (auto st = this->stats()) {
+                st->ring_size.store(queue_t::elems_t::elem_max, std::memory_order_relaxed);
+                st->data_size.store(DataSize, std::memory_order_relaxed);
+            }
         }
 
         void clear() noexcept {
@@ -419,30 +935,33 @@ struct queue_generator {
 
         static void clear_storage(char const * prefix, char const * name) noexcept {
             queue_t::clear_storage(ipc::make_prefix(ipc::make_string(prefix), {
-                                   "QU_CONN__", 
+                                   queue_tag, 
                                    ipc::make_string(name), 
                                    "__", ipc::to_string(DataSize), 
                                    "__", ipc::to_string(AlignSize)}).c_str());
-            conn_info_head::clear_storage(prefix, name);
+            conn_info_head::clear_storage(prefix, name, tags);
         }
 
         void disconnect_receiver() {
+            this->unprepare();
             bool dis = que_.disconnect();
             this->quit_waiting();
+            this->unpark();
             if (dis) {
                 this->recv_cache().clear();
+                this->skipped_.clear();
             }
         }
     };
 };
 
-template <typename Policy>
+template <typename Policy, typename Generator = queue_generator<Policy>>
 struct detail_impl {
 
 using policy_t    = Policy;
 using flag_t      = typename policy_t::flag_t;
-using queue_t     = typename queue_generator<policy_t>::queue_t;
-using conn_info_t = typename queue_generator<policy_t>::conn_info_t;
+using queue_t     = typename Generator::queue_t;
+using conn_info_t = typename Generator::conn_info_t;
 
 constexpr static conn_info_t* info_of(ipc::handle_t h) noexcept {
     return static_cast<conn_info_t*>(h);
@@ -452,6 +971,44 @@ constexpr static queue_t* queue_of(ipc::handle_t h) noexcept {
     return (info_of(h) == nullptr) ? nullptr : &(info_of(h)->que_);
 }
 
+// The stats slot of a connected receiver, which is chosen by its connection bit.
+static ipc::stats::receiver_t *receiver_stats(ipc::handle_t h) noexcept {
+    auto st = info_of(h)->stats();
+    if ((st == nullptr) || !queue_of(h)->connected()) {
+        return nullptr;
+    }
+    std::size_t index = 0;
+    if (ipc::relat_trait<flag_t>::is_broadcast) {
+        for (auto id = queue_of(h)->connected_id(); id > 1; id >>= 1) ++index;
+    }
+    return &(st->receiver(index));
+}
+
+static void count_connection(ipc::handle_t h, bool connected) noexcept {
+    auto st = info_of(h)->stats();
+    auto rs = receiver_stats(h);
+    if (rs == nullptr) return;
+    auto conns = queue_of(h)->elems()->connections(std::memory_order_relaxed);
+    if (connected) {
+        // the slot may have been used by another receiver
+        for (auto *c : {&rs->messages, &rs->bytes, &rs->fragments, &rs->skipped, &rs->lost, &rs->parks}) {
+            c->store(0, std::memory_order_relaxed);
+        }
+        rs->latency.reset();
+        rs->base.store(st->pushed(), std::memory_order_relaxed);
+        rs->pid .store(ipc::detail::this_process(), std::memory_order_relaxed);
+        ipc::stats::add(st->connects);
+    }
+    else {
+        rs->pid.store(0, std::memory_order_relaxed);
+        ipc::stats::add(st->disconnects);
+        // it's going to leave
+        conns = ipc::relat_trait<flag_t>::is_broadcast ? (conns & ~queue_of(h)->connected_id()) 
+                                                       : ((conns == 0) ? 0 : conns - 1);
+    }
+    st->connections.store(conns, std::memory_order_relaxed);
+}
+
 /* API implementations */
 
 static bool connect(ipc::handle_t * ph, ipc::prefix pref, char const * name, bool start_to_recv) {
@@ -471,8 +1028,12 @@ static void disconnect(ipc::handle_t h) {
     if (que == nullptr) {
         return;
     }
+    info_of(h)->stop_spill();
     que->shut_sending();
+    info_of(h)->release_producer();
+    info_of(h)->leave_writer();
     assert(info_of(h) != nullptr);
+    count_connection(h, false);
     info_of(h)->disconnect_receiver();
 }
 
@@ -483,10 +1044,13 @@ static bool reconnect(ipc::handle_t * ph, bool start_to_recv) {
     if (que == nullptr) {
         return false;
     }
+    info_of(*ph)->unprepare();
     info_of(*ph)->init();
     if (start_to_recv) {
         que->shut_sending();
+        bool was_connected = que->connected();
         if (que->connect()) { // wouldn't connect twice
+            if (!was_connected) count_connection(*ph, true);
             info_of(*ph)->cc_waiter_.broadcast();
             return true;
         }
@@ -494,12 +1058,17 @@ static bool reconnect(ipc::handle_t * ph, bool start_to_recv) {
     }
     // start_to_recv == false
     if (que->connected()) {
+        count_connection(*ph, false);
         info_of(*ph)->disconnect_receiver();
     }
     return que->ready_sending();
 }
 
 static void destroy(ipc::handle_t h) noexcept {
+    if (info_of(h) != nullptr) {
+        // the drainer must quit before the queue goes away
+        info_of(h)->stop_spill();
+    }
     ipc::mem::free(info_of(h));
 }
 
@@ -521,13 +1090,16 @@ static bool wait_for_recv(ipc::handle_t h, std::size_t r_count, std::uint64_t tm
     }, tm);
 }
 
-template <typename F>
-static bool send(F&& gen_push, ipc::handle_t h, void const * data, std::size_t size) {
-    if (data == nullptr || size == 0) {
-        ipc::error("fail: send(%p, %zd)\n", data, size);
-        return false;
-    }
+using sender_t = typename conn_info_t::sender_t;
+
+/**
+ * Checks what 'send' needs of a connection & fills 'snd' with it,
+ * it's done once by 'prepare' for a prepared sender.
+*/
+static bool ready_to_send(ipc::handle_t h, sender_t &snd) {
     auto que = queue_of(h);
+    // before the checks, what comes after them makes it stale
+    auto epoch = (que == nullptr) ? 0 : info_of(h)->prepared_epoch_.load(std::memory_order_acquire);
     if (que == nullptr) {
         ipc::error("fail: send, queue_of(h) == nullptr\n");
         return false;
@@ -540,123 +1112,428 @@ static bool send(F&& gen_push, ipc::handle_t h, void const * data, std::size_t s
         ipc::error("fail: send, que->ready_sending() == false\n");
         return false;
     }
-    ipc::circ::cc_t conns = que->elems()->connections(std::memory_order_relaxed);
+    if (info_of(h)->acc() == nullptr) {
+        ipc::error("fail: send, info_of(h)->acc() == nullptr\n");
+        return false;
+    }
+    snd = { info_of(h), que, que->elems(), info_of(h)->acc(), info_of(h)->stats(), info_of(h)->producer_stats(), epoch };
+    return true;
+}
+
+template <typename F>
+static bool send(F&& gen_push, ipc::handle_t h, void const * data, std::size_t size) {
+    sender_t snd;
+    return ready_to_send(h, snd) && send(std::forward<F>(gen_push), snd, data, size);
+}
+
+template <typename F>
+static bool send(F&& gen_push, sender_t const &snd, void const * data, std::size_t size) {
+    if (data == nullptr || size == 0) {
+        ipc::error("fail: send(%p, %zd)\n", data, size);
+        return false;
+    }
+    auto que = snd.que;
+    auto inf = snd.inf;
+    auto ps  = snd.ps;
+    ipc::circ::cc_t conns = snd.elems->connections(std::memory_order_relaxed);
     if (conns == 0) {
         ipc::error("fail: send, there is no receiver on this connection.\n");
+        if (ps != nullptr) ipc::stats::add(ps->failures);
         return false;
     }
     // calc a new message id
-    conn_info_t *inf = info_of(h);
-    auto acc = inf->acc();
-    if (acc == nullptr) {
-        ipc::error("fail: send, info_of(h)->acc() == nullptr\n");
-        return false;
+    auto msg_id   = snd.acc->fetch_add(1, std::memory_order_relaxed);
+    auto st       = snd.st;
+    // all the fragments of a message carry the same stamp
+    auto stamp    = ((st != nullptr) && st->timestamps.load(std::memory_order_relaxed)) ? ipc::detail::timestamp() : 0;
+    auto try_push = std::forward<F>(gen_push)(inf, que, msg_id, stamp);
+    auto trace_ts = ipc::detail::trace::on() ? ipc::detail::trace::now() : 0;
+    // a connection which receives as well would ignore its own messages by the ids
+    unsigned flags = (que->connected() || (trace_ts != 0)) ? static_cast<unsigned>(msg_ids) : 0u;
+    if (stamp != 0) flags |= msg_stamped;
+    std::uint64_t pushed = 0;
+    auto push_one = [&](std::uint64_t remain) {
+        ++pushed;
+        IPC_HOOK_(inf, push, msg_id, remain);
+        if (trace_ts != 0) {
+            ipc::detail::trace::record(ipc::detail::trace::event::push, inf->trace_name_, ipc::detail::trace::now(), 0,
+                                       ipc::detail::trace::flow_id(inf->cc_id_, msg_id), remain);
+        }
+    };
+    auto finish = [inf, ps, size, msg_id, trace_ts, &pushed](bool succ, bool large) {
+        if ((trace_ts != 0) && succ) {
+            ipc::detail::trace::record(ipc::detail::trace::event::send, inf->trace_name_, 
+                                       trace_ts, ipc::detail::trace::now() - trace_ts,
+                                       ipc::detail::trace::flow_id(inf->cc_id_, msg_id), size);
+        }
+        if (ps != nullptr) {
+            ipc::stats::add(ps->fragments, pushed);
+            if (succ) {
+                ipc::stats::add(ps->messages);
+                ipc::stats::add(ps->bytes, size);
+                if (large) ipc::stats::add(ps->large);
+            }
+            else ipc::stats::add(ps->failures);
+        }
+        return succ;
+    };
+    // a message which fits in a slot goes as it is, whatever its size
+    if (size <= queue_t::value_t::capacity(size, flags)) {
+        if (!try_push(flags, size, data, size)) {
+            return finish(false, false);
+        }
+        push_one(0);
+        return finish(true, false);
     }
-    auto msg_id   = acc->fetch_add(1, std::memory_order_relaxed);
-    auto try_push = std::forward<F>(gen_push)(inf, que, msg_id);
-    if (size > ipc::large_msg_limit) {
+    // a lossy ring couldn't tell when a chunk has been read, so it always sends fragments
+    if ((size > ipc::large_msg_limit) && !ipc::relat_trait<flag_t>::is_lossy) {
         auto   dat = acquire_storage(inf, size, conns);
         void * buf = dat.second;
         if (buf != nullptr) {
             std::memcpy(buf, data, size);
-            return try_push(static_cast<std::int32_t>(size) - 
-                            static_cast<std::int32_t>(ipc::data_length), &(dat.first), 0);
+            if (try_push(flags | msg_ids | msg_storage, size, &(dat.first), sizeof(dat.first))) {
+                push_one(0);
+                return finish(true, true);
+            }
+            // nobody would receive it
+            release_storage(dat.first, inf, size);
+            return finish(false, true);
         }
         // try using message fragment
         //ipc::log("fail: shm::handle for big message. msg_id: %zd, size: %zd\n", msg_id, size);
     }
-    // push message fragment
-    std::int32_t offset = 0;
-    for (std::int32_t i = 0; i < static_cast<std::int32_t>(size / ipc::data_length); ++i, offset += ipc::data_length) {
-        if (!try_push(static_cast<std::int32_t>(size) - offset - static_cast<std::int32_t>(ipc::data_length),
-                      static_cast<ipc::byte_t const *>(data) + offset, ipc::data_length)) {
-            return false;
+    // push message fragment, the rest of the message goes with each of them
+    flags |= msg_ids;
+    for (std::size_t offset = 0; offset < size;) {
+        std::size_t remain = size - offset;
+        std::size_t frag   = (ipc::detail::min)(remain, queue_t::value_t::capacity(remain, flags));
+        if (!try_push(flags, remain, static_cast<ipc::byte_t const *>(data) + offset, frag)) {
+            return finish(false, false);
         }
+        push_one(remain - frag);
+        offset += frag;
     }
-    // if remain > 0, this is the last message fragment
-    std::int32_t remain = static_cast<std::int32_t>(size) - offset;
-    if (remain > 0) {
-        if (!try_push(remain - static_cast<std::int32_t>(ipc::data_length),
-                      static_cast<ipc::byte_t const *>(data) + offset, 
-                      static_cast<std::size_t>(remain))) {
-            return false;
+    return finish(true, false);
+}
+
+/**
+ * Generates the pushing function of 'send', which handles a full ring with the overflow policy.
+ * Only the first fragment of a message follows the policy, the rest of a started message
+ * always waits & forces, so that a message would never be torn.
+ * 'full' is set when the first fragment has been turned away.
+ * The policy is a template argument, so that a prepared sender doesn't dispatch on it at all.
+*/
+template <ipc::overflow Overflow>
+static auto gen_push(std::uint64_t tm, bool &full) {
+    constexpr bool turns_away = (Overflow == ipc::overflow::drop)
+                             || (Overflow == ipc::overflow::reject)
+                             || (Overflow == ipc::overflow::spill);
+    return [tm, &full](auto *info, auto *que, auto msg_id, std::uint64_t stamp) {
+        return [tm, &full, info, que, msg_id, stamp, head = true]
+               (unsigned flags, std::uint64_t length, void const * data, std::size_t size) mutable {
+            auto push = [&] {
+                return que->push(
+                    [](void*) { return true; },
+                    info->cc_id_, msg_id, stamp, flags, length, data, size);
+            };
+            std::uint64_t remain = (flags & msg_storage) ? 0 : length - size;
+            bool first = std::exchange(head, false);
+            if (!push()) {
+                info->ovf_.full_.fetch_add(1, std::memory_order_relaxed);
+                IPC_HOOK_(info, full, msg_id, remain);
+                if ((Overflow == ipc::overflow::block) && first) {
+                    info->ovf_.blocked_.fetch_add(1, std::memory_order_relaxed);
+                    if (!wait_for(info->wt_waiter_, [&] { return !push(); }, ipc::invalid_value, 
+                                  parks_of(info->producer_stats()), info)) {
+                        return false;
+                    }
+                }
+                else if (turns_away && first) {
+                    full = true;
+                    return false;
+                }
+                else if (!wait_for(info->wt_waiter_, [&] { return !push(); }, tm,
+                                   parks_of(info->producer_stats()), info)) {
+                    ipc::log("force_push: msg_id = %zd, remain = %zd, size = %zd\n", msg_id, static_cast<std::size_t>(remain), size);
+                    info->ovf_.disconnected_.fetch_add(1, std::memory_order_relaxed);
+                    if (auto ps = info->producer_stats()) ipc::stats::add(ps->force_pushes);
+                    IPC_HOOK_(info, force_push, msg_id, remain);
+                    if (ipc::detail::trace::on()) {
+                        ipc::detail::trace::record(ipc::detail::trace::event::force_push, info->trace_name_,
+                                                   ipc::detail::trace::now(), 0,
+                                                   ipc::detail::trace::flow_id(info->cc_id_, msg_id), remain);
+                    }
+                    if (!que->force_push(
+                            [info](void* p) { return clear_message<typename queue_t::value_t>(info, p); },
+                            info->cc_id_, msg_id, stamp, flags, length, data, size)) {
+                        return false;
+                    }
+                }
+            }
+            info->notify_receivers();
+            return true;
+        };
+    };
+}
+
+// The send of a policy but spill, which goes through 'spill' instead.
+template <ipc::overflow Overflow>
+static bool send(sender_t const &snd, void const * data, std::size_t size, std::uint64_t tm) {
+    bool full = false;
+    if (send(gen_push<Overflow>(tm, full), snd, data, size)) {
+        snd.inf->ovf_.succeed();
+        return true;
+    }
+    if (!full) {
+        return false;
+    }
+    if (Overflow == ipc::overflow::drop) {
+        snd.inf->ovf_.dropped_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    snd.inf->ovf_.reject();
+    return false;
+}
+
+static bool send(ipc::handle_t h, void const * data, std::size_t size, std::uint64_t tm) {
+    conn_info_t *inf = info_of(h);
+    auto policy = (inf == nullptr) ? ipc::overflow::disconnect : inf->overflow_.load(std::memory_order_relaxed);
+    if (policy == ipc::overflow::spill) {
+        return spill(h, data, size, tm);
+    }
+    sender_t snd;
+    if (!ready_to_send(h, snd)) {
+        return false;
+    }
+    switch (policy) {
+    case ipc::overflow::block : return send<ipc::overflow::block >(snd, data, size, tm);
+    case ipc::overflow::drop  : return send<ipc::overflow::drop  >(snd, data, size, tm);
+    case ipc::overflow::reject: return send<ipc::overflow::reject>(snd, data, size, tm);
+    default                   : return send<ipc::overflow::disconnect>(snd, data, size, tm);
+    }
+}
+
+static bool spill(ipc::handle_t h, void const * data, std::size_t size, std::uint64_t tm) {
+    conn_info_t *inf = info_of(h);
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> spill_guard {inf->spill_lock_};
+        if (inf->spill_ != nullptr) {
+            std::lock_guard<std::mutex> guard {inf->spill_->lock_};
+            queued = !inf->spill_->que_.empty();
+        }
+    }
+    // the spilled messages go first, to keep the order,
+    // & the send doesn't hold the locks, which would stall set_overflow & overflow_counters
+    if (!queued) {
+        bool full = false;
+        if (send(gen_push<ipc::overflow::spill>(tm, full), h, data, size)) {
+            return true;
         }
+        if (!full) return false;
     }
+    std::lock_guard<std::mutex> spill_guard {inf->spill_lock_};
+    auto &sp = inf->spill();
+    std::lock_guard<std::mutex> guard {sp.lock_};
+    if ((data == nullptr) || (size == 0) || (sp.bytes_ + size > sp.limit_)) {
+        inf->ovf_.reject();
+        return false;
+    }
+    auto mem = ipc::mem::alloc(size);
+    std::memcpy(mem, data, size);
+    sp.que_.push_back(ipc::buff_t{ mem, size, ipc::mem::free });
+    sp.bytes_ += size;
+    inf->ovf_.spilled_.fetch_add(1, std::memory_order_relaxed);
+    if (!sp.drainer_.joinable()) {
+        sp.drainer_ = std::thread{[h, &sp] { drain(h, sp); }};
+    }
+    sp.cv_.notify_one();
     return true;
 }
 
-static bool send(ipc::handle_t h, void const * data, std::size_t size, std::uint64_t tm) {
-    return send([tm](auto *info, auto *que, auto msg_id) {
-        return [tm, info, que, msg_id](std::int32_t remain, void const * data, std::size_t size) {
-            if (!wait_for(info->wt_waiter_, [&] {
-                    return !que->push(
+/**
+ * Generates the pushing function of the drainer, which waits for room as long as it takes & never forces:
+ * the spill policy is there to spare the slow receivers, a spilled message is only given up
+ * when the spill queue is stopped.
+*/
+static auto gen_drain_push(spill_t &sp) {
+    return [&sp](auto *info, auto *que, auto msg_id, std::uint64_t stamp) {
+        return [&sp, info, que, msg_id, stamp](unsigned flags, std::uint64_t length, void const * data, std::size_t size) {
+            bool pushed = que->push(
+                [](void*) { return true; },
+                info->cc_id_, msg_id, stamp, flags, length, data, size);
+            if (!pushed) {
+                info->ovf_.full_.fetch_add(1, std::memory_order_relaxed);
+                IPC_HOOK_(info, full, msg_id, (flags & msg_storage) ? 0 : length - size);
+            }
+            while (!pushed) {
+                if (sp.quit_.load(std::memory_order_acquire)) return false;
+                wait_for(info->wt_waiter_, [&] {
+                    if (sp.quit_.load(std::memory_order_acquire)) return false;
+                    pushed = que->push(
                         [](void*) { return true; },
-                        info->cc_id_, msg_id, remain, data, size);
-                }, tm)) {
-                ipc::log("force_push: msg_id = %zd, remain = %d, size = %zd\n", msg_id, remain, size);
-                if (!que->force_push(
-                        [info](void* p) { return clear_message<typename queue_t::value_t>(info, p); },
-                        info->cc_id_, msg_id, remain, data, size)) {
-                    return false;
-                }
+                        info->cc_id_, msg_id, stamp, flags, length, data, size);
+                    return !pushed;
+                }, spill_t::retry_ms, parks_of(info->producer_stats()), info);
             }
-            info->rd_waiter_.broadcast();
+            info->notify_receivers();
             return true;
         };
-    }, h, data, size);
+    };
+}
+
+// The background thread of the spill policy, 'sp' lives until it has been joined by stop_spill.
+static void drain(ipc::handle_t h, spill_t &sp) {
+    conn_info_t *inf = info_of(h);
+    std::unique_lock<std::mutex> guard {sp.lock_};
+    for (;;) {
+        sp.cv_.wait(guard, [&sp] { return sp.quit_.load(std::memory_order_relaxed) || !sp.que_.empty(); });
+        if (sp.quit_.load(std::memory_order_relaxed)) return;
+        // Nobody else pushes while the queue isn't empty, so it could be sent out of the lock.
+        // Pushing back doesn't invalidate the reference of the front.
+        auto &msg = sp.que_.front();
+        guard.unlock();
+        if (!send(gen_drain_push(sp), h, msg.data(), msg.size())) {
+            inf->ovf_.dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+        guard.lock();
+        sp.bytes_ -= msg.size();
+        sp.que_.pop_front();
+    }
 }
 
 static bool try_send(ipc::handle_t h, void const * data, std::size_t size, std::uint64_t tm) {
-    return send([tm](auto *info, auto *que, auto msg_id) {
-        return [tm, info, que, msg_id](std::int32_t remain, void const * data, std::size_t size) {
+    sender_t snd;
+    return ready_to_send(h, snd) && try_send(snd, data, size, tm);
+}
+
+static bool try_send(sender_t const &snd, void const * data, std::size_t size, std::uint64_t tm) {
+    return send([tm, ps = snd.ps](auto *info, auto *que, auto msg_id, std::uint64_t stamp) {
+        return [tm, ps, info, que, msg_id, stamp](unsigned flags, std::uint64_t length, void const * data, std::size_t size) {
+            auto push = [&] {
+                return que->push([](void*) { return true; }, info->cc_id_, msg_id, stamp, flags, length, data, size);
+            };
+            bool full = false;
             if (!wait_for(info->wt_waiter_, [&] {
-                    return !que->push(
-                        [](void*) { return true; },
-                        info->cc_id_, msg_id, remain, data, size);
-                }, tm)) {
-                return false;
+                    if (push()) return false;
+                    if (!std::exchange(full, true)) {
+                        IPC_HOOK_(info, full, msg_id, (flags & msg_storage) ? 0 : length - size);
+                    }
+                    return true;
+                }, tm, parks_of(ps), info)) {
+                // a sender waiting on a select arms its slot, then looks once more,
+                // a receiver which has popped in between may not have seen it armed
+                if (!info->park_writer() || !push()) return false;
             }
-            info->rd_waiter_.broadcast();
+            info->notify_receivers();
             return true;
         };
-    }, h, data, size);
+    }, snd, data, size);
 }
 
-static ipc::buff_t recv(ipc::handle_t h, std::uint64_t tm) {
+using receiver_t = typename conn_info_t::receiver_t;
+
+/**
+ * Checks what 'recv' needs of a connection & fills 'rcv' with it,
+ * it's done once by 'prepare' for a prepared receiver.
+*/
+static bool ready_to_recv(ipc::handle_t h, receiver_t &rcv) {
     auto que = queue_of(h);
     if (que == nullptr) {
         ipc::error("fail: recv, queue_of(h) == nullptr\n");
-        return {};
+        return false;
     }
+    auto epoch = info_of(h)->prepared_epoch_.load(std::memory_order_acquire);
     if (!que->connected()) {
+        return false;
+    }
+    rcv = { info_of(h), que, receiver_stats(h), epoch };
+    return true;
+}
+
+static ipc::buff_t recv(ipc::handle_t h, std::uint64_t tm) {
+    receiver_t rcv;
+    if (!ready_to_recv(h, rcv)) {
         // hasn't connected yet, just return.
         return {};
     }
-    conn_info_t *inf = info_of(h);
-    auto& rc = inf->recv_cache();
+    return recv(rcv, tm);
+}
+
+static ipc::buff_t recv(receiver_t const &rcv, std::uint64_t tm) {
+    auto que = rcv.que;
+    conn_info_t *inf = rcv.inf;
+    auto& rc = inf->recv_cache();
+    auto  rs = rcv.rs;
+    auto  trace_ts = ipc::detail::trace::on() ? ipc::detail::trace::now() : 0;
+    auto done = [inf, rs, trace_ts](ipc::buff_t buf, msg_head_t const & h) {
+        if (rs != nullptr) {
+            ipc::stats::add(rs->messages);
+            ipc::stats::add(rs->bytes, buf.size());
+            if (h.stamp != 0) {
+                rs->latency.record(ipc::detail::stamp_to_ns(h.stamp, ipc::detail::timestamp()));
+            }
+        }
+        if (trace_ts != 0) {
+            ipc::detail::trace::record(ipc::detail::trace::event::recv, inf->trace_name_, 
+                                       trace_ts, ipc::detail::trace::now() - trace_ts,
+                                       ipc::detail::trace::flow_id(h.cc_id, h.id), buf.size());
+        }
+        return buf;
+    };
     for (;;) {
         // pop a new message
         typename queue_t::value_t msg {};
+        auto lost = que->lost();
         if (!wait_for(inf->rd_waiter_, [que, &msg] {
                 return !que->pop(msg);
-            }, tm)) {
-            // pop failed, just return.
-            return {};
+            }, tm, parks_of(rs), inf)) {
+            if ((tm != 0) || !inf->parkable()) {
+                // pop failed, just return.
+                return {};
+            }
+            // the ring is drained: arm the ready fd & the select, then look once more,
+            // a sender which has pushed in between may not have seen it armed
+            inf->park();
+            if (!que->pop(msg)) return {};
+        }
+        inf->notify_writers();
+        auto h         = msg.head();
+        auto msg_size  = static_cast<std::size_t>(h.length);
+        auto frag_size = msg.size_of(h);
+        auto remain    = (h.flags & msg_storage) ? 0 : h.length - frag_size;
+        IPC_HOOK_(inf, pop, h.id, remain);
+        if (trace_ts != 0) {
+            ipc::detail::trace::record(ipc::detail::trace::event::pop, inf->trace_name_, ipc::detail::trace::now(), 0,
+                                       ipc::detail::trace::flow_id(h.cc_id, h.id), remain);
         }
-        inf->wt_waiter_.broadcast();
-        if ((inf->acc() != nullptr) && (msg.cc_id_ == inf->cc_id_)) {
+        if (rs != nullptr) {
+            ipc::stats::add(rs->fragments);
+            ipc::stats::add(rs->lost, que->lost() - lost);
+        }
+        if (que->lost() != lost) {
+            // the fragments in the cache may have lost their neighbours
+            rc.clear();
+            inf->skipped_.clear();
+        }
+        if ((inf->acc() != nullptr) && (h.cc_id == inf->cc_id_)) {
             continue; // ignore message to self
         }
-        // msg.remain_ may minus & abs(msg.remain_) < data_length
-        std::int32_t r_size = static_cast<std::int32_t>(ipc::data_length) + msg.remain_;
-        if (r_size <= 0) {
-            ipc::error("fail: recv, r_size = %d\n", (int)r_size);
+        if (msg_size == 0) {
+            ipc::error("fail: recv, msg_size = 0\n");
             return {};
         }
-        std::size_t msg_size = static_cast<std::size_t>(r_size);
+        if ((h.flags & msg_ids) && !inf->skipped_.empty()) {
+            auto it = std::find(inf->skipped_.begin(), inf->skipped_.end(), h.id);
+            if (it != inf->skipped_.end()) {
+                // the head of this message has been skipped, drop it up to its last fragment
+                if (frag_size == msg_size) inf->skipped_.erase(it);
+                continue;
+            }
+        }
         // large message
-        if (msg.storage_) {
-            ipc::storage_id_t buf_id = *reinterpret_cast<ipc::storage_id_t*>(&msg.data_);
+        if (h.flags & msg_storage) {
+            ipc::storage_id_t buf_id = msg.storage_id(h);
             void* buf = find_storage(buf_id, inf, msg_size);
             if (buf != nullptr) {
                 struct recycle_t {
@@ -672,9 +1549,9 @@ static ipc::buff_t recv(ipc::handle_t h, std::uint64_t tm) {
                 });
                 if (r_info == nullptr) {
                     ipc::log("fail: ipc::mem::alloc<recycle_t>.\n");
-                    return ipc::buff_t{buf, msg_size}; // no recycle
+                    return done(ipc::buff_t{buf, msg_size}, h); // no recycle
                 } else {
-                    return ipc::buff_t{buf, msg_size, [](void* p_info, std::size_t size) {
+                    return done(ipc::buff_t{buf, msg_size, [](void* p_info, std::size_t size) {
                         auto r_info = static_cast<recycle_t *>(p_info);
                         IPC_UNUSED_ auto finally = ipc::guard([r_info] {
                             ipc::mem::free(r_info);
@@ -684,24 +1561,36 @@ static ipc::buff_t recv(ipc::handle_t h, std::uint64_t tm) {
                                                 size, 
                                                 r_info->curr_conns, 
                                                 r_info->conn_id);
-                    }, r_info};
+                    }, r_info}, h);
                 }
             } else {
-                ipc::log("fail: shm::handle for large message. msg_id: %zd, buf_id: %zd, size: %zd\n", msg.id_, buf_id, msg_size);
+                ipc::log("fail: shm::handle for large message. msg_id: %zd, buf_id: %zd, size: %zd\n", h.id, buf_id, msg_size);
                 continue;
             }
         }
-        // find cache with msg.id_
-        auto cac_it = rc.find(msg.id_);
-        if (cac_it == rc.end()) {
-            if (msg_size <= ipc::data_length) {
-                return make_cache(msg.data_, msg_size);
+        // a whole message in one slot
+        if (frag_size == msg_size) {
+            auto cac_it = rc.find(h.id);
+            if ((h.flags & msg_ids) && (cac_it != rc.end())) {
+                // this is the last message fragment
+                auto& cac = cac_it->second;
+                cac.append(msg.payload(h), frag_size);
+                // finish this message, erase it from cache
+                auto buff = std::move(cac.buff_);
+                rc.erase(cac_it);
+                IPC_HOOK_(inf, reassembly, h.id, buff.size());
+                return done(std::move(buff), h);
             }
+            return done(make_cache(msg.payload(h), frag_size, msg_size), h);
+        }
+        // find cache with the message id
+        auto cac_it = rc.find(h.id);
+        if (cac_it == rc.end()) {
             // gc
             if (rc.size() > 1024) {
                 std::vector<msg_id_t> need_del;
                 for (auto const & pair : rc) {
-                    auto cmp = std::minmax(msg.id_, pair.first);
+                    auto cmp = std::minmax(h.id, pair.first);
                     if (cmp.second - cmp.first > 8192) {
                         need_del.push_back(pair.first);
                     }
@@ -709,22 +1598,10 @@ static ipc::buff_t recv(ipc::handle_t h, std::uint64_t tm) {
                 for (auto id : need_del) rc.erase(id);
             }
             // cache the first message fragment
-            rc.emplace(msg.id_, cache_t { ipc::data_length, make_cache(msg.data_, msg_size) });
-        }
-        // has cached before this message
-        else {
-            auto& cac = cac_it->second;
-            // this is the last message fragment
-            if (msg.remain_ <= 0) {
-                cac.append(&(msg.data_), msg_size);
-                // finish this message, erase it from cache
-                auto buff = std::move(cac.buff_);
-                rc.erase(cac_it);
-                return buff;
-            }
-            // there are remain datas after this message
-            cac.append(&(msg.data_), ipc::data_length);
+            rc.emplace(h.id, cache_t { frag_size, make_cache(msg.payload(h), frag_size, msg_size) });
         }
+        // there are remain datas after this message
+        else cac_it->second.append(msg.payload(h), frag_size);
     }
 }
 
@@ -732,11 +1609,426 @@ static ipc::buff_t try_recv(ipc::handle_t h) {
     return recv(h, 0);
 }
 
+static ipc::lag_stats lag(ipc::handle_t h) {
+    auto que = queue_of(h);
+    if ((que == nullptr) || !que->connected()) {
+        return {};
+    }
+    conn_info_t *inf = info_of(h);
+    ipc::lag_stats st {};
+    que->peek([&](void const * p) {
+        auto msg = static_cast<typename queue_t::value_t const *>(p);
+        auto h   = msg->head();
+        ++st.slots;
+        if ((inf->acc() != nullptr) && (h.cc_id == inf->cc_id_)) {
+            return; // recv ignores it
+        }
+        if (h.flags & msg_storage) {
+            ++st.messages;
+            st.bytes += static_cast<std::size_t>(h.length);
+            return;
+        }
+        auto frag = msg->size_of(h);
+        if (frag == h.length) ++st.messages;
+        st.bytes += frag;
+    });
+    return st;
+}
+
+/**
+ * Skips 'n' messages in one pass: the read bits are cleared without copying anything,
+ * the chunks of the skipped large messages are recycled at once,
+ * and the half-received messages whose fragments have been skipped are dropped.
+ * If the ring runs dry in the middle of a message, recv drops the rest of it when it comes.
+*/
+static std::size_t skip(ipc::handle_t h, std::size_t n) {
+    auto que = queue_of(h);
+    if (que == nullptr) {
+        ipc::error("fail: skip, queue_of(h) == nullptr\n");
+        return 0;
+    }
+    if (!que->connected()) {
+        return 0;
+    }
+    conn_info_t *inf = info_of(h);
+    auto& rc = inf->recv_cache();
+    std::size_t count = 0;
+    auto slots = que->skip([&](void const * p) {
+        if (count >= n) return false;
+        auto msg = static_cast<typename queue_t::value_t const *>(p);
+        auto h   = msg->head();
+        if ((inf->acc() != nullptr) && (h.cc_id == inf->cc_id_)) {
+            return true; // recv ignores it
+        }
+        if (h.flags & msg_storage) {
+            if (h.length > 0) {
+                recycle_storage<flag_t>(msg->storage_id(h), 
+                                        inf, 
+                                        static_cast<std::size_t>(h.length), 
+                                        que->elems()->connections(std::memory_order_relaxed), 
+                                        que->connected_id());
+            }
+            ++count;
+            return true;
+        }
+        bool last = (msg->size_of(h) == h.length);
+        if (h.flags & msg_ids) {
+            rc.erase(h.id);
+            // the ring may run dry before the last fragment has been pushed
+            auto it = std::find(inf->skipped_.begin(), inf->skipped_.end(), h.id);
+            if (it != inf->skipped_.end()) {
+                if (last) inf->skipped_.erase(it);
+            }
+            else if (!last) inf->skipped_.push_back(h.id);
+        }
+        if (last) {
+            ++count;
+        }
+        return true;
+    });
+    if (auto rs = receiver_stats(h)) ipc::stats::add(rs->skipped, slots);
+    inf->notify_writers();
+    return count;
+}
+
+static std::uint64_t lost_count(ipc::handle_t h) {
+    auto que = queue_of(h);
+    if (que == nullptr) {
+        return 0;
+    }
+    return que->lost();
+}
+
+static ipc::stats::channel const * stats(ipc::handle_t h) {
+    conn_info_t *inf = info_of(h);
+    return (inf == nullptr) ? nullptr : inf->stats();
+}
+
+static bool set_timestamps(ipc::handle_t h, bool enabled) {
+    conn_info_t *inf = info_of(h);
+    if (inf == nullptr) {
+        ipc::error("fail: set_timestamps, info_of(h) == nullptr\n");
+        return false;
+    }
+    auto st = inf->stats();
+    if (st == nullptr) {
+        return false; // nowhere to keep the histograms
+    }
+    st->timestamps.store(enabled ? 1 : 0, std::memory_order_relaxed);
+    return true;
+}
+
+static ipc::latency_stats latency(ipc::handle_t h) {
+    conn_info_t *inf = info_of(h);
+    auto st = (inf == nullptr) ? nullptr : inf->stats();
+    return (st == nullptr) ? ipc::latency_stats{} : st->latency();
+}
+
+static void set_hooks(ipc::handle_t h, ipc::hook_fn fn, unsigned mask) {
+    conn_info_t *inf = info_of(h);
+    if (inf == nullptr) {
+        ipc::error("fail: set_hooks, info_of(h) == nullptr\n");
+        return;
+    }
+    inf->hook_      = fn;
+    inf->hook_mask_ = (fn == nullptr) ? 0 : mask;
+}
+
+// A prepared call which has gone stale goes the checked way, with what the connection is now.
+template <ipc::overflow Overflow>
+static bool send_prepared(void * ctx, void const * data, std::size_t size, std::uint64_t tm) {
+    auto &snd = *static_cast<sender_t *>(ctx);
+    if (snd.inf->unprepared(snd.epoch)) return send(snd.inf, data, size, tm);
+    return send<Overflow>(snd, data, size, tm);
+}
+
+static bool send_spilled(void * ctx, void const * data, std::size_t size, std::uint64_t tm) {
+    auto &snd = *static_cast<sender_t *>(ctx);
+    if (snd.inf->unprepared(snd.epoch)) return send(snd.inf, data, size, tm);
+    return spill(snd.inf, data, size, tm);
+}
+
+static bool try_send_prepared(void * ctx, void const * data, std::size_t size, std::uint64_t tm) {
+    auto &snd = *static_cast<sender_t *>(ctx);
+    if (snd.inf->unprepared(snd.epoch)) return try_send(snd.inf, data, size, tm);
+    return try_send(snd, data, size, tm);
+}
+
+static ipc::buff_t recv_prepared(void * ctx, std::uint64_t tm) {
+    auto &rcv = *static_cast<receiver_t *>(ctx);
+    if (rcv.inf->unprepared(rcv.epoch)) return recv(rcv.inf, tm);
+    return recv(rcv, tm);
+}
+
+/**
+ * Checks the connection once, and hands out the calls which skip the checks & the lookups,
+ * a sender needs a ring it could send to, a receiver needs to be connected.
+ * The context is what 'send' or 'recv' needs of the connection, and the send goes to the push of
+ * the overflow policy which has been set, without looking the policy up again.
+ * A disconnect, a reconnect or a new overflow policy makes them stale (see conn_info_head::unprepare),
+ * then they go the checked way until the connection is prepared again.
+*/
+static bool prepare(ipc::handle_t h, unsigned mode, ipc::prepared_ops * ops) {
+    conn_info_t *inf = info_of(h);
+    if (inf == nullptr) {
+        ipc::error("fail: prepare, info_of(h) == nullptr\n");
+        return false;
+    }
+    if (mode & ipc::receiver) {
+        if (!ready_to_recv(h, inf->prepared_recv_)) {
+            ipc::error("fail: prepare, %s isn't connected as a receiver\n", inf->name_.c_str());
+            return false;
+        }
+        *ops = { &(inf->prepared_recv_), nullptr, nullptr, &recv_prepared };
+        return true;
+    }
+    if (!ready_to_send(h, inf->prepared_)) {
+        return false;
+    }
+    *ops = { &(inf->prepared_), nullptr, &try_send_prepared, nullptr };
+    switch (inf->overflow_.load(std::memory_order_relaxed)) {
+    case ipc::overflow::block : ops->send = &send_prepared<ipc::overflow::block >; break;
+    case ipc::overflow::drop  : ops->send = &send_prepared<ipc::overflow::drop  >; break;
+    case ipc::overflow::reject: ops->send = &send_prepared<ipc::overflow::reject>; break;
+    case ipc::overflow::spill : ops->send = &send_spilled;                         break;
+    default                   : ops->send = &send_prepared<ipc::overflow::disconnect>; break;
+    }
+    return true;
+}
+
+static void set_overflow(ipc::handle_t h, ipc::overflow policy, std::size_t spill_limit) {
+    conn_info_t *inf = info_of(h);
+    if (inf == nullptr) {
+        ipc::error("fail: set_overflow, info_of(h) == nullptr\n");
+        return;
+    }
+    // the sends which come after it don't spill any more
+    if ((inf->overflow_.exchange(policy, std::memory_order_relaxed) == ipc::overflow::spill) &&
+        (policy != ipc::overflow::spill)) {
+        inf->stop_spill();
+    }
+    // the prepared senders have picked the push of the old one
+    inf->unprepare();
+    std::lock_guard<std::mutex> spill_guard {inf->spill_lock_};
+    inf->spill_limit_ = spill_limit;
+    if (inf->spill_ != nullptr) {
+        std::lock_guard<std::mutex> guard {inf->spill_->lock_};
+        inf->spill_->limit_ = spill_limit;
+    }
+}
+
+static ipc::overflow_stats overflow_counters(ipc::handle_t h) {
+    conn_info_t *inf = info_of(h);
+    if (inf == nullptr) {
+        return {};
+    }
+    ipc::overflow_stats st {};
+    st.full         = inf->ovf_.full_        .load(std::memory_order_relaxed);
+    st.blocked      = inf->ovf_.blocked_     .load(std::memory_order_relaxed);
+    st.dropped      = inf->ovf_.dropped_     .load(std::memory_order_relaxed);
+    st.rejected     = inf->ovf_.rejected_    .load(std::memory_order_relaxed);
+    st.disconnected = inf->ovf_.disconnected_.load(std::memory_order_relaxed);
+    st.spilled      = inf->ovf_.spilled_     .load(std::memory_order_relaxed);
+    st.backoff_hint = inf->ovf_.backoff_     .load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> spill_guard {inf->spill_lock_};
+    if (inf->spill_ != nullptr) {
+        std::lock_guard<std::mutex> guard {inf->spill_->lock_};
+        st.spill_depth = inf->spill_->que_.size();
+    }
+    return st;
+}
+
+static int ready_fd(ipc::handle_t h) {
+    auto que = queue_of(h);
+    if ((que == nullptr) || !que->connected()) {
+        ipc::error("fail: ready_fd, the handle isn't a connected receiver\n");
+        return -1;
+    }
+    conn_info_t *inf = info_of(h);
+    if (!inf->ready_.open(inf->ready_receivers())) {
+        return -1;
+    }
+    return inf->ready_.fd();
+}
+
+static bool select_attach(ipc::handle_t h, std::uint64_t token) {
+    auto que = queue_of(h);
+    if ((que == nullptr) || !que->connected()) {
+        ipc::error("fail: select_attach, the handle isn't a connected receiver\n");
+        return false;
+    }
+    conn_info_t *inf = info_of(h);
+    auto tb = inf->ready_receivers();
+    if (tb == nullptr) {
+        return false;
+    }
+    inf->leave_select();
+    inf->select_slot_ = tb->join(token, true);
+    if (inf->select_slot_ >= ipc::detail::ready_table::max_slots) {
+        ipc::error("fail: select_attach, all the %zu slots are in use\n",
+                   static_cast<std::size_t>(ipc::detail::ready_table::max_slots));
+        return false;
+    }
+    return true;
+}
+
+static void select_detach(ipc::handle_t h) {
+    if (info_of(h) != nullptr) info_of(h)->leave_select();
+}
+
+static bool select_attach_writer(ipc::handle_t h, std::uint64_t token) {
+    auto que = queue_of(h);
+    if (que == nullptr) {
+        ipc::error("fail: select_attach_writer, queue_of(h) == nullptr\n");
+        return false;
+    }
+    conn_info_t *inf = info_of(h);
+    auto tb = inf->ready_writers();
+    if (tb == nullptr) {
+        return false;
+    }
+    inf->leave_writer();
+    auto slot = tb->join(token);
+    if (slot >= ipc::detail::ready_table::max_slots) {
+        ipc::error("fail: select_attach_writer, all the %zu slots are in use\n",
+                   static_cast<std::size_t>(ipc::detail::ready_table::max_slots));
+        return false;
+    }
+    inf->writer_slot_.store(slot, std::memory_order_release);
+    return true;
+}
+
+static void select_detach_writer(ipc::handle_t h) {
+    if (info_of(h) != nullptr) info_of(h)->leave_writer();
+}
+
+static bool set_numa(ipc::handle_t h, ipc::shm::numa_policy const & ring, ipc::shm::numa_policy const & chunk) {
+    auto que = queue_of(h);
+    if (que == nullptr) {
+        ipc::error("fail: set_numa, queue_of(h) == nullptr\n");
+        return false;
+    }
+    conn_info_t *inf = info_of(h);
+    // The chunk storages are shared by all the channels under the same prefix.
+    inf->chunk_numa_ = chunk;
+    for_each_chunk_storage(inf, [&chunk](ipc::shm::handle &seg) {
+        seg.set_numa(chunk);
+    });
+    inf->acc_h_.set_numa(ring);
+    return que->elems_handle().set_numa(ring);
+}
+
+static std::string numa_report(ipc::handle_t h) {
+    auto que = queue_of(h);
+    if (que == nullptr) {
+        return {};
+    }
+    std::string report;
+    auto append = [&report](ipc::shm::handle const &seg) {
+        if (!seg.valid()) return;
+        std::size_t pages[ipc::shm::numa_max_nodes] {};
+        std::size_t total = seg.numa_residency(pages, ipc::shm::numa_max_nodes);
+        report += seg.name();
+        report += ": size = " + std::to_string(seg.size()) + ", resident pages = " + std::to_string(total);
+        for (std::size_t i = 0; i < ipc::shm::numa_max_nodes; ++i) {
+            if (pages[i] == 0) continue;
+            report += ", node" + std::to_string(i) + " = " + std::to_string(pages[i]);
+        }
+        report += "\n";
+    };
+    append(que->elems_handle());
+    append(info_of(h)->acc_h_);
+    for_each_chunk_storage(info_of(h), append);
+    return report;
+}
+
+/* Typed channels: a slot is a whole message, there is no header, fragment nor cache. */
+
+static bool send_slot(ipc::handle_t h, void const * data, std::size_t size, std::uint64_t tm, bool force) {
+    auto que = queue_of(h);
+    if ((que == nullptr) || (que->elems() == nullptr)) {
+        ipc::error("fail: send, queue_of(h) == nullptr\n");
+        return false;
+    }
+    if (!que->ready_sending()) {
+        ipc::error("fail: send, que->ready_sending() == false\n");
+        return false;
+    }
+    conn_info_t *inf = info_of(h);
+    auto ps = inf->producer_stats();
+    if (que->elems()->connections(std::memory_order_relaxed) == 0) {
+        ipc::error("fail: send, there is no receiver on this connection.\n");
+        if (ps != nullptr) ipc::stats::add(ps->failures);
+        return false;
+    }
+    auto push = [que, data, size] {
+        return que->push([](void*) { return true; }, data, size);
+    };
+    if (!push() && !wait_for(inf->wt_waiter_, [&push] { return !push(); }, tm, parks_of(ps), inf)) {
+        if (!force) {
+            if (ps != nullptr) ipc::stats::add(ps->failures);
+            return false;
+        }
+        ipc::log("force_push: typed, size = %zd\n", size);
+        inf->ovf_.disconnected_.fetch_add(1, std::memory_order_relaxed);
+        if (ps != nullptr) ipc::stats::add(ps->force_pushes);
+        if (!que->force_push([](void*) { return true; }, data, size)) {
+            return false;
+        }
+    }
+    inf->notify_receivers();
+    if (ps != nullptr) {
+        ipc::stats::add(ps->fragments);
+        ipc::stats::add(ps->messages);
+        ipc::stats::add(ps->bytes, size);
+    }
+    return true;
+}
+
+static bool recv_slot(ipc::handle_t h, void * data, std::size_t size, std::uint64_t tm) {
+    auto que = queue_of(h);
+    if (que == nullptr) {
+        ipc::error("fail: recv, queue_of(h) == nullptr\n");
+        return false;
+    }
+    if (!que->connected()) {
+        return false;
+    }
+    conn_info_t *inf = info_of(h);
+    auto rs   = receiver_stats(h);
+    auto lost = que->lost();
+    // copied straight out of the ring
+    auto pop = [que, data, size] {
+        return que->pop_by([data, size](void const * p) { std::memcpy(data, p, size); });
+    };
+    if (!wait_for(inf->rd_waiter_, [&pop] { return !pop(); }, tm, parks_of(rs), inf)) {
+        if ((tm != 0) || !inf->parkable()) return false;
+        inf->park();
+        if (!pop()) return false;
+    }
+    inf->notify_writers();
+    if (rs != nullptr) {
+        ipc::stats::add(rs->fragments);
+        ipc::stats::add(rs->messages);
+        ipc::stats::add(rs->bytes, size);
+        ipc::stats::add(rs->lost, que->lost() - lost);
+    }
+    return true;
+}
+
 }; // detail_impl<Policy>
 
 template <typename Flag>
 using policy_t = ipc::policy::choose<ipc::circ::elem_array, Flag>;
 
+template <std::size_t SlotSize>
+using slot_align = std::integral_constant<std::size_t, (ipc::detail::min)(SlotSize, alignof(std::max_align_t))>;
+
+template <typename Flag, std::size_t SlotSize>
+using typed_detail_t = detail_impl<policy_t<Flag>, 
+                                   queue_generator<policy_t<Flag>, SlotSize, slot_align<SlotSize>::value, 
+                                                   slot_t<SlotSize, slot_align<SlotSize>::value>>>;
+
 } // internal-linkage
 
 namespace ipc {
@@ -749,43 +2041,58 @@ ipc::handle_t chan_impl<Flag>::init_first() {
 
 template <typename Flag>
 bool chan_impl<Flag>::connect(ipc::handle_t * ph, char const * name, unsigned mode) {
-    return detail_impl<policy_t<Flag>>::connect(ph, name, mode & receiver);
+    return chan_impl<Flag>::connect(ph, {nullptr}, name, mode);
 }
 
 template <typename Flag>
 bool chan_impl<Flag>::connect(ipc::handle_t * ph, prefix pref, char const * name, unsigned mode) {
+    bool local = detail::inproc::selected(name, mode);
+    if ((*ph != nullptr) && (detail::inproc::is(*ph) != local)) {
+        // switching the transport
+        destroy(*ph);
+        *ph = nullptr;
+    }
+    if (local) {
+        return detail::inproc::connect(ph, detail::inproc::kind_of<Flag>(), pref, name, mode & receiver);
+    }
     return detail_impl<policy_t<Flag>>::connect(ph, pref, name, mode & receiver);
 }
 
 template <typename Flag>
 bool chan_impl<Flag>::reconnect(ipc::handle_t * ph, unsigned mode) {
+    if (detail::inproc::is(*ph)) return detail::inproc::reconnect(ph, mode & receiver);
     return detail_impl<policy_t<Flag>>::reconnect(ph, mode & receiver);
 }
 
 template <typename Flag>
 void chan_impl<Flag>::disconnect(ipc::handle_t h) {
+    if (detail::inproc::is(h)) return detail::inproc::disconnect(h);
     detail_impl<policy_t<Flag>>::disconnect(h);
 }
 
 template <typename Flag>
 void chan_impl<Flag>::destroy(ipc::handle_t h) {
+    if (detail::inproc::is(h)) return detail::inproc::destroy(h);
     disconnect(h);
     detail_impl<policy_t<Flag>>::destroy(h);
 }
 
 template <typename Flag>
 void chan_impl<Flag>::release(ipc::handle_t h) noexcept {
+    if (detail::inproc::is(h)) return detail::inproc::destroy(h);
     detail_impl<policy_t<Flag>>::destroy(h);
 }
 
 template <typename Flag>
 char const * chan_impl<Flag>::name(ipc::handle_t h) {
+    if (detail::inproc::is(h)) return detail::inproc::name(h);
     auto *info = detail_impl<policy_t<Flag>>::info_of(h);
     return (info == nullptr) ? nullptr : info->name_.c_str();
 }
 
 template <typename Flag>
 void chan_impl<Flag>::clear(ipc::handle_t h) noexcept {
+    if (detail::inproc::is(h)) return detail::inproc::destroy(h);
     disconnect(h);
     using conn_info_t = typename detail_impl<policy_t<Flag>>::conn_info_t;
     auto conn_info_p = static_cast<conn_info_t *>(h);
@@ -801,44 +2108,268 @@ void chan_impl<Flag>::clear_storage(char const * name) noexcept {
 
 template <typename Flag>
 void chan_impl<Flag>::clear_storage(prefix pref, char const * name) noexcept {
+    if (detail::inproc::selected(name, sender)) return; // nothing is left behind
     using conn_info_t = typename detail_impl<policy_t<Flag>>::conn_info_t;
     conn_info_t::clear_storage(pref.str, name);
 }
 
 template <typename Flag>
 std::size_t chan_impl<Flag>::recv_count(ipc::handle_t h) {
+    if (detail::inproc::is(h)) return detail::inproc::recv_count(h);
     return detail_impl<policy_t<Flag>>::recv_count(h);
 }
 
 template <typename Flag>
 bool chan_impl<Flag>::wait_for_recv(ipc::handle_t h, std::size_t r_count, std::uint64_t tm) {
+    if (detail::inproc::is(h)) return detail::inproc::wait_for_recv(h, r_count, tm);
     return detail_impl<policy_t<Flag>>::wait_for_recv(h, r_count, tm);
 }
 
 template <typename Flag>
 bool chan_impl<Flag>::send(ipc::handle_t h, void const * data, std::size_t size, std::uint64_t tm) {
+    if (detail::inproc::is(h)) return detail::inproc::send(h, data, size, tm);
     return detail_impl<policy_t<Flag>>::send(h, data, size, tm);
 }
 
+template <typename Flag>
+bool chan_impl<Flag>::send(ipc::handle_t h, buff_t && buff, std::uint64_t tm) {
+    if (detail::inproc::is(h)) return detail::inproc::send(h, std::move(buff), tm);
+    return detail_impl<policy_t<Flag>>::send(h, buff.data(), buff.size(), tm);
+}
+
 template <typename Flag>
 buff_t chan_impl<Flag>::recv(ipc::handle_t h, std::uint64_t tm) {
+    if (detail::inproc::is(h)) return detail::inproc::recv(h, tm);
     return detail_impl<policy_t<Flag>>::recv(h, tm);
 }
 
 template <typename Flag>
 bool chan_impl<Flag>::try_send(ipc::handle_t h, void const * data, std::size_t size, std::uint64_t tm) {
+    if (detail::inproc::is(h)) return detail::inproc::try_send(h, data, size, tm);
     return detail_impl<policy_t<Flag>>::try_send(h, data, size, tm);
 }
 
 template <typename Flag>
 buff_t chan_impl<Flag>::try_recv(ipc::handle_t h) {
+    if (detail::inproc::is(h)) return detail::inproc::recv(h, 0);
     return detail_impl<policy_t<Flag>>::try_recv(h);
 }
 
+template <typename Flag>
+lag_stats chan_impl<Flag>::lag(ipc::handle_t h) {
+    if (detail::inproc::is(h)) return detail::inproc::lag(h);
+    return detail_impl<policy_t<Flag>>::lag(h);
+}
+
+template <typename Flag>
+std::size_t chan_impl<Flag>::skip(ipc::handle_t h, std::size_t n) {
+    if (detail::inproc::is(h)) return detail::inproc::skip(h, n);
+    return detail_impl<policy_t<Flag>>::skip(h, n);
+}
+
+template <typename Flag>
+std::uint64_t chan_impl<Flag>::lost_count(ipc::handle_t h) {
+    if (detail::inproc::is(h)) return detail::inproc::lost_count(h);
+    return detail_impl<policy_t<Flag>>::lost_count(h);
+}
+
+template <typename Flag>
+stats::channel const * chan_impl<Flag>::stats(ipc::handle_t h) {
+    if (detail::inproc::is(h)) return nullptr;
+    return detail_impl<policy_t<Flag>>::stats(h);
+}
+
+template <typename Flag>
+bool chan_impl<Flag>::set_timestamps(ipc::handle_t h, bool enabled) {
+    if (detail::inproc::is(h)) return false;
+    return detail_impl<policy_t<Flag>>::set_timestamps(h, enabled);
+}
+
+template <typename Flag>
+latency_stats chan_impl<Flag>::latency(ipc::handle_t h) {
+    if (detail::inproc::is(h)) return {};
+    return detail_impl<policy_t<Flag>>::latency(h);
+}
+
+template <typename Flag>
+void chan_impl<Flag>::set_hooks(ipc::handle_t h, hook_fn fn, unsigned mask) {
+    if (detail::inproc::is(h)) return;
+    detail_impl<policy_t<Flag>>::set_hooks(h, fn, mask);
+}
+
+template <typename Flag>
+bool chan_impl<Flag>::prepare(ipc::handle_t h, unsigned mode, prepared_ops * ops) {
+    if (ops == nullptr) return false;
+    if (detail::inproc::is(h)) {
+        // nothing to check nor to skip, the calls just go to the transport
+        *ops = { h,
+                 [](void * ctx, void const * data, std::size_t size, std::uint64_t tm) {
+                     return detail::inproc::send(ctx, data, size, tm);
+                 },
+                 [](void * ctx, void const * data, std::size_t size, std::uint64_t tm) {
+                     return detail::inproc::try_send(ctx, data, size, tm);
+                 },
+                 [](void * ctx, std::uint64_t tm) {
+                     return detail::inproc::recv(ctx, tm);
+                 } };
+        return true;
+    }
+    return detail_impl<policy_t<Flag>>::prepare(h, mode, ops);
+}
+
+template <typename Flag>
+void chan_impl<Flag>::set_overflow(ipc::handle_t h, overflow policy, std::size_t spill_limit) {
+    if (detail::inproc::is(h)) return detail::inproc::set_overflow(h, policy, spill_limit);
+    detail_impl<policy_t<Flag>>::set_overflow(h, policy, spill_limit);
+}
+
+template <typename Flag>
+overflow_stats chan_impl<Flag>::overflow_counters(ipc::handle_t h) {
+    if (detail::inproc::is(h)) return detail::inproc::overflow_counters(h);
+    return detail_impl<policy_t<Flag>>::overflow_counters(h);
+}
+
+template <typename Flag>
+int chan_impl<Flag>::ready_fd(ipc::handle_t h) {
+    if (detail::inproc::is(h)) return -1;
+    return detail_impl<policy_t<Flag>>::ready_fd(h);
+}
+
+template <typename Flag>
+bool chan_impl<Flag>::select_attach(ipc::handle_t h, std::uint64_t token) {
+    if (detail::inproc::is(h)) return detail::inproc::select_attach(h, token);
+    return detail_impl<policy_t<Flag>>::select_attach(h, token);
+}
+
+template <typename Flag>
+void chan_impl<Flag>::select_detach(ipc::handle_t h) {
+    if (detail::inproc::is(h)) return detail::inproc::select_detach(h);
+    detail_impl<policy_t<Flag>>::select_detach(h);
+}
+
+template <typename Flag>
+bool chan_impl<Flag>::select_attach_writer(ipc::handle_t h, std::uint64_t token) {
+    if (detail::inproc::is(h)) return detail::inproc::select_attach_writer(h, token);
+    return detail_impl<policy_t<Flag>>::select_attach_writer(h, token);
+}
+
+template <typename Flag>
+void chan_impl<Flag>::select_detach_writer(ipc::handle_t h) {
+    if (detail::inproc::is(h)) return detail::inproc::select_detach_writer(h);
+    detail_impl<policy_t<Flag>>::select_detach_writer(h);
+}
+
+template <typename Flag>
+bool chan_impl<Flag>::set_numa(ipc::handle_t h, shm::numa_policy const & ring, shm::numa_policy const & chunk) {
+    if (detail::inproc::is(h)) return false;
+    return detail_impl<policy_t<Flag>>::set_numa(h, ring, chunk);
+}
+
+template <typename Flag>
+std::string chan_impl<Flag>::numa_report(ipc::handle_t h) {
+    if (detail::inproc::is(h)) return {};
+    return detail_impl<policy_t<Flag>>::numa_report(h);
+}
+
 template struct chan_impl<ipc::wr<relat::single, relat::single, trans::unicast  >>;
 // template struct chan_impl<ipc::wr<relat::single, relat::multi , trans::unicast  >>; // TBD
 // template struct chan_impl<ipc::wr<relat::multi , relat::multi , trans::unicast  >>; // TBD
 template struct chan_impl<ipc::wr<relat::single, relat::multi , trans::broadcast>>;
 template struct chan_impl<ipc::wr<relat::multi , relat::multi , trans::broadcast>>;
+template struct chan_impl<ipc::wr<relat::single, relat::multi , trans::overwrite>>;
+
+template <typename Flag, std::size_t SlotSize>
+bool typed_impl<Flag, SlotSize>::connect(ipc::handle_t * ph, prefix pref, char const * name, unsigned mode) {
+    ipc::detail::waiter::init();
+    if (detail::inproc::selected(name, mode)) {
+        ipc::error("fail: connect, a typed channel has no in-process transport: %s\n", name);
+        return false;
+    }
+    return typed_detail_t<Flag, SlotSize>::connect(ph, pref, name, mode & receiver);
+}
+
+template <typename Flag, std::size_t SlotSize>
+bool typed_impl<Flag, SlotSize>::reconnect(ipc::handle_t * ph, unsigned mode) {
+    return typed_detail_t<Flag, SlotSize>::reconnect(ph, mode & receiver);
+}
+
+template <typename Flag, std::size_t SlotSize>
+void typed_impl<Flag, SlotSize>::disconnect(ipc::handle_t h) {
+    typed_detail_t<Flag, SlotSize>::disconnect(h);
+}
+
+template <typename Flag, std::size_t SlotSize>
+void typed_impl<Flag, SlotSize>::destroy(ipc::handle_t h) {
+    disconnect(h);
+    typed_detail_t<Flag, SlotSize>::destroy(h);
+}
+
+template <typename Flag, std::size_t SlotSize>
+char const * typed_impl<Flag, SlotSize>::name(ipc::handle_t h) {
+    auto *info = typed_detail_t<Flag, SlotSize>::info_of(h);
+    return (info == nullptr) ? nullptr : info->name_.c_str();
+}
+
+template <typename Flag, std::size_t SlotSize>
+void typed_impl<Flag, SlotSize>::clear_storage(prefix pref, char const * name) noexcept {
+    typed_detail_t<Flag, SlotSize>::conn_info_t::clear_storage(pref.str, name);
+}
+
+template <typename Flag, std::size_t SlotSize>
+std::size_t typed_impl<Flag, SlotSize>::recv_count(ipc::handle_t h) {
+    return typed_detail_t<Flag, SlotSize>::recv_count(h);
+}
+
+template <typename Flag, std::size_t SlotSize>
+bool typed_impl<Flag, SlotSize>::wait_for_recv(ipc::handle_t h, std::size_t r_count, std::uint64_t tm) {
+    return typed_detail_t<Flag, SlotSize>::wait_for_recv(h, r_count, tm);
+}
+
+template <typename Flag, std::size_t SlotSize>
+bool typed_impl<Flag, SlotSize>::send(ipc::handle_t h, void const * data, std::size_t size, std::uint64_t tm) {
+    if ((data == nullptr) || (size == 0) || (size > SlotSize)) {
+        ipc::error("fail: send(%p, %zd), the slot size is %zd\n", data, size, SlotSize);
+        return false;
+    }
+    return typed_detail_t<Flag, SlotSize>::send_slot(h, data, size, tm, true);
+}
+
+template <typename Flag, std::size_t SlotSize>
+bool typed_impl<Flag, SlotSize>::try_send(ipc::handle_t h, void const * data, std::size_t size, std::uint64_t tm) {
+    if ((data == nullptr) || (size == 0) || (size > SlotSize)) {
+        ipc::error("fail: try_send(%p, %zd), the slot size is %zd\n", data, size, SlotSize);
+        return false;
+    }
+    return typed_detail_t<Flag, SlotSize>::send_slot(h, data, size, tm, false);
+}
+
+template <typename Flag, std::size_t SlotSize>
+bool typed_impl<Flag, SlotSize>::recv(ipc::handle_t h, void * data, std::size_t size, std::uint64_t tm) {
+    if ((data == nullptr) || (size > SlotSize)) {
+        ipc::error("fail: recv(%p, %zd), the slot size is %zd\n", data, size, SlotSize);
+        return false;
+    }
+    return typed_detail_t<Flag, SlotSize>::recv_slot(h, data, size, tm);
+}
+
+template <typename Flag, std::size_t SlotSize>
+stats::channel const * typed_impl<Flag, SlotSize>::stats(ipc::handle_t h) {
+    return typed_detail_t<Flag, SlotSize>::stats(h);
+}
+
+#define IPC_TYPED_IMPL_(S) \
+    template struct typed_impl<ipc::wr<relat::single, relat::single, trans::unicast  >, S>; \
+    template struct typed_impl<ipc::wr<relat::single, relat::multi , trans::broadcast>, S>; \
+    template struct typed_impl<ipc::wr<relat::multi , relat::multi , trans::broadcast>, S>; \
+    template struct typed_impl<ipc::wr<relat::single, relat::multi , trans::overwrite>, S>;
+
+IPC_TYPED_IMPL_(8)
+IPC_TYPED_IMPL_(16)
+IPC_TYPED_IMPL_(32)
+IPC_TYPED_IMPL_(64)
+IPC_TYPED_IMPL_(128)
+IPC_TYPED_IMPL_(256)
+
+#undef IPC_TYPED_IMPL_
 
 } // namespace ipc
@@ -0,0 +1,334 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstddef>
+#include <cstring>
+#include <utility>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include "libipc/log.h"
+
+#include "libipc/utility/log.h"
+#include "libipc/platform/detail.h"
+#include "libipc/platform/process.h"
+#if !defined(IPC_OS_WINDOWS_)
+#include <pthread.h>
+#endif
+
+namespace ipc {
+namespace detail {
+namespace logging {
+namespace {
+
+enum : std::size_t {
+    ring_size  = 1024, // records, a power of 2
+    site_count = 512,  // call sites tracked by the rate limiter, a power of 2
+    text_size  = 512   // a formatted record is cut at this size
+};
+
+enum : std::uint32_t {
+    default_rate = 100 // records per call site per second
+};
+
+struct record_t {
+    log_level     level;
+    char const *  fmt;
+    format_fn     fn;
+    std::uint32_t size;
+    alignas(std::max_align_t) ipc::byte_t args[args_size];
+};
+
+struct slot_t {
+    std::atomic<std::size_t> seq;
+    record_t                 rec;
+};
+
+struct site_t {
+    std::atomic<char const *>  fmt        {nullptr};
+    std::atomic<std::uint64_t> second     {0};
+    std::atomic<std::uint32_t> count      {0};
+    std::atomic<std::uint64_t> suppressed {0};
+};
+
+void default_sink(log_level lv, char const * msg, std::size_t len) {
+    std::fwrite(msg, 1, len, (lv >= log_level::warn) ? stderr : stdout);
+}
+
+/**
+ * A bounded MPMC ring (D. Vyukov): each slot has a sequence number,
+ * which tells the producers & the consumers whose turn it is.
+ * Pushing never blocks, a full ring drops the record.
+*/
+class logger {
+    slot_t slots_[ring_size];
+    site_t sites_[site_count];
+    std::atomic<std::size_t> head_ {0};
+    std::atomic<std::size_t> tail_ {0};
+
+    std::atomic<log_sink_t>    sink_    {nullptr};
+    std::atomic<std::uint32_t> rate_    {default_rate};
+    std::atomic<bool>          async_   {true};
+    std::atomic<std::uint64_t> dropped_ {0};
+
+    std::mutex               drain_lock_; // one consumer at a time, so the records keep their order
+    std::mutex               lock_;
+    std::condition_variable  cv_;
+    std::thread *            drainer_ = nullptr;
+    std::atomic<ipc::detail::pid_t> owner_ {0};
+    bool                     quit_    = false;
+
+    logger() {
+        for (std::size_t i = 0; i < ring_size; ++i) {
+            slots_[i].seq.store(i, std::memory_order_relaxed);
+        }
+#if !defined(IPC_OS_WINDOWS_)
+        // A child must not inherit a lock held by a thread which doesn't exist there.
+        ::pthread_atfork([] {
+            auto &l = instance();
+            l.drain_lock_.lock();
+            l.lock_.lock();
+        }, [] {
+            auto &l = instance();
+            l.lock_.unlock();
+            l.drain_lock_.unlock();
+        }, [] {
+            auto &l = instance();
+            l.lock_.unlock();
+            l.drain_lock_.unlock();
+        });
+#endif
+    }
+
+    static std::uint64_t this_second() noexcept {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    site_t *find_site(char const * fmt) noexcept {
+        auto h = reinterpret_cast<std::uintptr_t>(fmt);
+        h ^= (h >> 17);
+        h *= 0x9E3779B97F4A7C15ull;
+        for (std::size_t i = 0; i < 8; ++i) {
+            auto &s = sites_[(h + i) & (site_count - 1)];
+            auto  f = s.fmt.load(std::memory_order_acquire);
+            if (f == fmt) return &s;
+            if ((f == nullptr) && (s.fmt.compare_exchange_strong(f, fmt, std::memory_order_acq_rel) || (f == fmt))) {
+                return &s;
+            }
+        }
+        return nullptr;
+    }
+
+    void report_suppressed(char const * fmt, std::uint64_t n) noexcept {
+        std::size_t len = 0;
+        while ((fmt[len] != '\0') && (fmt[len] != '\n') && (len < 60)) ++len;
+        char buf[args_size];
+        int r = std::snprintf(buf, sizeof(buf), "[ipc] %llu records suppressed: %.*s\n",
+                              static_cast<unsigned long long>(n), static_cast<int>(len), fmt);
+        if (r > 0) enqueue(log_level::warn, fmt, nullptr, buf, (std::min)(static_cast<std::size_t>(r), sizeof(buf) - 1));
+    }
+
+    bool enqueue(log_level lv, char const * fmt, format_fn fn, void const * args, std::size_t size) noexcept {
+        auto pos = head_.load(std::memory_order_relaxed);
+        slot_t *s;
+        for (;;) {
+            s = &slots_[pos & (ring_size - 1)];
+            auto seq  = s->seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if (diff < 0) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            else pos = head_.load(std::memory_order_relaxed);
+        }
+        s->rec.level = lv;
+        s->rec.fmt   = fmt;
+        s->rec.fn    = fn;
+        s->rec.size  = static_cast<std::uint32_t>((std::min)(size, std::size_t(args_size)));
+        std::memcpy(s->rec.args, args, s->rec.size);
+        s->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool dequeue(record_t &rec) noexcept {
+        auto pos = tail_.load(std::memory_order_relaxed);
+        slot_t *s;
+        for (;;) {
+            s = &slots_[pos & (ring_size - 1)];
+            auto seq  = s->seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if (diff < 0) return false; // empty
+            else pos = tail_.load(std::memory_order_relaxed);
+        }
+        rec = s->rec;
+        s->seq.store(pos + ring_size, std::memory_order_release);
+        return true;
+    }
+
+    std::size_t pending() const noexcept {
+        return head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_relaxed);
+    }
+
+    void start() {
+        std::lock_guard<std::mutex> guard {lock_};
+        auto pid = ipc::detail::this_process();
+        if (owner_.load(std::memory_order_relaxed) == pid) return;
+        // after fork, the thread of the parent isn't here, just leave its object behind
+        bool first = (owner_.load(std::memory_order_relaxed) == 0);
+        owner_.store(pid, std::memory_order_relaxed);
+        quit_    = false;
+        drainer_ = new std::thread {[this] { run(); }};
+        if (first) std::atexit([] { instance().stop(); });
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> guard {lock_};
+        while (!quit_) {
+            cv_.wait_for(guard, std::chrono::milliseconds(50), [this] {
+                return quit_ || (pending() >= ring_size / 2);
+            });
+            guard.unlock();
+            flush();
+            guard.lock();
+        }
+    }
+
+    void stop() {
+        std::thread *t = nullptr;
+        {
+            std::lock_guard<std::mutex> guard {lock_};
+            if (owner_.load(std::memory_order_relaxed) == ipc::detail::this_process()) {
+                quit_ = true;
+                t = std::exchange(drainer_, nullptr);
+            }
+        }
+        cv_.notify_all();
+        if ((t != nullptr) && t->joinable()) {
+            t->join();
+            delete t;
+        }
+        flush();
+    }
+
+public:
+    static logger &instance() {
+        // never destroyed, the records are flushed at exit
+        static auto *l = new logger;
+        return *l;
+    }
+
+    bool allow(char const * fmt) noexcept {
+        auto limit = rate_.load(std::memory_order_relaxed);
+        if ((limit == 0) || (fmt == nullptr)) return true;
+        auto s = find_site(fmt);
+        if (s == nullptr) return true;
+        auto now = this_second();
+        auto sec = s->second.load(std::memory_order_relaxed);
+        if ((sec != now) && s->second.compare_exchange_strong(sec, now, std::memory_order_relaxed)) {
+            s->count.store(0, std::memory_order_relaxed);
+            auto n = s->suppressed.exchange(0, std::memory_order_relaxed);
+            if (n != 0) report_suppressed(fmt, n);
+        }
+        if (s->count.fetch_add(1, std::memory_order_relaxed) < limit) return true;
+        s->suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    void push(log_level lv, char const * fmt, format_fn fn, void const * args, std::size_t size) noexcept {
+        bool pushed = enqueue(lv, fmt, fn, args, size);
+        if (!async_.load(std::memory_order_relaxed)) return;
+        try {
+            if (owner_.load(std::memory_order_relaxed) != ipc::detail::this_process()) start();
+        } catch (...) {
+            // no thread, the records would be flushed at exit
+            return;
+        }
+        if (!pushed || (pending() >= ring_size / 2)) cv_.notify_one();
+    }
+
+    std::size_t flush() noexcept {
+        std::lock_guard<std::mutex> guard {drain_lock_};
+        auto sink = sink_.load(std::memory_order_acquire);
+        if (sink == nullptr) sink = default_sink;
+        std::size_t n = 0;
+        record_t rec;
+        char text[text_size];
+        while (dequeue(rec)) {
+            std::size_t len = rec.size;
+            if (rec.fn == nullptr) {
+                std::memcpy(text, rec.args, len);
+                text[len] = '\0';
+            }
+            else {
+                int r = rec.fn(text, sizeof(text), rec.fmt, rec.args);
+                if (r < 0) continue;
+                len = (std::min)(static_cast<std::size_t>(r), sizeof(text) - 1);
+            }
+            sink(rec.level, text, len);
+            ++n;
+        }
+        if (sink == default_sink) std::fflush(stdout);
+        return n;
+    }
+
+    void set_sink(log_sink_t sink) noexcept {
+        flush(); // the records before belong to the old sink
+        sink_.store(sink, std::memory_order_release);
+    }
+
+    void set_rate(std::uint32_t r) noexcept {
+        rate_.store(r, std::memory_order_relaxed);
+    }
+
+    void set_async(bool async) noexcept {
+        async_.store(async, std::memory_order_relaxed);
+    }
+
+    std::uint64_t dropped() const noexcept {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+};
+
+} // namespace
+
+bool allow(char const * fmt) noexcept {
+    return logger::instance().allow(fmt);
+}
+
+void push(log_level lv, char const * fmt, format_fn fn, void const * args, std::size_t size) noexcept {
+    logger::instance().push(lv, fmt, fn, args, size);
+}
+
+} // namespace logging
+} // namespace detail
+
+void set_log_sink(log_sink_t sink) noexcept {
+    ipc::detail::logging::logger::instance().set_sink(sink);
+}
+
+void set_log_rate_limit(std::uint32_t per_second) noexcept {
+    ipc::detail::logging::logger::instance().set_rate(per_second);
+}
+
+void set_log_async(bool async) noexcept {
+    ipc::detail::logging::logger::instance().set_async(async);
+}
+
+std::size_t flush_log() noexcept {
+    return ipc::detail::logging::logger::instance().flush();
+}
+
+std::uint64_t log_dropped() noexcept {
+    return ipc::detail::logging::logger::instance().dropped();
+}
+
+} // namespace ipc
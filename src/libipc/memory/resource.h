@@ -66,15 +66,26 @@ using basic_string = std::basic_string<
 using string  = basic_string<char>;
 using wstring = basic_string<wchar_t>;
 
+/// \brief FNV-1a, hashes the characters rather than the address of the string.
+template <typename Char>
+std::size_t hash_string(Char const *str, std::size_t len) noexcept {
+    std::uint64_t h = 14695981039346656037ull;
+    auto p = reinterpret_cast<unsigned char const *>(str);
+    for (std::size_t i = 0; i < len * sizeof(Char); ++i) {
+        h = (h ^ p[i]) * 1099511628211ull;
+    }
+    return static_cast<std::size_t>(h);
+}
+
 template <> struct hash<string> {
     std::size_t operator()(string const &val) const noexcept {
-        return std::hash<char const *>{}(val.c_str());
+        return hash_string(val.c_str(), val.size());
     }
 };
 
 template <> struct hash<wstring> {
     std::size_t operator()(wstring const &val) const noexcept {
-        return std::hash<wchar_t const *>{}(val.c_str());
+        return hash_string(val.c_str(), val.size());
     }
 };
 
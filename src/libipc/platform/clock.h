@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+#include <algorithm>
+
+#include "libipc/platform/detail.h"
+#if defined(IPC_OS_WINDOWS_)
+#include <Windows.h>
+#else/*!IPC_OS_WINDOWS_*/
+#include <time.h>
+#endif/*!IPC_OS_WINDOWS_*/
+#if defined(LIBIPC_USE_TSC) && (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86))
+#   define IPC_CLOCK_TSC_
+#   if defined(_MSC_VER)
+#   include <intrin.h>
+#   else
+#   include <x86intrin.h>
+#   endif
+#endif
+
+namespace ipc {
+namespace detail {
+
+#if defined(IPC_CLOCK_TSC_)
+/// \brief The TSC ticks per nanosecond, calibrated against the steady clock once.
+inline double tsc_ticks_per_ns() noexcept {
+    static double const ticks = [] {
+        auto t0 = std::chrono::steady_clock::now();
+        auto c0 = __rdtsc();
+        while (std::chrono::steady_clock::now() - t0 < std::chrono::milliseconds(10)) ;
+        auto c1 = __rdtsc();
+        auto t1 = std::chrono::steady_clock::now();
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+        return (ns <= 0) ? 1.0 : (static_cast<double>(c1 - c0) / static_cast<double>(ns));
+    }();
+    return ticks;
+}
+#endif
+
+/// \brief The nanoseconds of the OS monotonic clock, the same timeline in all the processes.
+/// CLOCK_MONOTONIC_RAW if there is one, QueryPerformanceCounter on Windows.
+inline std::uint64_t monotonic_ns() noexcept {
+#if defined(IPC_OS_WINDOWS_)
+    static std::uint64_t const freq = [] {
+        LARGE_INTEGER f;
+        ::QueryPerformanceFrequency(&f);
+        return static_cast<std::uint64_t>(f.QuadPart);
+    }();
+    LARGE_INTEGER c;
+    ::QueryPerformanceCounter(&c);
+    auto t = static_cast<std::uint64_t>(c.QuadPart);
+    return (t / freq) * 1000000000ull + (t % freq) * 1000000000ull / freq;
+#else
+    timespec ts;
+#   if defined(CLOCK_MONOTONIC_RAW)
+    ::clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+#   else
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+#   endif
+    return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<std::uint64_t>(ts.tv_nsec);
+#endif
+}
+
+/// \brief A timestamp which could be compared between processes, never 0.
+/// It's the raw TSC with LIBIPC_USE_TSC on x86 (all the processes of a channel must be built the same way),
+/// otherwise monotonic_ns.
+inline std::uint64_t timestamp() noexcept {
+#if defined(IPC_CLOCK_TSC_)
+    std::uint64_t t = static_cast<std::uint64_t>(__rdtsc());
+#else
+    std::uint64_t t = monotonic_ns();
+#endif
+    return (std::max)(t, std::uint64_t(1));
+}
+
+/// \brief The nanoseconds between two timestamps, 0 if 'to' is earlier than 'from'.
+inline std::uint64_t stamp_to_ns(std::uint64_t from, std::uint64_t to) noexcept {
+    if (to <= from) return 0;
+    std::uint64_t d = to - from;
+#if defined(IPC_CLOCK_TSC_)
+    return static_cast<std::uint64_t>(static_cast<double>(d) / tsc_ticks_per_ns());
+#else
+    return d;
+#endif
+}
+
+} // namespace detail
+} // namespace ipc
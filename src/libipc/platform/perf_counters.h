@@ -0,0 +1,217 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#include "libipc/platform/detail.h"
+#if defined(IPC_OS_LINUX_)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace ipc {
+namespace detail {
+
+/// \brief The events which could be counted by perf_counters.
+enum class perf_event : std::size_t {
+    cycles,
+    instructions,
+    l1d_misses,       // L1 data cache read misses
+    llc_misses,       // last level cache read misses
+    branch_misses,
+    context_switches,
+    page_faults,
+    count
+};
+
+inline char const * perf_event_name(perf_event e) noexcept {
+    static char const * const names[] = {
+        "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses", "context_switches", "page_faults"
+    };
+    return names[static_cast<std::size_t>(e)];
+}
+
+/// \brief The values read from perf_counters, an event which couldn't be opened isn't valid.
+struct perf_values {
+    std::uint64_t value[static_cast<std::size_t>(perf_event::count)] {};
+    bool          valid[static_cast<std::size_t>(perf_event::count)] {};
+
+    std::uint64_t operator[](perf_event e) const noexcept {
+        return value[static_cast<std::size_t>(e)];
+    }
+
+    bool has(perf_event e) const noexcept {
+        return valid[static_cast<std::size_t>(e)];
+    }
+
+    perf_values & operator+=(perf_values const & rhs) noexcept {
+        for (std::size_t i = 0; i < static_cast<std::size_t>(perf_event::count); ++i) {
+            value[i] += rhs.value[i];
+            valid[i]  = valid[i] || rhs.valid[i];
+        }
+        return *this;
+    }
+};
+
+/**
+ * \brief The hardware & software counters of the calling thread, by perf_event_open.
+ *
+ * The hardware events are opened as one group (so that they are scheduled on the PMU together,
+ * and their ratios make sense), the software ones as another.
+ * It degrades with perf_event_paranoid & the machine instead of failing:
+ *  - the kernel is counted too if it's allowed, otherwise only the user space (paranoid 2),
+ *  - an event the PMU doesn't have (or no PMU at all, as in many VMs) is left out,
+ *  - nothing is counted if perf is forbidden (paranoid 3 on some distributions) or it isn't Linux.
+ * A multiplexed group is scaled by its enabled/running time.
+*/
+class perf_counters {
+#if defined(IPC_OS_LINUX_)
+    enum : std::size_t {
+        event_count = static_cast<std::size_t>(perf_event::count)
+    };
+
+    int  fds_   [event_count];
+    int  leader_[2] = {-1, -1};  // hardware, software
+    bool kernel_ = false;
+
+    static long open_event(perf_event_attr & attr, int group) noexcept {
+        return ::syscall(__NR_perf_event_open, &attr, 0 /*this thread*/, -1 /*any cpu*/, group, 0);
+    }
+
+    static void describe(perf_event e, perf_event_attr & attr) noexcept {
+        auto cache = [&attr](std::uint64_t id) {
+            attr.type   = PERF_TYPE_HW_CACHE;
+            attr.config = id | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        };
+        switch (e) {
+        case perf_event::cycles:
+            attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case perf_event::instructions:
+            attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case perf_event::l1d_misses:
+            cache(PERF_COUNT_HW_CACHE_L1D);
+            break;
+        case perf_event::llc_misses:
+            cache(PERF_COUNT_HW_CACHE_LL);
+            break;
+        case perf_event::branch_misses:
+            attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        case perf_event::context_switches:
+            attr.type = PERF_TYPE_SOFTWARE; attr.config = PERF_COUNT_SW_CONTEXT_SWITCHES;
+            break;
+        case perf_event::page_faults:
+            attr.type = PERF_TYPE_SOFTWARE; attr.config = PERF_COUNT_SW_PAGE_FAULTS;
+            break;
+        default:
+            break;
+        }
+    }
+
+    int open(perf_event e, bool kernel) noexcept {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        describe(e, attr);
+        auto &leader = leader_[(attr.type == PERF_TYPE_SOFTWARE) ? 1 : 0];
+        attr.disabled       = (leader == -1) ? 1 : 0; // the group follows its leader
+        attr.exclude_kernel = kernel ? 0 : 1;
+        attr.exclude_hv     = 1;
+        attr.read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_ID
+                            | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        auto fd = static_cast<int>(open_event(attr, leader));
+        if ((fd != -1) && (leader == -1)) leader = fd;
+        return fd;
+    }
+
+    void read_group(int leader, perf_values & out) const noexcept {
+        if (leader == -1) return;
+        // nr, time_enabled, time_running, {value, id} * nr
+        std::uint64_t buf[3 + 2 * event_count];
+        if (::read(leader, buf, sizeof(buf)) < static_cast<ssize_t>(3 * sizeof(std::uint64_t))) return;
+        auto nr = (buf[0] < event_count) ? buf[0] : event_count;
+        double scale = (buf[2] == 0) ? 0.0 : (static_cast<double>(buf[1]) / static_cast<double>(buf[2]));
+        for (std::uint64_t k = 0; k < nr; ++k) {
+            auto value = buf[3 + 2 * k];
+            auto id    = buf[4 + 2 * k];
+            for (std::size_t i = 0; i < event_count; ++i) {
+                std::uint64_t fid = 0;
+                if ((fds_[i] == -1) || (::ioctl(fds_[i], PERF_EVENT_IOC_ID, &fid) != 0) || (fid != id)) continue;
+                out.value[i] = static_cast<std::uint64_t>(static_cast<double>(value) * scale);
+                out.valid[i] = true;
+            }
+        }
+    }
+
+    void each_leader(unsigned long op) noexcept {
+        for (int fd : leader_) {
+            if (fd != -1) ::ioctl(fd, op, PERF_IOC_FLAG_GROUP);
+        }
+    }
+
+public:
+    perf_counters() noexcept {
+        for (auto & fd : fds_) fd = -1;
+        // try with the kernel first, perf_event_paranoid >= 2 turns it down with EACCES
+        // (unless the process has CAP_PERFMON)
+        kernel_ = true;
+        for (std::size_t i = 0; i < event_count; ++i) {
+            fds_[i] = open(static_cast<perf_event>(i), kernel_);
+            if ((fds_[i] == -1) && kernel_ && ((errno == EACCES) || (errno == EPERM))) {
+                kernel_ = false;
+                fds_[i] = open(static_cast<perf_event>(i), false);
+            }
+        }
+    }
+
+    ~perf_counters() {
+        for (int fd : fds_) {
+            if (fd != -1) ::close(fd);
+        }
+    }
+
+    perf_counters(perf_counters const &) = delete;
+    perf_counters & operator=(perf_counters const &) = delete;
+
+    bool valid() const noexcept {
+        return (leader_[0] != -1) || (leader_[1] != -1);
+    }
+
+    /// \brief Whether the kernel side (syscalls, futex waits ...) is counted as well.
+    bool kernel() const noexcept {
+        return kernel_;
+    }
+
+    void start() noexcept {
+        each_leader(PERF_EVENT_IOC_RESET);
+        each_leader(PERF_EVENT_IOC_ENABLE);
+    }
+
+    void stop() noexcept {
+        each_leader(PERF_EVENT_IOC_DISABLE);
+    }
+
+    perf_values read() const noexcept {
+        perf_values v;
+        read_group(leader_[0], v);
+        read_group(leader_[1], v);
+        return v;
+    }
+#else /*!IPC_OS_LINUX_*/
+public:
+    bool valid () const noexcept { return false; }
+    bool kernel() const noexcept { return false; }
+    void start() noexcept {}
+    void stop () noexcept {}
+    perf_values read() const noexcept { return {}; }
+#endif/*!IPC_OS_LINUX_*/
+};
+
+} // namespace detail
+} // namespace ipc
@@ -10,6 +10,7 @@
 #include <string>
 #include <utility>
 #include <cstring>
+#include <climits>  // CHAR_BIT
 
 #include "libipc/shm.h"
 #include "libipc/def.h"
@@ -17,6 +18,11 @@
 
 #include "libipc/utility/log.h"
 #include "libipc/memory/resource.h"
+#include "libipc/platform/detail.h"
+
+#if defined(IPC_OS_LINUX_)
+#include <sys/syscall.h>
+#endif
 
 namespace {
 
@@ -29,8 +35,66 @@ struct id_info_t {
     void*       mem_  = nullptr;
     std::size_t size_ = 0;
     ipc::string name_;
+    ipc::shm::numa_policy numa_;
 };
 
+#if defined(IPC_OS_LINUX_)
+
+// see: https://man7.org/linux/man-pages/man2/mbind.2.html
+enum : int {
+    mpol_default    = 0,
+    mpol_preferred  = 1,
+    mpol_bind       = 2,
+    mpol_interleave = 3,
+    mpol_mf_move    = (1 << 1)
+};
+
+constexpr std::size_t ulong_bits = sizeof(unsigned long) * CHAR_BIT;
+
+bool mbind_numa(void* mem, std::size_t size, ipc::shm::numa_policy const & policy, unsigned flags) {
+    unsigned long mask[ipc::shm::numa_max_nodes / ulong_bits] {};
+    std::uint64_t nodes = policy.nodes;
+    int mode = mpol_default;
+    switch (policy.mode) {
+    case ipc::shm::numa::bind:
+        if (nodes == 0) {
+            ipc::error("fail mbind: no node to bind\n");
+            return false;
+        }
+        mode = mpol_bind;
+        break;
+    case ipc::shm::numa::interleave:
+        if (nodes == 0) nodes = ~nodes; // the kernel drops the nodes without memory
+        mode = mpol_interleave;
+        break;
+    case ipc::shm::numa::local: {
+            unsigned cpu = 0, node = 0;
+            if (::syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+                ipc::error("fail getcpu[%d]\n", errno);
+                return false;
+            }
+            nodes = std::uint64_t(1) << (node % ipc::shm::numa_max_nodes);
+            mode  = mpol_preferred;
+        }
+        break;
+    default:
+        nodes = 0;
+        break;
+    }
+    for (std::size_t i = 0; i < ipc::shm::numa_max_nodes; ++i) {
+        if (nodes & (std::uint64_t(1) << i)) mask[i / ulong_bits] |= 1ul << (i % ulong_bits);
+    }
+    // The kernel ignores the last bit of maxnode.
+    if (::syscall(SYS_mbind, mem, size, mode, (nodes == 0) ? nullptr : mask,
+                  ipc::shm::numa_max_nodes + 1, flags) != 0) {
+        ipc::error("fail mbind[%d]: mode = %d, nodes = %llx\n", errno, mode, (unsigned long long)nodes);
+        return false;
+    }
+    return true;
+}
+
+#endif/*IPC_OS_LINUX_*/
+
 constexpr std::size_t calc_size(std::size_t size) {
     return ((((size - 1) / alignof(info_t)) + 1) * alignof(info_t)) + sizeof(info_t);
 }
@@ -151,6 +215,12 @@ void * get_mem(id_t id, std::size_t * size) {
         ipc::error("fail mmap[%d]: %s, size = %zd\n", errno, ii->name_.c_str(), ii->size_);
         return nullptr;
     }
+#if defined(IPC_OS_LINUX_)
+    // Must be done before the first touch below.
+    if (ii->numa_.mode != numa::none) {
+        mbind_numa(mem, ii->size_, ii->numa_, 0);
+    }
+#endif
     ::close(fd);
     ii->fd_  = -1;
     ii->mem_ = mem;
@@ -159,6 +229,62 @@ void * get_mem(id_t id, std::size_t * size) {
     return mem;
 }
 
+bool set_numa(id_t id, numa_policy const & policy) noexcept {
+    if (id == nullptr) {
+        ipc::error("fail set_numa: invalid id (null)\n");
+        return false;
+    }
+    auto ii = static_cast<id_info_t*>(id);
+    ii->numa_ = policy;
+    if (ii->mem_ == nullptr) {
+        return true; // applied by get_mem
+    }
+#if defined(IPC_OS_LINUX_)
+    // Only the pages mapped by this process alone could be moved.
+    return mbind_numa(ii->mem_, ii->size_, policy, mpol_mf_move);
+#else
+    return false;
+#endif
+}
+
+std::size_t numa_residency(id_t id, std::size_t * pages, std::size_t count) noexcept {
+    for (std::size_t i = 0; (pages != nullptr) && (i < count); ++i) pages[i] = 0;
+    if (id == nullptr) {
+        ipc::error("fail numa_residency: invalid id (null)\n");
+        return 0;
+    }
+    auto ii = static_cast<id_info_t*>(id);
+    if (ii->mem_ == nullptr || ii->size_ == 0) {
+        return 0;
+    }
+    std::size_t total = 0;
+#if defined(IPC_OS_LINUX_)
+    enum : unsigned { batch = 64 };
+    auto page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    void* addrs [batch];
+    int   status[batch];
+    for (std::size_t off = 0; off < ii->size_;) {
+        unsigned n = 0;
+        for (; (n < batch) && (off < ii->size_); ++n, off += page_size) {
+            addrs[n] = static_cast<ipc::byte_t*>(ii->mem_) + off;
+        }
+        // With nodes == nullptr, move_pages only reports where the pages are.
+        if (::syscall(SYS_move_pages, 0, n, addrs, nullptr, status, 0) != 0) {
+            ipc::error("fail move_pages[%d]: %s\n", errno, ii->name_.c_str());
+            return total;
+        }
+        for (unsigned i = 0; i < n; ++i) {
+            if (status[i] < 0) continue; // not resident
+            ++total;
+            if ((pages != nullptr) && (static_cast<std::size_t>(status[i]) < count)) {
+                ++pages[status[i]];
+            }
+        }
+    }
+#endif
+    return total;
+}
+
 std::int32_t release(id_t id) noexcept {
     if (id == nullptr) {
         ipc::error("fail release: invalid id (null)\n");
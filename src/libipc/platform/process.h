@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+
+#include "libipc/platform/detail.h"
+#if defined(IPC_OS_WINDOWS_)
+#include <Windows.h>
+#else/*!IPC_OS_WINDOWS_*/
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#endif/*!IPC_OS_WINDOWS_*/
+
+namespace ipc {
+namespace detail {
+
+using pid_t    = std::uint32_t;
+using pid_ns_t = std::uint64_t;
+
+/// \brief The id of the calling process, never 0.
+inline pid_t this_process() noexcept {
+#if defined(IPC_OS_WINDOWS_)
+    return static_cast<pid_t>(::GetCurrentProcessId());
+#else
+    return static_cast<pid_t>(::getpid());
+#endif
+}
+
+/// \brief Check whether a process is still running.
+/// A recycled pid would be regarded as alive, which only falls back to the timeout.
+inline bool process_alive(pid_t pid) noexcept {
+#if defined(IPC_OS_WINDOWS_)
+    HANDLE h = ::OpenProcess(SYNCHRONIZE, FALSE, static_cast<DWORD>(pid));
+    if (h == NULL) {
+        return ::GetLastError() != ERROR_INVALID_PARAMETER;
+    }
+    bool alive = (::WaitForSingleObject(h, 0) == WAIT_TIMEOUT);
+    ::CloseHandle(h);
+    return alive;
+#else
+    // EPERM means the process exists, but belongs to another user.
+    return (::kill(static_cast< ::pid_t>(pid), 0) == 0) || (errno != ESRCH);
+#endif
+}
+
+/// \brief The pid namespace of the calling process, 0 if it couldn't be told.
+/// The processes of a channel may be in other containers which only share /dev/shm with this one,
+/// a pid means nothing out of its own namespace.
+inline pid_ns_t this_pid_ns() noexcept {
+#if defined(IPC_OS_WINDOWS_)
+    return 1; // no pid namespaces
+#else
+    static pid_ns_t const ns = [] {
+        struct ::stat st;
+        return (::stat("/proc/self/ns/pid", &st) == 0) ? static_cast<pid_ns_t>(st.st_ino) : pid_ns_t(0);
+    }();
+    return ns;
+#endif
+}
+
+/// \brief Check whether a process is still running, by a pid which has been recorded with its namespace.
+/// A pid of another (or an unknown) namespace couldn't be checked, so it's regarded as alive.
+inline bool process_alive(pid_t pid, pid_ns_t ns) noexcept {
+    if ((ns == 0) || (ns != this_pid_ns())) return true;
+    return process_alive(pid);
+}
+
+} // namespace detail
+} // namespace ipc
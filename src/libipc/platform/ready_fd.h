@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "libipc/platform/detail.h"
+#if defined(IPC_OS_LINUX_)
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include "libipc/utility/log.h"
+#include "libipc/ready_table.h"
+
+namespace ipc {
+namespace detail {
+
+/**
+ * \brief The fd of a receiver, which a sender of any process could make readable.
+ *
+ * An eventfd couldn't be written by another process, so on Linux it's a datagram socket
+ * bound to an address in the abstract namespace: nothing on the file system to clean up,
+ * and the address is gone along with a dead receiver (a signal to it fails with ECONNREFUSED).
+ * The senders only signal it when it's parked, see ready_table.
+ * It isn't supported on the other systems, the fd is -1 there.
+*/
+class ready_fd {
+    int         fd_   = -1;
+    std::size_t slot_ = ready_table::max_slots;
+
+#if defined(IPC_OS_LINUX_)
+    static socklen_t address_of(std::uint64_t token, sockaddr_un & addr) noexcept {
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        // sun_path[0] == '\0': the abstract namespace
+        int n = std::snprintf(addr.sun_path + 1, sizeof(addr.sun_path) - 1, "libipc.ready.%016llx",
+                              static_cast<unsigned long long>(token));
+        return static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 + n);
+    }
+
+    static std::uint64_t make_token() noexcept {
+        static std::atomic<std::uint32_t> seq {0};
+        return ready_table::make_token(seq.fetch_add(1, std::memory_order_relaxed) + 1);
+    }
+#endif
+
+public:
+    ready_fd() = default;
+    ready_fd(ready_fd const &) = delete;
+    ready_fd & operator=(ready_fd const &) = delete;
+
+    ~ready_fd() {
+        close(nullptr);
+    }
+
+    int  fd   () const noexcept { return fd_; }
+    bool valid() const noexcept { return fd_ != -1; }
+
+    /// \brief Creates the fd & registers it in a free slot of the table.
+    bool open(ready_table * tb) noexcept {
+        if (valid()) return true;
+        if (tb == nullptr) return false;
+#if defined(IPC_OS_LINUX_)
+        int fd = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd == -1) {
+            ipc::error("fail ready_fd socket[%d]\n", errno);
+            return false;
+        }
+        sockaddr_un addr;
+        auto token = make_token();
+        if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), address_of(token, addr)) != 0) {
+            ipc::error("fail ready_fd bind[%d]\n", errno);
+            ::close(fd);
+            return false;
+        }
+        auto slot = tb->join(token);
+        if (slot < ready_table::max_slots) {
+            fd_   = fd;
+            slot_ = slot;
+            // readable at first, so that whatever has been sent before would be received
+            signal(token);
+            return true;
+        }
+        ipc::error("fail ready_fd: all the %zu slots are in use\n", static_cast<std::size_t>(ready_table::max_slots));
+        ::close(fd);
+#endif
+        return false;
+    }
+
+    /// \brief Leaves the slot & closes the fd.
+    void close(ready_table * tb) noexcept {
+        if (!valid()) return;
+        if (tb != nullptr) tb->leave(slot_);
+#if defined(IPC_OS_LINUX_)
+        ::close(fd_);
+#endif
+        fd_   = -1;
+        slot_ = ready_table::max_slots;
+    }
+
+    /// \brief Consumes the pending signals & arms the slot, see ready_table::arm.
+    void park(ready_table * tb) noexcept {
+        if (!valid() || (tb == nullptr)) return;
+#if defined(IPC_OS_LINUX_)
+        char buf[16];
+        while (::recv(fd_, buf, sizeof(buf), MSG_DONTWAIT) > 0) ;
+#endif
+        tb->arm(slot_);
+    }
+
+    /// \brief Makes the fd of 'token' readable, false if it doesn't exist anymore.
+    static bool signal(std::uint64_t token) noexcept {
+#if defined(IPC_OS_LINUX_)
+        // an unbound socket of each sending thread
+        static thread_local struct sender_t {
+            int fd = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+            ~sender_t() { if (fd != -1) ::close(fd); }
+        } sender;
+        if (sender.fd == -1) return true;
+        sockaddr_un addr;
+        char c = 0;
+        if (::sendto(sender.fd, &c, 1, MSG_DONTWAIT | MSG_NOSIGNAL,
+                     reinterpret_cast<sockaddr *>(&addr), address_of(token, addr)) == 1) {
+            return true;
+        }
+        // EAGAIN: the socket is full of signals already, it's readable anyway
+        return (errno != ECONNREFUSED) && (errno != ENOENT);
+#else
+        static_cast<void>(token);
+        return true;
+#endif
+    }
+};
+
+} // namespace detail
+} // namespace ipc
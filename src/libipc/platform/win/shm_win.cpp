@@ -22,8 +22,29 @@ struct id_info_t {
     HANDLE      h_    = NULL;
     void*       mem_  = nullptr;
     std::size_t size_ = 0;
+    ipc::shm::numa_policy numa_;
 };
 
+DWORD preferred_node(ipc::shm::numa_policy const & policy) {
+    switch (policy.mode) {
+    case ipc::shm::numa::bind:
+        for (DWORD i = 0; i < ipc::shm::numa_max_nodes; ++i) {
+            if (policy.nodes & (std::uint64_t(1) << i)) return i;
+        }
+        break;
+    case ipc::shm::numa::local: {
+            UCHAR node = 0;
+            if (::GetNumaProcessorNode(static_cast<UCHAR>(::GetCurrentProcessorNumber()), &node)) {
+                return node;
+            }
+        }
+        break;
+    default:
+        break;
+    }
+    return NUMA_NO_PREFERRED_NODE;
+}
+
 } // internal-linkage
 
 namespace ipc {
@@ -92,7 +113,8 @@ void * get_mem(id_t id, std::size_t * size) {
         ipc::error("fail to_mem: invalid id (h = null)\n");
         return nullptr;
     }
-    LPVOID mem = ::MapViewOfFile(ii->h_, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    // Interleaving is not supported by Windows, only the preferred node is.
+    LPVOID mem = ::MapViewOfFileExNuma(ii->h_, FILE_MAP_ALL_ACCESS, 0, 0, 0, NULL, preferred_node(ii->numa_));
     if (mem == NULL) {
         ipc::error("fail MapViewOfFile[%d]\n", static_cast<int>(::GetLastError()));
         return nullptr;
@@ -110,6 +132,22 @@ void * get_mem(id_t id, std::size_t * size) {
     return static_cast<void *>(mem);
 }
 
+bool set_numa(id_t id, numa_policy const & policy) noexcept {
+    if (id == nullptr) {
+        ipc::error("fail set_numa: invalid id (null)\n");
+        return false;
+    }
+    auto ii = static_cast<id_info_t*>(id);
+    ii->numa_ = policy;
+    // A mapped view could not be moved.
+    return ii->mem_ == nullptr;
+}
+
+std::size_t numa_residency(id_t, std::size_t * pages, std::size_t count) noexcept {
+    for (std::size_t i = 0; (pages != nullptr) && (i < count); ++i) pages[i] = 0;
+    return 0;
+}
+
 std::int32_t release(id_t id) noexcept {
     if (id == nullptr) {
         ipc::error("fail release: invalid id (null)\n");
@@ -69,6 +69,35 @@ struct prod_cons_impl<wr<relat::single, relat::single, trans::unicast>> {
         rd_.fetch_add(1, std::memory_order_release);
         return true;
     }
+
+    circ::u2_t pending(circ::u2_t /*cur*/) const noexcept {
+        return wt_.load(std::memory_order_acquire) - rd_.load(std::memory_order_relaxed);
+    }
+
+    template <typename F, typename E>
+    void peek(circ::u2_t /*cur*/, F&& f, E* elems) const {
+        auto cur_wt = wt_.load(std::memory_order_acquire);
+        for (auto cur_rd = rd_.load(std::memory_order_relaxed); 
+             circ::index_of(cur_rd) != circ::index_of(cur_wt); ++cur_rd) {
+            f(&(elems[circ::index_of(cur_rd)].data_));
+        }
+    }
+
+    /**
+     * Skips the unread elements while 'f' returns true, and moves the read index only once.
+    */
+    template <typename W, typename F, typename E>
+    circ::u2_t skip(W* /*wrapper*/, circ::u2_t& /*cur*/, F&& f, E* elems) {
+        auto beg_rd = rd_.load(std::memory_order_relaxed);
+        auto cur_wt = wt_.load(std::memory_order_acquire);
+        auto cur_rd = beg_rd;
+        while ((circ::index_of(cur_rd) != circ::index_of(cur_wt)) && 
+               f(&(elems[circ::index_of(cur_rd)].data_))) {
+            ++cur_rd;
+        }
+        rd_.store(cur_rd, std::memory_order_release);
+        return cur_rd - beg_rd;
+    }
 };
 
 template <>
@@ -81,6 +110,10 @@ struct prod_cons_impl<wr<relat::single, relat::multi , trans::unicast>>
         return false;
     }
 
+    // the read index is shared by the receivers, nobody could skip for the others
+    template <typename W, typename F, typename E>
+    circ::u2_t skip(W*, circ::u2_t&, F&&, E*) = delete;
+
     template <typename W, typename F, typename R, 
               template <std::size_t, std::size_t> class E, std::size_t DS, std::size_t AS>
     bool pop(W* /*wrapper*/, circ::u2_t& /*cur*/, F&& f, R&& out, E<DS, AS>* elems) {
@@ -221,12 +254,17 @@ struct prod_cons_impl<wr<relat::single, relat::multi, trans::broadcast>> {
         for (unsigned k = 0;;) {
             circ::cc_t cc = wrapper->elems()->connections(std::memory_order_relaxed);
             if (cc == 0) return false; // no reader
-            el = elems + circ::index_of(wt_.load(std::memory_order_relaxed));
+            auto cur_wt = wt_.load(std::memory_order_relaxed);
+            el = elems + circ::index_of(cur_wt);
             // check all consumers have finished reading this element
             auto cur_rc = el->rc_.load(std::memory_order_acquire);
             circ::cc_t rem_cc = cur_rc & ep_mask;
             if ((cc & rem_cc) && ((cur_rc & ~ep_mask) == epoch_)) {
-                return false; // has not finished yet
+                // a dead reader would never finish, reclaim its slot instead of waiting for force_push
+                if (wrapper->elems()->disconnect_dead_receiver(cc & rem_cc, cur_wt) == 0) {
+                    return false; // has not finished yet
+                }
+                continue;
             }
             // consider rem_cc to be 0 here
             if (el->rc_.compare_exchange_weak(
@@ -287,6 +325,33 @@ struct prod_cons_impl<wr<relat::single, relat::multi, trans::broadcast>> {
             ipc::yield(k);
         }
     }
+
+    circ::u2_t pending(circ::u2_t cur) const noexcept {
+        return cursor() - cur;
+    }
+
+    template <typename F, typename E>
+    void peek(circ::u2_t cur, F&& f, E* elems) const {
+        for (auto cur_wt = cursor(); cur != cur_wt; ++cur) {
+            f(&(elems[circ::index_of(cur)].data_));
+        }
+    }
+
+    /**
+     * Skips the unread elements while 'f' returns true.
+     * Only clears the read bit of this receiver from each one, without any copying.
+    */
+    template <typename W, typename F, typename E>
+    circ::u2_t skip(W* wrapper, circ::u2_t& cur, F&& f, E* elems) {
+        auto beg = cur;
+        auto cc_id = static_cast<rc_t>(wrapper->connected_id());
+        for (auto cur_wt = cursor(); cur != cur_wt; ++cur) {
+            auto* el = elems + circ::index_of(cur);
+            if (!f(&(el->data_))) break;
+            el->rc_.fetch_and(~cc_id, std::memory_order_release);
+        }
+        return cur - beg;
+    }
 };
 
 // Զƫػʵ
@@ -364,7 +429,11 @@ struct prod_cons_impl<wr<relat::multi, relat::multi, trans::broadcast>> {
             auto cur_rc = el->rc_.load(std::memory_order_relaxed);
             circ::cc_t rem_cc = cur_rc & rc_mask;
             if ((cc & rem_cc) && ((cur_rc & ~ep_mask) == epoch)) {
-                return false; // has not finished yet
+                // a dead reader would never finish, reclaim its slot instead of waiting for force_push
+                if (wrapper->elems()->disconnect_dead_receiver(cc & rem_cc, cur_ct) == 0) {
+                    return false; // has not finished yet
+                }
+                continue;
             }
             else if (!rem_cc) {
                 // ?
@@ -463,6 +532,160 @@ struct prod_cons_impl<wr<relat::multi, relat::multi, trans::broadcast>> {
             ipc::yield(k);
         }
     }
+
+    circ::u2_t pending(circ::u2_t cur) const noexcept {
+        return cursor() - cur;
+    }
+
+    template <typename F, typename E, std::size_t N>
+    void peek(circ::u2_t cur, F&& f, E(& elems)[N]) const {
+        for (;; ++cur) {
+            auto* el = elems + circ::index_of(cur);
+            if (el->f_ct_.load(std::memory_order_acquire) != ~static_cast<flag_t>(cur)) {
+                return; // not committed yet
+            }
+            f(&(el->data_));
+        }
+    }
+
+    /**
+     * Skips the unread elements while 'f' returns true.
+     * Releasing an element has to follow 'pop', as the last reader hands it back to the writers,
+     * but nothing would be copied.
+    */
+    template <typename W, typename F, typename E, std::size_t N>
+    circ::u2_t skip(W* wrapper, circ::u2_t& cur, F&& f, E(& elems)[N]) {
+        auto beg = cur;
+        for (;;) {
+            auto* el = elems + circ::index_of(cur);
+            if (el->f_ct_.load(std::memory_order_acquire) != ~static_cast<flag_t>(cur)) {
+                break; // not committed yet
+            }
+            if (!f(&(el->data_))) break;
+            pop(wrapper, cur, [](void*) {}, [](bool) {}, elems);
+        }
+        return cur - beg;
+    }
+};
+
+/**
+ * Lossy broadcast: the writer never looks at the readers, it just overwrites the oldest slot.
+ * Every slot carries a seqlock-style sequence number, so a reader could tell whether
+ * the slot it has copied still holds the message it wanted, or has been overrun.
+ * An overrun reader jumps forward to the oldest slot which might still be valid,
+ * the skipped slots are counted as lost by the queue.
+*/
+template <>
+struct prod_cons_impl<wr<relat::single, relat::multi, trans::overwrite>> {
+
+    using seq_t = std::uint64_t;
+
+    template <std::size_t DataSize, std::size_t AlignSize>
+    struct elem_t {
+        std::aligned_storage_t<DataSize, AlignSize> data_ {};
+        std::atomic<seq_t> seq_ { 0 }; // even: committed, odd: being written
+    };
+
+    alignas(cache_line_size) std::atomic<circ::u2_t> wt_; // write index
+
+    // The sequence number of a committed slot, which holds the message 'cur'.
+    constexpr static seq_t seq_of(circ::u2_t cur) noexcept {
+        return (static_cast<seq_t>(cur) + 1) << 1;
+    }
+
+    circ::u2_t cursor() const noexcept {
+        return wt_.load(std::memory_order_acquire);
+    }
+
+    template <typename W, typename F, typename E>
+    bool push(W* wrapper, F&& f, E* elems) {
+        if (wrapper->elems()->connections(std::memory_order_relaxed) == 0) {
+            return false; // no reader
+        }
+        auto cur_wt = wt_.load(std::memory_order_relaxed);
+        auto* el = elems + circ::index_of(cur_wt);
+        el->seq_.store(seq_of(cur_wt) - 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::forward<F>(f)(&(el->data_));
+        el->seq_.store(seq_of(cur_wt), std::memory_order_release);
+        wt_.store(cur_wt + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * 'push' never meets a full ring here, so there is nothing to force.
+    */
+    template <typename W, typename F, typename E>
+    bool force_push(W* wrapper, F&& f, E* elems) {
+        return push(wrapper, std::forward<F>(f), elems);
+    }
+
+    template <typename W, typename F, typename R, 
+              template <std::size_t, std::size_t> class E, std::size_t DS, std::size_t AS, std::size_t N>
+    bool pop(W* /*wrapper*/, circ::u2_t& cur, F&& f, R&& out, E<DS, AS>(& elems)[N]) {
+        byte_t buff[DS];
+        for (;;) {
+            auto cur_wt = cursor();
+            if (cur == cur_wt) return false; // empty
+            if (cur_wt - cur >= N) {
+                // has been lapped, the slot of 'cur_wt' is the next one to be overwritten
+                cur = cur_wt - static_cast<circ::u2_t>(N - 1);
+            }
+            auto* el = elems + circ::index_of(cur);
+            auto cur_sq = el->seq_.load(std::memory_order_acquire);
+            if (cur_sq == seq_of(cur)) {
+                std::memcpy(buff, &(el->data_), sizeof(buff));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (el->seq_.load(std::memory_order_relaxed) == cur_sq) {
+                    ++cur;
+                    std::forward<F>(f)(buff);
+                    std::forward<R>(out)(true);
+                    return true;
+                }
+            }
+            // overrun while reading, the writer has gone at least N messages past 'cur'
+            cur = cursor() - static_cast<circ::u2_t>(N - 1);
+        }
+    }
+
+    circ::u2_t pending(circ::u2_t cur) const noexcept {
+        return cursor() - cur;
+    }
+
+    /**
+     * The slots may be overwritten while peeking, so what 'f' sees is only a hint.
+    */
+    template <typename F, typename E, std::size_t N>
+    void peek(circ::u2_t cur, F&& f, E(& elems)[N]) const {
+        auto cur_wt = cursor();
+        if (cur_wt - cur >= N) {
+            cur = cur_wt - static_cast<circ::u2_t>(N - 1);
+        }
+        for (; cur != cur_wt; ++cur) {
+            f(&(elems[circ::index_of(cur)].data_));
+        }
+    }
+
+    /**
+     * Skips the unread slots while 'f' returns true.
+     * Each slot is validated like 'pop', the overwritten ones are jumped over anyway.
+    */
+    template <typename W, typename F, typename E, std::size_t N>
+    circ::u2_t skip(W* wrapper, circ::u2_t& cur, F&& f, E(& elems)[N]) {
+        auto beg = cur;
+        for (;;) {
+            bool next = true;
+            if (!pop(wrapper, cur, [&](void* p) { next = f(p); }, [](bool) {}, elems)) {
+                break;
+            }
+            if (!next) {
+                // keep the slot which 'f' has refused, it would be validated again by 'pop'
+                --cur;
+                break;
+            }
+        }
+        return cur - beg;
+    }
 };
 
 } // namespace ipc
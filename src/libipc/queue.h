@@ -78,6 +78,9 @@ public:
         return connected_;
     }
 
+    shm::handle       & elems_handle()       noexcept { return elems_h_; }
+    shm::handle const & elems_handle() const noexcept { return elems_h_; }
+
     // receiver
     template <typename Elems>
     auto connect(Elems* elems) noexcept
@@ -117,6 +120,7 @@ protected:
     elems_t * elems_ = nullptr;
     // commit index,prod_cons_impl::cursor()
     decltype(std::declval<elems_t>().cursor()) cursor_ = 0; 
+    std::uint64_t lost_ = 0; // the messages which have been overwritten before read, lossy rings only
     bool sender_flag_ = false;
 
 public:
@@ -189,6 +193,28 @@ public:
         return !valid() || (cursor_ == elems_->cursor());
     }
 
+    std::uint64_t lost() const noexcept {
+        return lost_;
+    }
+
+    // the elements which haven't been read by this receiver
+    std::size_t pending() const noexcept {
+        return (elems_ == nullptr) ? 0 : static_cast<std::size_t>(elems_->pending(cursor_));
+    }
+
+    template <typename F>
+    void peek(F&& f) const {
+        if (elems_ == nullptr) return;
+        elems_->peek(cursor_, std::forward<F>(f));
+    }
+
+    // skips the unread elements while 'f' returns true, returns how many have been skipped
+    template <typename F>
+    std::size_t skip(F&& f) {
+        if (elems_ == nullptr) return 0;
+        return static_cast<std::size_t>(elems_->skip(this, &(this->cursor_), std::forward<F>(f)));
+    }
+
     template <typename T, typename F, typename... P>
     bool push(F&& prep, P&&... params) {
         if (elems_ == nullptr) return false;
@@ -207,12 +233,26 @@ public:
 
     template <typename T, typename F>
     bool pop(T& item, F&& out) {
+        return pop_by([&item](void* p) {
+            ::new (&item) T(std::move(*static_cast<T*>(p)));
+        }, std::forward<F>(out));
+    }
+
+    // 'read' gets the element in place, so it could copy out only the part it needs
+    template <typename R, typename F>
+    bool pop_by(R&& read, F&& out) {
         if (elems_ == nullptr) {
             return false;
         }
-        return elems_->pop(this, &(this->cursor_), [&item](void* p) {
-            ::new (&item) T(std::move(*static_cast<T*>(p)));
-        }, std::forward<F>(out));
+        auto cur = cursor_;
+        if (!elems_->pop(this, &(this->cursor_), std::forward<R>(read), std::forward<F>(out))) {
+            return false;
+        }
+        // a lossy ring jumps over the slots which have been overwritten
+        if (relat_trait<policy_t>::is_lossy) {
+            lost_ += static_cast<decltype(cursor_)>(cursor_ - cur - 1);
+        }
+        return true;
     }
 };
 
@@ -248,6 +288,11 @@ public:
     bool pop(T& item, F&& out) {
         return base_t::pop(item, std::forward<F>(out));
     }
+
+    template <typename R>
+    bool pop_by(R&& read) {
+        return base_t::pop_by(std::forward<R>(read), [](bool) {});
+    }
 };
 
 } // namespace ipc
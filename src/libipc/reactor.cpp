@@ -0,0 +1,322 @@
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "libipc/reactor.h"
+
+#include "libipc/utility/pimpl.h"
+#include "libipc/utility/log.h"
+#include "libipc/memory/resource.h"
+
+namespace ipc {
+
+class reactor::reactor_ : public ipc::pimpl<reactor_> {
+public:
+    using clock_t    = std::chrono::steady_clock;
+    using deadline_t = clock_t::time_point;
+
+    struct waiter_t {
+        resume_fn  resume_;
+        deadline_t deadline_;
+    };
+
+    struct chan_t {
+        ipc::handle_t        h_;
+        chan_fns             fns_;
+        std::size_t          index_     = invalid_value; // in the select, joined by the reactor thread
+        bool                 ready_     = false;
+        std::uint64_t        signals_   = 0;     // how many times the select has found it ready
+        bool                 failed_    = false;
+        bool                 forgotten_ = false;
+        std::mutex           recv_lock_;
+        std::deque<waiter_t> waiters_;
+    };
+
+    using chans_t = ipc::unordered_map<ipc::handle_t, std::unique_ptr<chan_t>>;
+
+    bool                   inline_;   // no executor, the tasks run on the reactor thread
+    post_fn                post_;
+    std::mutex             lock_;
+    std::condition_variable forgot_;
+    chans_t                chans_;    // the receivers
+    chans_t                writers_;  // the senders waiting for room, ready after a pop
+    chan_t *               by_index_[select::max_channels] {};
+    std::deque<task_t>     posted_;
+    bool                   quit_ = false;
+    ipc::select            sel_;
+    std::thread            thread_;
+
+    reactor_(post_fn post)
+        : inline_{!post}
+        , post_  {std::move(post)} {
+        thread_ = std::thread{[this] { run(); }};
+    }
+
+    static deadline_t deadline_of(std::uint64_t tm) noexcept {
+        return (tm == invalid_value) ? deadline_t::max() : (clock_t::now() + std::chrono::milliseconds(tm));
+    }
+
+    static std::uint64_t remain(deadline_t deadline) noexcept {
+        if (deadline == deadline_t::max()) return invalid_value;
+        auto now = clock_t::now();
+        if (now >= deadline) return 0;
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                          deadline - now + std::chrono::microseconds(999)).count());
+    }
+
+    static task_t resume(waiter_t & w, bool ready) {
+        return [f = std::move(w.resume_), ready] { f(ready); };
+    }
+
+    // Must be called with lock_ held, true if the reactor has to join it.
+    static chan_t *find(chans_t & chans, ipc::handle_t h, chan_fns const & fns, bool & created) {
+        auto & c = chans[h];
+        created = !c;
+        if (created) {
+            c.reset(new chan_t);
+            c->h_   = h;
+            c->fns_ = fns;
+        }
+        return c.get();
+    }
+
+    void join(chan_t * c) {
+        c->index_ = sel_.add(c->h_, c->fns_.attach, c->fns_.detach, c->fns_.try_recv);
+        if (c->index_ == invalid_value) {
+            c->failed_ = true;
+            return;
+        }
+        // the select reports it ready once at first, for whatever has been sent (or popped) before
+        by_index_[c->index_] = c;
+    }
+
+    void drop(chan_t * c, std::vector<task_t> & tasks) {
+        if (c->index_ != invalid_value) {
+            sel_.remove(c->index_);
+            by_index_[c->index_] = nullptr;
+            c->index_ = invalid_value;
+        }
+        for (auto & w : c->waiters_) tasks.push_back(resume(w, false));
+        c->waiters_.clear();
+    }
+
+    static void expire(std::deque<waiter_t> & waiters, deadline_t now, std::vector<task_t> & tasks, deadline_t & next) {
+        for (auto it = waiters.begin(); it != waiters.end();) {
+            if (it->deadline_ <= now) {
+                tasks.push_back(resume(*it, false));
+                it = waiters.erase(it);
+                continue;
+            }
+            next = (std::min)(next, it->deadline_);
+            ++it;
+        }
+    }
+
+    void dispatch(std::vector<task_t> & tasks) {
+        for (auto & t : tasks) {
+            if (inline_) t();
+            else post_(std::move(t));
+        }
+        tasks.clear();
+    }
+
+    bool watches(ipc::handle_t h) const {
+        return (chans_.find(h) != chans_.end()) || (writers_.find(h) != writers_.end());
+    }
+
+    /**
+     * Resumes the waiters of the ready channels: the receivers one at a time, the one which gets a message
+     * marks it ready again; all the senders at once, the ones which find it full again arm it again.
+    */
+    void serve(chans_t & chans, bool all, deadline_t now, std::vector<task_t> & tasks, deadline_t & next) {
+        for (auto it = chans.begin(); it != chans.end();) {
+            auto c = it->second.get();
+            if (c->forgotten_) {
+                drop(c, tasks);
+                it = chans.erase(it);
+                continue;
+            }
+            if ((c->index_ == invalid_value) && !c->failed_) join(c);
+            if (c->failed_) {
+                for (auto & w : c->waiters_) tasks.push_back(resume(w, false));
+                c->waiters_.clear();
+            }
+            if (c->ready_ && !c->waiters_.empty()) {
+                c->ready_ = false;
+                do {
+                    tasks.push_back(resume(c->waiters_.front(), true));
+                    c->waiters_.pop_front();
+                } while (all && !c->waiters_.empty());
+            }
+            expire(c->waiters_, now, tasks, next);
+            ++it;
+        }
+    }
+
+    void run() {
+        std::vector<task_t> tasks;
+        std::unique_lock<std::mutex> guard {lock_};
+        while (!quit_) {
+            auto now  = clock_t::now();
+            auto next = deadline_t::max();
+            serve(chans_  , false, now, tasks, next);
+            serve(writers_, true , now, tasks, next);
+            forgot_.notify_all();
+            for (auto & t : posted_) tasks.push_back(std::move(t));
+            posted_.clear();
+            if (!tasks.empty()) {
+                guard.unlock();
+                dispatch(tasks);
+                guard.lock();
+                continue;
+            }
+            guard.unlock();
+            auto ready = sel_.wait(remain(next));
+            guard.lock();
+            for (auto i : ready) {
+                if (by_index_[i] == nullptr) continue;
+                by_index_[i]->ready_ = true;
+                ++(by_index_[i]->signals_);
+            }
+        }
+        // stopped: nobody is going to resume them
+        for (auto & c : chans_  ) drop(c.second.get(), tasks);
+        for (auto & c : writers_) drop(c.second.get(), tasks);
+        for (auto & t : posted_) tasks.push_back(std::move(t));
+        posted_.clear();
+        guard.unlock();
+        dispatch(tasks);
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> guard {lock_};
+            quit_ = true;
+        }
+        sel_.wake();
+        if (thread_.joinable()) thread_.join();
+        chans_.clear();
+        writers_.clear();
+    }
+
+    bool wait(chans_t & chans, ipc::handle_t h, chan_fns const & fns, std::uint64_t tm, resume_fn resume) {
+        if (h == nullptr) return false;
+        {
+            std::lock_guard<std::mutex> guard {lock_};
+            if (quit_) return false;
+            bool created = false;
+            auto c = find(chans, h, fns, created);
+            if (c->failed_) return false;
+            c->waiters_.push_back({std::move(resume), deadline_of(tm)});
+        }
+        sel_.wake();
+        return true;
+    }
+};
+
+reactor::reactor()
+    : reactor(post_fn{}) {
+}
+
+reactor::reactor(post_fn post)
+    : p_(p_->make(std::move(post))) {
+}
+
+reactor::~reactor() {
+    impl(p_)->stop();
+    p_->clear();
+}
+
+buff_t reactor::try_recv(ipc::handle_t h, chan_fns const & fns) {
+    auto r = impl(p_);
+    if (h == nullptr) return {};
+    bool created = false;
+    reactor_::chan_t *c = nullptr;
+    std::uint64_t signals = 0;
+    {
+        std::lock_guard<std::mutex> guard {r->lock_};
+        c = r->find(r->chans_, h, fns, created);
+        signals = c->signals_;
+    }
+    if (created) r->sel_.wake();
+    buff_t buf;
+    {
+        std::lock_guard<std::mutex> guard {c->recv_lock_};
+        buf = fns.try_recv(h);
+    }
+    bool more = false;
+    {
+        std::lock_guard<std::mutex> guard {r->lock_};
+        if (buf.empty()) {
+            // drained, unless it has been signalled since (after this try_recv has armed it)
+            if (c->signals_ == signals) c->ready_ = false;
+        }
+        else {
+            more = !c->waiters_.empty();
+            if (more) c->ready_ = true;
+        }
+    }
+    // there may be more, for the next one waiting
+    if (more) r->sel_.wake();
+    return buf;
+}
+
+bool reactor::when_readable(ipc::handle_t h, chan_fns const & fns, std::uint64_t tm, resume_fn resume) {
+    auto r = impl(p_);
+    return r->wait(r->chans_, h, fns, tm, std::move(resume));
+}
+
+bool reactor::when_writable(ipc::handle_t h, chan_fns const & fns, std::uint64_t tm, resume_fn resume) {
+    auto r = impl(p_);
+    return r->wait(r->writers_, h, fns, tm, std::move(resume));
+}
+
+void reactor::forget(ipc::handle_t h) {
+    auto r = impl(p_);
+    std::vector<task_t> tasks;
+    {
+        std::unique_lock<std::mutex> guard {r->lock_};
+        if (!r->watches(h)) return;
+        bool inside = (std::this_thread::get_id() == r->thread_.get_id());
+        for (auto chans : {&(r->chans_), &(r->writers_)}) {
+            auto it = chans->find(h);
+            if (it == chans->end()) continue;
+            if (inside) {
+                // from a task run by the reactor itself
+                r->drop(it->second.get(), tasks);
+                chans->erase(it);
+            }
+            else it->second->forgotten_ = true;
+        }
+        if (!inside) {
+            r->sel_.wake();
+            r->forgot_.wait(guard, [r, h] { return !r->watches(h); });
+            return;
+        }
+    }
+    r->dispatch(tasks);
+}
+
+void reactor::post(task_t task) {
+    auto r = impl(p_);
+    if (!r->inline_) {
+        r->post_(std::move(task));
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard {r->lock_};
+        if (!r->quit_) {
+            r->posted_.push_back(std::move(task));
+            task = nullptr;
+        }
+    }
+    if (task) task();
+    else r->sel_.wake();
+}
+
+} // namespace ipc
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "libipc/platform/process.h"
+
+namespace ipc {
+namespace detail {
+
+/**
+ * \brief The receivers of a channel which are parked outside of recv, in shared memory.
+ *
+ * A receiver which is served by an event loop (ready_fd) or waits on many channels (ipc::select)
+ * instead of blocking in recv joins a slot with a token, which tells the senders how to wake it.
+ * It arms its slot when try_recv has found nothing, and the first sender which pushes after that
+ * disarms it & signals the token, once.
+ * So a busy receiver costs the senders a fence & a load per push, and no syscall at all.
+ * The ready fds & the selects of a channel share a table, told apart by the way they have joined it,
+ * so that it's still one fence & one load for both.
+ * The senders waiting for room on a select (see ipc::reactor) have a table of their own the other way round,
+ * armed by the try_send which has found the ring full & signalled by the next pop.
+ *
+ * The high 32 bits of a token are the pid of its owner (the pid namespace is kept beside it):
+ * the slots of the dead owners are taken back when all of them are in use.
+*/
+struct ready_table {
+    enum : std::size_t { max_slots = 32 };
+
+    std::atomic<std::uint32_t> used_;   // a bit per joined slot
+    std::atomic<std::uint32_t> armed_;  // a bit per parked receiver
+    std::atomic<std::uint32_t> select_; // a bit per slot joined by an ipc::select, the others are ready fds
+    std::atomic<std::uint64_t> token_[max_slots];
+    std::atomic<ipc::detail::pid_ns_t> pid_ns_[max_slots];
+
+    static std::uint64_t make_token(std::uint32_t low) noexcept {
+        return (static_cast<std::uint64_t>(ipc::detail::this_process()) << 32) | low;
+    }
+
+    /// \brief Joins a free slot with 'token', max_slots if there isn't one.
+    std::size_t join(std::uint64_t token, bool by_select = false) noexcept {
+        for (int k = 0; k < 2; ++k) {
+            auto i = claim();
+            if (i < max_slots) {
+                if (by_select) select_.fetch_or (  1u << i , std::memory_order_relaxed);
+                else           select_.fetch_and(~(1u << i), std::memory_order_relaxed);
+                pid_ns_[i].store(ipc::detail::this_pid_ns(), std::memory_order_relaxed);
+                token_ [i].store(token, std::memory_order_release);
+                return i;
+            }
+            for (i = 0; i < max_slots; ++i) {
+                auto pid = static_cast<ipc::detail::pid_t>(token_[i].load(std::memory_order_acquire) >> 32);
+                if (!ipc::detail::process_alive(pid, pid_ns_[i].load(std::memory_order_relaxed))) leave(i);
+            }
+        }
+        return max_slots;
+    }
+
+    /// \brief Whether the slot has been joined by an ipc::select, read by the signal of 'notify'.
+    bool by_select(std::size_t slot) const noexcept {
+        return (slot < max_slots) && ((select_.load(std::memory_order_relaxed) & (1u << slot)) != 0);
+    }
+
+    void leave(std::size_t slot) noexcept {
+        if (slot >= max_slots) return;
+        armed_.fetch_and(~(1u << slot), std::memory_order_relaxed);
+        used_ .fetch_and(~(1u << slot), std::memory_order_release);
+    }
+
+    /**
+     * \brief Arms the slot of a receiver which has found the ring empty.
+     * The receiver must check the ring once more after it,
+     * what has been pushed in between may not have seen the slot armed.
+    */
+    void arm(std::size_t slot) noexcept {
+        if (slot >= max_slots) return;
+        armed_.fetch_or(1u << slot, std::memory_order_relaxed);
+        // pairs with the fence of notify: either the sender sees the slot armed,
+        // or the receiver sees what it has pushed
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    /**
+     * \brief Calls 'signal(slot, token)' for all the parked receivers, after a push.
+     * A signal which returns false means the receiver is gone without leaving its slot.
+    */
+    template <typename F>
+    void notify(F && signal) noexcept {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto armed = armed_.load(std::memory_order_relaxed);
+        if (armed == 0) return;
+        for (std::size_t i = 0; i < max_slots; ++i) {
+            std::uint32_t bit = 1u << i;
+            if ((armed & bit) == 0) continue;
+            // only the sender which disarms it signals
+            if ((armed_.fetch_and(~bit, std::memory_order_acq_rel) & bit) == 0) continue;
+            if (!signal(i, token_[i].load(std::memory_order_acquire))) {
+                used_.fetch_and(~bit, std::memory_order_release);
+            }
+        }
+    }
+
+private:
+    std::size_t claim() noexcept {
+        auto used = used_.load(std::memory_order_relaxed);
+        for (;;) {
+            std::size_t i = 0;
+            while ((i < max_slots) && ((used & (1u << i)) != 0)) ++i;
+            if (i == max_slots) return i;
+            if (used_.compare_exchange_weak(used, used | (1u << i), std::memory_order_acq_rel)) return i;
+        }
+    }
+};
+
+} // namespace detail
+} // namespace ipc
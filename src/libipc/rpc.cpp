@@ -0,0 +1,380 @@
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "libipc/rpc.h"
+#include "libipc/ipc.h"
+
+#include "libipc/utility/pimpl.h"
+#include "libipc/utility/log.h"
+#include "libipc/memory/resource.h"
+#include "libipc/platform/clock.h"
+#include "libipc/platform/process.h"
+
+namespace ipc {
+namespace rpc {
+namespace {
+
+using request_chan = ipc::channel;
+using reply_chan   = ipc::chan<relat::single, relat::single, trans::unicast>;
+
+enum : std::uint32_t {
+    kind_call,
+    kind_bye,  // the client has gone, its reply ring could be let go
+    kind_stop  // from the server itself
+};
+
+struct request_head {
+    std::uint64_t client;
+    std::uint64_t id;
+    std::uint64_t deadline; // monotonic_ns, 0 if there is none
+    std::uint32_t kind;
+    std::uint32_t reserved;
+};
+
+struct reply_head {
+    std::uint64_t id;
+    std::uint32_t status;
+    std::uint32_t reserved;
+};
+
+std::string reply_name(std::string const & name, std::uint64_t client) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(client));
+    return name + "__RPC_REPLY__" + buf;
+}
+
+std::uint64_t deadline_of(std::uint64_t tm) noexcept {
+    if (tm >= (invalid_value / 1000000)) return 0;
+    return ipc::detail::monotonic_ns() + tm * 1000000;
+}
+
+void write_request(std::vector<byte_t> & out, request_head const & hd, void const * data, std::size_t size) {
+    out.resize(sizeof(hd) + size);
+    std::memcpy(out.data(), &hd, sizeof(hd));
+    if (size != 0) std::memcpy(out.data() + sizeof(hd), data, size);
+}
+
+} // internal-linkage
+
+class server::server_ : public ipc::pimpl<server_> {
+public:
+    enum : std::uint64_t {
+        reply_timeout_ms = 10 // how long a reply waits for the space in the ring of a slow client
+    };
+
+    std::string         name_;
+    handler_t           handler_;
+    request_chan        requests_;
+    request_chan        self_;     // only sends kind_stop
+    std::mutex          self_lock_;
+    bool                stop_ = false;
+    std::atomic<std::uint64_t> dropped_ {0};
+    std::vector<byte_t> scratch_;
+    ipc::unordered_map<std::uint64_t, std::unique_ptr<reply_chan>> links_;
+
+    server_(char const * name, handler_t handler)
+        : name_    {name}
+        , handler_ {std::move(handler)}
+        , requests_{name, ipc::receiver}
+        , self_    {name, ipc::sender} {
+    }
+
+    reply_chan *link_of(std::uint64_t client) {
+        auto & link = links_[client];
+        if (!link) {
+            link.reset(new reply_chan{reply_name(name_, client).c_str(), ipc::sender});
+            if (!link->valid()) {
+                links_.erase(client);
+                return nullptr;
+            }
+        }
+        return link.get();
+    }
+
+    std::size_t handle(buff_t const & buf) {
+        if (buf.size() < sizeof(request_head)) return 0;
+        request_head hd;
+        std::memcpy(&hd, buf.data(), sizeof(hd));
+        switch (hd.kind) {
+        case kind_stop:
+            stop_ = true;
+            return 0;
+        case kind_bye:
+            links_.erase(hd.client);
+            return 0;
+        case kind_call:
+            break;
+        default:
+            return 0;
+        }
+        // nobody is waiting for it any longer
+        if ((hd.deadline != 0) && (ipc::detail::monotonic_ns() > hd.deadline)) return 0;
+        buff_t reply = handler_(static_cast<byte_t const *>(buf.data()) + sizeof(hd), buf.size() - sizeof(hd));
+        auto link = link_of(hd.client);
+        if (link == nullptr) return 0;
+        reply_head rh {hd.id, static_cast<std::uint32_t>(status::ok), 0};
+        scratch_.resize(sizeof(rh) + reply.size());
+        std::memcpy(scratch_.data(), &rh, sizeof(rh));
+        if (!reply.empty()) std::memcpy(scratch_.data() + sizeof(rh), reply.data(), reply.size());
+        // a force push would disconnect the client for good, only this reply is lost
+        if (!link->try_send(scratch_.data(), scratch_.size(), reply_timeout_ms)) {
+            if (link->recv_count() == 0) links_.erase(hd.client);
+            else dropped_.fetch_add(1, std::memory_order_relaxed);
+            return 0;
+        }
+        return 1;
+    }
+
+    std::size_t poll(std::uint64_t tm) {
+        std::size_t n = 0;
+        buff_t buf = requests_.recv(tm);
+        while (!buf.empty()) {
+            n += handle(buf);
+            buf = requests_.try_recv();
+        }
+        return n;
+    }
+};
+
+server::server(char const * name, handler_t handler)
+    : p_(p_->make(name, std::move(handler))) {
+}
+
+server::~server() {
+    p_->clear();
+}
+
+bool server::valid() const noexcept {
+    return impl(p_)->requests_.valid() && impl(p_)->handler_;
+}
+
+std::size_t server::poll(std::uint64_t tm) {
+    return impl(p_)->poll(tm);
+}
+
+void server::run() {
+    auto s = impl(p_);
+    while (!s->stop_) s->poll(invalid_value);
+    s->stop_ = false;
+}
+
+std::uint64_t server::dropped_replies() const noexcept {
+    return impl(p_)->dropped_.load(std::memory_order_relaxed);
+}
+
+void server::stop() {
+    auto s = impl(p_);
+    request_head hd {0, 0, 0, kind_stop, 0};
+    std::lock_guard<std::mutex> guard {s->self_lock_};
+    s->self_.send(&hd, sizeof(hd));
+}
+
+void server::clear_storage(char const * name) noexcept {
+    request_chan::clear_storage(name);
+}
+
+class client::client_ : public ipc::pimpl<client_> {
+public:
+    struct pending_t {
+        std::uint64_t deadline_;
+        callback_t    cb_;
+    };
+
+    using completion_t = std::pair<callback_t, status>;
+
+    std::string         name_;
+    std::uint64_t       id_;
+    reply_chan          replies_;
+    request_chan        requests_;
+    std::mutex          send_lock_; // requests_ & scratch_
+    std::vector<byte_t> scratch_;
+    mutable std::mutex  lock_;      // the rest
+    ipc::unordered_map<std::uint64_t, pending_t> pending_;
+    std::uint64_t       next_id_       = 0;
+    std::uint64_t       next_deadline_ = 0; // the earliest one of pending_, 0 if there is none
+    std::atomic<bool>   quit_ {false};
+    std::thread         thread_;
+
+    static std::uint64_t make_id() noexcept {
+        static std::atomic<std::uint32_t> seq {0};
+        return (static_cast<std::uint64_t>(ipc::detail::this_process()) << 32)
+             | (seq.fetch_add(1, std::memory_order_relaxed) + 1);
+    }
+
+    client_(char const * name, bool reply_thread)
+        : name_{name}
+        , id_  {make_id()} {
+        // the reply ring must be there before the first request
+        auto rname = reply_name(name_, id_);
+        reply_chan::clear_storage(rname.c_str()); // it may have been left by a dead process with the same pid
+        replies_.connect(rname.c_str(), ipc::receiver);
+        requests_.connect(name, ipc::sender);
+        if (reply_thread && replies_.valid()) {
+            thread_ = std::thread{[this] {
+                while (!quit_.load(std::memory_order_acquire)) poll(expire_ms);
+            }};
+        }
+    }
+
+    ~client_() {
+        quit_.store(true, std::memory_order_release);
+        if (thread_.joinable()) thread_.join();
+        if (requests_.valid()) {
+            request_head hd {id_, 0, 0, kind_bye, 0};
+            std::lock_guard<std::mutex> guard {send_lock_};
+            requests_.try_send(&hd, sizeof(hd));
+        }
+        std::vector<callback_t> failed;
+        {
+            std::lock_guard<std::mutex> guard {lock_};
+            for (auto & p : pending_) failed.push_back(std::move(p.second.cb_));
+            pending_.clear();
+        }
+        for (auto & cb : failed) cb(status::failed, {});
+    }
+
+    void call(void const * data, std::size_t size, callback_t cb, std::uint64_t tm) {
+        request_head hd {id_, 0, deadline_of(tm), kind_call, 0};
+        {
+            // before it's sent, the reply may come at once
+            std::lock_guard<std::mutex> guard {lock_};
+            hd.id = ++next_id_;
+            pending_.emplace(hd.id, pending_t{hd.deadline, std::move(cb)});
+            if ((hd.deadline != 0) && ((next_deadline_ == 0) || (hd.deadline < next_deadline_))) {
+                next_deadline_ = hd.deadline;
+            }
+        }
+        bool sent = false;
+        if (replies_.valid()) {
+            std::lock_guard<std::mutex> guard {send_lock_};
+            write_request(scratch_, hd, data, size);
+            // a force push would disconnect the server from all the clients
+            sent = requests_.try_send(scratch_.data(), scratch_.size(), tm);
+        }
+        if (sent) return;
+        {
+            std::lock_guard<std::mutex> guard {lock_};
+            auto it = pending_.find(hd.id);
+            if (it == pending_.end()) return; // expired meanwhile
+            cb = std::move(it->second.cb_);
+            pending_.erase(it);
+        }
+        cb(status::failed, {});
+    }
+
+    // Returns the reply without its head, which keeps the received buffer alive.
+    static buff_t payload_of(buff_t & buf) {
+        auto data = static_cast<byte_t *>(buf.data()) + sizeof(reply_head);
+        auto size = buf.size() - sizeof(reply_head);
+        if (size == 0) return {};
+        return {data, size, [](void * p, std::size_t) { delete static_cast<buff_t *>(p); },
+                new buff_t{std::move(buf)}};
+    }
+
+    bool complete(buff_t & buf) {
+        if (buf.size() < sizeof(reply_head)) return false;
+        reply_head rh;
+        std::memcpy(&rh, buf.data(), sizeof(rh));
+        callback_t cb;
+        {
+            std::lock_guard<std::mutex> guard {lock_};
+            auto it = pending_.find(rh.id);
+            if (it == pending_.end()) return false; // too late
+            cb = std::move(it->second.cb_);
+            pending_.erase(it);
+        }
+        cb(static_cast<status>(rh.status), payload_of(buf));
+        return true;
+    }
+
+    std::size_t expire() {
+        std::vector<callback_t> expired;
+        {
+            std::lock_guard<std::mutex> guard {lock_};
+            if (next_deadline_ == 0) return 0;
+            auto now = ipc::detail::monotonic_ns();
+            if (now <= next_deadline_) return 0;
+            next_deadline_ = 0;
+            for (auto it = pending_.begin(); it != pending_.end();) {
+                auto d = it->second.deadline_;
+                if ((d != 0) && (d < now)) {
+                    expired.push_back(std::move(it->second.cb_));
+                    it = pending_.erase(it);
+                    continue;
+                }
+                if ((d != 0) && ((next_deadline_ == 0) || (d < next_deadline_))) next_deadline_ = d;
+                ++it;
+            }
+        }
+        for (auto & cb : expired) cb(status::timeout, {});
+        return expired.size();
+    }
+
+    std::size_t poll(std::uint64_t tm) {
+        std::size_t n = 0;
+        buff_t buf = (tm == 0) ? replies_.try_recv() : replies_.recv(tm);
+        while (!buf.empty()) {
+            if (complete(buf)) ++n;
+            buf = replies_.try_recv();
+        }
+        return n + expire();
+    }
+};
+
+client::client(char const * name, bool reply_thread)
+    : p_(p_->make(name, reply_thread)) {
+}
+
+client::~client() {
+    p_->clear();
+}
+
+bool client::valid() const noexcept {
+    return impl(p_)->replies_.valid() && impl(p_)->requests_.valid();
+}
+
+std::future<client::result_t> client::call(void const * data, std::size_t size, std::uint64_t tm) {
+    auto promise = std::make_shared<std::promise<result_t>>();
+    auto future  = promise->get_future();
+    impl(p_)->call(data, size, [promise](status st, buff_t reply) {
+        promise->set_value(result_t{st, std::move(reply)});
+    }, tm);
+    return future;
+}
+
+void client::call(void const * data, std::size_t size, callback_t cb, std::uint64_t tm) {
+    impl(p_)->call(data, size, std::move(cb), tm);
+}
+
+buff_t client::request(void const * data, std::size_t size, std::uint64_t tm) {
+    auto c = impl(p_);
+    if (c->thread_.joinable()) return call(data, size, tm).get().second;
+    bool done = false;
+    buff_t out;
+    c->call(data, size, [&done, &out](status, buff_t reply) {
+        done = true;
+        out  = std::move(reply);
+    }, tm);
+    while (!done) c->poll(expire_ms);
+    return out;
+}
+
+std::size_t client::poll(std::uint64_t tm) {
+    return impl(p_)->poll(tm);
+}
+
+std::size_t client::in_flight() const {
+    auto c = impl(p_);
+    std::lock_guard<std::mutex> guard {c->lock_};
+    return c->pending_.size();
+}
+
+} // namespace rpc
+} // namespace ipc
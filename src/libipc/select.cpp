@@ -0,0 +1,217 @@
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include "libipc/select.h"
+#include "libipc/shm.h"
+
+#include "libipc/utility/pimpl.h"
+#include "libipc/utility/log.h"
+#include "libipc/memory/resource.h"
+#include "libipc/waiter.h"
+#include "libipc/ready_table.h"
+#include "libipc/select_link.h"
+
+namespace ipc {
+
+static_assert(std::size_t(select::max_channels) == std::size_t(detail::select_block::max_channels), "max_channels mismatch");
+
+class select::select_ : public ipc::pimpl<select_> {
+public:
+    struct chan_t {
+        ipc::handle_t h_        = nullptr;
+        detach_fn     detach_   = nullptr;
+        recv_fn       try_recv_ = nullptr;
+    };
+
+    using clock_t    = std::chrono::steady_clock;
+    using deadline_t = clock_t::time_point;
+
+    std::uint64_t       key_ = 0;
+    ipc::shm::handle    blk_h_;
+    ipc::detail::waiter waiter_;
+    chan_t              chans_[max_channels];
+    std::uint64_t       used_    = 0;
+    std::uint64_t       pending_ = 0;                // the channels which may have messages
+    std::size_t         cursor_  = max_channels - 1; // the last one served
+
+    static std::uint64_t make_key() noexcept {
+        static std::atomic<std::uint32_t> seq {0};
+        auto id = (seq.fetch_add(1, std::memory_order_relaxed) + 1)
+                & ((1u << (32 - detail::select_block::index_bits)) - 1);
+        return detail::ready_table::make_token(id << detail::select_block::index_bits)
+            >> detail::select_block::index_bits;
+    }
+
+    detail::select_block *block() const noexcept {
+        return static_cast<detail::select_block *>(blk_h_.get());
+    }
+
+    bool open() {
+        ipc::detail::waiter::init();
+        key_ = make_key();
+        auto name = detail::select_block::name_of(key_);
+        if (!blk_h_.acquire(name.c_str(), sizeof(detail::select_block))) {
+            ipc::error("fail select: acquire %s\n", name.c_str());
+            return false;
+        }
+        // it may have been left by a dead process with the same pid
+        block()->ready_ .store(0    , std::memory_order_relaxed);
+        block()->woken_ .store(false, std::memory_order_relaxed);
+        block()->closed_.store(false, std::memory_order_release);
+        if (!waiter_.open(name.c_str())) {
+            ipc::error("fail select: open the waiter of %s\n", name.c_str());
+            blk_h_.clear();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        for (std::size_t i = 0; i < max_channels; ++i) remove(i);
+        if (block() == nullptr) return;
+        // the senders which still have it opened will see it's gone
+        block()->closed_.store(true, std::memory_order_release);
+        // not cleared: a sender of this process may share the waiter, it's removed with the last reference
+        waiter_.close();
+        blk_h_.clear();
+    }
+
+    bool remove(std::size_t index) {
+        if ((index >= max_channels) || ((used_ & bit(index)) == 0)) return false;
+        chans_[index].detach_(chans_[index].h_);
+        chans_[index] = {};
+        used_    &= ~bit(index);
+        pending_ &= ~bit(index);
+        return true;
+    }
+
+    static std::uint64_t bit(std::size_t index) noexcept {
+        return std::uint64_t(1) << index;
+    }
+
+    static deadline_t deadline_of(std::uint64_t tm) noexcept {
+        return (tm == invalid_value) ? deadline_t::max() : (clock_t::now() + std::chrono::milliseconds(tm));
+    }
+
+    static std::uint64_t remain(deadline_t deadline) noexcept {
+        if (deadline == deadline_t::max()) return invalid_value;
+        auto now = clock_t::now();
+        if (now >= deadline) return 0;
+        // round up, a wait of 0 would give up at once
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                          deadline - now + std::chrono::microseconds(999)).count());
+    }
+
+    // Takes over what the senders have signalled, and parks if there's nothing.
+    bool wait_ready(deadline_t deadline) {
+        auto blk = block();
+        for (;;) {
+            pending_ |= blk->ready_.exchange(0, std::memory_order_acquire) & used_;
+            if (pending_ != 0) return true;
+            if (blk->woken_.exchange(false, std::memory_order_acquire)) return false;
+            auto tm = remain(deadline);
+            if (tm == 0) return false;
+            if (!waiter_.wait_if([blk] {
+                    return (blk->ready_.load(std::memory_order_acquire) == 0)
+                        && !blk->woken_.load(std::memory_order_acquire);
+                }, tm)) {
+                return false;
+            }
+        }
+    }
+
+    buff_t recv(std::size_t * index, deadline_t deadline) {
+        while (wait_ready(deadline)) {
+            for (std::size_t n = 1; (n <= max_channels) && (pending_ != 0); ++n) {
+                auto i = (cursor_ + n) % max_channels;
+                if ((pending_ & bit(i)) == 0) continue;
+                auto buf = chans_[i].try_recv_(chans_[i].h_);
+                if (buf.empty()) {
+                    // drained, and the try_recv has armed it
+                    pending_ &= ~bit(i);
+                    continue;
+                }
+                cursor_ = i;
+                if (index != nullptr) *index = i;
+                return buf;
+            }
+        }
+        return {};
+    }
+};
+
+select::select()
+    : p_(p_->make()) {
+    impl(p_)->open();
+}
+
+select::~select() {
+    impl(p_)->close();
+    p_->clear();
+}
+
+std::size_t select::add(ipc::handle_t h, attach_fn attach, detach_fn detach, recv_fn try_recv) {
+    auto s = impl(p_);
+    if ((h == nullptr) || (s->block() == nullptr)) return invalid_value;
+    std::size_t i = 0;
+    while ((i < max_channels) && ((s->used_ & select_::bit(i)) != 0)) ++i;
+    if (i == max_channels) {
+        ipc::error("fail select::add: all the %zu channels are in use\n", static_cast<std::size_t>(max_channels));
+        return invalid_value;
+    }
+    if (!attach(h, (s->key_ << detail::select_block::index_bits) | i)) {
+        return invalid_value;
+    }
+    s->chans_[i] = {h, detach, try_recv};
+    s->used_    |= select_::bit(i);
+    // whatever has been sent before would be received
+    s->pending_ |= select_::bit(i);
+    return i;
+}
+
+bool select::remove(std::size_t index) {
+    return impl(p_)->remove(index);
+}
+
+std::size_t select::size() const noexcept {
+    std::size_t n = 0;
+    for (auto used = impl(p_)->used_; used != 0; used &= used - 1) ++n;
+    return n;
+}
+
+std::vector<std::size_t> select::wait(std::uint64_t tm) {
+    auto s = impl(p_);
+    std::vector<std::size_t> ready;
+    if ((s->block() == nullptr) || !s->wait_ready(select_::deadline_of(tm))) {
+        return ready;
+    }
+    for (std::size_t n = 1; n <= max_channels; ++n) {
+        auto i = (s->cursor_ + n) % max_channels;
+        if ((s->pending_ & select_::bit(i)) != 0) ready.push_back(i);
+    }
+    // the caller drains them
+    s->pending_ = 0;
+    s->cursor_  = ready.front();
+    return ready;
+}
+
+buff_t select::recv(std::size_t * index, std::uint64_t tm) {
+    auto s = impl(p_);
+    if (s->block() == nullptr) return {};
+    return s->recv(index, select_::deadline_of(tm));
+}
+
+buff_t select::try_recv(std::size_t * index) {
+    return recv(index, 0);
+}
+
+void select::wake() {
+    auto s = impl(p_);
+    if (s->block() == nullptr) return;
+    s->block()->woken_.store(true, std::memory_order_release);
+    s->waiter_.broadcast();
+}
+
+} // namespace ipc
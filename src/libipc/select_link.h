@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+#include "libipc/shm.h"
+#include "libipc/waiter.h"
+#include "libipc/ready_table.h"
+
+namespace ipc {
+namespace detail {
+
+/**
+ * \brief The shared part of an ipc::select: which of its channels have been signalled.
+ *
+ * A select joins the ready_table of each of its channels with the token
+ * (pid << 32) | (id << index_bits) | the index of the channel in the select,
+ * the senders then find the block & the waiter of the select by the name of the key (the token without the index).
+*/
+struct select_block {
+    enum : std::size_t {
+        index_bits   = 6,
+        max_channels = 1u << index_bits
+    };
+
+    std::atomic<std::uint64_t> ready_;  // a bit per channel
+    std::atomic<bool>          woken_;  // by select::wake
+    std::atomic<bool>          closed_;
+
+    static std::uint64_t key_of(std::uint64_t token) noexcept {
+        return token >> index_bits;
+    }
+
+    static std::size_t index_of(std::uint64_t token) noexcept {
+        return static_cast<std::size_t>(token & (max_channels - 1));
+    }
+
+    static std::string name_of(std::uint64_t key) {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "SELECT__%llx", static_cast<unsigned long long>(key));
+        return buf;
+    }
+};
+
+/**
+ * \brief The selects parked on a channel, as seen by a sender.
+ * They are opened on demand, the first time a select is signalled from this connection.
+*/
+class select_links {
+    struct link_t {
+        std::uint64_t    key_ = 0;
+        ipc::shm::handle blk_h_;
+        waiter           waiter_;
+
+        void reset() noexcept {
+            key_ = 0;
+            waiter_.close();
+            blk_h_.release();
+        }
+    };
+
+    std::mutex lock_; // the spill drainer pushes as well
+    link_t     links_[ready_table::max_slots];
+
+public:
+    /// \brief Signals the select of 'token' parked on 'slot', false if it doesn't exist anymore.
+    bool signal(std::size_t slot, std::uint64_t token) {
+        if (slot >= ready_table::max_slots) return false;
+        std::lock_guard<std::mutex> guard {lock_};
+        auto &l  = links_[slot];
+        auto key = select_block::key_of(token);
+        if (l.key_ != key) {
+            l.reset();
+            auto name = select_block::name_of(key);
+            if (!l.blk_h_.acquire(name.c_str(), sizeof(select_block), ipc::shm::open)) {
+                return false;
+            }
+            if (!l.waiter_.open(name.c_str())) {
+                l.blk_h_.release();
+                return true; // try again the next time
+            }
+            l.key_ = key;
+        }
+        auto blk = static_cast<select_block *>(l.blk_h_.get());
+        if (blk->closed_.load(std::memory_order_acquire)) {
+            // the waiter may have been created again after the select has closed it,
+            // then it's removed with this last reference
+            l.reset();
+            return false;
+        }
+        blk->ready_.fetch_or(std::uint64_t(1) << select_block::index_of(token), std::memory_order_release);
+        l.waiter_.broadcast();
+        return true;
+    }
+};
+
+} // namespace detail
+} // namespace ipc
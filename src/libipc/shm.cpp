@@ -70,6 +70,10 @@ void handle::sub_ref() noexcept {
 }
 
 bool handle::acquire(char const * name, std::size_t size, unsigned mode) {
+    return acquire(name, size, numa_policy{}, mode);
+}
+
+bool handle::acquire(char const * name, std::size_t size, numa_policy const & policy, unsigned mode) {
     if (!is_valid_string(name)) {
         ipc::error("fail acquire: name is empty\n");
         return false;
@@ -83,6 +87,9 @@ bool handle::acquire(char const * name, std::size_t size, unsigned mode) {
     if (!id) {
         return false;
     }
+    if (policy.mode != numa::none) {
+        shm::set_numa(id, policy);
+    }
     impl(p_)->id_ = id;
     impl(p_)->n_  = name;
     impl(p_)->m_  = shm::get_mem(impl(p_)->id_, &(impl(p_)->s_));
@@ -94,6 +101,16 @@ std::int32_t handle::release() {
     return shm::release(detach());
 }
 
+bool handle::set_numa(numa_policy const & policy) noexcept {
+    if (impl(p_)->id_ == nullptr) return false;
+    return shm::set_numa(impl(p_)->id_, policy);
+}
+
+std::size_t handle::numa_residency(std::size_t * pages, std::size_t count) const noexcept {
+    if (impl(p_)->id_ == nullptr) return 0;
+    return shm::numa_residency(impl(p_)->id_, pages, count);
+}
+
 void handle::clear() noexcept {
     if (impl(p_)->id_ == nullptr) return;
     shm::remove(detach());
@@ -0,0 +1,252 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cinttypes>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "libipc/trace.h"
+
+#include "libipc/utility/trace.h"
+#include "libipc/utility/log.h"
+#include "libipc/platform/detail.h"
+#include "libipc/platform/process.h"
+#if !defined(IPC_OS_WINDOWS_)
+#include <sys/file.h>
+#endif
+
+namespace ipc {
+namespace detail {
+namespace trace {
+
+std::atomic<bool> on__ {false};
+
+namespace {
+
+struct record_t {
+    std::uint64_t ts;
+    std::uint64_t dur;
+    std::uint64_t id;
+    std::uint64_t arg;
+    std::uint16_t name;
+    event         e;
+};
+
+// Only its own thread writes a buffer, so recording is a plain store & a counter bump.
+struct buffer_t {
+    std::uint32_t              tid;
+    std::vector<record_t>      ring;
+    std::atomic<std::uint64_t> count {0};
+};
+
+struct registry_t {
+    std::mutex                                     lock;
+    std::vector<std::unique_ptr<buffer_t>>         buffers;
+    std::vector<std::string>                       names {std::string{}};
+    std::unordered_map<std::string, std::uint16_t> ids;
+    std::size_t                                    capacity = 65536;
+
+    registry_t() {
+        if (auto n = std::getenv("LIBIPC_TRACE_EVENTS")) {
+            auto c = std::strtoull(n, nullptr, 10);
+            if (c > 0) capacity = static_cast<std::size_t>(c);
+        }
+    }
+
+    buffer_t *attach() {
+        auto buf = std::unique_ptr<buffer_t>(new buffer_t);
+        buf->ring.resize(capacity);
+        std::lock_guard<std::mutex> guard {lock};
+        buf->tid = static_cast<std::uint32_t>(buffers.size() + 1);
+        buffers.push_back(std::move(buf));
+        return buffers.back().get();
+    }
+};
+
+// Never destroyed, since the events are dumped at exit.
+registry_t &registry() {
+    static auto *r = new registry_t;
+    return *r;
+}
+
+void write_escaped(std::FILE *f, std::string const &s) {
+    for (char c : s) {
+        if ((c == '"') || (c == '\\')) {
+            std::fputc('\\', f);
+            std::fputc(c, f);
+        }
+        else if (static_cast<unsigned char>(c) < 0x20) {
+            std::fprintf(f, "\\u%04x", static_cast<unsigned>(c));
+        }
+        else std::fputc(c, f);
+    }
+}
+
+void write_head(std::FILE *f, char const *name, char const *cat, char ph,
+                std::uint64_t ts, std::uint32_t pid, std::uint32_t tid) {
+    std::fprintf(f, "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%" PRIu64 ".%03" PRIu64
+                    ",\"pid\":%" PRIu32 ",\"tid\":%" PRIu32,
+                 name, cat, ph, ts / 1000, ts % 1000, pid, tid);
+}
+
+void write_flow(std::FILE *f, std::string const &chan, char ph,
+                std::uint64_t ts, std::uint64_t id, std::uint32_t pid, std::uint32_t tid) {
+    std::fputs("{\"name\":\"", f);
+    write_escaped(f, chan);
+    std::fprintf(f, "\",\"cat\":\"ipc.flow\",\"ph\":\"%c\",\"id\":\"0x%" PRIx64 "\",\"ts\":%" PRIu64 ".%03" PRIu64
+                    ",\"pid\":%" PRIu32 ",\"tid\":%" PRIu32 "%s},\n",
+                 ph, id, ts / 1000, ts % 1000, pid, tid, (ph == 'f') ? ",\"bp\":\"e\"" : "");
+}
+
+void write_record(std::FILE *f, record_t const &r, std::string const &name, std::uint32_t pid, std::uint32_t tid) {
+    switch (r.e) {
+    case event::send:
+    case event::recv:
+        write_head(f, (r.e == event::send) ? "send" : "recv", "ipc", 'X', r.ts, pid, tid);
+        std::fprintf(f, ",\"dur\":%" PRIu64 ".%03" PRIu64 ",\"args\":{\"channel\":\"", r.dur / 1000, r.dur % 1000);
+        write_escaped(f, name);
+        std::fprintf(f, "\",\"size\":%" PRIu64 ",\"id\":\"0x%" PRIx64 "\"}},\n", r.arg, r.id);
+        // a flow binds to the slice which encloses it
+        if (r.e == event::send) {
+            write_flow(f, name, 's', r.ts, r.id, pid, tid);
+        }
+        else write_flow(f, name, 'f', r.ts + r.dur - ((r.dur > 0) ? 1 : 0), r.id, pid, tid);
+        break;
+    case event::push:
+    case event::pop:
+    case event::force_push:
+        write_head(f, (r.e == event::push) ? "push" : ((r.e == event::pop) ? "pop" : "force_push"),
+                   "ipc", 'i', r.ts, pid, tid);
+        std::fprintf(f, ",\"s\":\"%c\",\"args\":{\"channel\":\"", (r.e == event::force_push) ? 'p' : 't');
+        write_escaped(f, name);
+        std::fprintf(f, "\",\"remain\":%" PRId64 ",\"id\":\"0x%" PRIx64 "\"}},\n",
+                     static_cast<std::int64_t>(r.arg), r.id);
+        break;
+    case event::park:
+        write_head(f, "park", "ipc", 'X', r.ts, pid, tid);
+        std::fprintf(f, ",\"dur\":%" PRIu64 ".%03" PRIu64 ",\"args\":{\"waiter\":\"", r.dur / 1000, r.dur % 1000);
+        write_escaped(f, name);
+        std::fputs("\"}},\n", f);
+        break;
+    default:
+        break;
+    }
+}
+
+// Never destroyed either, it's read at exit.
+std::string &env_path() {
+    static auto *p = new std::string;
+    return *p;
+}
+
+// LIBIPC_TRACE=<file> turns the tracing on at startup & dumps at exit.
+struct env_init_t {
+    env_init_t() {
+        auto p = std::getenv("LIBIPC_TRACE");
+        if ((p == nullptr) || (*p == '\0')) return;
+        env_path() = p;
+        registry();
+        on__.store(true, std::memory_order_relaxed);
+        std::atexit([] {
+            ipc::trace::dump(env_path().c_str());
+        });
+    }
+} env_init__;
+
+} // namespace
+
+std::uint16_t intern(char const * name) noexcept {
+    if (name == nullptr) return 0;
+    auto &reg = registry();
+    std::lock_guard<std::mutex> guard {reg.lock};
+    try {
+        auto it = reg.ids.find(name);
+        if (it != reg.ids.end()) return it->second;
+        if (reg.names.size() > UINT16_MAX) return 0;
+        auto id = static_cast<std::uint16_t>(reg.names.size());
+        reg.names.emplace_back(name);
+        reg.ids.emplace(reg.names.back(), id);
+        return id;
+    } catch (...) {
+        return 0;
+    }
+}
+
+void record(event e, std::uint16_t name, std::uint64_t ts, std::uint64_t dur, std::uint64_t id, std::uint64_t arg) noexcept {
+    thread_local buffer_t *buf = nullptr;
+    if (buf == nullptr) {
+        try {
+            buf = registry().attach();
+        } catch (...) {
+            return;
+        }
+    }
+    auto n = buf->count.load(std::memory_order_relaxed);
+    buf->ring[n % buf->ring.size()] = record_t {ts, dur, id, arg, name, e};
+    buf->count.store(n + 1, std::memory_order_release);
+}
+
+} // namespace trace
+} // namespace detail
+
+namespace trace {
+
+void enable(bool on) noexcept {
+    ipc::detail::trace::on__.store(on, std::memory_order_relaxed);
+}
+
+bool enabled() noexcept {
+    return ipc::detail::trace::on();
+}
+
+std::size_t dump(char const * path) {
+    using namespace ipc::detail::trace;
+    if (path == nullptr) return 0;
+    auto &reg = registry();
+    std::FILE *f = std::fopen(path, "ab");
+    if (f == nullptr) {
+        ipc::error("fail: trace::dump, cannot open %s\n", path);
+        return 0;
+    }
+#if !defined(IPC_OS_WINDOWS_)
+    // the other processes may be dumping into the same file
+    ::flock(::fileno(f), LOCK_EX);
+#endif
+    std::fseek(f, 0, SEEK_END);
+    if (std::ftell(f) == 0) {
+        std::fputs("[\n", f); // the closing bracket is optional in the JSON array format
+    }
+    auto pid = ipc::detail::this_process();
+    std::size_t written = 0;
+    {
+        std::lock_guard<std::mutex> guard {reg.lock};
+        for (auto &buf : reg.buffers) {
+            auto cap = static_cast<std::uint64_t>(buf->ring.size());
+            auto end = buf->count.load(std::memory_order_acquire);
+            for (auto i = (end > cap) ? (end - cap) : 0; i < end; ++i) {
+                auto const &r = buf->ring[i % cap];
+                write_record(f, r, (r.name < reg.names.size()) ? reg.names[r.name] : std::string{}, pid, buf->tid);
+                ++written;
+            }
+        }
+    }
+    std::fflush(f);
+#if !defined(IPC_OS_WINDOWS_)
+    ::flock(::fileno(f), LOCK_UN);
+#endif
+    std::fclose(f);
+    return written;
+}
+
+void clear() noexcept {
+    auto &reg = ipc::detail::trace::registry();
+    std::lock_guard<std::mutex> guard {reg.lock};
+    for (auto &buf : reg.buffers) {
+        buf->count.store(0, std::memory_order_relaxed);
+    }
+}
+
+} // namespace trace
+} // namespace ipc
@@ -1,41 +1,143 @@
 #pragma once
 
 #include <cstdio>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <tuple>
 #include <utility>
+#include <type_traits>
+
+#include "libipc/def.h"
+#include "libipc/log.h"
+#include "libipc/platform/detail.h"
+
+#if !defined(LIBIPC_LOG_LEVEL)
+#   define LIBIPC_LOG_LEVEL 1 // info
+#endif
 
 namespace ipc {
 namespace detail {
+namespace logging {
+
+enum : std::size_t {
+    args_size = 240, // the raw arguments of a record
+    str_size  = 64   // a string argument is copied, and cut at this size
+};
+
+// Formats the raw arguments of a record, see std::snprintf.
+using format_fn = int (*)(char * out, std::size_t n, char const * fmt, void const * args);
+
+// Whether the call site of 'fmt' may write another record in this second.
+bool allow(char const * fmt) noexcept;
+
+// Puts a record into the ring, a null 'fn' means 'args' is the text itself.
+// The record is dropped if the ring is full.
+void push(log_level lv, char const * fmt, format_fn fn, void const * args, std::size_t size) noexcept;
+
+struct str_arg {
+    char s[str_size];
+};
+
+// The strings are copied, since they may be gone before being formatted.
+template <typename T>
+using stored_t = std::conditional_t<std::is_same<std::decay_t<T>, char const *>::value ||
+                                    std::is_same<std::decay_t<T>, char *>::value,
+                                    str_arg, std::decay_t<T>>;
+
+template <typename T>
+stored_t<T> store(T && v) noexcept {
+    if constexpr (std::is_same<stored_t<T>, str_arg>::value) {
+        str_arg a {};
+        std::strncpy(a.s, (v == nullptr) ? "(null)" : v, str_size - 1);
+        return a;
+    }
+    else return v;
+}
+
+inline char const * load(str_arg const & a) noexcept {
+    return a.s;
+}
+
+template <typename T>
+T const & load(T const & v) noexcept {
+    return v;
+}
+
+template <typename... T>
+struct pack {
+    static_assert((std::is_trivially_copyable<T>::value && ...), "log arguments must be trivially copyable");
+
+    static constexpr std::size_t size = (sizeof(T) + ... + 0);
+
+    static void write(ipc::byte_t * p, T const &... v) noexcept {
+        IPC_UNUSED_ auto l = {0, (std::memcpy(p, &v, sizeof(T)), p += sizeof(T), 0)...};
+    }
+
+    template <std::size_t... I>
+    static int format(char * out, std::size_t n, char const * fmt, ipc::byte_t const * p, std::index_sequence<I...>) {
+        std::tuple<T...> t;
+        IPC_UNUSED_ auto l = {0, (std::memcpy(&std::get<I>(t), p, sizeof(T)), p += sizeof(T), 0)...};
+        return std::snprintf(out, n, fmt, load(std::get<I>(t))...);
+    }
+
+    static int format(char * out, std::size_t n, char const * fmt, void const * args) {
+        return format(out, n, fmt, static_cast<ipc::byte_t const *>(args), std::index_sequence_for<T...>{});
+    }
+};
 
-template <typename O>
-void print(O out, char const * str) {
-    std::fprintf(out, "%s", str);
+template <log_level L>
+void write(char const * str) noexcept {
+    if constexpr (static_cast<unsigned>(L) >= LIBIPC_LOG_LEVEL) {
+        if (!allow(str)) return;
+        push(L, str, nullptr, str, std::strlen(str));
+    }
 }
 
 // һP1ʾһںͲɱεĺ
-template <typename O, typename P1, typename... P>
-void print(O out, char const * fmt, P1&& p1, P&&... params) {
-    std::fprintf(out, fmt, std::forward<P1>(p1), std::forward<P>(params)...);
+template <log_level L, typename P1, typename... P>
+void write(char const * fmt, P1 && p1, P &&... params) noexcept {
+    if constexpr (static_cast<unsigned>(L) >= LIBIPC_LOG_LEVEL) {
+        if (!allow(fmt)) return;
+        using pack_t = pack<stored_t<P1>, stored_t<P>...>;
+        if constexpr (pack_t::size <= args_size) {
+            ipc::byte_t buf[pack_t::size];
+            pack_t::write(buf, store(std::forward<P1>(p1)), store(std::forward<P>(params))...);
+            push(L, fmt, &pack_t::format, buf, pack_t::size);
+        }
+        else {
+            // too many arguments to be deferred
+            char buf[args_size];
+            int n = std::snprintf(buf, sizeof(buf), fmt, std::forward<P1>(p1), std::forward<P>(params)...);
+            if (n > 0) push(L, fmt, nullptr, buf, (std::min)(static_cast<std::size_t>(n), sizeof(buf) - 1));
+        }
+    }
 }
 
+} // namespace logging
 } // namespace detail
 
-inline void log(char const * fmt) {
-    ipc::detail::print(stdout, fmt);
+/**
+ * The format string must be a string literal, which lives as long as the process,
+ * and the arguments must be what printf takes (strings are cut at detail::logging::str_size).
+*/
+inline void log(char const * fmt) noexcept {
+    ipc::detail::logging::write<log_level::info>(fmt);
 }
 
 template <typename P1, typename... P>
-void log(char const * fmt, P1&& p1, P&&... params) {
-    ipc::detail::print(stdout, fmt, std::forward<P1>(p1), std::forward<P>(params)...);
+void log(char const * fmt, P1&& p1, P&&... params) noexcept {
+    ipc::detail::logging::write<log_level::info>(fmt, std::forward<P1>(p1), std::forward<P>(params)...);
 }
 
 // Ϣ׼
-inline void error(char const * str) {
-    ipc::detail::print(stderr, str);
+inline void error(char const * str) noexcept {
+    ipc::detail::logging::write<log_level::error>(str);
 }
 
 template <typename P1, typename... P>
-void error(char const * fmt, P1&& p1, P&&... params) {
-    ipc::detail::print(stderr, fmt, std::forward<P1>(p1), std::forward<P>(params)...);
+void error(char const * fmt, P1&& p1, P&&... params) noexcept {
+    ipc::detail::logging::write<log_level::error>(fmt, std::forward<P1>(p1), std::forward<P>(params)...);
 }
 
 } // namespace ipc
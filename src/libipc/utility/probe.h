@@ -0,0 +1,21 @@
+#pragma once
+
+/**
+ * USDT probes (provider "libipc"), for perf/bpftrace/systemtap:
+ *
+ *  bpftrace -e 'usdt:./libipc.so:libipc:push { @[str(arg0)] = count(); }'
+ *
+ * A probe is a single nop with an ELF note, and its arguments are only evaluated into registers.
+ * They need <sys/sdt.h> (systemtap-sdt-dev), otherwise or with LIBIPC_DISABLE_USDT they vanish.
+*/
+
+#if !defined(LIBIPC_DISABLE_USDT) && defined(__has_include)
+#   if __has_include(<sys/sdt.h>)
+#       include <sys/sdt.h>
+#       define IPC_PROBE_(NAME, A1, A2, A3) DTRACE_PROBE3(libipc, NAME, A1, A2, A3)
+#   endif
+#endif
+
+#if !defined(IPC_PROBE_)
+#   define IPC_PROBE_(NAME, A1, A2, A3) ((void)0)
+#endif
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "libipc/trace.h"
+#include "libipc/platform/clock.h"
+
+namespace ipc {
+namespace detail {
+namespace trace {
+
+enum class event : std::uint8_t {
+    send,       // a slice, 'id' is the flow which starts here
+    recv,       // a slice, 'id' is the flow which ends here
+    push,       // a fragment has been pushed into the ring
+    pop,        // a fragment has been popped from the ring
+    park,       // a slice, waiting on a waiter
+    force_push  // the slow receivers have been disconnected
+};
+
+extern std::atomic<bool> on__;
+
+inline bool on() noexcept {
+    return on__.load(std::memory_order_relaxed);
+}
+
+inline std::uint64_t now() noexcept {
+    return ipc::detail::monotonic_ns();
+}
+
+inline std::uint64_t flow_id(std::uint32_t cc_id, std::uint32_t msg_id) noexcept {
+    return (static_cast<std::uint64_t>(cc_id) << 32) | msg_id;
+}
+
+// Gives a name (of a channel or a waiter) a small id for the events, 0 if it's unknown.
+std::uint16_t intern(char const * name) noexcept;
+
+void record(event e, std::uint16_t name, std::uint64_t ts, std::uint64_t dur,
+            std::uint64_t id = 0, std::uint64_t arg = 0) noexcept;
+
+} // namespace trace
+} // namespace detail
+} // namespace ipc
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace ipc {
+namespace detail {
+
+/**
+ * \brief A bounded lock-free work-stealing queue of pointers.
+ *
+ * It's the Chase-Lev deque without the LIFO pop of the owner:
+ * only the owner pushes at the bottom, and anyone (the owner as well) steals from the top,
+ * so whatever has been put back waits its turn behind the others.
+ * A push fails when it's full, a steal fails when it's empty or another thief has won the race.
+*/
+template <typename T>
+class ws_queue {
+    std::atomic<std::int64_t>        top_    {0};
+    std::atomic<std::int64_t>        bottom_ {0};
+    std::size_t                      mask_;
+    std::unique_ptr<std::atomic<T*>[]> slots_;
+
+    static std::size_t round_up(std::size_t n) noexcept {
+        std::size_t r = 1;
+        while (r < n) r <<= 1;
+        return r;
+    }
+
+public:
+    explicit ws_queue(std::size_t capacity)
+        : mask_ {round_up(capacity) - 1}
+        , slots_{new std::atomic<T*>[mask_ + 1]} {
+        for (std::size_t i = 0; i <= mask_; ++i) slots_[i].store(nullptr, std::memory_order_relaxed);
+    }
+
+    std::size_t capacity() const noexcept {
+        return mask_ + 1;
+    }
+
+    // By the owner only.
+    bool push(T *p) noexcept {
+        auto b = bottom_.load(std::memory_order_relaxed);
+        auto t = top_   .load(std::memory_order_acquire);
+        if (static_cast<std::size_t>(b - t) > mask_) return false;
+        slots_[static_cast<std::size_t>(b) & mask_].store(p, std::memory_order_relaxed);
+        bottom_.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    T *steal() noexcept {
+        auto t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto b = bottom_.load(std::memory_order_acquire);
+        if (t >= b) return nullptr;
+        // the slot may be refilled by a push once another thief has taken it, then the CAS fails
+        T *p = slots_[static_cast<std::size_t>(t) & mask_].load(std::memory_order_relaxed);
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return p;
+    }
+
+    bool empty() const noexcept {
+        return top_.load(std::memory_order_acquire) >= bottom_.load(std::memory_order_acquire);
+    }
+};
+
+} // namespace detail
+} // namespace ipc
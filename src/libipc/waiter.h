@@ -9,6 +9,7 @@
 #include "libipc/mutex.h"
 #include "libipc/condition.h"
 #include "libipc/platform/detail.h"
+#include "libipc/utility/trace.h"
 
 namespace ipc {
 namespace detail {
@@ -19,6 +20,7 @@ class waiter {
     ipc::sync::condition cond_;
     ipc::sync::mutex     lock_;
     std::atomic<bool>    quit_ {false};
+    std::uint16_t        trace_name_ = 0;
 
 public:
     static void init();
@@ -38,6 +40,7 @@ public:
 
     bool open(char const *name) noexcept {
         quit_.store(false, std::memory_order_relaxed);
+        trace_name_ = ipc::detail::trace::intern(name);
         if (!cond_.open((std::string{name} + "_WAITER_COND_").c_str())) {
             return false;
         }
@@ -72,7 +75,13 @@ public:
                     return !quit_.load(std::memory_order_relaxed)
                         && std::forward<F>(pred)();
                 }()) {
-            if (!cond_.wait(lock_, tm)) return false;
+            std::uint64_t ts = ipc::detail::trace::on() ? ipc::detail::trace::now() : 0;
+            bool succ = cond_.wait(lock_, tm);
+            if (ts != 0) {
+                ipc::detail::trace::record(ipc::detail::trace::event::park, trace_name_, 
+                                           ts, ipc::detail::trace::now() - ts);
+            }
+            if (!succ) return false;
         }
         return true;
     }
@@ -7,6 +7,7 @@
 #include <memory>
 #include <mutex>
 #include <utility>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -15,6 +16,7 @@
 #include "thread_pool.h"
 
 #include "libipc/platform/detail.h"
+#include "libipc/platform/perf_counters.h"
 #ifdef IPC_OS_LINUX_
 #include <fcntl.h> // ::open
 #endif
@@ -48,28 +50,64 @@ template <> struct unit<std::chrono::seconds> {
     }
 };
 
+/**
+ * Every thread which calls start() counts itself with perf counters (if it's allowed to),
+ * they are summed up & printed per op along with the elapsed time.
+*/
 struct test_stopwatch {
     capo::stopwatch<> sw_;
     std::atomic_flag started_ = ATOMIC_FLAG_INIT;
+    std::mutex perf_lock_;
+    std::vector<std::unique_ptr<ipc::detail::perf_counters>> perf_;
 
     void start() {
+        std::unique_ptr<ipc::detail::perf_counters> pc {new ipc::detail::perf_counters};
+        if (pc->valid()) {
+            pc->start();
+            std::lock_guard<std::mutex> guard {perf_lock_};
+            perf_.push_back(std::move(pc));
+        }
         if (!started_.test_and_set()) {
             sw_.start();
         }
     }
 
+    void print_perf(double ops) {
+        using ipc::detail::perf_event;
+        ipc::detail::perf_values sum;
+        bool kernel = true;
+        {
+            std::lock_guard<std::mutex> guard {perf_lock_};
+            for (auto & pc : perf_) {
+                sum += pc->read();
+                kernel = kernel && pc->kernel();
+            }
+            if (perf_.empty()) return;
+        }
+        std::cout << "\tper op:";
+        for (std::size_t i = 0; i < static_cast<std::size_t>(perf_event::count); ++i) {
+            auto e = static_cast<perf_event>(i);
+            if (!sum.has(e)) continue;
+            std::cout << " " << ipc::detail::perf_event_name(e) << " " << (double(sum[e]) / ops);
+        }
+        std::cout << (kernel ? "" : " (user)") << std::endl;
+    }
+
     template <typename ToDur = std::chrono::nanoseconds>
     void print_elapsed(int N, int Loops, char const * message = "") {
         auto ts = sw_.elapsed<ToDur>();
         std::cout << "[" << N << ", \t" << Loops << "] " << message << "\t"
                   << (double(ts) / double(Loops)) << " " << unit<ToDur>::str() << std::endl;
+        print_perf(double(Loops));
     }
 
     template <int Factor, typename ToDur = std::chrono::nanoseconds>
     void print_elapsed(int N, int M, int Loops, char const * message = "") {
         auto ts = sw_.elapsed<ToDur>();
+        auto ops = double(Factor ? (Loops * Factor) : (Loops * N));
         std::cout << "[" << N << "-" << M << ", \t" << Loops << "] " << message << "\t"
-                  << (double(ts) / double(Factor ? (Loops * Factor) : (Loops * N))) << " " << unit<ToDur>::str() << std::endl;
+                  << (double(ts) / ops) << " " << unit<ToDur>::str() << std::endl;
+        print_perf(ops);
     }
 
     template <typename ToDur = std::chrono::nanoseconds>
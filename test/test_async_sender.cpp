@@ -0,0 +1,112 @@
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "libipc/ipc.h"
+#include "libipc/async_sender.h"
+
+#include "test.h"
+
+namespace {
+
+using chan_t = ipc::chan<ipc::relat::single, ipc::relat::multi, ipc::trans::broadcast>;
+
+} // internal-linkage
+
+TEST(AsyncSender, order) {
+    constexpr int threads = 4;
+    constexpr int count   = 500;
+    chan_t::clear_storage("async-order");
+    chan_t que {"async-order", ipc::sender};
+    chan_t rcv {"async-order", ipc::receiver};
+
+    std::atomic<int> errors {0};
+    std::thread receiver {[&rcv, &errors] {
+        int next[threads] {};
+        for (int n = 0; n < threads * count; ++n) {
+            ipc::buff_t buf = rcv.recv(5000);
+            if (buf.empty()) {
+                ++errors;
+                return;
+            }
+            std::string msg {static_cast<char const *>(buf.data())};
+            auto dash = msg.find('-');
+            int k = std::stoi(msg.substr(0, dash));
+            int i = std::stoi(msg.substr(dash + 1));
+            // one ring is shared by all the callers, each of them keeps its own order
+            if (next[k]++ != i) ++errors;
+        }
+    }};
+
+    ipc::async_sender as {que};
+    std::atomic<int> called {0};
+    std::vector<std::thread> callers;
+    for (int k = 0; k < threads; ++k) {
+        callers.emplace_back([&as, &called, &errors, k] {
+            for (int i = 0; i < count; ++i) {
+                auto msg = std::to_string(k) + "-" + std::to_string(i);
+                bool ok = (i % 2 == 0) ? as.send(msg)
+                                       : as.send(msg, [&called](bool sent) { if (sent) ++called; });
+                if (!ok) ++errors;
+            }
+        });
+    }
+    for (auto & t : callers) t.join();
+    EXPECT_TRUE(as.flush(5000));
+    EXPECT_EQ(called, threads * count / 2);
+    auto st = as.stats();
+    EXPECT_EQ(st.queued, 0u);
+    EXPECT_EQ(st.queued_bytes, 0u);
+    EXPECT_EQ(st.sent, std::uint64_t(threads * count));
+    EXPECT_EQ(st.failed, 0u);
+    receiver.join();
+    EXPECT_EQ(errors, 0);
+}
+
+TEST(AsyncSender, limit) {
+    chan_t::clear_storage("async-limit");
+    chan_t que {"async-limit", ipc::sender};
+    chan_t rcv {"async-limit", ipc::receiver};
+
+    ipc::async_sender::options opt;
+    opt.memory_limit = 4096;
+    ipc::async_sender as {que, opt};
+    EXPECT_FALSE(as.send(nullptr, 0));
+
+    // the flusher is held by the callback of the first one
+    std::promise<void> go;
+    auto held = go.get_future().share();
+    std::atomic<bool> holding {false};
+    ASSERT_TRUE(as.send(std::string{"first"}, [held, &holding](bool) {
+        holding = true;
+        held.wait();
+    }));
+    for (int i = 0; (i < 1000) && !holding; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_TRUE(holding);
+    EXPECT_FALSE(as.flush(10));
+
+    std::string big(1000, 'x');
+    int queued = 0;
+    while (as.send(big)) ++queued;
+    EXPECT_GT(queued, 0);
+    EXPECT_LT(queued, 5);
+    auto st = as.stats();
+    EXPECT_EQ(st.queued, std::uint64_t(queued + 1));
+    EXPECT_EQ(st.rejected, 2u);
+    EXPECT_LE(st.queued_bytes, opt.memory_limit);
+    EXPECT_FALSE(as.send_future(big.c_str(), big.size() + 1).get());
+
+    go.set_value();
+    EXPECT_TRUE(as.send_future("after", 6).get());
+    EXPECT_TRUE(as.flush());
+    EXPECT_EQ(as.stats().sent, std::uint64_t(queued + 2));
+    for (int i = 0; i < queued + 2; ++i) {
+        EXPECT_FALSE(rcv.recv(1000).empty());
+    }
+}
@@ -0,0 +1,191 @@
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "libipc/ipc.h"
+#include "libipc/coro.h"
+
+#include "test.h"
+#include "thread_pool.h"
+
+namespace {
+
+using chan_t = ipc::chan<ipc::relat::single, ipc::relat::multi, ipc::trans::broadcast>;
+
+struct pool_executor {
+    ipc_ut::thread_pool & pool_;
+
+    void post(std::function<void()> job) {
+        pool_ << std::move(job);
+    }
+};
+
+template <typename F>
+bool wait_until(F && pred, int ms = 5000) {
+    for (int i = 0; (i < ms) && !pred(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return pred();
+}
+
+#if LIBIPC_COROUTINES
+// Runs eagerly, and nobody waits for it.
+struct detached {
+    struct promise_type {
+        detached get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+detached consume(ipc::reactor & r, chan_t & ch, int count, std::atomic<int> & done, std::atomic<int> & errors) {
+    for (int i = 0; i < count; ++i) {
+        ipc::buff_t buf = co_await ipc::async_recv(r, ch, 5000);
+        if (buf.empty() || (std::to_string(i) != static_cast<char const *>(buf.data()))) {
+            ++errors;
+        }
+    }
+    ++done;
+}
+
+detached produce(ipc::reactor & r, chan_t & ch, int count, std::atomic<int> & done, std::atomic<int> & errors) {
+    for (int i = 0; i < count; ++i) {
+        if (!co_await ipc::async_send(r, ch, std::to_string(i), 5000)) ++errors;
+    }
+    ++done;
+}
+#endif
+
+} // internal-linkage
+
+TEST(Coro, reactor) {
+    chan_t::clear_storage("coro-reactor");
+    chan_t que {"coro-reactor", ipc::sender};
+    chan_t rcv {"coro-reactor", ipc::receiver};
+    {
+        ipc::reactor r;
+        EXPECT_TRUE(r.try_recv(rcv).empty());
+        // it's watched from then on, and known to be empty once a try_recv has found nothing
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        EXPECT_TRUE(r.try_recv(rcv).empty());
+        // a task waiting for a message
+        std::atomic<int> woken {0};
+        ASSERT_TRUE(r.when_readable(rcv, ipc::invalid_value, [&woken](bool ready) {
+            woken = ready ? 1 : -1;
+        }));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        EXPECT_EQ(woken, 0);
+        ASSERT_TRUE(que.send(std::string{"hello"}, 0));
+        ASSERT_TRUE(wait_until([&woken] { return woken != 0; }));
+        EXPECT_EQ(woken, 1);
+        ipc::buff_t buf = r.try_recv(rcv);
+        ASSERT_FALSE(buf.empty());
+        EXPECT_STREQ(static_cast<char const *>(buf.data()), "hello");
+        EXPECT_TRUE(r.try_recv(rcv).empty());
+        // and its timeout
+        woken = 0;
+        ASSERT_TRUE(r.when_readable(rcv, 10, [&woken](bool ready) {
+            woken = ready ? 1 : -1;
+        }));
+        ASSERT_TRUE(wait_until([&woken] { return woken != 0; }));
+        EXPECT_EQ(woken, -1);
+        // a sender isn't a receiver to be watched
+        EXPECT_TRUE(r.try_recv(que).empty());
+        woken = 0;
+        if (r.when_readable(que, ipc::invalid_value, [&woken](bool ready) { woken = ready ? 1 : -1; })) {
+            ASSERT_TRUE(wait_until([&woken] { return woken != 0; }));
+            EXPECT_EQ(woken, -1);
+        }
+        r.forget(que);
+        // the tasks still waiting on a channel are resumed with false when it's forgotten
+        ASSERT_TRUE(r.when_readable(rcv, ipc::invalid_value, [&woken](bool ready) {
+            woken = ready ? 1 : -1;
+        }));
+        woken = 0;
+        r.forget(rcv);
+        ASSERT_TRUE(wait_until([&woken] { return woken != 0; }));
+        EXPECT_EQ(woken, -1);
+        // a task waiting for room, woken by the next pop
+        char const msg[] = "room";
+        while (que.try_send(msg, sizeof(msg), 0)) ;
+        woken = 0;
+        ASSERT_TRUE(r.when_writable(que, ipc::invalid_value, [&woken](bool ready) { woken = ready ? 1 : -1; }));
+        // the first one only tries again, since it has been full before the sender was watched
+        ASSERT_TRUE(wait_until([&woken] { return woken != 0; }));
+        EXPECT_EQ(woken, 1);
+        EXPECT_FALSE(que.try_send(msg, sizeof(msg), 0));
+        woken = 0;
+        ASSERT_TRUE(r.when_writable(que, ipc::invalid_value, [&woken](bool ready) { woken = ready ? 1 : -1; }));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        EXPECT_EQ(woken, 0);
+        EXPECT_FALSE(rcv.recv(0).empty());
+        ASSERT_TRUE(wait_until([&woken] { return woken != 0; }));
+        EXPECT_EQ(woken, 1);
+        EXPECT_TRUE(que.try_send(msg, sizeof(msg), 0));
+        r.forget(que);
+    }
+    std::atomic<int> posted {0};
+    {
+        ipc_ut::thread_pool pool {2};
+        pool_executor exec {pool};
+        ipc::reactor r {exec};
+        r.post([&posted] { ++posted; });
+        ASSERT_TRUE(wait_until([&posted] { return posted == 1; }));
+        pool.wait_for_done();
+    }
+}
+
+#if LIBIPC_COROUTINES
+TEST(Coro, async) {
+    constexpr int channels = 16;
+    constexpr int count    = 500; // more than a ring could hold
+    std::vector<std::unique_ptr<chan_t>> ques, rcvs;
+    for (int k = 0; k < channels; ++k) {
+        auto name = "coro-" + std::to_string(k);
+        chan_t::clear_storage(name.c_str());
+        ques.emplace_back(new chan_t{name.c_str(), ipc::sender});
+        rcvs.emplace_back(new chan_t{name.c_str(), ipc::receiver});
+    }
+    std::atomic<int> done {0}, errors {0};
+    {
+        ipc_ut::thread_pool pool {2};
+        pool_executor exec {pool};
+        ipc::reactor r {exec};
+        // nothing there yet: the timeout
+        std::atomic<int> timed_out {0};
+        [](ipc::reactor & r, chan_t & ch, std::atomic<int> & out) -> detached {
+            ipc::buff_t buf = co_await ipc::async_recv(r, ch, 10);
+            out = buf.empty() ? 1 : -1;
+        }(r, *rcvs[0], timed_out);
+        ASSERT_TRUE(wait_until([&timed_out] { return timed_out != 0; }));
+        EXPECT_EQ(timed_out, 1);
+        // the senders fill the rings before any receiver has started, then wait for the space
+        for (int k = 0; k < channels; ++k) produce(r, *ques[k], count, done, errors);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        EXPECT_LT(done, channels);
+        for (int k = 0; k < channels; ++k) consume(r, *rcvs[k], count, done, errors);
+        ASSERT_TRUE(wait_until([&done] { return done == channels * 2; }, 30000));
+        pool.wait_for_done();
+    }
+    EXPECT_EQ(errors, 0);
+}
+#else
+TEST(Coro, blocking) {
+    chan_t::clear_storage("coro-blocking");
+    chan_t que {"coro-blocking", ipc::sender};
+    chan_t rcv {"coro-blocking", ipc::receiver};
+    ipc::reactor r;
+    EXPECT_TRUE(ipc::async_send(r, que, std::string{"hello"}));
+    ipc::buff_t buf = ipc::async_recv(r, rcv, 1000);
+    ASSERT_FALSE(buf.empty());
+    EXPECT_STREQ(static_cast<char const *>(buf.data()), "hello");
+    EXPECT_TRUE(ipc::async_recv(r, rcv, 10).empty());
+}
+#endif
@@ -0,0 +1,131 @@
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "libipc/ipc.h"
+#include "libipc/dispatcher.h"
+
+#include "test.h"
+
+namespace {
+
+using chan_t = ipc::chan<ipc::relat::single, ipc::relat::multi, ipc::trans::broadcast>;
+
+template <typename F>
+bool wait_until(F && pred, int ms = 10000) {
+    for (int i = 0; (i < ms) && !pred(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return pred();
+}
+
+} // internal-linkage
+
+TEST(Dispatcher, route) {
+    constexpr int channels = 4;
+    constexpr int keys     = 16;
+    constexpr int count    = 2000; // of each channel
+
+    std::vector<std::unique_ptr<chan_t>> ques, rcvs;
+    for (int k = 0; k < channels; ++k) {
+        auto name = "dispatcher-" + std::to_string(k);
+        chan_t::clear_storage(name.c_str());
+        ques.emplace_back(new chan_t{name.c_str(), ipc::sender});
+        rcvs.emplace_back(new chan_t{name.c_str(), ipc::receiver});
+    }
+
+    ipc::dispatcher::options opt;
+    opt.workers = 4;
+    opt.strands = 8; // fewer than the keys, some keys share a strand
+    opt.batch   = 16;
+    ipc::dispatcher d {opt};
+
+    // each key is sent by one channel only, so its order is the order of the sender
+    std::atomic<int> next[keys] {};
+    std::atomic<int> running[keys] {};
+    std::atomic<int> misordered {0}, overlapped {0}, others {0}, unknown {0};
+    ASSERT_TRUE(d.on(1, [&](ipc::dispatcher::message const & m) {
+        ASSERT_EQ(m.size, sizeof(int));
+        int seq = *static_cast<int const *>(m.data);
+        auto key = static_cast<int>(m.key);
+        if (running[key]++ != 0) ++overlapped;
+        if (next[key] != seq) ++misordered;
+        next[key] = seq + 1;
+        --running[key];
+    }));
+    ASSERT_TRUE(d.on(2, [&](ipc::dispatcher::message const & m) {
+        EXPECT_EQ(m.key, ipc::dispatcher::no_key);
+        EXPECT_STREQ(static_cast<char const *>(m.data), "other");
+        ++others;
+    }));
+    for (auto & r : rcvs) EXPECT_NE(d.add(*r), ipc::invalid_value);
+    ASSERT_TRUE(d.start());
+    EXPECT_FALSE(d.on(3, [](ipc::dispatcher::message const &) {}));
+    EXPECT_EQ(d.add(*rcvs[0]), ipc::invalid_value);
+
+    std::vector<std::thread> senders;
+    for (int k = 0; k < channels; ++k) {
+        senders.emplace_back([&, k] {
+            int seq[keys / channels] {};
+            for (int i = 0; i < count; ++i) {
+                int n = i % (keys / channels);
+                int key = k * (keys / channels) + n;
+                ASSERT_TRUE(ipc::dispatcher::send(*ques[k], 1, static_cast<std::uint64_t>(key), &seq[n], sizeof(int)));
+                ++seq[n];
+                if (i % 100 == 0) {
+                    ASSERT_TRUE(ipc::dispatcher::send(*ques[k], 2, ipc::dispatcher::no_key, "other", 6));
+                }
+            }
+        });
+    }
+    for (auto & t : senders) t.join();
+    // no header, and no handler
+    ASSERT_TRUE(ques[0]->send(std::string{"x"}));
+    ASSERT_TRUE(ipc::dispatcher::send(*ques[0], 3, 0, "?", 2));
+
+    ASSERT_TRUE(wait_until([&] {
+        return (d.stats(1).handled == channels * count) && (d.dropped() == 2);
+    }));
+    d.stop();
+    EXPECT_EQ(misordered, 0);
+    EXPECT_EQ(overlapped, 0);
+    EXPECT_EQ(others, channels * (count / 100));
+
+    auto st = d.stats(1);
+    EXPECT_EQ(st.received, std::uint64_t(channels * count));
+    EXPECT_EQ(st.depth, 0u);
+    EXPECT_GE(st.max_depth, 1u);
+    EXPECT_EQ(st.wait.count, std::uint64_t(channels * count));
+    EXPECT_EQ(st.run .count, std::uint64_t(channels * count));
+    EXPECT_LE(st.wait.p50, st.wait.p99);
+    EXPECT_LE(st.wait.p99, st.wait.max);
+    EXPECT_EQ(d.stats(2).handled, std::uint64_t(others));
+    EXPECT_EQ(d.stats(3).received, 0u);
+}
+
+TEST(Dispatcher, unknown) {
+    chan_t::clear_storage("dispatcher-unknown");
+    chan_t que {"dispatcher-unknown", ipc::sender};
+    chan_t rcv {"dispatcher-unknown", ipc::receiver};
+    std::atomic<std::uint32_t> got {0};
+    {
+        ipc::dispatcher d;
+        ASSERT_TRUE(d.on_unknown([&got](ipc::dispatcher::message const & m) { got = m.type; }));
+        ASSERT_NE(d.add(rcv), ipc::invalid_value);
+        ASSERT_TRUE(d.start());
+        ASSERT_TRUE(ipc::dispatcher::send(que, 42, 7, nullptr, 0));
+        ASSERT_TRUE(wait_until([&got] { return got != 0; }));
+        EXPECT_EQ(got, 42u);
+        EXPECT_EQ(d.dropped(), 0u);
+    }
+    // the channel is left to be received from directly
+    ASSERT_TRUE(que.send(std::string{"after"}));
+    ipc::buff_t buf = rcv.recv(1000);
+    ASSERT_FALSE(buf.empty());
+    EXPECT_STREQ(static_cast<char const *>(buf.data()), "after");
+}
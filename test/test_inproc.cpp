@@ -0,0 +1,117 @@
+
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "libipc/ipc.h"
+#include "libipc/select.h"
+#include "libipc/inproc.h"
+
+#include "test.h"
+
+namespace {
+
+std::string to_string(ipc::buff_t const & buf) {
+    return buf.empty() ? std::string{} : std::string{static_cast<char const *>(buf.data())};
+}
+
+} // internal-linkage
+
+TEST(Inproc, broadcast) {
+    constexpr int count = 2000;
+    ipc::route que {"inproc://route"};
+    ipc::route r1  {"inproc://route", ipc::receiver};
+    ipc::route r2  {"inproc://route", ipc::receiver};
+    ASSERT_TRUE(que.valid());
+    EXPECT_EQ(que.recv_count(), 2u);
+    EXPECT_STREQ(que.name(), "inproc://route");
+    // nothing in shared memory
+    EXPECT_EQ(que.stats(), nullptr);
+    EXPECT_EQ(r1.ready_fd(), -1);
+
+    std::atomic<int> errors {0};
+    auto recv = [&errors](ipc::route & rcv) {
+        for (int i = 0; i < count; ++i) {
+            if (to_string(rcv.recv(5000)) != std::to_string(i)) ++errors;
+        }
+    };
+    std::thread t1 {recv, std::ref(r1)};
+    std::thread t2 {recv, std::ref(r2)};
+    for (int i = 0; i < count; ++i) {
+        if (!que.send(std::to_string(i), 5000)) ++errors;
+    }
+    t1.join();
+    t2.join();
+    EXPECT_EQ(errors, 0);
+    EXPECT_TRUE(r1.try_recv().empty());
+
+    // a buffer is handed over as it is
+    auto p = new char[6];
+    std::memcpy(p, "hello", 6);
+    ASSERT_TRUE(que.send(ipc::buff_t{p, 6, [](void * p, std::size_t) { delete [] static_cast<char *>(p); }}));
+    auto b1 = r1.recv(100);
+    auto b2 = r2.recv(100);
+    EXPECT_EQ(b1.data(), p);
+    EXPECT_EQ(b2.data(), p);
+    EXPECT_EQ(to_string(b1), "hello");
+
+    // the same name in shared memory is another channel
+    ipc::route::clear_storage("inproc-other");
+    ipc::route other {"inproc-other", ipc::receiver};
+    EXPECT_EQ(ipc::route{"inproc-other"}.recv_count(), 1u);
+    EXPECT_EQ((ipc::route{"inproc-other", ipc::inproc}.recv_count()), 0u);
+}
+
+TEST(Inproc, channel) {
+    // by the flag, the messages to self are ignored
+    ipc::channel c1 {"inproc-chan", ipc::sender | ipc::receiver | ipc::inproc};
+    ipc::channel c2 {"inproc-chan", ipc::sender | ipc::receiver | ipc::inproc};
+    ASSERT_TRUE(c1.send(std::string{"from 1"}));
+    ASSERT_TRUE(c2.send(std::string{"from 2"}));
+    EXPECT_EQ(to_string(c2.recv(100)), "from 1");
+    EXPECT_EQ(to_string(c1.recv(100)), "from 2");
+    EXPECT_TRUE(c1.try_recv().empty());
+
+    // a full ring
+    ipc::channel que {"inproc-chan", ipc::inproc};
+    c2.disconnect();
+    que.set_overflow(ipc::overflow::reject);
+    std::size_t sent = 0;
+    while (que.send(std::string{"x"})) ++sent;
+    EXPECT_EQ(sent, std::size_t(ipc::detail::inproc::ring_size));
+    EXPECT_FALSE(que.try_send(std::string{"y"}, 10));
+    EXPECT_EQ(c1.lag().messages, sent);
+    EXPECT_EQ(c1.skip(10), 10u);
+    EXPECT_TRUE(que.try_send(std::string{"y"}, 10));
+    auto ovf = que.overflow_counters();
+    EXPECT_EQ(ovf.rejected, 1u);
+    EXPECT_EQ(ovf.full, 2u);
+
+    // the default: the slow receiver is disconnected on timeout
+    que.set_overflow(ipc::overflow::disconnect);
+    while (c1.lag().messages < sent) que.send(std::string{"z"});
+    EXPECT_FALSE(que.send(std::string{"z"}, 10));
+    EXPECT_EQ(que.overflow_counters().disconnected, 1u);
+    EXPECT_EQ(que.recv_count(), 0u);
+    EXPECT_TRUE(c1.recv(0).empty());
+}
+
+TEST(Inproc, overwrite) {
+    ipc::telemetry que {"inproc://telemetry"};
+    ipc::telemetry rcv {"inproc://telemetry", ipc::receiver};
+    for (int i = 0; i < 300; ++i) {
+        ASSERT_TRUE(que.send(std::to_string(i)));
+    }
+    EXPECT_EQ(rcv.lost_count(), 300u - ipc::detail::inproc::ring_size);
+    EXPECT_EQ(to_string(rcv.recv(0)), std::to_string(300 - ipc::detail::inproc::ring_size));
+    EXPECT_EQ(rcv.skip_to_latest(), ipc::detail::inproc::ring_size - 1);
+
+    // served by a select
+    ipc::select sel;
+    ASSERT_NE(sel.add(rcv), std::size_t(ipc::invalid_value));
+    std::thread sender {[&que] { que.send(std::string{"late"}); }};
+    EXPECT_EQ(to_string(sel.recv(nullptr, 5000)), "late");
+    sender.join();
+}
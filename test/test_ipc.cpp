@@ -4,9 +4,16 @@
 #include <mutex>
 #include <atomic>
 #include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
 
 #include "libipc/ipc.h"
 #include "libipc/buffer.h"
+#include "libipc/trace.h"
+#include "libipc/select.h"
 #include "libipc/memory/resource.h"
 
 #include "test.h"
@@ -14,6 +21,13 @@
 
 #include "capo/random.hpp"
 
+#ifdef IPC_OS_LINUX_
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
 using namespace ipc;
 
 namespace {
@@ -149,6 +163,45 @@ void test_sr(char const * name, int s_cnt, int r_cnt) {
     sw.print_elapsed<std::chrono::microseconds>(s_cnt, r_cnt, (int)data_set__.get().size(), name);
 }
 
+#ifdef IPC_OS_LINUX_
+template <relat Rp, relat Rc, trans Ts>
+void test_dead_receiver(char const * name) {
+    using que_t = chan<Rp, Rc, Ts>;
+    que_t::clear_storage(name);
+    que_t que { name, ipc::sender };
+    que_t live { name, ipc::receiver };
+
+    pid_t pid = ::fork();
+    ASSERT_NE(pid, -1);
+    if (pid == 0) {
+        // connect & die without disconnecting
+        que_t dead { name, ipc::receiver };
+        ::_exit(dead.valid() ? 0 : 1);
+    }
+    int status = 0;
+    ASSERT_EQ(::waitpid(pid, &status, 0), pid); // a zombie is still alive
+    ASSERT_EQ(que.recv_count(), 2u);
+
+    constexpr int count = 1000;
+    std::thread reader {[&live] {
+        for (int i = 0; i < count; ++i) {
+            ASSERT_FALSE(live.recv().empty());
+        }
+    }};
+    // try_send never calls force_push, so the ring would stay full if the dead slot isn't reclaimed.
+    int sent = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while ((sent < count) && (std::chrono::steady_clock::now() < deadline)) {
+        if (que.try_send(rand_buf{msg_head{sent}}, 0)) ++sent;
+        else std::this_thread::yield();
+    }
+    EXPECT_EQ(sent, count);
+    EXPECT_EQ(que.recv_count(), 1u);
+    if (sent < count) live.disconnect();
+    reader.join();
+}
+#endif
+
 } // internal-linkage
 
 TEST(IPC, clear) {
@@ -161,7 +214,7 @@ TEST(IPC, clear) {
         EXPECT_TRUE(ipc_ut::expect_exist("__IPC_SHM__RD_CONN__ssu_WAITER_LOCK_", true));
         EXPECT_TRUE(ipc_ut::expect_exist("__IPC_SHM__WT_CONN__ssu_WAITER_COND_", true));
         EXPECT_TRUE(ipc_ut::expect_exist("__IPC_SHM__WT_CONN__ssu_WAITER_LOCK_", true));
-        EXPECT_TRUE(ipc_ut::expect_exist("__IPC_SHM__QU_CONN__ssu__64__16", true));
+        EXPECT_TRUE(ipc_ut::expect_exist("__IPC_SHM__QU_CONN__ssu__128__16", true));
         c.clear();
         EXPECT_TRUE(ipc_ut::expect_exist("__IPC_SHM__AC_CONN__ssu", false));
         EXPECT_TRUE(ipc_ut::expect_exist("__IPC_SHM__CC_CONN__ssu_WAITER_COND_", false));
@@ -170,7 +223,7 @@ TEST(IPC, clear) {
         EXPECT_TRUE(ipc_ut::expect_exist("__IPC_SHM__RD_CONN__ssu_WAITER_LOCK_", false));
         EXPECT_TRUE(ipc_ut::expect_exist("__IPC_SHM__WT_CONN__ssu_WAITER_COND_", false));
         EXPECT_TRUE(ipc_ut::expect_exist("__IPC_SHM__WT_CONN__ssu_WAITER_LOCK_", false));
-        EXPECT_TRUE(ipc_ut::expect_exist("__IPC_SHM__QU_CONN__ssu__64__16", false));
+        EXPECT_TRUE(ipc_ut::expect_exist("__IPC_SHM__QU_CONN__ssu__128__16", false));
     }
     {
         chan<relat::single, relat::single, trans::unicast> c{"ssu"};
@@ -181,7 +234,7 @@ TEST(IPC, clear) {
         EXPECT_TRUE(ipc_ut::expect_exist("__IPC_SHM__RD_CONN__ssu_WAITER_LOCK_", true));
         EXPECT_TRUE(ipc_ut::expect_exist("__IPC_SHM__WT_CONN__ssu_WAITER_COND_", true));
         EXPECT_TRUE(ipc_ut::expect_exist("__IPC_SHM__WT_CONN__ssu_WAITER_LOCK_", true));
-        EXPECT_TRUE(ipc_ut::expect_exist("__IPC_SHM__QU_CONN__ssu__64__16", true));
+        EXPECT_TRUE(ipc_ut::expect_exist("__IPC_SHM__QU_CONN__ssu__128__16", true));
         chan<relat::single, relat::single, trans::unicast>::clear_storage("ssu");
         EXPECT_TRUE(ipc_ut::expect_exist("__IPC_SHM__AC_CONN__ssu", false));
         EXPECT_TRUE(ipc_ut::expect_exist("__IPC_SHM__CC_CONN__ssu_WAITER_COND_", false));
@@ -190,7 +243,7 @@ TEST(IPC, clear) {
         EXPECT_TRUE(ipc_ut::expect_exist("__IPC_SHM__RD_CONN__ssu_WAITER_LOCK_", false));
         EXPECT_TRUE(ipc_ut::expect_exist("__IPC_SHM__WT_CONN__ssu_WAITER_COND_", false));
         EXPECT_TRUE(ipc_ut::expect_exist("__IPC_SHM__WT_CONN__ssu_WAITER_LOCK_", false));
-        EXPECT_TRUE(ipc_ut::expect_exist("__IPC_SHM__QU_CONN__ssu__64__16", false));
+        EXPECT_TRUE(ipc_ut::expect_exist("__IPC_SHM__QU_CONN__ssu__128__16", false));
         c.release(); // Call this interface to prevent destruction-time exceptions.
     }
 }
@@ -227,6 +280,512 @@ TEST(IPC, Nv1) {
     test_sr<relat::multi , relat::multi , trans::broadcast>("mmb", MultiMax, 1);
 }
 
+TEST(IPC, overflow) {
+    using que_t = chan<relat::single, relat::multi, trans::broadcast>;
+    constexpr int count = 1000;
+    {
+        que_t que { "smb-overflow", ipc::sender };
+        que_t rcv { que.name(), ipc::receiver };
+        que.set_overflow(overflow::drop);
+        for (int i = 0; i < count; ++i) {
+            ASSERT_TRUE(que.send(rand_buf{msg_head{i}}));
+        }
+        auto st = que.overflow_counters();
+        EXPECT_GT(st.dropped, 0u);
+        EXPECT_EQ(st.dropped, st.full);
+        EXPECT_EQ(st.disconnected, 0u);
+        EXPECT_EQ(que.recv_count(), 1u);
+        std::uint64_t got = 0;
+        for (rand_buf buf {rcv.try_recv()}; !buf.empty(); buf = rcv.try_recv()) {
+            EXPECT_EQ(buf.get_id(), static_cast<int>(got++));
+        }
+        EXPECT_EQ(got + st.dropped, static_cast<std::uint64_t>(count));
+    }
+    {
+        que_t que { "smb-overflow", ipc::sender };
+        que_t rcv { que.name(), ipc::receiver };
+        que.set_overflow(overflow::reject);
+        int i = 0;
+        while (que.send(rand_buf{msg_head{i}})) ++i;
+        EXPECT_EQ(que.overflow_counters().rejected, 1u);
+        EXPECT_EQ(que.overflow_counters().backoff_hint, 1u);
+        EXPECT_FALSE(que.send(rand_buf{msg_head{i}}));
+        EXPECT_EQ(que.overflow_counters().backoff_hint, 2u);
+        EXPECT_FALSE(rcv.recv().empty());
+        EXPECT_TRUE(que.send(rand_buf{msg_head{i}}));
+        EXPECT_EQ(que.overflow_counters().backoff_hint, 0u);
+        EXPECT_EQ(que.recv_count(), 1u);
+    }
+    {
+        que_t que { "smb-overflow", ipc::sender };
+        que_t rcv { que.name(), ipc::receiver };
+        que.set_overflow(overflow::spill);
+        for (int i = 0; i < count; ++i) {
+            ASSERT_TRUE(que.send(rand_buf{msg_head{i}}, 10));
+        }
+        EXPECT_GT(que.overflow_counters().spilled, 0u);
+        // the drainer waits for the slow receiver far beyond the timeout, & never forces
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        EXPECT_EQ(que.recv_count(), 1u);
+        for (int i = 0; i < count; ++i) {
+            rand_buf buf {rcv.recv(1000)};
+            ASSERT_FALSE(buf.empty());
+            EXPECT_EQ(buf.get_id(), i);
+        }
+        EXPECT_EQ(que.overflow_counters().spill_depth, 0u);
+        EXPECT_EQ(que.overflow_counters().disconnected, 0u);
+    }
+    que_t::clear_storage("smb-overflow");
+
+    // one handle spilling from two threads, while the counters are read
+    using mmb_t = chan<relat::multi, relat::multi, trans::broadcast>;
+    {
+        mmb_t que { "mmb-overflow", ipc::sender };
+        mmb_t rcv { que.name(), ipc::receiver };
+        que.set_overflow(overflow::spill);
+        std::atomic<bool> done {false};
+        std::thread reader {[&] {
+            while (!done) que.overflow_counters();
+        }};
+        auto send = [&que] {
+            for (int i = 0; i < count; ++i) que.send(rand_buf{msg_head{i}});
+        };
+        std::thread t1 {send}, t2 {send};
+        t1.join();
+        t2.join();
+        int got = 0;
+        while (got < 2 * count && !rcv.recv(1000).empty()) ++got;
+        EXPECT_EQ(got, 2 * count);
+        que.set_overflow(overflow::disconnect);
+        done = true;
+        reader.join();
+        EXPECT_EQ(que.overflow_counters().spill_depth, 0u);
+    }
+    mmb_t::clear_storage("mmb-overflow");
+}
+
+template <relat Rp, relat Rc, trans Ts>
+void test_lag_skip(char const * name) {
+    using que_t = chan<Rp, Rc, Ts>;
+    que_t que { name, ipc::sender };
+    que_t rcv { name, ipc::receiver };
+    EXPECT_EQ(rcv.lag().messages, 0u);
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(que.send(rand_buf{msg_head{i}}, 0));
+    }
+    std::vector<char> frag(ipc::data_length * 3 + 1), big(ipc::large_msg_align * 4);
+    ASSERT_TRUE(que.send(frag.data(), frag.size(), 0));
+    ASSERT_TRUE(que.send(big.data(), big.size(), 0));
+    auto st = rcv.lag();
+    EXPECT_EQ(st.messages, 12u);
+    EXPECT_EQ(st.bytes, 10 * sizeof(msg_head) + frag.size() + big.size());
+    EXPECT_EQ(st.slots, 12u); // both of the larger ones go to the chunk storage
+    EXPECT_EQ(rcv.skip(3), 3u);
+    rand_buf buf {rcv.try_recv()};
+    ASSERT_FALSE(buf.empty());
+    EXPECT_EQ(buf.get_id(), 3);
+    EXPECT_EQ(rcv.skip_to_latest(), 8u);
+    EXPECT_EQ(rcv.lag().messages, 0u);
+    EXPECT_TRUE(rcv.try_recv().empty());
+    // a stalled receiver blocks the sender, until it skips the backlog
+    int i = 0;
+    while (que.try_send(rand_buf{msg_head{i}}, 0)) ++i;
+    EXPECT_GT(rcv.skip_to_latest(), 0u);
+    EXPECT_TRUE(que.try_send(rand_buf{msg_head{i}}, 0));
+    buf = rcv.try_recv();
+    ASSERT_FALSE(buf.empty());
+    EXPECT_EQ(buf.get_id(), i);
+}
+
+TEST(IPC, lag_skip) {
+    test_lag_skip<relat::single, relat::single, trans::unicast  >("ssu-lag");
+    test_lag_skip<relat::single, relat::multi , trans::broadcast>("smb-lag");
+    test_lag_skip<relat::multi , relat::multi , trans::broadcast>("mmb-lag");
+}
+
+struct skipping_hooks {
+    inline static std::function<void()> on_first_push;
+
+    static void on_push(ipc::hook_info const &) {
+        if (on_first_push) std::exchange(on_first_push, nullptr)();
+    }
+};
+
+TEST(IPC, skip_fragments) {
+    // a lossy ring always sends a large message as fragments
+    using que_t = chan<relat::single, relat::multi, trans::overwrite, skipping_hooks>;
+    que_t::clear_storage("skip-frag");
+    {
+        que_t que { "skip-frag", ipc::sender };
+        que_t rcv { que.name(), ipc::receiver };
+        // the receiver skips when only the first fragment has been pushed
+        skipping_hooks::on_first_push = [&rcv] { EXPECT_EQ(rcv.skip(1), 0u); };
+        std::vector<char> frag(ipc::data_length * 4, 'x');
+        ASSERT_TRUE(que.send(frag.data(), frag.size()));
+        ASSERT_TRUE(que.send(std::string{"next"}));
+        // the rest of the skipped message is dropped, not taken for a whole one
+        auto buf = rcv.try_recv();
+        ASSERT_FALSE(buf.empty());
+        EXPECT_STREQ(static_cast<char const *>(buf.data()), "next");
+        EXPECT_TRUE(rcv.try_recv().empty());
+    }
+    que_t::clear_storage("skip-frag");
+}
+
+#if !defined(LIBIPC_DISABLE_STATS)
+TEST(IPC, stats) {
+    using que_t = chan<relat::single, relat::multi, trans::broadcast>;
+    que_t::clear_storage("smb-stats");
+    {
+        que_t que { "smb-stats", ipc::sender };
+        que_t rcv { que.name(), ipc::receiver };
+        auto st = que.stats();
+        ASSERT_NE(st, nullptr);
+        ASSERT_NE(rcv.stats(), nullptr); // a mapping of its own, over the same block
+        EXPECT_EQ(rcv.stats()->connects.load(), 1u);
+        EXPECT_EQ(st->ring_size.load(), 256u);
+        EXPECT_EQ(st->connects.load(), 1u);
+        EXPECT_NE(st->connections.load(), 0u);
+        std::vector<char> big(ipc::large_msg_align * 2);
+        for (int i = 0; i < 10; ++i) {
+            ASSERT_TRUE(que.send(rand_buf{msg_head{i}}));
+        }
+        ASSERT_TRUE(que.send(big.data(), big.size()));
+        std::uint64_t sent = 0, bytes = 0, large = 0;
+        for (auto const & p : st->producers) {
+            sent  += p.messages.load();
+            bytes += p.bytes   .load();
+            large += p.large   .load();
+        }
+        EXPECT_EQ(sent, 11u);
+        EXPECT_EQ(bytes, 10 * sizeof(msg_head) + big.size());
+        EXPECT_EQ(large, 1u);
+        EXPECT_EQ(st->chunks.load(), 1u);
+        std::size_t claimed = 0;
+        for (auto const & p : st->producers) {
+            if (p.pid.load() != 0) ++claimed;
+        }
+        EXPECT_EQ(claimed, 1u);
+        std::uint64_t depth = 0, recv = 0;
+        for (auto const & r : st->receivers) {
+            if (r.pid.load() != 0) depth = (std::max)(depth, st->depth(r));
+        }
+        EXPECT_EQ(depth, 11u);
+        for (int i = 0; i < 11; ++i) {
+            ASSERT_FALSE(rcv.recv().empty());
+        }
+        for (auto const & r : st->receivers) {
+            recv += r.messages.load();
+            if (r.pid.load() != 0) {
+                EXPECT_EQ(st->depth(r), 0u);
+            }
+        }
+        EXPECT_EQ(recv, 11u);
+        EXPECT_EQ(st->chunks.load(), 0u);
+        // the slot of the producer is released, its pushes still count
+        auto pushed = st->pushed();
+        que.disconnect();
+        EXPECT_EQ(st->pushed(), pushed);
+        for (auto const & p : st->producers) {
+            EXPECT_EQ(p.pid.load(), 0u);
+        }
+        rcv.disconnect();
+        EXPECT_EQ(st->disconnects.load(), 1u);
+        EXPECT_EQ(st->connections.load(), 0u);
+    }
+    que_t::clear_storage("smb-stats");
+}
+
+TEST(IPC, latency) {
+    using hist_t = ipc::stats::histogram;
+    for (std::uint64_t v : {0ull, 7ull, 8ull, 15ull, 16ull, 1000ull, 123456789ull}) {
+        auto i = hist_t::index_of(v);
+        EXPECT_GE(hist_t::upper_of(i), v);
+        EXPECT_LE(hist_t::upper_of(i) - v, v / 8) << v;
+        if (i > 0) {
+            EXPECT_LT(hist_t::upper_of(i - 1), v);
+        }
+    }
+
+    using que_t = chan<relat::single, relat::multi, trans::broadcast>;
+    que_t::clear_storage("smb-latency");
+    {
+        que_t que { "smb-latency", ipc::sender };
+        que_t rcv { que.name(), ipc::receiver };
+        ASSERT_TRUE(que.send(rand_buf{msg_head{0}}));
+        ASSERT_FALSE(rcv.recv().empty());
+        EXPECT_EQ(que.latency().count, 0u); // not stamped
+
+        ASSERT_TRUE(rcv.set_timestamps());
+        std::vector<char> frag(ipc::data_length * 3 + 1);
+        for (int i = 0; i < 100; ++i) {
+            ASSERT_TRUE((i % 10 == 0) ? que.send(frag.data(), frag.size()) : que.send(rand_buf{msg_head{i}}));
+            ASSERT_FALSE(rcv.recv().empty());
+        }
+        auto ls = que.latency();
+        EXPECT_EQ(ls.count, 100u);
+        EXPECT_LE(ls.p50 , ls.p99);
+        EXPECT_LE(ls.p99 , ls.p999);
+        EXPECT_LE(ls.p999, ls.max);
+        EXPECT_LE(ls.mean, ls.max);
+        EXPECT_GT(ls.max , 0u);
+        printf("latency: p50 %llu ns, p99 %llu ns, p99.9 %llu ns, max %llu ns\n",
+               (unsigned long long)ls.p50, (unsigned long long)ls.p99, 
+               (unsigned long long)ls.p999, (unsigned long long)ls.max);
+    }
+    que_t::clear_storage("smb-latency");
+}
+#endif
+
+TEST(IPC, trace) {
+    using que_t = chan<relat::single, relat::multi, trans::broadcast>;
+    que_t::clear_storage("smb-trace");
+    char const path[] = "ipc-test-trace.json";
+    std::remove(path);
+    ipc::trace::clear();
+    ipc::trace::enable();
+    ASSERT_TRUE(ipc::trace::enabled());
+    {
+        que_t que { "smb-trace", ipc::sender };
+        que_t rcv { que.name(), ipc::receiver };
+        ASSERT_TRUE(que.send(rand_buf{msg_head{1}}));
+        ASSERT_FALSE(rcv.recv().empty());
+    }
+    ipc::trace::enable(false);
+    EXPECT_GE(ipc::trace::dump(path), 4u); // send, push, pop, recv
+    std::stringstream ss;
+    ss << std::ifstream{path}.rdbuf();
+    auto json = ss.str();
+    std::remove(path);
+    que_t::clear_storage("smb-trace");
+
+    EXPECT_EQ(json.compare(0, 2, "[\n"), 0);
+    for (char const *s : {"\"name\":\"send\"", "\"name\":\"recv\"", "\"name\":\"push\"", "\"name\":\"pop\"", 
+                          "\"ph\":\"s\"", "\"ph\":\"f\"", "\"channel\":\"smb-trace\""}) {
+        EXPECT_NE(json.find(s), std::string::npos) << s;
+    }
+    // the flow arrow starts and ends with the same id
+    auto id_of = [&json](char const *ph) {
+        auto p = json.find(ph);
+        if (p == std::string::npos) return std::string{};
+        auto b = json.find("\"id\":\"", p);
+        auto e = json.find('"', b + 6);
+        return json.substr(b + 6, e - b - 6);
+    };
+    EXPECT_FALSE(id_of("\"ph\":\"s\"").empty());
+    EXPECT_EQ(id_of("\"ph\":\"s\""), id_of("\"ph\":\"f\""));
+}
+
+struct counting_hooks {
+    inline static std::atomic<int> push {0}, pop {0}, full {0}, reassembly {0}, park {0}, wake {0};
+    inline static std::string channel;
+
+    static void on_push      (ipc::hook_info const & i) { ++push; channel = i.channel; }
+    static void on_pop       (ipc::hook_info const &  ) { ++pop; }
+    static void on_full      (ipc::hook_info const &  ) { ++full; }
+    static void on_reassembly(ipc::hook_info const & i) { reassembly += static_cast<int>(i.value); }
+    static void on_park      (ipc::hook_info const &  ) { ++park; }
+    static void on_wake      (ipc::hook_info const &  ) { ++wake; }
+};
+
+TEST(IPC, hooks) {
+    static_assert(ipc::detail::hook_dispatch<ipc::no_hooks>::mask == 0, "no_hooks");
+    static_assert(ipc::detail::hook_dispatch<counting_hooks>::mask == 
+                  (0x7f & ~ipc::hook_bit(ipc::hook_event::force_push)), "counting_hooks");
+
+    using que_t = chan<relat::single, relat::multi, trans::overwrite, counting_hooks>;
+    que_t::clear_storage("hooks");
+    {
+        que_t que { "hooks", ipc::sender };
+        que_t rcv { que.name(), ipc::receiver };
+        // a slot holds about 100 bytes of a fragment (see msg_t)
+        std::vector<char> frag(ipc::data_length * 2 + 1);
+        ASSERT_TRUE(que.send(frag.data(), frag.size()));
+        EXPECT_EQ(counting_hooks::push, 2);
+        EXPECT_EQ(counting_hooks::channel, "hooks");
+        ASSERT_EQ(rcv.recv().size(), frag.size());
+        EXPECT_EQ(counting_hooks::pop, 2);
+        EXPECT_EQ(counting_hooks::reassembly, static_cast<int>(frag.size()));
+        EXPECT_TRUE(rcv.recv(10).empty());
+        EXPECT_GE(counting_hooks::park, 1);
+        EXPECT_EQ(counting_hooks::park, counting_hooks::wake);
+    }
+    que_t::clear_storage("hooks");
+
+    using ful_t = chan<relat::single, relat::single, trans::unicast, counting_hooks>;
+    ful_t::clear_storage("hooks-full");
+    {
+        ful_t que { "hooks-full", ipc::sender };
+        ful_t rcv { que.name(), ipc::receiver };
+        while (que.try_send(rand_buf{msg_head{0}}, 0)) ;
+        EXPECT_EQ(counting_hooks::full, 1);
+    }
+    ful_t::clear_storage("hooks-full");
+}
+
+TEST(IPC, overwrite) {
+    ipc::telemetry que { "telemetry", ipc::sender };
+    ipc::telemetry rcv { que.name(), ipc::receiver };
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(que.send(rand_buf{msg_head{i}}, 0));
+    }
+    rand_buf buf {rcv.try_recv()};
+    ASSERT_FALSE(buf.empty());
+    int first = buf.get_id();
+    EXPECT_GT(first, 0);
+    EXPECT_EQ(rcv.lost_count(), static_cast<std::uint64_t>(first));
+    for (int i = first + 1; i < 1000; ++i) {
+        buf = rcv.try_recv();
+        ASSERT_FALSE(buf.empty());
+        EXPECT_EQ(buf.get_id(), i);
+    }
+    EXPECT_TRUE(rcv.try_recv().empty());
+    // a large message goes as fragments, and comes back in one piece
+    std::vector<char> big(ipc::large_msg_limit * 4);
+    for (std::size_t i = 0; i < big.size(); ++i) big[i] = static_cast<char>(i);
+    ASSERT_TRUE(que.send(big.data(), big.size(), 0));
+    buf = rcv.try_recv();
+    ASSERT_EQ(buf.size(), big.size());
+    EXPECT_EQ(std::memcmp(buf.data(), big.data(), big.size()), 0);
+    EXPECT_EQ(rcv.lost_count(), static_cast<std::uint64_t>(first));
+}
+
+#ifdef IPC_OS_LINUX_
+TEST(IPC, dead_receiver) {
+    test_dead_receiver<relat::single, relat::multi , trans::broadcast>("smb-dead");
+    test_dead_receiver<relat::multi , relat::multi , trans::broadcast>("mmb-dead");
+}
+
+TEST(IPC, ready_fd) {
+    using chan_t = chan<relat::single, relat::multi, trans::broadcast>;
+    chan_t::clear_storage("ready-fd");
+    chan_t que {"ready-fd", ipc::sender};
+    chan_t rcv {"ready-fd", ipc::receiver};
+    EXPECT_EQ(que.ready_fd(), -1);
+    int fd = rcv.ready_fd();
+    ASSERT_NE(fd, -1);
+    EXPECT_EQ(rcv.ready_fd(), fd);
+    auto readable = [fd](int ms) {
+        pollfd pfd {fd, POLLIN, 0};
+        return ::poll(&pfd, 1, ms) == 1;
+    };
+    auto drain_fd = [fd] {
+        char c;
+        while (::recv(fd, &c, 1, MSG_DONTWAIT) > 0) ;
+    };
+    // readable at first, until a try_recv finds nothing
+    EXPECT_TRUE(readable(0));
+    EXPECT_TRUE(rcv.try_recv().empty());
+    EXPECT_FALSE(readable(0));
+    ASSERT_TRUE(que.send(rand_buf{msg_head{0}}, 0));
+    EXPECT_TRUE(readable(0));
+    rand_buf buf {rcv.try_recv()};
+    EXPECT_EQ(buf.get_id(), 0);
+    // not parked: the senders don't signal
+    drain_fd();
+    ASSERT_TRUE(que.send(rand_buf{msg_head{1}}, 0));
+    EXPECT_FALSE(readable(0));
+    buf = rcv.try_recv();
+    EXPECT_EQ(buf.get_id(), 1);
+    EXPECT_TRUE(rcv.try_recv().empty());
+    // an event loop
+    std::thread sender {[&que] {
+        for (int i = 2; i < 1000; ++i) {
+            while (!que.send(rand_buf{msg_head{i}})) ;
+        }
+    }};
+    int n = 2;
+    while (n < 1000) {
+        ASSERT_TRUE(readable(5000));
+        for (buf = rcv.try_recv(); !buf.empty(); buf = rcv.try_recv()) {
+            EXPECT_EQ(buf.get_id(), n);
+            ++n;
+        }
+    }
+    sender.join();
+    EXPECT_FALSE(readable(0));
+    // the select of another receiver shares the table with the fd, a push wakes both
+    chan_t rcv2 {"ready-fd", ipc::receiver};
+    ipc::select sel;
+    ASSERT_NE(sel.add(rcv2), ipc::invalid_value);
+    EXPECT_TRUE(sel.try_recv().empty());
+    ASSERT_TRUE(que.send(rand_buf{msg_head{1000}}, 0));
+    EXPECT_TRUE(readable(1000));
+    EXPECT_EQ(sel.wait(1000).size(), 1u);
+    buf = rcv.try_recv();
+    EXPECT_EQ(buf.get_id(), 1000);
+    buf = rcv2.try_recv();
+    EXPECT_EQ(buf.get_id(), 1000);
+    rcv.disconnect();
+    EXPECT_EQ(rcv.ready_fd(), -1);
+}
+#endif
+
+TEST(IPC, select) {
+    using chan_t = chan<relat::single, relat::multi, trans::broadcast>;
+    constexpr int count = 3;
+    std::vector<std::unique_ptr<chan_t>> ques, rcvs;
+    ipc::select sel;
+    for (int k = 0; k < count; ++k) {
+        auto name = "select-" + std::to_string(k);
+        chan_t::clear_storage(name.c_str());
+        ques.emplace_back(new chan_t{name.c_str(), ipc::sender});
+        rcvs.emplace_back(new chan_t{name.c_str(), ipc::receiver});
+        EXPECT_EQ(sel.add(*rcvs.back()), static_cast<std::size_t>(k));
+    }
+    EXPECT_EQ(sel.add(*ques.front()), ipc::invalid_value);
+    EXPECT_EQ(sel.size(), static_cast<std::size_t>(count));
+    std::size_t index = ipc::invalid_value;
+    EXPECT_TRUE(sel.try_recv(&index).empty());
+    EXPECT_TRUE(sel.recv(&index, 10).empty());
+    // a flooding channel doesn't starve the others
+    for (int i = 0; i < 10; ++i) ASSERT_TRUE(ques[0]->send(rand_buf{msg_head{i}}, 0));
+    ASSERT_TRUE(ques[2]->send(rand_buf{msg_head{100}}, 0));
+    rand_buf buf {sel.recv(&index, 0)};
+    EXPECT_EQ(index, 0u);
+    EXPECT_EQ(buf.get_id(), 0);
+    buf = sel.recv(&index, 0);
+    EXPECT_EQ(index, 2u);
+    EXPECT_EQ(buf.get_id(), 100);
+    for (int i = 1; i < 10; ++i) {
+        buf = sel.recv(&index, 0);
+        EXPECT_EQ(index, 0u);
+        EXPECT_EQ(buf.get_id(), i);
+    }
+    EXPECT_TRUE(sel.try_recv(&index).empty());
+    // parked once, woken by any of them
+    std::thread sender {[&ques] {
+        for (int i = 0; i < 300; ++i) {
+            while (!ques[i % count]->send(rand_buf{msg_head{i}})) ;
+            if (i % 50 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }};
+    int next[count] = {0, 1, 2};
+    for (int n = 0; n < 300; ++n) {
+        buf = sel.recv(&index, 5000);
+        ASSERT_FALSE(buf.empty());
+        ASSERT_LT(index, static_cast<std::size_t>(count));
+        EXPECT_EQ(buf.get_id(), next[index]);
+        next[index] += count;
+    }
+    sender.join();
+    EXPECT_TRUE(sel.try_recv(&index).empty());
+    // wait returns the ready channels, which are drained by the caller
+    ASSERT_TRUE(ques[1]->send(rand_buf{msg_head{7}}, 0));
+    auto ready = sel.wait(1000);
+    ASSERT_EQ(ready.size(), 1u);
+    EXPECT_EQ(ready[0], 1u);
+    buf = rcvs[1]->try_recv();
+    EXPECT_EQ(buf.get_id(), 7);
+    EXPECT_TRUE(rcvs[1]->try_recv().empty());
+    EXPECT_TRUE(sel.wait(10).empty());
+    EXPECT_TRUE(sel.remove(1));
+    EXPECT_FALSE(sel.remove(1));
+    ASSERT_TRUE(ques[1]->send(rand_buf{msg_head{8}}, 0));
+    EXPECT_TRUE(sel.wait(10).empty());
+    EXPECT_EQ(sel.size(), static_cast<std::size_t>(count - 1));
+}
+
 TEST(IPC, NvN) {
     //test_sr<relat::multi , relat::multi , trans::unicast  >("mmu", MultiMax, MultiMax);
     test_sr<relat::multi , relat::multi , trans::broadcast>("mmb", MultiMax, MultiMax);
@@ -0,0 +1,102 @@
+#include <cstring>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <chrono>
+
+#include "libipc/log.h"
+#include "libipc/utility/log.h"
+
+#include "test.h"
+
+namespace {
+
+std::mutex lock__;
+std::vector<std::pair<ipc::log_level, std::string>> records__;
+
+void capture(ipc::log_level lv, char const * msg, std::size_t len) {
+    std::lock_guard<std::mutex> guard {lock__};
+    records__.emplace_back(lv, std::string(msg, len));
+}
+
+std::vector<std::pair<ipc::log_level, std::string>> take() {
+    ipc::flush_log();
+    std::lock_guard<std::mutex> guard {lock__};
+    return std::move(records__);
+}
+
+struct sink_guard {
+    sink_guard() {
+        ipc::set_log_sink(capture);
+        take();
+    }
+    ~sink_guard() {
+        ipc::set_log_sink(nullptr);
+        ipc::set_log_rate_limit(100);
+    }
+};
+
+} // internal-linkage
+
+TEST(Log, deferred) {
+    sink_guard guard;
+    char name[] = "hello";
+    ipc::error("fail: %s, %d, %zd\n", name, 42, std::size_t(7));
+    std::strcpy(name, "XXXXX"); // the string has been copied
+    ipc::log("no arguments: %d\n");
+    auto rs = take();
+    ASSERT_EQ(rs.size(), 2u);
+    EXPECT_EQ(rs[0].first , ipc::log_level::error);
+    EXPECT_EQ(rs[0].second, "fail: hello, 42, 7\n");
+    EXPECT_EQ(rs[1].first , ipc::log_level::info);
+    EXPECT_EQ(rs[1].second, "no arguments: %d\n");
+}
+
+TEST(Log, rate_limit) {
+    sink_guard guard;
+    ipc::set_log_rate_limit(5);
+    // all in the same second, as long as it doesn't roll over in between
+    auto sec = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch());
+    for (int i = 0; i < 100; ++i) {
+        ipc::log("rate_limit %d\n", i);
+    }
+    auto rs = take();
+    if (sec != std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch())) {
+        return;
+    }
+    ASSERT_EQ(rs.size(), 5u);
+    EXPECT_EQ(rs[4].second, "rate_limit 4\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    ipc::log("rate_limit %d\n", 100);
+    rs = take();
+    ASSERT_EQ(rs.size(), 2u);
+    EXPECT_EQ(rs[0].first , ipc::log_level::warn);
+    EXPECT_EQ(rs[0].second, "[ipc] 95 records suppressed: rate_limit %d\n");
+    EXPECT_EQ(rs[1].second, "rate_limit 100\n");
+}
+
+TEST(Log, multi_thread) {
+    sink_guard guard;
+    ipc::set_log_rate_limit(0);
+    std::vector<std::thread> ths;
+    for (int t = 0; t < 4; ++t) {
+        ths.emplace_back([t] {
+            for (int i = 0; i < 100; ++i) {
+                ipc::log("thread %d: %d\n", t, i);
+                if (i % 10 == 0) ipc::flush_log();
+            }
+        });
+    }
+    for (auto &th : ths) th.join();
+    auto rs = take();
+    EXPECT_EQ(rs.size() + ipc::log_dropped(), 400u);
+    // the records of a thread keep their order
+    std::vector<int> last(4, -1);
+    for (auto const & r : rs) {
+        int t = 0, i = 0;
+        ASSERT_EQ(std::sscanf(r.second.c_str(), "thread %d: %d", &t, &i), 2);
+        EXPECT_GT(i, last[t]);
+        last[t] = i;
+    }
+}
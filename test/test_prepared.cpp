@@ -0,0 +1,142 @@
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "libipc/ipc.h"
+#include "libipc/prepared.h"
+
+#include "test.h"
+
+namespace {
+
+std::string to_string(ipc::buff_t const & buf) {
+    return buf.empty() ? std::string{} : std::string{static_cast<char const *>(buf.data())};
+}
+
+} // internal-linkage
+
+TEST(Prepared, route) {
+    constexpr int count = 10000;
+    ipc::route::clear_storage("prepared-route");
+    ipc::route que {"prepared-route"};
+    ipc::route rcv {"prepared-route", ipc::receiver};
+    ipc::prepared_sender   snd {que};
+    ipc::prepared_receiver pr  {rcv};
+    ASSERT_TRUE(snd.valid());
+    ASSERT_TRUE(pr.valid());
+    EXPECT_TRUE(pr.try_recv().empty());
+
+    std::atomic<int> errors {0};
+    std::thread t {[&] {
+        for (int i = 0; i < count; ++i) {
+            if (to_string(pr.recv(5000)) != std::to_string(i)) ++errors;
+        }
+    }};
+    for (int i = 0; i < count; ++i) {
+        bool ok = (i % 2 == 0) ? snd.send(std::to_string(i), 5000) : snd.try_send(std::to_string(i), 5000);
+        if (!ok) ++errors;
+    }
+    t.join();
+    EXPECT_EQ(errors, 0);
+
+    // a large message goes through the chunk storage as usual
+    std::string big(ipc::large_msg_align * 2, 'x');
+    ASSERT_TRUE(snd.send(big));
+    EXPECT_EQ(to_string(pr.recv(100)), big);
+    // the channel itself is still usable
+    ASSERT_TRUE(que.send(std::string{"plain"}));
+    EXPECT_EQ(to_string(pr.try_recv()), "plain");
+}
+
+TEST(Prepared, invalid) {
+    ipc::channel::clear_storage("prepared-invalid");
+    ipc::channel que {"prepared-invalid"};
+    // not a receiver
+    ipc::prepared_receiver pr {que};
+    EXPECT_FALSE(pr.valid());
+    EXPECT_TRUE(pr.try_recv().empty());
+    ipc::prepared_sender<ipc::wr<ipc::relat::multi, ipc::relat::multi, ipc::trans::broadcast>> snd;
+    EXPECT_FALSE(snd.valid());
+    EXPECT_FALSE(snd.send(std::string{"x"}));
+
+    // to self: ignored like chan_wrapper::recv
+    ipc::channel both {"prepared-invalid", ipc::sender | ipc::receiver};
+    ASSERT_TRUE(snd.prepare(both));
+    ASSERT_TRUE(pr.prepare(both));
+    ipc::channel rcv {"prepared-invalid", ipc::receiver};
+    ASSERT_TRUE(snd.send(std::string{"self"}));
+    EXPECT_TRUE(pr.try_recv().empty());
+    EXPECT_EQ(to_string(rcv.recv(100)), "self");
+}
+
+TEST(Prepared, stale) {
+    ipc::route::clear_storage("prepared-stale");
+    ipc::route que {"prepared-stale"};
+    ipc::route rcv {"prepared-stale", ipc::receiver};
+    ipc::prepared_sender   snd {que};
+    ipc::prepared_receiver pr  {rcv};
+    // prepared with the default policy, which would disconnect the receiver
+    que.set_overflow(ipc::overflow::reject);
+    int sent = 0;
+    while (snd.send(std::to_string(sent), 0)) ++sent;
+    EXPECT_GT(sent, 0);
+    EXPECT_EQ(que.recv_count(), 1u);
+    EXPECT_EQ(que.overflow_counters().rejected, 1u);
+    for (int i = 0; i < sent; ++i) {
+        EXPECT_EQ(to_string(pr.recv(100)), std::to_string(i));
+    }
+
+    // a new connection of the receiver, with another stats slot
+    rcv.disconnect();
+    EXPECT_TRUE(pr.try_recv().empty());
+    ASSERT_TRUE(rcv.reconnect(ipc::receiver));
+    ASSERT_TRUE(snd.send(std::string{"again"}));
+    EXPECT_EQ(to_string(pr.recv(100)), "again");
+
+    // the sender has released its stats slot, it's claimed again like a send of the channel would
+    que.disconnect();
+    ASSERT_TRUE(snd.send(std::string{"back"}));
+    ASSERT_TRUE(snd.try_send(std::string{"back"}));
+    EXPECT_EQ(to_string(pr.recv(100)), "back");
+    EXPECT_EQ(to_string(pr.recv(100)), "back");
+    ASSERT_TRUE(snd.prepare(que));
+    ASSERT_TRUE(snd.send(std::string{"prepared"}));
+    EXPECT_EQ(to_string(pr.recv(100)), "prepared");
+}
+
+TEST(Prepared, inproc) {
+    ipc::channel que {"inproc://prepared"};
+    ipc::channel rcv {"inproc://prepared", ipc::receiver};
+    ipc::prepared_sender   snd {que};
+    ipc::prepared_receiver pr  {rcv};
+    ASSERT_TRUE(snd.send(std::string{"local"}));
+    EXPECT_EQ(to_string(pr.recv(100)), "local");
+}
+
+TEST(Prepared, overflow) {
+    ipc::route::clear_storage("prepared-overflow");
+    ipc::route que {"prepared-overflow"};
+    ipc::route rcv {"prepared-overflow", ipc::receiver};
+    ipc::prepared_receiver pr {rcv};
+
+    // the policy is taken by 'prepare'
+    que.set_overflow(ipc::overflow::reject);
+    ipc::prepared_sender snd {que};
+    ASSERT_TRUE(snd.valid());
+    int sent = 0;
+    while ((sent < 1000) && snd.send(std::to_string(sent), 0)) ++sent;
+    EXPECT_GT(sent, 0);
+    EXPECT_LT(sent, 1000);
+    EXPECT_EQ(que.overflow_counters().rejected, 1u);
+
+    que.set_overflow(ipc::overflow::drop);
+    ASSERT_TRUE(snd.prepare(que));
+    EXPECT_TRUE(snd.send(std::string{"dropped"}, 0));
+    EXPECT_EQ(que.overflow_counters().dropped, 1u);
+
+    for (int i = 0; i < sent; ++i) {
+        ASSERT_EQ(to_string(pr.recv(100)), std::to_string(i));
+    }
+    EXPECT_TRUE(pr.try_recv().empty());
+}
@@ -303,6 +303,65 @@ TEST(Queue, prod_cons_NvN_broadcast) {
     }
 }
 
+TEST(Queue, overwrite) {
+    using el_t  = elems_t<ipc::relat::single, ipc::relat::multi, ipc::trans::overwrite>;
+    using que_t = queue_t<ipc::relat::single, ipc::relat::multi, ipc::trans::overwrite>;
+    constexpr int keep = static_cast<int>(el_t::elem_max) - 1;
+    {
+        el_t el;
+        que_t que {&el};
+        que_t rd  {&el};
+        ASSERT_TRUE(rd.connect());
+        ASSERT_TRUE(que.ready_sending());
+        // never blocks, whether the reader has read or not
+        for (int i = 0; i < 1000; ++i) {
+            ASSERT_TRUE(que.push([](void*) { return true; }, i, i));
+        }
+        msg_t msg;
+        ASSERT_TRUE(rd.pop(msg));
+        EXPECT_EQ(msg.dat_, 1000 - keep);
+        EXPECT_EQ(rd.lost(), static_cast<std::uint64_t>(1000 - keep));
+        int expect = msg.dat_ + 1;
+        while (rd.pop(msg)) {
+            EXPECT_EQ(msg.dat_, expect++);
+        }
+        EXPECT_EQ(expect, 1000);
+        EXPECT_EQ(rd.lost(), static_cast<std::uint64_t>(1000 - keep));
+    }
+    for (int r_cnt = 1; r_cnt <= ThreadMax; r_cnt *= 2) {
+        el_t el;
+        ipc_ut::reader().start(static_cast<std::size_t>(r_cnt));
+        for (int k = 0; k < r_cnt; ++k) {
+            ipc_ut::reader() << [&el] {
+                que_t que {&el};
+                ASSERT_TRUE(que.connect());
+                std::uint64_t got = 0;
+                int last = -1;
+                for (;;) {
+                    msg_t msg = pop(que);
+                    if (msg.pid_ < 0) break;
+                    // a torn slot would never pass the sequence check
+                    ASSERT_EQ(msg.pid_, msg.dat_);
+                    ASSERT_GT(msg.dat_, last);
+                    last = msg.dat_;
+                    ++got;
+                }
+                EXPECT_EQ(got + que.lost(), static_cast<std::uint64_t>(LoopCount));
+                ASSERT_TRUE(que.disconnect());
+            };
+        }
+        que_t que {&el};
+        while (que.conn_count() != static_cast<std::size_t>(r_cnt)) {
+            std::this_thread::yield();
+        }
+        for (int i = 0; i < LoopCount; ++i) {
+            ASSERT_TRUE(que.push([](void*) { return true; }, i, i));
+        }
+        ASSERT_TRUE(que.push([](void*) { return true; }, -1, -1));
+        ipc_ut::reader().wait_for_done();
+    }
+}
+
 TEST(Queue, clear) {
     queue_t<ipc::relat::single, ipc::relat::single, ipc::trans::unicast> que{"test-queue-clear"};
     EXPECT_TRUE(ipc_ut::expect_exist("test-queue-clear", true));
@@ -0,0 +1,163 @@
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "libipc/rpc.h"
+
+#include "test.h"
+
+namespace {
+
+ipc::buff_t make_buff(std::string const & str) {
+    auto p = new char[str.size() + 1];
+    std::memcpy(p, str.c_str(), str.size() + 1);
+    return {p, str.size() + 1, [](void * p, std::size_t) { delete [] static_cast<char *>(p); }};
+}
+
+std::string to_string(ipc::buff_t const & buf) {
+    return buf.empty() ? std::string{} : std::string{static_cast<char const *>(buf.data())};
+}
+
+// Echoes "re:" + the request, after sleeping for the requests starting with "sleep".
+ipc::buff_t echo(void const * data, std::size_t size) {
+    std::string req {static_cast<char const *>(data), size - 1};
+    if (req.compare(0, 5, "sleep") == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    return make_buff("re:" + req);
+}
+
+} // internal-linkage
+
+TEST(RPC, request) {
+    ipc::rpc::server::clear_storage("rpc-echo");
+    ipc::rpc::server srv {"rpc-echo", echo};
+    ASSERT_TRUE(srv.valid());
+    std::thread serving {[&srv] { srv.run(); }};
+
+    std::vector<std::thread> clients;
+    std::atomic<int> errors {0};
+    for (int k = 0; k < 2; ++k) {
+        clients.emplace_back([k, &errors] {
+            ipc::rpc::client cli {"rpc-echo"};
+            if (!cli.valid()) {
+                ++errors;
+                return;
+            }
+            // a round trip at a time
+            for (int i = 0; i < 200; ++i) {
+                auto req = std::to_string(k) + "-" + std::to_string(i);
+                if (to_string(cli.request(req, 1000)) != ("re:" + req)) ++errors;
+            }
+            // pipelined
+            std::vector<std::future<ipc::rpc::client::result_t>> futures;
+            for (int i = 0; i < 200; ++i) {
+                auto req = "f" + std::to_string(k) + "-" + std::to_string(i);
+                futures.push_back(cli.call(req.c_str(), req.size() + 1, 5000));
+            }
+            for (int i = 0; i < 200; ++i) {
+                auto req = "f" + std::to_string(k) + "-" + std::to_string(i);
+                auto r = futures[i].get();
+                if ((r.first != ipc::rpc::status::ok) || (to_string(r.second) != ("re:" + req))) ++errors;
+            }
+            std::atomic<int> done {0};
+            for (int i = 0; i < 100; ++i) {
+                auto req = "c" + std::to_string(i);
+                cli.call(req.c_str(), req.size() + 1, [&done, &errors, req](ipc::rpc::status st, ipc::buff_t reply) {
+                    if ((st != ipc::rpc::status::ok) || (to_string(reply) != ("re:" + req))) ++errors;
+                    ++done;
+                }, 5000);
+            }
+            for (int i = 0; (i < 5000) && (done < 100); ++i) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            if (done != 100) ++errors;
+            if (cli.in_flight() != 0) ++errors;
+        });
+    }
+    for (auto & t : clients) t.join();
+    EXPECT_EQ(errors, 0);
+
+    // without a reply thread
+    {
+        ipc::rpc::client cli {"rpc-echo", false};
+        ASSERT_TRUE(cli.valid());
+        EXPECT_EQ(to_string(cli.request(std::string{"inline"}, 1000)), "re:inline");
+        std::atomic<ipc::rpc::status> st {ipc::rpc::status::failed};
+        cli.call("x", 2, [&st](ipc::rpc::status s, ipc::buff_t) { st = s; }, 1000);
+        EXPECT_EQ(cli.in_flight(), 1u);
+        for (int i = 0; (i < 100) && (cli.in_flight() != 0); ++i) cli.poll(10);
+        EXPECT_EQ(st, ipc::rpc::status::ok);
+    }
+
+    // the deadlines
+    {
+        ipc::rpc::client cli {"rpc-echo"};
+        std::atomic<int> timed_out {0};
+        cli.call("sleep", 6, [&timed_out](ipc::rpc::status s, ipc::buff_t reply) {
+            timed_out = ((s == ipc::rpc::status::timeout) && reply.empty()) ? 1 : -1;
+        }, 10);
+        EXPECT_TRUE(cli.request(std::string{"sleep2"}, 10).empty());
+        for (int i = 0; (i < 1000) && (timed_out == 0); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        EXPECT_EQ(timed_out, 1);
+        auto f = cli.call("sleep", 6, 10);
+        EXPECT_EQ(f.get().first, ipc::rpc::status::timeout);
+        // the late replies are dropped, the next one is still its own
+        EXPECT_EQ(to_string(cli.request(std::string{"after"}, 1000)), "re:after");
+    }
+
+    srv.stop();
+    serving.join();
+}
+
+TEST(RPC, no_server) {
+    ipc::rpc::server::clear_storage("rpc-none");
+    ipc::rpc::client cli {"rpc-none"};
+    std::atomic<int> failed {0};
+    cli.call("x", 2, [&failed](ipc::rpc::status s, ipc::buff_t) {
+        failed = (s == ipc::rpc::status::failed) ? 1 : -1;
+    }, 10);
+    EXPECT_EQ(failed, 1);
+    EXPECT_EQ(cli.in_flight(), 0u);
+    auto f = cli.call("x", 2, 10);
+    EXPECT_EQ(f.get().first, ipc::rpc::status::failed);
+}
+
+TEST(RPC, burst) {
+    ipc::rpc::server::clear_storage("rpc-burst");
+    ipc::rpc::server srv {"rpc-burst", echo};
+    ASSERT_TRUE(srv.valid());
+    std::thread serving {[&srv] { srv.run(); }};
+    {
+        // more calls in flight than the reply ring holds, nobody receives the replies meanwhile
+        constexpr int count = 400;
+        ipc::rpc::client cli {"rpc-burst", false};
+        ASSERT_TRUE(cli.valid());
+        std::atomic<int> ok {0}, timed_out {0};
+        for (int i = 0; i < count; ++i) {
+            auto req = std::to_string(i);
+            cli.call(req.c_str(), req.size() + 1, [&ok, &timed_out, req](ipc::rpc::status st, ipc::buff_t reply) {
+                if ((st == ipc::rpc::status::ok) && (to_string(reply) == ("re:" + req))) ++ok;
+                else if (st == ipc::rpc::status::timeout) ++timed_out;
+            }, 1000);
+        }
+        // the server gives up on the replies which find the ring full for a while
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        for (int i = 0; (i < 1000) && (cli.in_flight() != 0); ++i) cli.poll(10);
+        EXPECT_EQ(cli.in_flight(), 0u);
+        EXPECT_EQ(ok + timed_out, count);
+        EXPECT_GT(ok, 0);
+        EXPECT_GT(srv.dropped_replies(), 0u);
+        // only the replies which didn't fit are lost, the client still works
+        EXPECT_EQ(to_string(cli.request(std::string{"after"}, 1000)), "re:after");
+    }
+    srv.stop();
+    serving.join();
+}
@@ -131,4 +131,23 @@ TEST(SHM, remove) {
     }
 }
 
+#ifdef IPC_OS_LINUX_
+TEST(SHM, numa) {
+    handle shm_hd;
+    EXPECT_TRUE(shm_hd.acquire("numa-test", 4096 * 4, {ipc::shm::numa::local}));
+    std::memset(shm_hd.get(), 1, shm_hd.size());
+
+    std::size_t pages[ipc::shm::numa_max_nodes] {};
+    std::size_t total = shm_hd.numa_residency(pages, ipc::shm::numa_max_nodes);
+    EXPECT_GE(total, 4u);
+    std::size_t sum = 0;
+    for (auto n : pages) sum += n;
+    EXPECT_EQ(sum, total);
+
+    EXPECT_TRUE(shm_hd.set_numa({ipc::shm::numa::interleave}));
+    EXPECT_FALSE(shm_hd.set_numa({ipc::shm::numa::bind})); // no node
+    shm_hd.clear();
+}
+#endif
+
 } // internal-linkage
@@ -0,0 +1,115 @@
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "libipc/ipc.h"
+#include "libipc/typed_chan.h"
+
+#include "test.h"
+
+namespace {
+
+struct tick {
+    std::uint64_t id;
+    double        bid;
+    double        ask;
+};
+
+struct wide {
+    std::uint32_t seq;
+    char          text[196];
+};
+
+using tick_route = ipc::typed_chan<tick>;
+
+} // internal-linkage
+
+static_assert(ipc::detail::slot_size_of(sizeof(tick)) == 32, "a tick takes a 32-byte slot");
+static_assert(ipc::detail::slot_size_of(sizeof(wide)) == 256, "a wide takes a 256-byte slot");
+
+TEST(TypedChan, route) {
+    constexpr int count = 10000;
+    tick_route::clear_storage("typed-route");
+    ipc::route::clear_storage("typed-route");
+    tick_route que {"typed-route"};
+    tick_route r1  {"typed-route", ipc::receiver};
+    tick_route r2  {"typed-route", ipc::receiver};
+    ASSERT_TRUE(que.valid());
+    EXPECT_EQ(que.recv_count(), 2u);
+
+    std::atomic<int> errors {0};
+    auto recv = [&errors](tick_route & rcv) {
+        for (int i = 0; i < count; ++i) {
+            tick t {};
+            if (!rcv.recv(t, 5000) || (t.id != std::uint64_t(i)) || (t.bid != i * 0.5) || (t.ask != i * 0.25)) ++errors;
+        }
+    };
+    std::thread t1 {recv, std::ref(r1)};
+    std::thread t2 {recv, std::ref(r2)};
+    for (int i = 0; i < count; ++i) {
+        bool ok = (i % 2 == 0) ? que.send(tick{std::uint64_t(i), i * 0.5, i * 0.25}, 5000)
+                               : que.emplace(std::uint64_t(i), i * 0.5, i * 0.25);
+        if (!ok) ++errors;
+    }
+    t1.join();
+    t2.join();
+    EXPECT_EQ(errors, 0);
+    tick t {};
+    EXPECT_FALSE(r1.try_recv(t));
+
+    // the byte channel of the same name is another ring
+    ipc::route bytes {"typed-route", ipc::receiver};
+    ASSERT_TRUE(que.send(tick{1, 2, 3}));
+    EXPECT_TRUE(bytes.try_recv().empty());
+    ASSERT_TRUE(r1.recv(t, 100));
+    EXPECT_EQ(t.id, 1u);
+    // with stats of its own
+    ASSERT_NE(que.stats(), nullptr);
+    ASSERT_NE(bytes.stats(), nullptr);
+    EXPECT_EQ(que  .stats()->connects.load(), 2u);
+    EXPECT_EQ(bytes.stats()->connects.load(), 1u);
+}
+
+TEST(TypedChan, unicast) {
+    using chan_t = ipc::typed_chan<wide, ipc::wr<ipc::relat::single, ipc::relat::single, ipc::trans::unicast>>;
+    chan_t::clear_storage("typed-unicast");
+    chan_t que {"typed-unicast"};
+    chan_t rcv {"typed-unicast", ipc::receiver};
+    wide w {};
+    EXPECT_FALSE(rcv.try_recv(w));
+    // a full ring fails a try_send
+    std::uint32_t sent = 0;
+    while (que.try_send(wide{sent, "x"}, 0)) ++sent;
+    EXPECT_GT(sent, 0u);
+    for (std::uint32_t i = 0; i < sent; ++i) {
+        ASSERT_TRUE(rcv.recv(w, 100));
+        EXPECT_EQ(w.seq, i);
+        EXPECT_STREQ(w.text, "x");
+    }
+    EXPECT_FALSE(rcv.try_recv(w));
+    // no in-process transport
+    chan_t local {"inproc://typed"};
+    EXPECT_FALSE(local.valid());
+}
+
+TEST(TypedChan, overwrite) {
+    using chan_t = ipc::typed_chan<std::uint64_t, ipc::wr<ipc::relat::single, ipc::relat::multi, ipc::trans::overwrite>>;
+    chan_t::clear_storage("typed-overwrite");
+    chan_t que {"typed-overwrite"};
+    chan_t rcv {"typed-overwrite", ipc::receiver};
+    for (std::uint64_t i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(que.send(i));
+    }
+    // the oldest ones have been overwritten, the rest keep the order
+    std::uint64_t v = 0, last = 0, n = 0;
+    while (rcv.try_recv(v)) {
+        if (n++ != 0) {
+            EXPECT_EQ(v, last + 1);
+        }
+        last = v;
+    }
+    EXPECT_GT(n, 0u);
+    EXPECT_LT(n, 1000u);
+    EXPECT_EQ(last, 999u);
+}
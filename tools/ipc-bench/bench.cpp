@@ -0,0 +1,267 @@
+#include <sys/prctl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sched.h>
+#include <time.h>
+
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <cctype>
+
+#include "bench.h"
+
+namespace bench {
+
+std::uint64_t now_ns() noexcept {
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<std::uint64_t>(ts.tv_nsec);
+}
+
+std::uint64_t process_cpu_ns() noexcept {
+    struct timespec ts;
+    ::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<std::uint64_t>(ts.tv_nsec);
+}
+
+std::string channel_name() {
+    static unsigned id = 0;
+    return "ipc-bench-" + std::to_string(::getpid()) + "-" + std::to_string(id++);
+}
+
+int spawn(std::vector<std::string> args) {
+    std::vector<char *> argv;
+    for (auto & s : args) argv.push_back(&s[0]);
+    argv.push_back(nullptr);
+    auto parent = ::getpid();
+    auto pid = ::fork();
+    if (pid == 0) {
+        ::prctl(PR_SET_PDEATHSIG, SIGKILL);
+        if (::getppid() != parent) ::_exit(1);
+        ::execv(argv[0], argv.data());
+        ::_exit(127);
+    }
+    return (pid < 0) ? 0 : pid;
+}
+
+result make_result(config const & cfg) {
+    result r;
+    r.variant   = cfg.processes ? ((cfg.kill_ms != 0) ? "proc+kill" : "proc") : "";
+    if (cfg.rate > 0) {
+        if (!r.variant.empty()) r.variant += "/";
+        r.variant  += (cfg.poisson ? "poisson@" : "fixed@") + human(cfg.rate);
+    }
+    r.name      = cfg.mode + "/" + std::to_string(cfg.producers) + "x" + std::to_string(cfg.consumers)
+                           + "/" + cfg.size.label() + (r.variant.empty() ? "" : "/" + r.variant);
+    r.mode      = cfg.mode;
+    r.producers = cfg.producers;
+    r.consumers = cfg.consumers;
+    r.size      = cfg.size.mean();
+    r.offered   = cfg.rate;
+    r.messages  = cfg.count * cfg.producers;
+    return r;
+}
+
+bool size_dist::parse(std::string const & spec, size_dist & d) {
+    d = size_dist{};
+    d.spec = spec;
+    std::size_t pos;
+    if (spec.compare(0, 4, "exp:") == 0) {
+        d.type  = kind::exponential;
+        d.small = parse_size(spec.substr(4));
+    }
+    else if ((pos = spec.find('/')) != std::string::npos) {
+        auto colon = spec.find(':', pos);
+        d.type  = kind::bimodal;
+        d.small = parse_size(spec.substr(0, pos));
+        d.large = parse_size(spec.substr(pos + 1, (colon == std::string::npos) ? std::string::npos : colon - pos - 1));
+        d.ratio = (colon == std::string::npos) ? 0.5 : std::atof(spec.c_str() + colon + 1);
+        if ((d.large == 0) || (d.ratio < 0) || (d.ratio > 1)) return false;
+    }
+    else if ((pos = spec.find('-')) != std::string::npos) {
+        d.type  = kind::uniform;
+        d.small = parse_size(spec.substr(0, pos));
+        d.large = parse_size(spec.substr(pos + 1));
+        if (d.large < d.small) return false;
+    }
+    else d.small = parse_size(spec);
+    return (d.small != 0) && (d.min() >= sizeof(std::uint64_t));
+}
+
+std::size_t size_dist::min() const noexcept {
+    switch (type) {
+    case kind::bimodal:     return (std::min)(small, large);
+    case kind::exponential: return sizeof(std::uint64_t);
+    default:                return small;
+    }
+}
+
+std::size_t size_dist::mean() const noexcept {
+    switch (type) {
+    case kind::uniform: return (small + large) / 2;
+    case kind::bimodal: return static_cast<std::size_t>(ratio * static_cast<double>(small) + (1 - ratio) * static_cast<double>(large));
+    default:            return small;
+    }
+}
+
+std::size_t size_dist::max() const noexcept {
+    switch (type) {
+    case kind::uniform:     return large;
+    case kind::bimodal:     return (std::max)(small, large);
+    case kind::exponential: return small * 16;
+    default:                return small;
+    }
+}
+
+std::string size_dist::label() const {
+    switch (type) {
+    case kind::uniform:     return human_size(small) + "-" + human_size(large);
+    case kind::exponential: return "exp:" + human_size(small);
+    case kind::bimodal: {
+        char buf[16];
+        std::snprintf(buf, sizeof(buf), ":%g", ratio);
+        return human_size(small) + "/" + human_size(large) + buf;
+    }
+    default:                return human_size(small);
+    }
+}
+
+std::size_t size_dist::operator()(std::mt19937_64 & rng) const {
+    switch (type) {
+    case kind::uniform:
+        return std::uniform_int_distribution<std::size_t>{small, large}(rng);
+    case kind::exponential: {
+        auto n = std::exponential_distribution<double>{1.0 / static_cast<double>(small)}(rng);
+        return (std::min)((std::max)(static_cast<std::size_t>(n), min()), max());
+    }
+    case kind::bimodal:
+        return std::bernoulli_distribution{ratio}(rng) ? small : large;
+    default:
+        return small;
+    }
+}
+
+std::uint64_t pacer::next() {
+    if (interval_ <= 0) return now_ns();
+    auto due = static_cast<std::uint64_t>(next_);
+    next_ += poisson_ ? (interval_ * exp_(rng_)) : interval_;
+    // sleep for most of the wait, the timer slack is about 50us, then spin
+    for (auto now = now_ns(); now < due; now = now_ns()) {
+        if (due - now > 200000) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(due - now - 100000));
+        }
+        else std::this_thread::yield();
+    }
+    return due;
+}
+
+std::vector<int> cpu_list() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (::sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int i = 0; i < CPU_SETSIZE; ++i) {
+            if (CPU_ISSET(i, &set)) cpus.push_back(i);
+        }
+    }
+    return cpus;
+}
+
+bool pin_thread(std::vector<int> const & cpus, std::size_t index) noexcept {
+    if (cpus.empty()) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpus[index % cpus.size()], &set);
+    return ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) == 0;
+}
+
+void normalize(ipc::detail::perf_values const & sum, bool kernel, result & r) {
+    using ipc::detail::perf_event;
+    r.perf = {};
+    r.perf.kernel = kernel;
+    if (r.delivered == 0) return;
+    auto per_msg = [&](perf_event e) {
+        return sum.has(e) ? (static_cast<double>(sum[e]) / static_cast<double>(r.delivered)) : -1.0;
+    };
+    r.perf.cycles           = per_msg(perf_event::cycles);
+    r.perf.instructions     = per_msg(perf_event::instructions);
+    r.perf.l1d_misses       = per_msg(perf_event::l1d_misses);
+    r.perf.llc_misses       = per_msg(perf_event::llc_misses);
+    r.perf.branch_misses    = per_msg(perf_event::branch_misses);
+    r.perf.context_switches = per_msg(perf_event::context_switches);
+    r.perf.page_faults      = per_msg(perf_event::page_faults);
+}
+
+void shared_perf::add(ipc::detail::perf_counters & pc) noexcept {
+    pc.stop();
+    if (!pc.valid()) return;
+    auto v = pc.read();
+    for (std::size_t i = 0; i < static_cast<std::size_t>(ipc::detail::perf_event::count); ++i) {
+        if (!v.valid[i]) continue;
+        value[i].fetch_add(v.value[i], std::memory_order_relaxed);
+        valid.fetch_or(1u << i, std::memory_order_relaxed);
+    }
+    if (!pc.kernel()) user.fetch_add(1, std::memory_order_relaxed);
+}
+
+void shared_perf::normalize(result & r) const noexcept {
+    ipc::detail::perf_values sum;
+    auto bits = valid.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < static_cast<std::size_t>(ipc::detail::perf_event::count); ++i) {
+        sum.value[i] = value[i].load(std::memory_order_relaxed);
+        sum.valid[i] = (bits & (1u << i)) != 0;
+    }
+    bench::normalize(sum, user.load(std::memory_order_relaxed) == 0, r);
+}
+
+void summarize(std::vector<std::uint64_t> & samples, result & r) {
+    r.latency = {};
+    if (samples.empty()) return;
+    std::sort(samples.begin(), samples.end());
+    auto at = [&samples](double q) {
+        auto i = static_cast<std::size_t>(q * static_cast<double>(samples.size() - 1) + 0.5);
+        return static_cast<double>(samples[(std::min)(i, samples.size() - 1)]);
+    };
+    double sum = 0;
+    for (auto s : samples) sum += static_cast<double>(s);
+    r.latency.mean = sum / static_cast<double>(samples.size());
+    r.latency.p50  = at(0.5);
+    r.latency.p90  = at(0.9);
+    r.latency.p99  = at(0.99);
+    r.latency.p999 = at(0.999);
+    r.latency.max  = static_cast<double>(samples.back());
+}
+
+std::size_t parse_size(std::string const & s) noexcept {
+    char *end = nullptr;
+    auto n = std::strtoull(s.c_str(), &end, 10);
+    if ((end == s.c_str()) || (n == 0)) return 0;
+    switch (std::toupper(static_cast<unsigned char>(*end))) {
+    case 'K': n <<= 10; ++end; break;
+    case 'M': n <<= 20; ++end; break;
+    case 'G': n <<= 30; ++end; break;
+    default : break;
+    }
+    if (std::toupper(static_cast<unsigned char>(*end)) == 'B') ++end;
+    return (*end == '\0') ? static_cast<std::size_t>(n) : 0;
+}
+
+std::vector<std::string> split(std::string const & s, char sep) {
+    std::vector<std::string> out;
+    std::size_t b = 0;
+    for (;;) {
+        auto e = s.find(sep, b);
+        auto t = s.substr(b, (e == std::string::npos) ? std::string::npos : e - b);
+        if (!t.empty()) out.push_back(std::move(t));
+        if (e == std::string::npos) break;
+        b = e + 1;
+    }
+    return out;
+}
+
+} // namespace bench
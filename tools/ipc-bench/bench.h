@@ -0,0 +1,229 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <atomic>
+
+#include "libipc/ipc.h"
+#include "libipc/platform/perf_counters.h"
+
+#include "report.h"
+
+namespace bench {
+
+enum : std::uint64_t {
+    send_timeout = 10000, // ms, beyond it the slow receivers are disconnected
+    idle_limit   = 10000, // ms, a consumer gives up after receiving nothing for so long
+    recv_tick    = 100    // ms
+};
+
+enum : unsigned {
+    max_producers  = 64,
+    max_consumers  = 32, // the connection bits of a broadcast ring
+    max_sync_procs = 32
+};
+
+/**
+ * The sizes of the messages of a case:
+ *  "64", "4K"    fixed
+ *  "64-4K"       uniform in [64, 4K]
+ *  "exp:1K"      exponential with a mean of 1K, cut at 16 x the mean
+ *  "64/64K:0.9"  bimodal, 90% of 64 bytes & the rest 64K
+ * A message is never shorter than the 8 bytes of its send time.
+*/
+struct size_dist {
+    enum class kind { fixed, uniform, exponential, bimodal };
+
+    kind        type  = kind::fixed;
+    std::size_t small = 0;   // the fixed size, the lower bound, the mean or the small size
+    std::size_t large = 0;   // the upper bound or the large size
+    double      ratio = 1.0; // the share of the small size
+    std::string spec;        // as it has been given
+
+    static bool parse(std::string const & spec, size_dist & d);
+
+    std::size_t min  () const noexcept;
+    std::size_t mean () const noexcept;
+    std::size_t max  () const noexcept;
+    std::string label() const;
+    std::size_t operator()(std::mt19937_64 & rng) const;
+};
+
+struct config {
+    std::string   mode;
+    unsigned      producers;
+    unsigned      consumers;
+    size_dist     size;
+    std::uint64_t count; // per producer
+    bool          pin;
+    bool          processes = false; // fork/exec the producers & consumers instead of threads
+    std::uint64_t kill_ms   = 0;     // the mean interval of the random kills, 0 means none
+    double        rate      = 0;     // messages per second of all the producers, 0 means a closed loop
+    bool          poisson   = false; // exponential intervals between the sends instead of fixed ones
+};
+
+/**
+ * The schedule of an open-loop producer: each message has an intended send time,
+ * whether or not the previous one has gone out in time.
+ * The latency is measured from the intended time, so a stalled sender counts the messages
+ * queued up behind the stall too, instead of leaving them out (coordinated omission).
+ * With no rate it's a closed loop, the intended time is just now.
+*/
+class pacer {
+    double        interval_; // ns
+    bool          poisson_;
+    double        next_ = 0;
+    std::mt19937_64 rng_;
+    std::exponential_distribution<double> exp_ {1.0};
+
+public:
+    pacer(double rate, bool poisson, std::uint64_t seed)
+        : interval_((rate > 0) ? (1e9 / rate) : 0)
+        , poisson_ (poisson)
+        , rng_     (seed) {}
+
+    void start(std::uint64_t now) noexcept {
+        next_ = static_cast<double>(now);
+    }
+
+    // Waits for the intended send time of the next message & returns it.
+    std::uint64_t next();
+};
+
+template <typename T>
+struct type_tag { using type = T; };
+
+// Calls 'f' with the channel type of the mode (ssu, smb or mmb).
+template <typename F>
+decltype(auto) with_chan(std::string const & mode, F && f) {
+    using namespace ipc;
+    if (mode == "ssu") return f(type_tag<chan<relat::single, relat::single, trans::unicast>>{});
+    if (mode == "smb") return f(type_tag<route>{});
+    return f(type_tag<channel>{});
+}
+
+// Every producer sends so many messages before the clock starts.
+inline std::uint64_t warmup_of(std::uint64_t count) noexcept {
+    return (std::max<std::uint64_t>)(1, (std::min<std::uint64_t>)(count / 10, 1000));
+}
+
+// A result with the name & the settings of the case, but nothing measured yet.
+result make_result(config const & cfg);
+
+// Measures with the producers & consumers as threads of this process.
+result run_threads(config const & cfg, std::vector<int> const & cpus);
+
+// Measures with the producers & consumers as child processes, which exec 'exe' as workers.
+result run_processes(config const & cfg, std::vector<int> const & cpus, std::string const & exe);
+
+// The entry of a worker process, argv[1] is "--worker".
+int worker_main(int argc, char ** argv);
+
+/**
+ * A case of the sync suite, the primitives across processes:
+ *  mutex       "uncontended" lock + unlock, "handoff" the latency from an unlock to the lock by another process
+ *  semaphore   "uncontended" post + wait,   "wakeup" the latency from a post to a waiter running
+ *  condition   "uncontended" notify,        "wakeup" the latency from a notify to a waiter running
+ *  waiter      "uncontended" notify,        "wakeup" as the condition, through ipc::detail::waiter
+ * The results go into the same table & JSON, named "primitive/scenario/Np".
+*/
+struct sync_case {
+    std::string   primitive;
+    std::string   scenario;
+    unsigned      procs;
+    std::uint64_t count; // ops per process for "uncontended" & "handoff", rounds for "wakeup"
+};
+
+// All the cases, with 2, 4, ... 'max_procs' processes for the contended ones.
+std::vector<sync_case> sync_cases(unsigned max_procs, std::uint64_t count, bool quick);
+
+// Measures a case with the processes started from 'exe' as sync workers.
+result run_sync(sync_case const & c, std::vector<int> const & cpus, bool pin, std::string const & exe);
+
+// The entry of a sync worker process, argv[1] is "--sync-worker".
+int sync_worker_main(int argc, char ** argv);
+
+// Starts a worker process by fork & exec of argv[0], which is killed along with this process.
+// Returns its pid, 0 on failure.
+int spawn(std::vector<std::string> args);
+
+// CLOCK_MONOTONIC, the same clock in every process of the machine.
+std::uint64_t now_ns() noexcept;
+
+// The CPU time of the whole process.
+std::uint64_t process_cpu_ns() noexcept;
+
+// A channel name which is unique on this machine.
+std::string channel_name();
+
+// The CPUs this process is allowed to run on.
+std::vector<int> cpu_list();
+
+// Pins the calling thread on a CPU, the index is wrapped around 'cpus'.
+bool pin_thread(std::vector<int> const & cpus, std::size_t index) noexcept;
+
+/**
+ * Fills the counters of 'r' with the sums of all the producers & consumers per delivered message,
+ * 'kernel' is whether all of them have counted the kernel side too.
+*/
+void normalize(ipc::detail::perf_values const & sum, bool kernel, result & r);
+
+/**
+ * The counters of worker processes, summed up in a block they share with the harness.
+ * A killed worker takes its counters with it. Zero-filled is the initial state.
+*/
+struct shared_perf {
+    std::atomic<std::uint64_t> value[static_cast<std::size_t>(ipc::detail::perf_event::count)];
+    std::atomic<unsigned>      valid; // a bit per counter which any worker could open
+    std::atomic<unsigned>      user;  // the workers which couldn't count the kernel side
+
+    // Stops the counters of this worker & adds them up.
+    void add(ipc::detail::perf_counters & pc) noexcept;
+
+    // normalize() with the sums.
+    void normalize(result & r) const noexcept;
+};
+
+/**
+ * Fills the latency of 'r' with the percentiles of the samples (ns),
+ * the samples are sorted in place.
+*/
+void summarize(std::vector<std::uint64_t> & samples, result & r);
+
+/**
+ * Keeps every n-th sample, so that a long run wouldn't eat the memory up.
+ * The stride is fixed before the run, which keeps the samples spread over the whole of it.
+*/
+class sampler {
+    std::vector<std::uint64_t> samples_;
+    std::uint64_t stride_;
+    std::uint64_t count_ = 0;
+
+public:
+    enum : std::size_t { max_samples = 1 << 20 };
+
+    explicit sampler(std::uint64_t expected)
+        : stride_((expected / max_samples) + 1) {
+        samples_.reserve(static_cast<std::size_t>((std::min)(expected, std::uint64_t(max_samples))) + 1);
+    }
+
+    void add(std::uint64_t ns) {
+        if ((count_++ % stride_) == 0) samples_.push_back(ns);
+    }
+
+    std::vector<std::uint64_t> & samples() noexcept {
+        return samples_;
+    }
+};
+
+// "4K" => 4096, "16M" => 16777216, 0 if it isn't a size.
+std::size_t parse_size(std::string const & s) noexcept;
+
+// Splits "a,b,c".
+std::vector<std::string> split(std::string const & s, char sep = ',');
+
+} // namespace bench
@@ -0,0 +1,355 @@
+#include <unistd.h>
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+
+#include "bench.h"
+#include "report.h"
+
+/**
+ * ipc-bench: sweeps the channel modes, message sizes and producer x consumer counts,
+ * and reports throughput, send->recv latency percentiles and CPU time per message.
+ *
+ * usage: ipc-bench [options]
+ *  --mode    ssu,smb,mmb     the modes to run (default: all)
+ *  --size    8,64,4K,...     the message sizes (default: 8B ... 16M, x8 each step),
+ *                            or distributions: 64-4K (uniform), exp:1K, 64/64K:0.9 (bimodal)
+ *  --threads 1x1,2x4,...     producer x consumer counts (default: powers of 2 up to the CPU count)
+ *  --max-threads N           the upper bound of the default counts
+ *  --count   N               messages per producer (default: by size, about 256M bytes)
+ *  --no-pin                  don't pin the threads on CPUs
+ *  --processes               run the producers & consumers as processes (fork/exec) instead of threads
+ *  --kill    MS              with --processes, kill a random worker every MS ms on average & replace it
+ *  --rate    R1,R2,...|auto  open loop: pace the producers at so many msgs/s in all, one run each;
+ *                            'auto' measures the closed loop first & sweeps 10%..120% of it
+ *  --poisson                 exponential intervals between the sends (default: fixed)
+ *  --duration SEC            the length of an open-loop run (default: 1)
+ *  --slo     NS              the p99 bound of the knee (default: 10 x the p99 of the lowest rate)
+ *  --quick                   a short sweep, for a smoke test
+ *  --json    FILE            write the results as JSON ('-' for stdout)
+ *  --input   FILE            don't run, read the results from a JSON file
+ *  --compare FILE            compare the results with a saved baseline, exits with 2 on regressions
+ *  --threshold PCT           the change which counts as a regression (default: 10)
+ *  --sync                    run the sync-primitive suite instead (mutex, semaphore, condition, waiter
+ *                            across processes), 2 ... --max-threads processes, --count ops each
+*/
+
+namespace {
+
+constexpr std::size_t byte_budget = 256 * 1024 * 1024;
+
+struct case_t {
+    unsigned producers;
+    unsigned consumers;
+};
+
+// 1, 2, 4, ... and n itself
+std::vector<unsigned> powers_up_to(unsigned n) {
+    std::vector<unsigned> ns;
+    for (unsigned i = 1; i < n; i <<= 1) ns.push_back(i);
+    ns.push_back(n);
+    return ns;
+}
+
+std::vector<case_t> default_cases(std::string const & mode, unsigned max_threads) {
+    std::vector<case_t> cs;
+    if (mode == "ssu") {
+        cs.push_back({1, 1});
+        return cs;
+    }
+    auto ns = powers_up_to(max_threads);
+    for (auto p : ns) {
+        if ((mode == "smb") && (p > 1)) break;
+        for (auto c : ns) cs.push_back({p, c});
+    }
+    return cs;
+}
+
+bool valid(std::string const & mode, case_t const & c) {
+    if ((c.producers == 0) || (c.producers > bench::max_producers) ||
+        (c.consumers == 0) || (c.consumers > bench::max_consumers)) {
+        return false;
+    }
+    if (mode == "ssu") return (c.producers == 1) && (c.consumers == 1);
+    if (mode == "smb") return (c.producers == 1);
+    return true;
+}
+
+std::uint64_t default_count(std::size_t size, bool quick) {
+    auto n = byte_budget / size / (quick ? 64 : 1);
+    return (std::min<std::uint64_t>)((std::max<std::uint64_t>)(n, quick ? 16 : 64), quick ? 10000 : 100000);
+}
+
+// "50K" => 50000, "1.5M" => 1500000
+double parse_rate(std::string const & s) {
+    char *end = nullptr;
+    auto r = std::strtod(s.c_str(), &end);
+    switch (*end) {
+    case 'k': case 'K': r *= 1e3; ++end; break;
+    case 'm': case 'M': r *= 1e6; ++end; break;
+    default : break;
+    }
+    return (*end == '\0') ? r : 0;
+}
+
+/**
+ * The knee of a rate sweep is the highest offered rate, below which every run has kept up
+ * (at least 95% of the offered throughput, nothing lost) and kept its p99 under the SLO.
+*/
+void print_knee(std::ostream & os, std::vector<bench::result> const & sweep, double slo) {
+    if (sweep.empty()) return;
+    if (slo <= 0) slo = 10 * (std::max)(sweep.front().latency.p99, 1000.0);
+    bench::result const * knee = nullptr;
+    bench::result const * over = nullptr;
+    for (auto const & r : sweep) {
+        if ((r.msgs_per_sec < 0.95 * r.offered) || (r.errors != 0) || (r.latency.p99 > slo)) {
+            over = &r;
+            break;
+        }
+        knee = &r;
+    }
+    os << "knee (p99 <= " << bench::human_ns(slo) << "): ";
+    if (knee == nullptr) os << "none, the lowest rate is already beyond it";
+    else os << bench::human(knee->offered) << " msg/s, p99 " << bench::human_ns(knee->latency.p99);
+    if (over != nullptr) {
+        os << "; at " << bench::human(over->offered) << " msg/s: " << bench::human(over->msgs_per_sec)
+           << " msg/s, p99 " << bench::human_ns(over->latency.p99);
+    }
+    os << "\n" << std::flush;
+}
+
+int usage(char const * exe) {
+    std::cout << "usage: " << exe << " [--mode ssu,smb,mmb] [--size 8,64,4K,...] [--threads PxC,...]\n"
+              << "       [--max-threads N] [--count N] [--no-pin] [--quick] [--processes [--kill MS]]\n"
+              << "       [--rate R1,R2,...|auto] [--poisson] [--duration SEC] [--slo NS]\n"
+              << "       [--json FILE] [--input FILE] [--compare FILE] [--threshold PCT]\n"
+              << "       " << exe << " --sync [--max-threads N] [--count N] [--no-pin] [--quick] [--json FILE] ...\n";
+    return 1;
+}
+
+// The path of this executable, which the worker processes are started from.
+std::string self_path(char const * argv0) {
+    char buf[4096];
+    auto n = ::readlink("/proc/self/exe", buf, sizeof(buf) - 1);
+    if (n <= 0) return argv0;
+    buf[n] = '\0';
+    return buf;
+}
+
+} // namespace
+
+int main(int argc, char ** argv) {
+    if ((argc > 1) && (std::strcmp(argv[1], "--worker") == 0)) {
+        return bench::worker_main(argc, argv);
+    }
+    if ((argc > 1) && (std::strcmp(argv[1], "--sync-worker") == 0)) {
+        return bench::sync_worker_main(argc, argv);
+    }
+    std::vector<std::string> modes {"ssu", "smb", "mmb"};
+    std::vector<bench::size_dist> sizes;
+    std::vector<double>      rates;
+    std::vector<case_t>      cases;
+    auto cpus = bench::cpu_list();
+    unsigned max_threads = (std::max)(1u, static_cast<unsigned>(cpus.size()));
+    std::uint64_t count = 0;
+    bool   pin   = true;
+    bool   quick = false;
+    bool   procs = false;
+    bool   sync  = false;
+    bool   auto_rate = false;
+    bool   poisson   = false;
+    double duration  = 0;
+    double slo       = 0;
+    std::uint64_t kill_ms = 0;
+    double threshold = 0.1;
+    std::string json_path, input_path, baseline_path;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg {argv[i]};
+        bool has_value = (i + 1 < argc);
+        if ((arg == "--mode") && has_value) {
+            modes = bench::split(argv[++i]);
+            for (auto const & m : modes) {
+                if ((m != "ssu") && (m != "smb") && (m != "mmb")) {
+                    std::cerr << "ipc-bench: unknown mode: " << m << "\n";
+                    return 1;
+                }
+            }
+        }
+        else if ((arg == "--size") && has_value) {
+            for (auto const & s : bench::split(argv[++i])) {
+                bench::size_dist d;
+                if (!bench::size_dist::parse(s, d)) {
+                    std::cerr << "ipc-bench: invalid size (8 bytes at least): " << s << "\n";
+                    return 1;
+                }
+                sizes.push_back(d);
+            }
+        }
+        else if ((arg == "--rate") && has_value) {
+            std::string v {argv[++i]};
+            if (v == "auto") auto_rate = true;
+            else for (auto const & s : bench::split(v)) {
+                auto r = parse_rate(s);
+                if (r <= 0) {
+                    std::cerr << "ipc-bench: invalid rate: " << s << "\n";
+                    return 1;
+                }
+                rates.push_back(r);
+            }
+        }
+        else if (arg == "--poisson") {
+            poisson = true;
+        }
+        else if ((arg == "--duration") && has_value) {
+            duration = std::atof(argv[++i]);
+        }
+        else if ((arg == "--slo") && has_value) {
+            slo = std::atof(argv[++i]);
+        }
+        else if ((arg == "--threads") && has_value) {
+            for (auto const & s : bench::split(argv[++i])) {
+                case_t c {};
+                if (std::sscanf(s.c_str(), "%ux%u", &c.producers, &c.consumers) != 2) {
+                    std::cerr << "ipc-bench: invalid thread counts: " << s << "\n";
+                    return 1;
+                }
+                cases.push_back(c);
+            }
+        }
+        else if ((arg == "--max-threads") && has_value) {
+            max_threads = (std::max)(1u, static_cast<unsigned>(std::atoi(argv[++i])));
+        }
+        else if ((arg == "--count") && has_value) {
+            count = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if ((arg == "--threshold") && has_value) {
+            threshold = std::atof(argv[++i]) / 100.0;
+        }
+        else if ((arg == "--json") && has_value) {
+            json_path = argv[++i];
+        }
+        else if ((arg == "--input") && has_value) {
+            input_path = argv[++i];
+        }
+        else if ((arg == "--compare") && has_value) {
+            baseline_path = argv[++i];
+        }
+        else if (arg == "--no-pin") {
+            pin = false;
+        }
+        else if (arg == "--quick") {
+            quick = true;
+        }
+        else if (arg == "--processes") {
+            procs = true;
+        }
+        else if (arg == "--sync") {
+            sync = true;
+        }
+        else if ((arg == "--kill") && has_value) {
+            kill_ms = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else return usage(argv[0]);
+    }
+    if (sizes.empty()) {
+        for (auto const & s : bench::split(quick ? "8,4K,256K" : "8,64,512,4K,32K,256K,2M,16M")) {
+            sizes.emplace_back();
+            bench::size_dist::parse(s, sizes.back());
+        }
+    }
+    if (duration <= 0) duration = quick ? 0.2 : 1.0;
+    if ((kill_ms != 0) && !procs) {
+        std::cerr << "ipc-bench: --kill needs --processes\n";
+        return 1;
+    }
+    if (quick && cases.empty()) {
+        max_threads = (std::min)(max_threads, 2u);
+    }
+
+    // with the text table on stdout, the JSON goes to a file or nowhere
+    bool json_out = (json_path == "-");
+    std::ostream & text = json_out ? std::cerr : std::cout;
+
+    auto exe = self_path(argv[0]);
+    std::vector<bench::result> results;
+    if (!input_path.empty()) {
+        if (!bench::read_json(input_path, results)) return 1;
+    }
+    else if (sync) {
+        bench::print_header(text);
+        for (auto const & c : bench::sync_cases(max_threads, count, quick)) {
+            results.push_back(bench::run_sync(c, cpus, pin, exe));
+            bench::print_row(text, results.back());
+        }
+    }
+    else {
+        bench::print_header(text);
+        for (auto const & mode : modes) {
+            auto cs = cases.empty() ? default_cases(mode, max_threads) : cases;
+            for (auto const & c : cs) {
+                if (!valid(mode, c)) continue;
+                for (auto const & size : sizes) {
+                    bench::config cfg {mode, c.producers, c.consumers, size,
+                                       (count != 0) ? count : default_count(size.mean(), quick), pin, procs, kill_ms};
+                    auto run = [&](bench::config const & one) {
+                        results.push_back(procs ? bench::run_processes(one, cpus, exe)
+                                                : bench::run_threads  (one, cpus));
+                        bench::print_row(text, results.back());
+                        return results.back();
+                    };
+                    if (rates.empty() && !auto_rate) {
+                        run(cfg);
+                        continue;
+                    }
+                    auto rs = rates;
+                    if (auto_rate) {
+                        auto peak = run(cfg).msgs_per_sec;
+                        for (int k = 1; k <= 12; ++k) rs.push_back(peak * k / 10);
+                    }
+                    std::sort(rs.begin(), rs.end());
+                    std::vector<bench::result> sweep;
+                    for (auto rate : rs) {
+                        auto open    = cfg;
+                        open.rate    = rate;
+                        open.poisson = poisson;
+                        open.count   = (std::max<std::uint64_t>)(1, static_cast<std::uint64_t>(rate * duration / c.producers));
+                        sweep.push_back(run(open));
+                    }
+                    print_knee(text, sweep, slo);
+                }
+            }
+        }
+    }
+
+    if (json_out) {
+        bench::write_json(std::cout, results);
+    }
+    else if (!json_path.empty()) {
+        std::ofstream out {json_path};
+        if (!out) {
+            std::cerr << "ipc-bench: cannot write " << json_path << "\n";
+            return 1;
+        }
+        bench::write_json(out, results);
+    }
+
+    if (!baseline_path.empty()) {
+        std::vector<bench::result> base;
+        if (!bench::read_json(baseline_path, base)) return 1;
+        text << "\n";
+        auto n = bench::compare(text, base, results, threshold);
+        if (n != 0) {
+            text << n << " regression(s) beyond " << (threshold * 100.0) << "%\n";
+            return 2;
+        }
+    }
+    return 0;
+}
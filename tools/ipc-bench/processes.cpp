@@ -0,0 +1,397 @@
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <cstring>
+#include <cstdlib>
+
+#include "libipc/shm.h"
+
+#include "bench.h"
+
+namespace bench {
+namespace {
+
+enum : std::size_t {
+    sample_capacity = 1 << 16 // latency samples of each consumer
+};
+
+/**
+ * The block shared by the harness & its workers, it's followed by the latency samples of each consumer.
+ * A new segment is zero-filled, which is the initial state of all the members.
+*/
+struct shared_t {
+    std::atomic<unsigned>      ready;
+    std::atomic<unsigned>      phase;    // 0: connecting, 1: warming up, 2: measuring
+    std::atomic<unsigned>      warmed;
+    std::atomic<unsigned>      finished; // the producers which have sent all their messages
+    std::atomic<std::uint64_t> errors;
+    std::atomic<std::uint64_t> cpu_ns;
+    std::atomic<std::uint64_t> sent    [max_producers];
+    std::atomic<std::uint64_t> received[max_consumers];
+    std::atomic<std::uint64_t> stored  [max_consumers]; // latency samples
+    shared_perf                perf;
+
+    std::uint64_t *samples_of(unsigned k) noexcept {
+        return reinterpret_cast<std::uint64_t *>(this + 1) + (k * sample_capacity);
+    }
+};
+
+std::size_t shared_size(unsigned consumers) noexcept {
+    return sizeof(shared_t) + (consumers * sample_capacity * sizeof(std::uint64_t));
+}
+
+// The command line of a worker:
+// --worker role mode channel shared index producers consumers size count cpu respawned timeout rate poisson
+struct worker_args {
+    bool          producer  = false;
+    std::string   mode;
+    std::string   channel;
+    std::string   shared;
+    unsigned      index     = 0;
+    unsigned      producers = 0;
+    unsigned      consumers = 0;
+    size_dist     size;
+    std::uint64_t count     = 0;
+    int           cpu       = -1;
+    bool          respawned = false; // a replacement of a killed worker, which skips the warm-up
+    std::uint64_t timeout   = send_timeout;
+    double        rate      = 0; // of this producer
+    bool          poisson   = false;
+
+    std::vector<std::string> to_argv(std::string const & exe) const {
+        return {exe, "--worker", producer ? "producer" : "consumer", mode, channel, shared,
+                std::to_string(index), std::to_string(producers), std::to_string(consumers),
+                size.spec, std::to_string(count), std::to_string(cpu),
+                respawned ? "1" : "0", std::to_string(timeout), std::to_string(rate), poisson ? "1" : "0"};
+    }
+
+    bool parse(int argc, char ** argv) {
+        if (argc != 16) return false;
+        producer  = (std::strcmp(argv[2], "producer") == 0);
+        mode      = argv[3];
+        channel   = argv[4];
+        shared    = argv[5];
+        index     = static_cast<unsigned>(std::strtoul(argv[6], nullptr, 10));
+        producers = static_cast<unsigned>(std::strtoul(argv[7], nullptr, 10));
+        consumers = static_cast<unsigned>(std::strtoul(argv[8], nullptr, 10));
+        if (!size_dist::parse(argv[9], size)) return false;
+        count     = std::strtoull(argv[10], nullptr, 10);
+        cpu       = std::atoi(argv[11]);
+        respawned = (std::strcmp(argv[12], "1") == 0);
+        timeout   = std::strtoull(argv[13], nullptr, 10);
+        rate      = std::atof(argv[14]);
+        poisson   = (std::strcmp(argv[15], "1") == 0);
+        return (producers <= max_producers) && (consumers <= max_consumers)
+            && (index < (producer ? producers : consumers));
+    }
+};
+
+void wait_until(std::atomic<unsigned> const & a, unsigned n) {
+    while (a.load(std::memory_order_acquire) < n) std::this_thread::yield();
+}
+
+template <typename Chan>
+int produce(worker_args const & a, shared_t & sh) {
+    Chan ch {a.channel.c_str(), ipc::sender};
+    if (!ch.valid()) return 1;
+    std::vector<char> buf(a.size.max(), static_cast<char>('A' + a.index));
+    std::mt19937_64 rng {now_ns()};
+    ipc::detail::perf_counters pc;
+    auto send = [&](pacer & pa) {
+        auto stamp = pa.next();
+        std::memcpy(buf.data(), &stamp, sizeof(stamp));
+        if (!ch.send(buf.data(), a.size(rng), a.timeout)) {
+            sh.errors.fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+    if (!a.respawned) {
+        pacer closed {0, false, 0};
+        sh.ready.fetch_add(1, std::memory_order_release);
+        wait_until(sh.phase, 1);
+        for (std::uint64_t i = warmup_of(a.count); i > 0; --i) send(closed);
+        wait_until(sh.phase, 2);
+    }
+    auto cpu = process_cpu_ns();
+    pc.start();
+    auto & sent = sh.sent[a.index];
+    pacer paced {a.rate, a.poisson, rng()};
+    paced.start(now_ns());
+    // a replacement goes on from where the killed one has stopped
+    while (sent.load(std::memory_order_relaxed) < a.count) {
+        send(paced);
+        sent.fetch_add(1, std::memory_order_relaxed);
+    }
+    sh.perf.add(pc);
+    sh.cpu_ns.fetch_add(process_cpu_ns() - cpu, std::memory_order_relaxed);
+    sh.finished.fetch_add(1, std::memory_order_release);
+    return 0;
+}
+
+template <typename Chan>
+int consume(worker_args const & a, shared_t & sh) {
+    Chan ch {a.channel.c_str(), ipc::receiver};
+    if (!ch.valid()) return 1;
+    ipc::detail::perf_counters pc;
+    if (!a.respawned) {
+        sh.ready.fetch_add(1, std::memory_order_release);
+        std::uint64_t idle = 0;
+        for (std::uint64_t i = warmup_of(a.count) * a.producers; (i > 0) && (idle < idle_limit);) {
+            if (ch.recv(recv_tick).empty()) idle += recv_tick;
+            else --i;
+        }
+        sh.warmed.fetch_add(1, std::memory_order_release);
+    }
+    auto cpu    = process_cpu_ns();
+    pc.start();
+    auto total  = a.count * a.producers;
+    auto stride = (total / sample_capacity) + 1;
+    auto & got  = sh.received[a.index];
+    std::uint64_t idle = 0;
+    while (got.load(std::memory_order_relaxed) < total) {
+        auto buf = ch.recv(recv_tick);
+        if (buf.empty()) {
+            idle += recv_tick;
+            // Once all the producers are done, what hasn't come yet has been lost,
+            // with a killed producer or a replacement which has connected late.
+            if ((sh.finished.load(std::memory_order_acquire) >= a.producers) || (idle >= idle_limit)) break;
+            continue;
+        }
+        auto now = now_ns();
+        idle = 0;
+        auto n = got.fetch_add(1, std::memory_order_relaxed);
+        if ((buf.size() < a.size.min()) || (buf.size() > a.size.max())) {
+            sh.errors.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        if ((n % stride) == 0) {
+            auto i = sh.stored[a.index].fetch_add(1, std::memory_order_relaxed);
+            if (i < sample_capacity) {
+                std::uint64_t stamp;
+                std::memcpy(&stamp, buf.data(), sizeof(stamp));
+                sh.samples_of(a.index)[i] = now - stamp;
+            }
+        }
+    }
+    sh.perf.add(pc);
+    sh.cpu_ns.fetch_add(process_cpu_ns() - cpu, std::memory_order_relaxed);
+    return 0;
+}
+
+struct worker_t {
+    bool     producer;
+    unsigned index;
+    pid_t    pid;
+};
+
+} // namespace
+
+int worker_main(int argc, char ** argv) {
+    worker_args a;
+    if (!a.parse(argc, argv)) {
+        std::cerr << "ipc-bench: invalid worker arguments\n";
+        return 1;
+    }
+    if (a.cpu >= 0) pin_thread({a.cpu}, 0);
+    ipc::shm::handle shm {a.shared.c_str(), shared_size(a.consumers), ipc::shm::open};
+    if (!shm.valid()) {
+        std::cerr << "ipc-bench: cannot open the shared block: " << a.shared << "\n";
+        return 1;
+    }
+    auto & sh = *static_cast<shared_t *>(shm.get());
+    return with_chan(a.mode, [&](auto tag) {
+        using chan_t = typename decltype(tag)::type;
+        return a.producer ? produce<chan_t>(a, sh) : consume<chan_t>(a, sh);
+    });
+}
+
+/**
+ * The producers & consumers are the same executable started as workers, so that nothing is shared
+ * but what goes through the shared memory: separate mappings, page faults & caches of their own.
+ * They meet on a barrier in a shared block (connected -> warmed up -> measuring).
+ * With 'kill_ms', a random worker is killed by SIGKILL from time to time & replaced by a new one,
+ * which leaves a dead connection behind for the channel to recover from.
+*/
+result run_processes(config const & cfg, std::vector<int> const & cpus, std::string const & exe) {
+    auto r = make_result(cfg);
+    if ((cfg.producers > max_producers) || (cfg.consumers > max_consumers)) {
+        r.errors = 1;
+        return r;
+    }
+    auto channel = channel_name();
+    auto shared  = channel + "-harness";
+    ipc::shm::handle::clear_storage(shared.c_str());
+    ipc::shm::handle shm {shared.c_str(), shared_size(cfg.consumers)};
+    if (!shm.valid()) {
+        std::cerr << "ipc-bench: cannot create the shared block: " << shared << "\n";
+        r.errors = 1;
+        return r;
+    }
+    auto & sh = *static_cast<shared_t *>(shm.get());
+    auto total = cfg.count * cfg.producers;
+
+    std::vector<worker_t> workers;
+    for (unsigned k = 0; k < cfg.consumers; ++k) workers.push_back({false, k, 0});
+    for (unsigned k = 0; k < cfg.producers; ++k) workers.push_back({true , k, 0});
+
+    std::uint64_t unexpected = 0;
+    auto spawn = [&](worker_t & w, bool respawned) {
+        worker_args a;
+        a.producer  = w.producer;
+        a.mode      = cfg.mode;
+        a.channel   = channel;
+        a.shared    = shared;
+        a.index     = w.index;
+        a.producers = cfg.producers;
+        a.consumers = cfg.consumers;
+        a.size      = cfg.size;
+        a.count     = cfg.count;
+        a.cpu       = (cfg.pin && !cpus.empty())
+                    ? cpus[(w.producer ? w.index : cfg.producers + w.index) % cpus.size()] : -1;
+        a.respawned = respawned;
+        a.rate      = cfg.rate / cfg.producers;
+        a.poisson   = cfg.poisson;
+        // a dead receiver is only disconnected after the send timeout
+        a.timeout   = (cfg.kill_ms != 0) ? static_cast<std::uint64_t>(ipc::default_timeout) : send_timeout;
+        w.pid = bench::spawn(a.to_argv(exe));
+        if (w.pid == 0) ++unexpected;
+    };
+    auto reap = [&] {
+        int st = 0;
+        pid_t pid;
+        while ((pid = ::waitpid(-1, &st, WNOHANG)) > 0) {
+            for (auto & w : workers) {
+                if (w.pid != pid) continue;
+                w.pid = 0;
+                if (!WIFEXITED(st) || (WEXITSTATUS(st) != 0)) ++unexpected;
+            }
+        }
+    };
+    auto kill_all = [&] {
+        for (auto & w : workers) {
+            if (w.pid == 0) continue;
+            ::kill(w.pid, SIGKILL);
+            ::waitpid(w.pid, nullptr, 0);
+            w.pid = 0;
+        }
+    };
+    auto alive = [&](bool producer) {
+        for (auto const & w : workers) {
+            if ((w.producer == producer) && (w.pid != 0)) return true;
+        }
+        return false;
+    };
+    auto progress = [&] {
+        std::uint64_t n = 0;
+        for (unsigned k = 0; k < cfg.producers; ++k) n += sh.sent    [k].load(std::memory_order_relaxed);
+        for (unsigned k = 0; k < cfg.consumers; ++k) n += sh.received[k].load(std::memory_order_relaxed);
+        return n;
+    };
+    // waits for the barrier, as long as no worker is gone
+    auto wait_for = [&](std::atomic<unsigned> const & a, unsigned n) {
+        auto deadline = now_ns() + idle_limit * 1000000ull;
+        while (a.load(std::memory_order_acquire) < n) {
+            reap();
+            for (auto const & w : workers) {
+                if (w.pid == 0) return false;
+            }
+            if (now_ns() > deadline) return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    };
+
+    for (auto & w : workers) spawn(w, false);
+    bool ok = wait_for(sh.ready, cfg.producers + cfg.consumers);
+    if (ok) {
+        sh.phase.store(1, std::memory_order_release);
+        ok = wait_for(sh.warmed, cfg.consumers);
+    }
+    std::uint64_t beg = now_ns(), end = beg;
+    if (ok) {
+        std::mt19937_64 rng {beg};
+        std::exponential_distribution<double> interval {1.0 / static_cast<double>((std::max)(cfg.kill_ms, std::uint64_t(1)))};
+        auto next_kill = beg + static_cast<std::uint64_t>(interval(rng) * 1e6);
+        auto last      = progress();
+        auto last_tp   = beg;
+        sh.phase.store(2, std::memory_order_release);
+        for (;;) {
+            reap();
+            if (!alive(false)) break;
+            auto now = now_ns();
+            if ((cfg.kill_ms != 0) && (now >= next_kill) &&
+                (sh.finished.load(std::memory_order_acquire) < cfg.producers)) {
+                std::vector<worker_t *> live;
+                for (auto & w : workers) {
+                    if (w.pid != 0) live.push_back(&w);
+                }
+                auto & w = *live[std::uniform_int_distribution<std::size_t>{0, live.size() - 1}(rng)];
+                ::kill(w.pid, SIGKILL);
+                ::waitpid(w.pid, nullptr, 0);
+                spawn(w, true);
+                ++r.kills;
+                next_kill = now + static_cast<std::uint64_t>(interval(rng) * 1e6);
+            }
+            auto curr = progress();
+            if (curr != last) {
+                last    = curr;
+                last_tp = now;
+            }
+            else if (now - last_tp > 2 * idle_limit * 1000000ull) {
+                std::cerr << "ipc-bench: " << r.name << " made no progress, the workers are killed\n";
+                ++unexpected;
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        end = now_ns();
+        // The producers are done by now, unless the consumers have given up.
+        auto deadline = end + idle_limit * 1000000ull;
+        while (alive(true) && (now_ns() < deadline)) {
+            reap();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    else {
+        std::cerr << "ipc-bench: " << r.name << " failed to start the workers\n";
+        ++unexpected;
+    }
+    kill_all();
+    with_chan(cfg.mode, [&](auto tag) {
+        decltype(tag)::type::clear_storage(channel.c_str());
+    });
+
+    std::vector<std::uint64_t> samples;
+    std::uint64_t lost = 0;
+    for (unsigned k = 0; k < cfg.consumers; ++k) {
+        auto got = sh.received[k].load(std::memory_order_relaxed);
+        r.delivered += got;
+        lost += (got < total) ? (total - got) : 0;
+        auto n  = (std::min<std::uint64_t>)(sh.stored[k].load(std::memory_order_relaxed), sample_capacity);
+        auto *s = sh.samples_of(k);
+        samples.insert(samples.end(), s, s + n);
+    }
+    r.errors  = sh.errors.load(std::memory_order_relaxed) + lost + unexpected;
+    r.seconds = static_cast<double>(end - beg) / 1e9;
+    if (r.seconds > 0) {
+        r.msgs_per_sec  = static_cast<double>(r.messages) / r.seconds;
+        r.bytes_per_sec = r.msgs_per_sec * static_cast<double>(r.size);
+    }
+    if (r.delivered > 0) {
+        r.cpu_ns_per_msg = static_cast<double>(sh.cpu_ns.load(std::memory_order_relaxed)) / static_cast<double>(r.delivered);
+    }
+    summarize(samples, r);
+    sh.perf.normalize(r);
+    shm.clear();
+    return r;
+}
+
+} // namespace bench
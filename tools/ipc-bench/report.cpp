@@ -0,0 +1,440 @@
+#include <sys/utsname.h>
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <ctime>
+#include <cmath>
+#include <cctype>
+#include <cstdlib>
+#include <cstdio>
+
+#include "report.h"
+
+namespace bench {
+namespace {
+
+class parser {
+    char const * p_;
+    char const * end_;
+
+    void skip_ws() noexcept {
+        while ((p_ != end_) && std::isspace(static_cast<unsigned char>(*p_))) ++p_;
+    }
+
+    bool eat(char c) noexcept {
+        skip_ws();
+        if ((p_ == end_) || (*p_ != c)) return false;
+        ++p_;
+        return true;
+    }
+
+    bool literal(char const * s) noexcept {
+        auto q = p_;
+        for (; *s != '\0'; ++s, ++q) {
+            if ((q == end_) || (*q != *s)) return false;
+        }
+        p_ = q;
+        return true;
+    }
+
+    bool string(std::string & out) {
+        if (!eat('"')) return false;
+        out.clear();
+        while (p_ != end_) {
+            char c = *p_++;
+            if (c == '"') return true;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (p_ == end_) return false;
+            switch (c = *p_++) {
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case 'r': out += '\r'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'u': // only the ASCII ones are kept
+                if (end_ - p_ < 4) return false;
+                out += static_cast<char>(std::strtol(std::string(p_, p_ + 4).c_str(), nullptr, 16) & 0x7f);
+                p_ += 4;
+                break;
+            default : out += c; break;
+            }
+        }
+        return false;
+    }
+
+public:
+    parser(std::string const & text) noexcept
+        : p_(text.data()), end_(text.data() + text.size()) {}
+
+    bool value(json & v) {
+        skip_ws();
+        if (p_ == end_) return false;
+        switch (*p_) {
+        case '{':
+            ++p_;
+            v.type = json::kind::object;
+            if (eat('}')) return true;
+            do {
+                std::pair<std::string, json> kv;
+                if (!string(kv.first) || !eat(':') || !value(kv.second)) return false;
+                v.object.push_back(std::move(kv));
+            } while (eat(','));
+            return eat('}');
+        case '[':
+            ++p_;
+            v.type = json::kind::array;
+            if (eat(']')) return true;
+            do {
+                v.array.emplace_back();
+                if (!value(v.array.back())) return false;
+            } while (eat(','));
+            return eat(']');
+        case '"':
+            v.type = json::kind::string;
+            return string(v.string);
+        case 't':
+            v.type = json::kind::boolean;
+            return v.boolean = literal("true");
+        case 'f':
+            v.type = json::kind::boolean;
+            v.boolean = false;
+            return literal("false");
+        case 'n':
+            v.type = json::kind::null;
+            return literal("null");
+        default: {
+            char *q = nullptr;
+            v.type   = json::kind::number;
+            v.number = std::strtod(p_, &q);
+            if (q == p_) return false;
+            p_ = q;
+            return true;
+        }
+        }
+    }
+
+    bool finished() noexcept {
+        skip_ws();
+        return p_ == end_;
+    }
+};
+
+std::string escape(std::string const & s) {
+    std::string out;
+    for (char c : s) {
+        if ((c == '"') || (c == '\\')) out += '\\';
+        if (static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        }
+        else out += c;
+    }
+    return out;
+}
+
+std::string host_system() {
+    struct utsname u;
+    if (::uname(&u) != 0) return "unknown";
+    return std::string{u.sysname} + " " + u.release + " " + u.machine;
+}
+
+std::string utc_now() {
+    auto t = std::time(nullptr);
+    std::tm tm;
+    ::gmtime_r(&t, &tm);
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    return buf;
+}
+
+// A number which is always valid JSON.
+std::string number(double n) {
+    if (!std::isfinite(n)) return "0";
+    std::ostringstream ss;
+    ss << std::setprecision(12) << n;
+    return ss.str();
+}
+
+// +x% means better, whatever the metric is
+double change(double base, double curr, bool higher_is_better) {
+    if (base <= 0) return 0;
+    double d = (curr - base) / base;
+    return higher_is_better ? d : -d;
+}
+
+std::string percent(double d) {
+    if (std::fabs(d) < 0.0005) d = 0;
+    std::ostringstream ss;
+    ss << std::showpos << std::fixed << std::setprecision(1) << (d * 100.0) << "%";
+    return ss.str();
+}
+
+/*
+ * The counters per message under the row of a case, the kernel side is left out with
+ * perf_event_paranoid >= 2, e.g.
+ *   perf/msg: cycles 1.2K, IPC 0.85, L1D 12.3, LLC 0.41, br-miss 2.1, ctx-sw 0.02, faults 0.00 (user)
+*/
+void print_perf(std::ostream & os, result const & r) {
+    struct item { char const *name; double value; int precision; };
+    item const items[] = {
+        {"cycles" , r.perf.cycles          , 0},
+        {"IPC"    , ((r.perf.cycles > 0) && (r.perf.instructions >= 0)) ? (r.perf.instructions / r.perf.cycles) : -1, 2},
+        {"L1D"    , r.perf.l1d_misses      , 1},
+        {"LLC"    , r.perf.llc_misses      , 2},
+        {"br-miss", r.perf.branch_misses   , 1},
+        {"ctx-sw" , r.perf.context_switches, 2},
+        {"faults" , r.perf.page_faults     , 2},
+    };
+    bool first = true;
+    for (auto const & it : items) {
+        if (it.value < 0) continue;
+        os << (first ? "  perf/msg: " : ", ") << it.name << " ";
+        if ((it.precision == 0) || (it.value >= 1000)) os << human(it.value);
+        else os << std::fixed << std::setprecision(it.precision) << it.value << std::defaultfloat;
+        first = false;
+    }
+    if (!first) os << (r.perf.kernel ? "" : " (user)") << "\n";
+}
+
+} // namespace
+
+json const * json::find(char const * key) const noexcept {
+    for (auto const & kv : object) {
+        if (kv.first == key) return &kv.second;
+    }
+    return nullptr;
+}
+
+double json::num(char const * key, double def) const noexcept {
+    auto v = find(key);
+    return ((v == nullptr) || (v->type != kind::number)) ? def : v->number;
+}
+
+std::string json::str(char const * key) const {
+    auto v = find(key);
+    return ((v == nullptr) || (v->type != kind::string)) ? std::string{} : v->string;
+}
+
+bool json::parse(std::string const & text, json & out) {
+    parser p {text};
+    out = json{};
+    return p.value(out) && p.finished();
+}
+
+std::string human(double n) {
+    char const *units[] = {"", "K", "M", "G", "T"};
+    int u = 0;
+    while ((n >= 1000.0) && (u < 4)) {
+        n /= 1000.0;
+        ++u;
+    }
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision((u == 0) ? 0 : 1) << n << units[u];
+    return ss.str();
+}
+
+std::string human_ns(double ns) {
+    char const *units[] = {"ns", "us", "ms", "s"};
+    int u = 0;
+    while ((ns >= 1000.0) && (u < 3)) {
+        ns /= 1000.0;
+        ++u;
+    }
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision((u == 0) ? 0 : 1) << ns << units[u];
+    return ss.str();
+}
+
+std::string human_size(std::size_t n) {
+    char const *units[] = {"B", "K", "M", "G"};
+    int u = 0;
+    while ((n >= 1024) && (n % 1024 == 0) && (u < 3)) {
+        n /= 1024;
+        ++u;
+    }
+    return std::to_string(n) + units[u];
+}
+
+void print_header(std::ostream & os) {
+    os << std::left  << std::setw(34) << "CASE"
+       << std::right << std::setw(10) << "MSGS"
+       << std::setw(10) << "MSG/s" << std::setw(10) << "B/s"
+       << std::setw(9)  << "P50" << std::setw(9) << "P99" << std::setw(9) << "P99.9" << std::setw(9) << "MAX"
+       << std::setw(10) << "CPU/MSG" << std::setw(8) << "ERRORS" << "\n";
+}
+
+void print_row(std::ostream & os, result const & r) {
+    os << std::left  << std::setw(34) << r.name
+       << std::right << std::setw(10) << human(static_cast<double>(r.messages))
+       << std::setw(10) << human(r.msgs_per_sec)
+       << std::setw(10) << human(r.bytes_per_sec)
+       << std::setw(9)  << human_ns(r.latency.p50)
+       << std::setw(9)  << human_ns(r.latency.p99)
+       << std::setw(9)  << human_ns(r.latency.p999)
+       << std::setw(9)  << human_ns(r.latency.max)
+       << std::setw(10) << human_ns(r.cpu_ns_per_msg)
+       << std::setw(8)  << r.errors << "\n";
+    print_perf(os, r);
+    os << std::flush;
+}
+
+void write_json(std::ostream & os, std::vector<result> const & rs) {
+    os << "{\n"
+       << "  \"tool\": \"ipc-bench\",\n"
+       << "  \"version\": 1,\n"
+       << "  \"host\": {\"system\": \"" << escape(host_system()) << "\", "
+       <<              "\"cpus\": "     << std::thread::hardware_concurrency() << ", "
+       <<              "\"time\": \""   << utc_now() << "\"},\n"
+       << "  \"results\": [";
+    for (std::size_t i = 0; i < rs.size(); ++i) {
+        auto const & r = rs[i];
+        os << (i ? ",\n    " : "\n    ")
+           << "{\"name\": \""         << escape(r.name) << "\", "
+           << "\"mode\": \""          << escape(r.mode) << "\", "
+           << "\"variant\": \""       << escape(r.variant) << "\", "
+           << "\"producers\": "       << r.producers    << ", "
+           << "\"consumers\": "       << r.consumers    << ", "
+           << "\"size\": "            << r.size         << ", "
+           << "\"messages\": "        << r.messages     << ", "
+           << "\"delivered\": "       << r.delivered    << ", "
+           << "\"errors\": "          << r.errors       << ", "
+           << "\"kills\": "           << r.kills        << ", "
+           << "\"offered\": "         << number(r.offered)        << ", "
+           << "\"seconds\": "         << number(r.seconds)        << ", "
+           << "\"msgs_per_sec\": "    << number(r.msgs_per_sec)   << ", "
+           << "\"bytes_per_sec\": "   << number(r.bytes_per_sec)  << ", "
+           << "\"cpu_ns_per_msg\": "  << number(r.cpu_ns_per_msg) << ", "
+           << "\"latency_ns\": {"
+           <<     "\"mean\": " << number(r.latency.mean) << ", "
+           <<     "\"p50\": "  << number(r.latency.p50)  << ", "
+           <<     "\"p90\": "  << number(r.latency.p90)  << ", "
+           <<     "\"p99\": "  << number(r.latency.p99)  << ", "
+           <<     "\"p999\": " << number(r.latency.p999) << ", "
+           <<     "\"max\": "  << number(r.latency.max)  << "}, "
+           << "\"perf_per_msg\": {"
+           <<     "\"kernel\": " << (r.perf.kernel ? "true" : "false");
+        std::pair<char const *, double> const counters[] = {
+            {"cycles"          , r.perf.cycles          },
+            {"instructions"    , r.perf.instructions    },
+            {"l1d_misses"      , r.perf.l1d_misses      },
+            {"llc_misses"      , r.perf.llc_misses      },
+            {"branch_misses"   , r.perf.branch_misses   },
+            {"context_switches", r.perf.context_switches},
+            {"page_faults"     , r.perf.page_faults     },
+        };
+        // an unavailable counter is left out
+        for (auto const & c : counters) {
+            if (c.second >= 0) os << ", \"" << c.first << "\": " << number(c.second);
+        }
+        os << "}}";
+    }
+    os << "\n  ]\n}\n";
+}
+
+bool read_json(std::string const & path, std::vector<result> & rs) {
+    std::ifstream in {path};
+    if (!in) {
+        std::cerr << "ipc-bench: cannot open " << path << "\n";
+        return false;
+    }
+    std::stringstream ss;
+    ss << in.rdbuf();
+    json doc;
+    if (!json::parse(ss.str(), doc) || (doc.type != json::kind::object)) {
+        std::cerr << "ipc-bench: " << path << " is not a valid JSON document\n";
+        return false;
+    }
+    auto list = doc.find("results");
+    if ((list == nullptr) || (list->type != json::kind::array)) {
+        std::cerr << "ipc-bench: " << path << " has no results\n";
+        return false;
+    }
+    for (auto const & v : list->array) {
+        result r;
+        r.name           = v.str("name");
+        r.mode           = v.str("mode");
+        r.variant        = v.str("variant");
+        r.producers      = static_cast<unsigned>     (v.num("producers"));
+        r.consumers      = static_cast<unsigned>     (v.num("consumers"));
+        r.size           = static_cast<std::size_t>  (v.num("size"));
+        r.messages       = static_cast<std::uint64_t>(v.num("messages"));
+        r.delivered      = static_cast<std::uint64_t>(v.num("delivered"));
+        r.errors         = static_cast<std::uint64_t>(v.num("errors"));
+        r.kills          = static_cast<std::uint64_t>(v.num("kills"));
+        r.offered        = v.num("offered");
+        r.seconds        = v.num("seconds");
+        r.msgs_per_sec   = v.num("msgs_per_sec");
+        r.bytes_per_sec  = v.num("bytes_per_sec");
+        r.cpu_ns_per_msg = v.num("cpu_ns_per_msg");
+        if (auto lat = v.find("latency_ns")) {
+            r.latency.mean = lat->num("mean");
+            r.latency.p50  = lat->num("p50");
+            r.latency.p90  = lat->num("p90");
+            r.latency.p99  = lat->num("p99");
+            r.latency.p999 = lat->num("p999");
+            r.latency.max  = lat->num("max");
+        }
+        if (auto perf = v.find("perf_per_msg")) {
+            auto kernel = perf->find("kernel");
+            r.perf.kernel           = (kernel != nullptr) && kernel->boolean;
+            r.perf.cycles           = perf->num("cycles"          , -1);
+            r.perf.instructions     = perf->num("instructions"    , -1);
+            r.perf.l1d_misses       = perf->num("l1d_misses"      , -1);
+            r.perf.llc_misses       = perf->num("llc_misses"      , -1);
+            r.perf.branch_misses    = perf->num("branch_misses"   , -1);
+            r.perf.context_switches = perf->num("context_switches", -1);
+            r.perf.page_faults      = perf->num("page_faults"     , -1);
+        }
+        if (!r.name.empty()) rs.push_back(std::move(r));
+    }
+    return true;
+}
+
+std::size_t compare(std::ostream & os, std::vector<result> const & base,
+                    std::vector<result> const & curr, double threshold) {
+    os << std::left  << std::setw(34) << "CASE"
+       << std::right << std::setw(10) << "MSG/s" << std::setw(10) << "BASE" << std::setw(9) << "CHANGE"
+       << std::setw(9)  << "P99" << std::setw(9) << "BASE" << std::setw(9) << "CHANGE"
+       << std::setw(9)  << "CPU/MSG" << std::setw(9) << "CHANGE"
+       << std::setw(9)  << "CYC/MSG" << std::setw(9) << "CHANGE" << "\n";
+    std::size_t regressions = 0;
+    for (auto const & c : curr) {
+        result const * b = nullptr;
+        for (auto const & r : base) {
+            if (r.name == c.name) {
+                b = &r;
+                break;
+            }
+        }
+        os << std::left << std::setw(34) << c.name << std::right;
+        if (b == nullptr) {
+            os << std::setw(10) << human(c.msgs_per_sec) << "  (not in the baseline)\n";
+            continue;
+        }
+        auto tput = change(b->msgs_per_sec  , c.msgs_per_sec  , true );
+        auto p99  = change(b->latency.p99   , c.latency.p99   , false);
+        auto cpu  = change(b->cpu_ns_per_msg, c.cpu_ns_per_msg, false);
+        // the cycles are only compared if both runs could count them
+        bool cyc_ok = (b->perf.cycles > 0) && (c.perf.cycles >= 0);
+        auto cyc  = cyc_ok ? change(b->perf.cycles, c.perf.cycles, false) : 0;
+        bool bad  = (tput < -threshold) || (p99 < -threshold) || (cpu < -threshold) || (cyc < -threshold)
+                 || ((c.kills == 0) && (c.errors > b->errors));
+        if (bad) ++regressions;
+        os << std::setw(10) << human(c.msgs_per_sec)    << std::setw(10) << human(b->msgs_per_sec)    << std::setw(9) << percent(tput)
+           << std::setw(9)  << human_ns(c.latency.p99)  << std::setw(9)  << human_ns(b->latency.p99)  << std::setw(9) << percent(p99)
+           << std::setw(9)  << human_ns(c.cpu_ns_per_msg)                                             << std::setw(9) << percent(cpu)
+           << std::setw(9)  << (cyc_ok ? human(c.perf.cycles) : "-")                                  << std::setw(9) << (cyc_ok ? percent(cyc) : "-")
+           << (bad ? "  REGRESSION" : "") << "\n";
+    }
+    os << std::flush;
+    return regressions;
+}
+
+} // namespace bench
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>
+#include <iosfwd>
+
+/**
+ * The results of ipc-bench, and the JSON document they are saved in:
+ *
+ *  {
+ *    "tool": "ipc-bench", "version": 1,
+ *    "host": { "system": "...", "cpus": 8, "time": "..." },
+ *    "results": [ { "name": "smb/1x4/64B", "mode": "smb", ... }, ... ]
+ *  }
+ *
+ * A result is matched against its baseline by name.
+*/
+
+namespace bench {
+
+struct result {
+    std::string   name;       // mode/PxC/size[/variant], the key of the comparison
+    std::string   mode;
+    std::string   variant;    // empty for threads, "proc" for processes, "proc+kill" with random kills
+    unsigned      producers = 0;
+    unsigned      consumers = 0;
+    std::size_t   size      = 0; // the mean size
+    std::uint64_t messages  = 0; // sent by all the producers
+    std::uint64_t delivered = 0; // received by all the consumers
+    std::uint64_t errors    = 0; // failed sends, lost messages, ...
+    std::uint64_t kills     = 0; // processes killed on purpose during the run
+    double        offered   = 0; // msgs/s the producers have been paced at, 0 for a closed loop
+    double        seconds   = 0;
+    double        msgs_per_sec  = 0;
+    double        bytes_per_sec = 0;
+    double        cpu_ns_per_msg = 0; // the CPU time of the process(es) per delivered message
+
+    // send->recv latency in ns
+    struct {
+        double mean = 0;
+        double p50  = 0;
+        double p90  = 0;
+        double p99  = 0;
+        double p999 = 0;
+        double max  = 0;
+    } latency;
+
+    // The counters of the producers & consumers during the run per delivered message,
+    // a negative one isn't available (no PMU, perf_event_paranoid, ...).
+    struct {
+        bool   kernel           = false; // whether the kernel side is counted too
+        double cycles           = -1;
+        double instructions     = -1;
+        double l1d_misses       = -1;
+        double llc_misses       = -1;
+        double branch_misses    = -1;
+        double context_switches = -1;
+        double page_faults      = -1;
+    } perf;
+};
+
+// A parsed JSON value, only as much as reading a saved report needs.
+struct json {
+    enum class kind { null, boolean, number, string, array, object };
+
+    kind        type    = kind::null;
+    bool        boolean = false;
+    double      number  = 0;
+    std::string string;
+    std::vector<json> array;
+    std::vector<std::pair<std::string, json>> object;
+
+    json const * find(char const * key) const noexcept;
+    double       num (char const * key, double def = 0) const noexcept;
+    std::string  str (char const * key) const;
+
+    static bool parse(std::string const & text, json & out);
+};
+
+std::string human(double n);
+std::string human_ns(double ns);
+std::string human_size(std::size_t n);
+
+// Prints the header of the text table, and a row of it (followed by the counters if there are any).
+void print_header(std::ostream & os);
+void print_row(std::ostream & os, result const & r);
+
+void write_json(std::ostream & os, std::vector<result> const & rs);
+bool read_json (std::string const & path, std::vector<result> & rs);
+
+/**
+ * Prints the changes of throughput, p99 latency, CPU time & cycles against the baseline,
+ * returns how many results have regressed by more than 'threshold' (a fraction, 0.1 is 10%).
+*/
+std::size_t compare(std::ostream & os, std::vector<result> const & base,
+                    std::vector<result> const & curr, double threshold);
+
+} // namespace bench
@@ -0,0 +1,472 @@
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <cstring>
+#include <cstdlib>
+
+#include "libipc/shm.h"
+#include "libipc/mutex.h"
+#include "libipc/condition.h"
+#include "libipc/semaphore.h"
+#include "libipc/waiter.h"
+
+#include "bench.h"
+
+namespace bench {
+namespace {
+
+enum : std::size_t {
+    sample_capacity = 1 << 16, // latency samples of each process
+    batch           = 64       // the uncontended ops are timed in batches, a clock read costs as much as an op
+};
+
+/**
+ * The block shared by the harness & the workers of a sync case, followed by the latency samples of each worker.
+ * A new segment is zero-filled, which is the initial state of all the members.
+*/
+struct shared_t {
+    std::atomic<unsigned>      ready;
+    std::atomic<unsigned>      phase;   // 0: connecting, 1: measuring
+    std::atomic<unsigned>      quit;    // the notifier is done
+    std::atomic<std::uint64_t> errors;
+    std::atomic<std::uint64_t> cpu_ns;
+    std::atomic<std::uint64_t> ops;
+    std::atomic<std::uint64_t> end_ns;  // when the last worker has finished
+    // handoff: the last owner of the mutex (index + 1) & when it has unlocked it
+    std::atomic<unsigned>      owner;
+    std::atomic<std::uint64_t> unlocked;
+    // wakeup: a token, when it has been notified & how many have been woken up by it
+    std::atomic<unsigned>      pending;
+    std::atomic<std::uint64_t> stamp;
+    std::atomic<std::uint64_t> acked;
+    std::atomic<std::uint64_t> stored[max_sync_procs];
+    shared_perf                perf;
+
+    std::uint64_t *samples_of(unsigned k) noexcept {
+        return reinterpret_cast<std::uint64_t *>(this + 1) + (k * sample_capacity);
+    }
+};
+
+std::size_t shared_size(unsigned procs) noexcept {
+    return sizeof(shared_t) + (procs * sample_capacity * sizeof(std::uint64_t));
+}
+
+// The command line of a worker:
+// --sync-worker primitive scenario name shared index procs count cpu
+struct worker_args {
+    sync_case     c;
+    std::string   name;
+    std::string   shared;
+    unsigned      index = 0;
+    int           cpu   = -1;
+
+    std::vector<std::string> to_argv(std::string const & exe) const {
+        return {exe, "--sync-worker", c.primitive, c.scenario, name, shared,
+                std::to_string(index), std::to_string(c.procs), std::to_string(c.count), std::to_string(cpu)};
+    }
+
+    bool parse(int argc, char ** argv) {
+        if (argc != 10) return false;
+        c.primitive = argv[2];
+        c.scenario  = argv[3];
+        name        = argv[4];
+        shared      = argv[5];
+        index       = static_cast<unsigned>(std::strtoul(argv[6], nullptr, 10));
+        c.procs     = static_cast<unsigned>(std::strtoul(argv[7], nullptr, 10));
+        c.count     = std::strtoull(argv[8], nullptr, 10);
+        cpu         = std::atoi(argv[9]);
+        return (c.procs <= max_sync_procs) && (index < c.procs);
+    }
+};
+
+class recorder {
+    shared_t &    sh_;
+    unsigned      index_;
+    std::uint64_t stride_;
+    std::uint64_t count_ = 0;
+
+public:
+    recorder(shared_t & sh, unsigned index, std::uint64_t expected)
+        : sh_(sh), index_(index), stride_((expected / sample_capacity) + 1) {}
+
+    void add(std::uint64_t ns) noexcept {
+        if ((count_++ % stride_) != 0) return;
+        auto i = sh_.stored[index_].fetch_add(1, std::memory_order_relaxed);
+        if (i < sample_capacity) sh_.samples_of(index_)[i] = ns;
+    }
+};
+
+void wait_until(std::atomic<unsigned> const & a, unsigned n) {
+    while (a.load(std::memory_order_acquire) < n) std::this_thread::yield();
+}
+
+/**
+ * The cost of an op nobody else is interested in:
+ * mutex lock + unlock, semaphore post + wait, condition/waiter notify with no one waiting.
+*/
+template <typename Op>
+void uncontended(worker_args const & a, shared_t & sh, ipc::detail::perf_counters & pc, Op && op) {
+    for (int i = 0; i < 1000; ++i) op(); // warm-up
+    recorder rec {sh, a.index, a.c.count / batch};
+    pc.start();
+    for (std::uint64_t n = 0; n < a.c.count; n += batch) {
+        auto beg = now_ns();
+        for (std::size_t i = 0; i < batch; ++i) {
+            if (!op()) sh.errors.fetch_add(1, std::memory_order_relaxed);
+        }
+        rec.add((now_ns() - beg) / batch);
+        sh.ops.fetch_add(batch, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * All the workers take the mutex in turn,
+ * the latency is from an unlock to the lock by another process.
+*/
+void handoff(worker_args const & a, shared_t & sh, ipc::detail::perf_counters & pc, ipc::sync::mutex & mtx) {
+    recorder rec {sh, a.index, a.c.count};
+    pc.start();
+    for (std::uint64_t n = 0; n < a.c.count; ++n) {
+        if (!mtx.lock()) {
+            sh.errors.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        auto now   = now_ns();
+        auto owner = sh.owner.load(std::memory_order_relaxed);
+        if ((owner != 0) && (owner != a.index + 1)) {
+            rec.add(now - sh.unlocked.load(std::memory_order_relaxed));
+        }
+        sh.owner.store(a.index + 1, std::memory_order_relaxed);
+        sh.ops.fetch_add(1, std::memory_order_relaxed);
+        sh.unlocked.store(now_ns(), std::memory_order_relaxed);
+        mtx.unlock();
+    }
+}
+
+/**
+ * Worker 0 notifies, the others wait.
+ * A round is a token passed to one of the waiters, the notifier waits for it to be taken before the next one,
+ * so the latency is from the notification to a waiter being up & running.
+ * 'signal' hands a token over, 'finish' wakes all the waiters up to quit,
+ * 'wait' waits for a token for a while & returns whether it has got one.
+*/
+template <typename Signal, typename Finish, typename Wait>
+void wakeup(worker_args const & a, shared_t & sh, ipc::detail::perf_counters & pc,
+            Signal && signal, Finish && finish, Wait && wait) {
+    pc.start();
+    if (a.index == 0) {
+        for (std::uint64_t n = 0; n < a.c.count; ++n) {
+            sh.stamp.store(now_ns(), std::memory_order_relaxed);
+            if (!signal()) {
+                sh.errors.fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+            auto deadline = now_ns() + idle_limit * 1000000ull;
+            while (sh.acked.load(std::memory_order_acquire) <= n) {
+                if (now_ns() > deadline) {
+                    sh.errors.fetch_add(a.c.count - n, std::memory_order_relaxed);
+                    n = a.c.count;
+                    break;
+                }
+                std::this_thread::yield();
+            }
+        }
+        sh.quit.store(1, std::memory_order_release);
+        finish();
+        return;
+    }
+    recorder rec {sh, a.index, a.c.count / (a.c.procs - 1)};
+    std::uint64_t idle = 0; // a waiter which waits untimed relies on the watchdog of the harness
+    while (sh.quit.load(std::memory_order_acquire) == 0) {
+        if (!wait()) {
+            if ((idle += recv_tick) >= idle_limit) {
+                sh.errors.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            continue;
+        }
+        rec.add(now_ns() - sh.stamp.load(std::memory_order_relaxed));
+        idle = 0;
+        sh.ops.fetch_add(1, std::memory_order_relaxed);
+        sh.acked.fetch_add(1, std::memory_order_release);
+    }
+}
+
+int run_mutex(worker_args const & a, shared_t & sh, ipc::detail::perf_counters & pc) {
+    ipc::sync::mutex mtx {a.name.c_str()};
+    if (!mtx.valid()) return 1;
+    sh.ready.fetch_add(1, std::memory_order_release);
+    wait_until(sh.phase, 1);
+    if (a.c.scenario == "uncontended") {
+        uncontended(a, sh, pc, [&] { return mtx.lock() && mtx.unlock(); });
+    }
+    else handoff(a, sh, pc, mtx);
+    return 0;
+}
+
+int run_semaphore(worker_args const & a, shared_t & sh, ipc::detail::perf_counters & pc) {
+    ipc::sync::semaphore sem {a.name.c_str(), 0};
+    if (!sem.valid()) return 1;
+    sh.ready.fetch_add(1, std::memory_order_release);
+    wait_until(sh.phase, 1);
+    if (a.c.scenario == "uncontended") {
+        uncontended(a, sh, pc, [&] { return sem.post() && sem.wait(); });
+        return 0;
+    }
+    wakeup(a, sh, pc,
+        [&] { return sem.post(); },
+        [&] { sem.post(a.c.procs - 1); },
+        [&] { return sem.wait() && (sh.quit.load(std::memory_order_acquire) == 0); });
+    return 0;
+}
+
+int run_condition(worker_args const & a, shared_t & sh, ipc::detail::perf_counters & pc) {
+    ipc::sync::mutex     mtx  {(a.name + "_LOCK_").c_str()};
+    ipc::sync::condition cond {a.name.c_str()};
+    if (!mtx.valid() || !cond.valid()) return 1;
+    sh.ready.fetch_add(1, std::memory_order_release);
+    wait_until(sh.phase, 1);
+    if (a.c.scenario == "uncontended") {
+        uncontended(a, sh, pc, [&] { return cond.notify(mtx); });
+        return 0;
+    }
+    wakeup(a, sh, pc,
+        [&] {
+            IPC_UNUSED_ std::lock_guard<ipc::sync::mutex> guard {mtx};
+            sh.pending.store(1, std::memory_order_relaxed);
+            return cond.notify(mtx);
+        },
+        [&] {
+            IPC_UNUSED_ std::lock_guard<ipc::sync::mutex> guard {mtx};
+            cond.broadcast(mtx);
+        },
+        [&] {
+            IPC_UNUSED_ std::lock_guard<ipc::sync::mutex> guard {mtx};
+            while (sh.pending.load(std::memory_order_relaxed) == 0) {
+                if (sh.quit.load(std::memory_order_acquire) != 0) return false;
+                if (!cond.wait(mtx, recv_tick)) return false;
+            }
+            sh.pending.store(0, std::memory_order_relaxed);
+            return true;
+        });
+    return 0;
+}
+
+int run_waiter(worker_args const & a, shared_t & sh, ipc::detail::perf_counters & pc) {
+    ipc::detail::waiter w {a.name.c_str()};
+    if (!w.valid()) return 1;
+    sh.ready.fetch_add(1, std::memory_order_release);
+    wait_until(sh.phase, 1);
+    if (a.c.scenario == "uncontended") {
+        uncontended(a, sh, pc, [&] { return w.notify(); });
+        return 0;
+    }
+    wakeup(a, sh, pc,
+        [&] {
+            sh.pending.store(1, std::memory_order_release);
+            return w.notify();
+        },
+        [&] { w.broadcast(); },
+        [&] {
+            if (!w.wait_if([&] {
+                    return (sh.pending.load(std::memory_order_acquire) == 0)
+                        && (sh.quit   .load(std::memory_order_acquire) == 0);
+                }, recv_tick)) {
+                return false;
+            }
+            return sh.pending.exchange(0, std::memory_order_acq_rel) != 0;
+        });
+    return 0;
+}
+
+void clear_storage(std::string const & primitive, std::string const & name) {
+    if (primitive == "mutex") {
+        ipc::sync::mutex::clear_storage(name.c_str());
+    }
+    else if (primitive == "semaphore") {
+        ipc::sync::semaphore::clear_storage(name.c_str());
+    }
+    else if (primitive == "condition") {
+        ipc::sync::mutex::clear_storage((name + "_LOCK_").c_str());
+        ipc::sync::condition::clear_storage(name.c_str());
+    }
+    else ipc::detail::waiter::clear_storage(name.c_str());
+}
+
+} // namespace
+
+std::vector<sync_case> sync_cases(unsigned max_procs, std::uint64_t count, bool quick) {
+    std::vector<sync_case> cs;
+    // contended even on a single CPU, where the processes take turns
+    max_procs = (std::max)(2u, (std::min)(max_procs, unsigned(max_sync_procs)));
+    auto counts = [&](std::uint64_t dflt) {
+        return (count != 0) ? count : (quick ? (dflt / 10) : dflt);
+    };
+    for (auto const & prim : {"mutex", "semaphore", "condition", "waiter"}) {
+        cs.push_back({prim, "uncontended", 1, counts(1000000)});
+        std::string scenario = (std::strcmp(prim, "mutex") == 0) ? "handoff" : "wakeup";
+        for (unsigned n = 2; ; n <<= 1) {
+            n = (std::min)(n, max_procs);
+            cs.push_back({prim, scenario, n, counts(20000)});
+            if (n == max_procs) break;
+        }
+    }
+    return cs;
+}
+
+/**
+ * Like run_processes, every worker is this executable started with "--sync-worker",
+ * so that the primitives are shared through nothing but their names.
+*/
+result run_sync(sync_case const & c, std::vector<int> const & cpus, bool pin, std::string const & exe) {
+    result r;
+    r.mode      = c.primitive;
+    r.variant   = c.scenario;
+    r.producers = c.procs;
+    r.name      = c.primitive + "/" + c.scenario + "/" + std::to_string(c.procs) + "p";
+    r.messages  = (c.scenario == "handoff") ? (c.count * c.procs) : c.count;
+    if ((c.procs == 0) || (c.procs > max_sync_procs) || ((c.scenario != "uncontended") && (c.procs < 2))) {
+        r.errors = 1;
+        return r;
+    }
+    auto name   = channel_name();
+    auto shared = name + "-harness";
+    clear_storage(c.primitive, name);
+    ipc::shm::handle::clear_storage(shared.c_str());
+    ipc::shm::handle shm {shared.c_str(), shared_size(c.procs)};
+    if (!shm.valid()) {
+        std::cerr << "ipc-bench: cannot create the shared block: " << shared << "\n";
+        r.errors = 1;
+        return r;
+    }
+    auto & sh = *static_cast<shared_t *>(shm.get());
+
+    std::vector<int> pids;
+    std::uint64_t unexpected = 0;
+    for (unsigned k = 0; k < c.procs; ++k) {
+        worker_args a;
+        a.c      = c;
+        a.name   = name;
+        a.shared = shared;
+        a.index  = k;
+        a.cpu    = (pin && !cpus.empty()) ? cpus[k % cpus.size()] : -1;
+        auto pid = spawn(a.to_argv(exe));
+        if (pid == 0) ++unexpected;
+        else pids.push_back(pid);
+    }
+    auto reap = [&] {
+        int st = 0;
+        pid_t pid;
+        while ((pid = ::waitpid(-1, &st, WNOHANG)) > 0) {
+            for (auto & p : pids) {
+                if (p != pid) continue;
+                p = 0;
+                if (!WIFEXITED(st) || (WEXITSTATUS(st) != 0)) ++unexpected;
+            }
+        }
+    };
+    auto alive = [&] {
+        for (auto p : pids) {
+            if (p != 0) return true;
+        }
+        return false;
+    };
+
+    std::uint64_t beg = now_ns(), end = beg;
+    auto deadline = beg + idle_limit * 1000000ull;
+    while ((unexpected == 0) && (sh.ready.load(std::memory_order_acquire) < c.procs) && (now_ns() < deadline)) {
+        reap();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if ((unexpected == 0) && (sh.ready.load(std::memory_order_acquire) == c.procs)) {
+        beg = now_ns();
+        sh.phase.store(1, std::memory_order_release);
+        auto last    = sh.ops.load(std::memory_order_relaxed);
+        auto last_tp = beg;
+        while (alive()) {
+            reap();
+            auto now  = now_ns();
+            auto curr = sh.ops.load(std::memory_order_relaxed);
+            if (curr != last) {
+                last    = curr;
+                last_tp = now;
+            }
+            else if (now - last_tp > 2 * idle_limit * 1000000ull) {
+                std::cerr << "ipc-bench: " << r.name << " made no progress, the workers are killed\n";
+                ++unexpected;
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        end = (std::max)(sh.end_ns.load(std::memory_order_relaxed), beg);
+    }
+    else {
+        std::cerr << "ipc-bench: " << r.name << " failed to start the workers\n";
+        ++unexpected;
+    }
+    for (auto p : pids) {
+        if (p == 0) continue;
+        ::kill(p, SIGKILL);
+        ::waitpid(p, nullptr, 0);
+    }
+    clear_storage(c.primitive, name);
+
+    std::vector<std::uint64_t> samples;
+    for (unsigned k = 0; k < c.procs; ++k) {
+        auto n  = (std::min<std::uint64_t>)(sh.stored[k].load(std::memory_order_relaxed), sample_capacity);
+        auto *s = sh.samples_of(k);
+        samples.insert(samples.end(), s, s + n);
+    }
+    r.delivered = sh.ops.load(std::memory_order_relaxed);
+    r.errors    = sh.errors.load(std::memory_order_relaxed) + unexpected
+                + ((r.delivered < r.messages) ? (r.messages - r.delivered) : 0);
+    r.seconds   = static_cast<double>(end - beg) / 1e9;
+    if (r.seconds > 0) {
+        r.msgs_per_sec = static_cast<double>(r.delivered) / r.seconds;
+    }
+    if (r.delivered > 0) {
+        r.cpu_ns_per_msg = static_cast<double>(sh.cpu_ns.load(std::memory_order_relaxed)) / static_cast<double>(r.delivered);
+    }
+    summarize(samples, r);
+    sh.perf.normalize(r);
+    shm.clear();
+    return r;
+}
+
+int sync_worker_main(int argc, char ** argv) {
+    worker_args a;
+    if (!a.parse(argc, argv)) {
+        std::cerr << "ipc-bench: invalid sync worker arguments\n";
+        return 1;
+    }
+    if (a.cpu >= 0) pin_thread({a.cpu}, 0);
+    ipc::shm::handle shm {a.shared.c_str(), shared_size(a.c.procs), ipc::shm::open};
+    if (!shm.valid()) {
+        std::cerr << "ipc-bench: cannot open the shared block: " << a.shared << "\n";
+        return 1;
+    }
+    auto & sh = *static_cast<shared_t *>(shm.get());
+    ipc::detail::perf_counters pc;
+    auto cpu = process_cpu_ns();
+    int ret  = (a.c.primitive == "mutex")     ? run_mutex    (a, sh, pc)
+             : (a.c.primitive == "semaphore") ? run_semaphore(a, sh, pc)
+             : (a.c.primitive == "condition") ? run_condition(a, sh, pc)
+             :                                  run_waiter   (a, sh, pc);
+    auto now = now_ns();
+    auto end = sh.end_ns.load(std::memory_order_relaxed);
+    while ((end < now) && !sh.end_ns.compare_exchange_weak(end, now, std::memory_order_relaxed)) ;
+    sh.perf.add(pc);
+    sh.cpu_ns.fetch_add(process_cpu_ns() - cpu, std::memory_order_relaxed);
+    return ret;
+}
+
+} // namespace bench
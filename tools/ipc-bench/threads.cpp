@@ -0,0 +1,156 @@
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <cstring>
+
+#include "bench.h"
+
+namespace bench {
+namespace {
+
+void wait_until(std::atomic<unsigned> const & a, unsigned n) {
+    while (a.load(std::memory_order_acquire) < n) std::this_thread::yield();
+}
+
+/**
+ * Every producer sends a warm-up round first, which maps the shared memory & faults the pages in,
+ * then the clock starts and they send 'count' messages each, paced if there is a rate.
+ * Each message carries its (intended) send time in the first 8 bytes.
+*/
+template <typename Chan>
+result run(config const & cfg, std::vector<int> const & cpus) {
+    auto r      = make_result(cfg);
+    auto name   = channel_name();
+    auto warmup = warmup_of(cfg.count);
+    // a broadcast consumer receives everything, an unicast one (a single consumer here) too
+    auto total  = cfg.count * cfg.producers;
+    auto max_size = cfg.size.max();
+
+    std::atomic<unsigned>      ready  {0};
+    std::atomic<unsigned>      phase  {0};
+    std::atomic<unsigned>      warmed {0};
+    std::atomic<std::uint64_t> errors {0};
+    std::atomic<std::uint64_t> delivered {0};
+    std::vector<sampler> samplers(cfg.consumers, sampler{total});
+    std::mutex perf_lock;
+    ipc::detail::perf_values perf_sum;
+    bool perf_kernel = true;
+    // each thread counts itself over the measured phase only
+    auto add_perf = [&](ipc::detail::perf_counters & pc) {
+        pc.stop();
+        if (!pc.valid()) return;
+        auto v = pc.read();
+        std::lock_guard<std::mutex> guard {perf_lock};
+        perf_sum += v;
+        perf_kernel = perf_kernel && pc.kernel();
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned k = 0; k < cfg.consumers; ++k) {
+        threads.emplace_back([&, k] {
+            if (cfg.pin) pin_thread(cpus, cfg.producers + k);
+            Chan ch {name.c_str(), ipc::receiver};
+            ipc::detail::perf_counters pc;
+            ready.fetch_add(1, std::memory_order_release);
+            auto receive = [&](std::uint64_t n, sampler *smp) {
+                std::uint64_t idle = 0;
+                for (std::uint64_t i = 0; i < n;) {
+                    auto buf = ch.recv(recv_tick);
+                    if (buf.empty()) {
+                        if ((idle += recv_tick) < idle_limit) continue;
+                        errors.fetch_add(n - i, std::memory_order_relaxed);
+                        return i;
+                    }
+                    auto now = now_ns();
+                    idle = 0;
+                    ++i;
+                    if ((buf.size() < cfg.size.min()) || (buf.size() > max_size)) {
+                        errors.fetch_add(1, std::memory_order_relaxed);
+                        continue;
+                    }
+                    if (smp != nullptr) {
+                        std::uint64_t stamp;
+                        std::memcpy(&stamp, buf.data(), sizeof(stamp));
+                        smp->add(now - stamp);
+                    }
+                }
+                return n;
+            };
+            receive(warmup * cfg.producers, nullptr);
+            warmed.fetch_add(1, std::memory_order_release);
+            pc.start();
+            delivered.fetch_add(receive(total, &samplers[k]), std::memory_order_relaxed);
+            add_perf(pc);
+        });
+    }
+    for (unsigned k = 0; k < cfg.producers; ++k) {
+        threads.emplace_back([&, k] {
+            if (cfg.pin) pin_thread(cpus, k);
+            Chan ch {name.c_str(), ipc::sender};
+            std::vector<char> buf(max_size, static_cast<char>('A' + k));
+            std::mt19937_64 rng {k + 1};
+            ipc::detail::perf_counters pc;
+            ready.fetch_add(1, std::memory_order_release);
+            auto send = [&](std::uint64_t n, pacer & pc) {
+                pc.start(now_ns());
+                for (std::uint64_t i = 0; i < n; ++i) {
+                    auto stamp = pc.next();
+                    std::memcpy(buf.data(), &stamp, sizeof(stamp));
+                    if (!ch.send(buf.data(), cfg.size(rng), send_timeout)) {
+                        errors.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            };
+            pacer closed {0, false, 0};
+            pacer paced  {cfg.rate / cfg.producers, cfg.poisson, k + 1};
+            wait_until(phase, 1);
+            send(warmup, closed);
+            wait_until(phase, 2);
+            pc.start();
+            send(cfg.count, paced);
+            add_perf(pc);
+            errors.fetch_add(ch.overflow_counters().disconnected, std::memory_order_relaxed);
+        });
+    }
+
+    wait_until(ready, cfg.producers + cfg.consumers);
+    phase.store(1, std::memory_order_release);
+    wait_until(warmed, cfg.consumers);
+    auto cpu = process_cpu_ns();
+    auto beg = now_ns();
+    phase.store(2, std::memory_order_release);
+    for (auto & t : threads) t.join();
+    auto end = now_ns();
+    cpu = process_cpu_ns() - cpu;
+    Chan::clear_storage(name.c_str());
+
+    r.delivered = delivered.load(std::memory_order_relaxed);
+    r.errors    = errors.load(std::memory_order_relaxed);
+    r.seconds   = static_cast<double>(end - beg) / 1e9;
+    if (r.seconds > 0) {
+        r.msgs_per_sec  = static_cast<double>(r.messages) / r.seconds;
+        r.bytes_per_sec = r.msgs_per_sec * static_cast<double>(r.size);
+    }
+    if (r.delivered > 0) {
+        r.cpu_ns_per_msg = static_cast<double>(cpu) / static_cast<double>(r.delivered);
+    }
+    std::vector<std::uint64_t> all;
+    for (auto & s : samplers) {
+        all.insert(all.end(), s.samples().begin(), s.samples().end());
+    }
+    summarize(all, r);
+    normalize(perf_sum, perf_kernel, r);
+    return r;
+}
+
+} // namespace
+
+result run_threads(config const & cfg, std::vector<int> const & cpus) {
+    return with_chan(cfg.mode, [&](auto tag) {
+        return run<typename decltype(tag)::type>(cfg, cpus);
+    });
+}
+
+} // namespace bench
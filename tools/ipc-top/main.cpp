@@ -0,0 +1,263 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <signal.h>
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#include "libipc/stats.h"
+
+/**
+ * ipc-top: watches the statistics blocks of all the channels on this machine.
+ * The blocks are mapped read-only, so it never takes part in (or keeps alive) a channel.
+ *
+ * usage: ipc-top [-i interval_ms] [-n iterations] [-v] [name-filter]
+*/
+
+namespace {
+
+constexpr char const shm_dir__ [] = "/dev/shm";
+constexpr char const shm_tag__ [] = "__IPC_SHM__";
+constexpr char const stats_tag__[] = "ST_CONN__";
+constexpr char const typed_tag__[] = "ST_SLOT__"; // the typed channels, see ipc::typed_chan
+
+std::atomic<bool> is_quit__ {false};
+
+struct totals_t {
+    std::uint64_t sent  = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t recv  = 0;
+    std::uint64_t force = 0;
+};
+
+class mapping {
+    void *      mem_  = MAP_FAILED;
+    std::size_t size_ = 0;
+
+public:
+    explicit mapping(std::string const & file) {
+        int fd = ::shm_open(("/" + file).c_str(), O_RDONLY, 0);
+        if (fd == -1) return;
+        struct stat st;
+        if ((::fstat(fd, &st) == 0) && (static_cast<std::size_t>(st.st_size) >= sizeof(ipc::stats::channel))) {
+            size_ = static_cast<std::size_t>(st.st_size);
+            mem_  = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+    }
+
+    ~mapping() {
+        if (mem_ != MAP_FAILED) ::munmap(mem_, size_);
+    }
+
+    mapping(mapping const &) = delete;
+    mapping & operator=(mapping const &) = delete;
+
+    ipc::stats::channel const * get() const noexcept {
+        if (mem_ == MAP_FAILED) return nullptr;
+        auto st = static_cast<ipc::stats::channel const *>(mem_);
+        if ((st->magic  .load(std::memory_order_relaxed) != ipc::stats::magic) ||
+            (st->version.load(std::memory_order_relaxed) != ipc::stats::version)) {
+            return nullptr;
+        }
+        return st;
+    }
+};
+
+// "[prefix]__IPC_SHM__ST_CONN__name" => "[prefix/]name"
+// "[prefix]__IPC_SHM__ST_SLOT__name" => "[prefix/]name[typed]"
+std::string channel_name(std::string const & file) {
+    static_assert(sizeof(stats_tag__) == sizeof(typed_tag__), "the tags should have the same length");
+    auto tag = file.find(shm_tag__);
+    auto pos = tag + sizeof(shm_tag__) - 1;
+    std::string name = file.substr(pos + sizeof(stats_tag__) - 1);
+    if (file.compare(pos, sizeof(typed_tag__) - 1, typed_tag__) == 0) name += "[typed]";
+    return (tag == 0) ? name : (file.substr(0, tag) + "/" + name);
+}
+
+std::vector<std::string> list_channels(std::string const & filter) {
+    std::vector<std::string> files;
+    DIR *dir = ::opendir(shm_dir__);
+    if (dir == nullptr) {
+        std::cerr << "ipc-top: cannot open " << shm_dir__ << ": " << std::strerror(errno) << "\n";
+        return files;
+    }
+    std::string pattern = std::string{shm_tag__} + stats_tag__;
+    std::string typed   = std::string{shm_tag__} + typed_tag__;
+    while (auto ent = ::readdir(dir)) {
+        std::string file {ent->d_name};
+        if ((file.find(pattern) == std::string::npos) && (file.find(typed) == std::string::npos)) continue;
+        if (!filter.empty() && (channel_name(file).find(filter) == std::string::npos)) continue;
+        files.push_back(std::move(file));
+    }
+    ::closedir(dir);
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+std::string human(double n) {
+    char const *units[] = {"", "K", "M", "G", "T"};
+    int u = 0;
+    while ((n >= 1000.0) && (u < 4)) {
+        n /= 1000.0;
+        ++u;
+    }
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision((u == 0) ? 0 : 1) << n << units[u];
+    return ss.str();
+}
+
+std::string human_ns(std::uint64_t ns) {
+    char const *units[] = {"ns", "us", "ms", "s"};
+    double n = static_cast<double>(ns);
+    int u = 0;
+    while ((n >= 1000.0) && (u < 3)) {
+        n /= 1000.0;
+        ++u;
+    }
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision((u == 0) ? 0 : 1) << n << units[u];
+    return ss.str();
+}
+
+bool process_alive(std::uint32_t pid) {
+    return (::kill(static_cast<pid_t>(pid), 0) == 0) || (errno != ESRCH);
+}
+
+void print_channel(std::string const & name, ipc::stats::channel const & st,
+                   totals_t & last, double secs, bool verbose) {
+    totals_t now;
+    std::uint64_t parks = 0, fails = 0;
+    for (auto const & p : st.producers) {
+        now.sent  += p.messages    .load(std::memory_order_relaxed);
+        now.bytes += p.bytes       .load(std::memory_order_relaxed);
+        now.force += p.force_pushes.load(std::memory_order_relaxed);
+        parks     += p.parks       .load(std::memory_order_relaxed);
+        fails     += p.failures    .load(std::memory_order_relaxed);
+    }
+    unsigned receivers = 0;
+    std::uint64_t depth = 0;
+    for (auto const & r : st.receivers) {
+        auto pid = r.pid.load(std::memory_order_relaxed);
+        if (pid == 0) continue;
+        ++receivers;
+        now.recv += r.messages.load(std::memory_order_relaxed);
+        depth = (std::max)(depth, st.depth(r));
+    }
+    auto lat  = st.latency();
+    auto rate = [secs](std::uint64_t curr, std::uint64_t prev) {
+        return (secs <= 0.0 || curr < prev) ? 0.0 : static_cast<double>(curr - prev) / secs;
+    };
+    std::cout << std::left  << std::setw(32) << name
+              << std::right << std::setw(5)  << receivers
+              << std::setw(9)  << human(rate(now.sent , last.sent ))
+              << std::setw(9)  << human(rate(now.bytes, last.bytes))
+              << std::setw(9)  << human(rate(now.recv , last.recv ))
+              << std::setw(6)  << depth << "/" << std::left << std::setw(5) << st.ring_size.load(std::memory_order_relaxed)
+              << std::right
+              << std::setw(7)  << st.chunks.load(std::memory_order_relaxed)
+              << std::setw(8)  << human(static_cast<double>(now.force))
+              << std::setw(8)  << human(static_cast<double>(parks))
+              << std::setw(8)  << human(static_cast<double>(fails))
+              << std::setw(9)  << ((lat.count == 0) ? std::string{"-"} : human_ns(lat.p99))
+              << "\n";
+    if (verbose) {
+        for (std::size_t i = 0; i < ipc::stats::receiver_max; ++i) {
+            auto const & r = st.receivers[i];
+            auto pid = r.pid.load(std::memory_order_relaxed);
+            if (pid == 0) continue;
+            std::cout << "    #" << std::left << std::setw(3) << i
+                      << "pid " << std::setw(8) << pid << (process_alive(pid) ? "" : "(dead) ")
+                      << std::right
+                      << " recv " << std::setw(8) << human(static_cast<double>(r.messages.load(std::memory_order_relaxed)))
+                      << " depth " << std::setw(5) << st.depth(r)
+                      << " skipped " << std::setw(7) << human(static_cast<double>(r.skipped.load(std::memory_order_relaxed)))
+                      << " lost " << std::setw(7) << human(static_cast<double>(r.lost.load(std::memory_order_relaxed)))
+                      << " parks " << std::setw(7) << human(static_cast<double>(r.parks.load(std::memory_order_relaxed)));
+            auto ls = st.latency(i);
+            if (ls.count != 0) {
+                std::cout << " latency p50 " << human_ns(ls.p50)  << " p99 " << human_ns(ls.p99)
+                          << " p99.9 "       << human_ns(ls.p999) << " max " << human_ns(ls.max);
+            }
+            std::cout << "\n";
+        }
+    }
+    last = now;
+}
+
+} // namespace
+
+int main(int argc, char ** argv) {
+    long interval = 1000; // ms
+    long count    = -1;
+    bool verbose  = false;
+    std::string filter;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg {argv[i]};
+        if ((arg == "-i") && (i + 1 < argc)) {
+            interval = (std::max)(std::atol(argv[++i]), 10l);
+        }
+        else if ((arg == "-n") && (i + 1 < argc)) {
+            count = std::atol(argv[++i]);
+        }
+        else if (arg == "-v") {
+            verbose = true;
+        }
+        else if ((arg == "-h") || (arg == "--help")) {
+            std::cout << "usage: " << argv[0] << " [-i interval_ms] [-n iterations] [-v] [name-filter]\n";
+            return 0;
+        }
+        else filter = arg;
+    }
+
+    auto exit = [](int) {
+        is_quit__.store(true, std::memory_order_release);
+    };
+    ::signal(SIGINT , exit);
+    ::signal(SIGTERM, exit);
+    ::signal(SIGHUP , exit);
+
+    std::map<std::string, totals_t> last;
+    auto tp = std::chrono::steady_clock::now();
+    for (long k = 0; !is_quit__.load(std::memory_order_acquire) && (count < 0 || k < count); ++k) {
+        auto now  = std::chrono::steady_clock::now();
+        double secs = std::chrono::duration<double>(now - tp).count();
+        tp = now;
+        if (count != 1) std::cout << "\x1b[H\x1b[2J";
+        std::cout << std::left  << std::setw(32) << "CHANNEL"
+                  << std::right << std::setw(5) << "RECV"
+                  << std::setw(9) << "MSG/s" << std::setw(9) << "B/s" << std::setw(9) << "RMSG/s"
+                  << std::setw(12) << "DEPTH/RING" << std::setw(7) << "CHUNKS"
+                  << std::setw(8) << "FORCE" << std::setw(8) << "PARKS" << std::setw(8) << "FAILS" << std::setw(9) << "P99" << "\n";
+        std::map<std::string, totals_t> curr;
+        for (auto const & file : list_channels(filter)) {
+            mapping mem {file};
+            auto st = mem.get();
+            if (st == nullptr) continue;
+            auto it = last.find(file);
+            totals_t t = (it == last.end()) ? totals_t{} : it->second;
+            print_channel(channel_name(file), *st, t, (it == last.end()) ? 0.0 : secs, verbose);
+            curr[file] = t;
+        }
+        std::cout << std::flush;
+        last.swap(curr);
+        if (count >= 0 && k + 1 >= count) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+    }
+    return 0;
+}